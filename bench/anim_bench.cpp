@@ -0,0 +1,91 @@
+﻿#include "bench.h"
+
+#include <string>
+#include <vector>
+#include <cmath>
+#include <fbx_binary.h>
+#ifndef BENCH_NO_FBXSDK
+#include <fbx.h>
+#endif
+
+namespace bench {
+
+    namespace {
+        //アニメーションの全ノードをボーンとして持つメッシュ
+        fbx::ModelMesh MakeAllBoneMesh(const std::vector<std::string>& node_name_list) {
+            fbx::ModelMesh mesh;
+            mesh.boneNodeNameList = node_name_list;
+            mesh.invBoneBaseposeMatrixList.assign(node_name_list.size(), glm::mat4(1.0f));
+            return mesh;
+        }
+
+        //インスタンスごとに少しずつずらした時刻でボーン行列を求め、1回あたりの時間(us)を返す
+        template<class Loader>
+        double MeasureBoneMatrix(const Loader& loader, const fbx::ModelMesh& mesh, int instance_count, float end_frame) {
+            std::vector<glm::mat4> matrix_list(mesh.boneNodeNameList.size());
+            double ms = Measure(3, [&]() {
+                for (int i = 0; i < instance_count; i++) {
+                    float frame = std::fmod(i * 0.37f, end_frame);
+                    loader.GetAnimationBoneMatrix(matrix_list.data(), frame, mesh, (int)matrix_list.size(), 0);
+                }
+            });
+            return ms * 1000.0 / instance_count;
+        }
+
+        void PrintHeader(const char* name, int bone_count) {
+            printf("[%s] bones:%d\n", name, bone_count);
+            printf("%10s %14s %14s %10s\n", "instances", "old[us/call]", "baked[us/call]", "speedup");
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    void RunAnimationBenchmark(const char* resource_dir) {
+        printf("---- baked animation ----------------------------\n");
+        std::string anim_path = std::string(resource_dir) + "oma_2_anim.fbx";
+        const int instance_counts[] = { 1, 100, 10000 };
+
+        fbx::binary::BinaryFbxLoader curve_loader;
+        fbx::binary::BinaryFbxLoader baked_loader;
+        fbx::BakeOption bake_option;
+        bake_option.enable = true;
+        baked_loader.SetBakeOption(bake_option);
+        if (!curve_loader.LoadAnimation(anim_path.c_str()) || !baked_loader.LoadAnimation(anim_path.c_str())) {
+            printf("load failed: %s\n", anim_path.c_str());
+            return;
+        }
+
+        const auto& scene = curve_loader.GetAnimationArray()[0];
+        std::vector<std::string> node_name_list;
+        for (const auto& node : scene.nodeList) {
+            node_name_list.push_back(node.name);
+        }
+        auto mesh = MakeAllBoneMesh(node_name_list);
+        float end_frame = std::max(1.0f, scene.GetAnimationEndFrame());
+
+        PrintHeader("binary", (int)node_name_list.size());
+        for (int instance_count : instance_counts) {
+            double old_us = MeasureBoneMatrix(curve_loader, mesh, instance_count, end_frame);
+            double baked_us = MeasureBoneMatrix(baked_loader, mesh, instance_count, end_frame);
+            printf("%10d %14.3f %14.3f %10.2f\n", instance_count, old_us, baked_us, old_us / baked_us);
+        }
+        printf("clip keys:%d memory:%.1f KB\n", baked_loader.GetAnimationArray()[0].clip.GetKeyCount(), baked_loader.GetAnimationArray()[0].clip.GetKeyMemorySize() / 1024.0);
+
+#ifndef BENCH_NO_FBXSDK
+        //FBX SDKのEvaluateGlobalTransformとの比較
+        fbx::FbxLoader sdk_loader;
+        fbx::FbxLoader sdk_baked_loader;
+        sdk_baked_loader.SetBakeOption(bake_option);
+        if (!sdk_loader.Initialize(anim_path.c_str(), anim_path.c_str()) || !sdk_baked_loader.Initialize(anim_path.c_str(), anim_path.c_str())) {
+            printf("sdk load failed: %s\n", anim_path.c_str());
+            return;
+        }
+        PrintHeader("sdk", (int)node_name_list.size());
+        for (int instance_count : instance_counts) {
+            double old_us = MeasureBoneMatrix(sdk_loader, mesh, instance_count, end_frame);
+            double baked_us = MeasureBoneMatrix(sdk_baked_loader, mesh, instance_count, end_frame);
+            printf("%10d %14.3f %14.3f %10.2f\n", instance_count, old_us, baked_us, old_us / baked_us);
+        }
+#endif
+    }
+    //------------------------------------------------------------------------------------------
+} // bench
@@ -0,0 +1,142 @@
+﻿#include "bench.h"
+#include "scene_generator.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <arena.h>
+#include <geometry_arena.h>
+#include <fbx_binary.h>
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+
+namespace bench {
+
+    namespace {
+        struct ArenaResult {
+            double loadMs;
+            //読み込み前からの増え方。プロセス全体のピークは前の計測に引きずられるので差で見る
+            double peakBytes;
+            double steadyBytes;
+            double arenaBytes;
+            double scratchPeakBytes;
+            //新しいプロセスで測ったかどうか。forkしただけの子は親が触ったヒープを使い回すので、ピークと読み込み後の増え方が小さく出る
+            int freshProcess;
+        };
+
+        //------------------------------------------------------------------------------------------
+        bool LoadScene(ArenaResult* out_result, const std::string& path, bool use_arena) {
+            size_t base_rss = GetCurrentRss();
+            fbx::binary::BinaryFbxLoader loader;
+            fbx::ArenaOption option;
+            option.enable = use_arena;
+            loader.SetArenaOption(option);
+            Timer timer;
+            if (!loader.Initialize(path.c_str(), nullptr)) {
+                return false;
+            }
+            out_result->loadMs = timer.ElapsedMs();
+            out_result->peakBytes = (double)GetPeakRss() - (double)base_rss;
+            out_result->steadyBytes = (double)GetCurrentRss() - (double)base_rss;
+            out_result->arenaBytes = (double)loader.GetGeometryArena().GetUsedBytes();
+            out_result->scratchPeakBytes = (double)fbx::GetScratchArena()->GetPeakBytes();
+            out_result->freshProcess = 0;
+            return true;
+        }
+        //------------------------------------------------------------------------------------------
+        //ピークRSSを前の計測と混ぜないよう、Linuxでは自分を--arena-measureで起動し直した新しいプロセスで読み込む
+        //起動し直せなければforkした子でそのまま読み込む
+        bool MeasureScene(ArenaResult* out_result, const std::string& path, bool use_arena) {
+#ifdef _WIN32
+            return LoadScene(out_result, path, use_arena);
+#else
+            int pipe_fd[2];
+            if (pipe(pipe_fd) != 0) {
+                return false;
+            }
+            pid_t pid = fork();
+            if (pid < 0) {
+                close(pipe_fd[0]);
+                close(pipe_fd[1]);
+                return false;
+            }
+            if (pid == 0) {
+                close(pipe_fd[0]);
+                std::string fd_text = std::to_string(pipe_fd[1]);
+                execl("/proc/self/exe", "bench", "--arena-measure", path.c_str(), use_arena ? "1" : "0", fd_text.c_str(), (char*)nullptr);
+                ArenaResult result;
+                bool success = LoadScene(&result, path, use_arena);
+                if (success && write(pipe_fd[1], &result, sizeof(result)) != (ssize_t)sizeof(result)) {
+                    success = false;
+                }
+                close(pipe_fd[1]);
+                _exit(success ? 0 : 1);
+            }
+            close(pipe_fd[1]);
+            bool success = (read(pipe_fd[0], out_result, sizeof(*out_result)) == (ssize_t)sizeof(*out_result));
+            close(pipe_fd[0]);
+            int status = 0;
+            waitpid(pid, &status, 0);
+            return success && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+#endif
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    int RunArenaMeasureProcess(const char* path, bool use_arena, int fd) {
+#ifdef _WIN32
+        (void)path;
+        (void)use_arena;
+        (void)fd;
+        return 1;
+#else
+        ArenaResult result;
+        bool success = LoadScene(&result, path, use_arena);
+        result.freshProcess = 1;
+        if (success && write(fd, &result, sizeof(result)) != (ssize_t)sizeof(result)) {
+            success = false;
+        }
+        close(fd);
+        return success ? 0 : 1;
+#endif
+    }
+    //------------------------------------------------------------------------------------------
+    void RunArenaBenchmark(const SceneSpec& spec) {
+        //差が見えるように大きめのシーンにする
+        SceneSpec arena_spec = spec;
+        arena_spec.meshCount = std::max(spec.meshCount, 16);
+        arena_spec.triangleCount = std::max(spec.triangleCount, 50000);
+        arena_spec.clipFrameCount = 0;
+        std::string suite = "arena/" + arena_spec.GetName();
+        printf("---- arena %s ----\n", arena_spec.GetName().c_str());
+
+        std::string path = "bench_arena_" + arena_spec.GetName() + ".fbx";
+        if (!WriteSceneFbx(path.c_str(), arena_spec)) {
+            return;
+        }
+        const char* name_list[] = { "vector", "arena" };
+        for (int i = 0; i < 2; i++) {
+            ArenaResult result;
+            if (!MeasureScene(&result, path, i == 1)) {
+                printf("  %-8s failed\n", name_list[i]);
+                continue;
+            }
+            const double mb = 1024.0 * 1024.0;
+            printf("  %-8s load %9.3f ms  peak +%8.2f MB  steady +%8.2f MB  arena %8.2f MB  scratch peak %8.2f MB\n", name_list[i],
+                result.loadMs, result.peakBytes / mb, result.steadyBytes / mb, result.arenaBytes / mb, result.scratchPeakBytes / mb);
+            if (!result.freshProcess) {
+                printf("  %-8s warning: not measured in a fresh process, peak/steady include heap reused from earlier suites\n", name_list[i]);
+            }
+            std::string prefix = name_list[i];
+            Report(suite.c_str(), prefix + "/load", result.loadMs, "ms");
+            Report(suite.c_str(), prefix + "/peak_rss", result.peakBytes, "bytes");
+            Report(suite.c_str(), prefix + "/steady_rss", result.steadyBytes, "bytes");
+            Report(suite.c_str(), prefix + "/arena", result.arenaBytes, "bytes");
+            Report(suite.c_str(), prefix + "/scratch_peak", result.scratchPeakBytes, "bytes");
+        }
+        std::remove(path.c_str());
+    }
+    //------------------------------------------------------------------------------------------
+}
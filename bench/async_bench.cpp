@@ -0,0 +1,137 @@
+﻿#include "bench.h"
+#include "scene_generator.h"
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include <weld.h>
+#include <async_load.h>
+#include <fbx_binary.h>
+#ifndef BENCH_NO_FBXSDK
+#include <fbx.h>
+#endif
+
+namespace bench {
+
+    namespace {
+        //格子状のメッシュを溶接して作るだけのローダー。メッシュの多いファイルの代わりに使う
+        class SyntheticLoader
+        {
+        public:
+            static const int kMeshCount = 32;
+            static const int kSide = 96;
+
+            SyntheticLoader() : mLoadListener(nullptr) {}
+
+            //ファイルは読まないので引数は使わない
+            bool Initialize(const char*, const char*) {
+                for (int mesh = 0; mesh < kMeshCount; mesh++) {
+                    if (this->mLoadListener != nullptr && this->mLoadListener->IsCanceled()) {
+                        return false;
+                    }
+                    auto corner_list = MakeGridCornerList(kSide, (size_t)kSide * kSide, (float)mesh);
+                    fbx::ModelMesh model_mesh;
+                    model_mesh.nodeName = "mesh" + std::to_string(mesh);
+                    fbx::WeldVertices(&model_mesh, corner_list, fbx::WeldOption());
+                    this->mMeshList.push_back(model_mesh);
+                    if (this->mLoadListener != nullptr && this->mLoadListener->onMesh) {
+                        this->mLoadListener->onMesh(this->mMeshList.size() - 1, this->mMeshList.back());
+                    }
+                }
+                return true;
+            }
+            void SetLoadListener(const fbx::LoadListener* listener) {
+                this->mLoadListener = listener;
+            }
+            const std::vector<fbx::ModelMesh>& GetMeshList() const {
+                return this->mMeshList;
+            }
+        private:
+            std::vector<fbx::ModelMesh> mMeshList;
+            const fbx::LoadListener* mLoadListener;
+        };
+
+        //同期読み込みの時間と、非同期での最初のメッシュまでの時間・全体の時間
+        template<class Loader>
+        void MeasureAsync(const char* name, const std::string& path) {
+            size_t mesh_count = 0;
+            double blocking_ms = Measure(3, [&]() {
+                Loader loader;
+                loader.Initialize(path.c_str(), nullptr);
+                mesh_count = loader.GetMeshList().size();
+            });
+
+            double first_ms = 1e30;
+            double total_ms = 1e30;
+            fbx::AsyncLoader async_loader(1);
+            for (int i = 0; i < 3; i++) {
+                auto task = async_loader.Load<Loader>(path.c_str(), nullptr, fbx::LoadListener(), 0);
+                task->Wait();
+                if (task->GetFirstMeshTime() >= 0.0) {
+                    first_ms = std::min(first_ms, task->GetFirstMeshTime());
+                }
+                total_ms = std::min(total_ms, task->GetTotalTime());
+            }
+            if (first_ms > total_ms) {
+                first_ms = -1.0;
+            }
+            printf("[%s] %-32s meshes:%3d blocking:%8.2f ms  async first mesh:%8.2f ms total:%8.2f ms\n",
+                name, path.c_str(), (int)mesh_count, blocking_ms, first_ms, total_ms);
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    void RunAsyncBenchmark(const char* resource_dir) {
+        printf("---- async load ---------------------------------\n");
+        const std::string path_list[] = { std::string(resource_dir) + "oma_2.fbx", std::string(resource_dir) + "oma_2_anim.fbx" };
+        for (const auto& path : path_list) {
+            MeasureAsync<fbx::binary::BinaryFbxLoader>("binary", path);
+#ifndef BENCH_NO_FBXSDK
+            MeasureAsync<fbx::FbxLoader>("sdk", path);
+#endif
+        }
+        MeasureAsync<SyntheticLoader>("synthetic", "32 meshes");
+
+        //優先度: 低い優先度の読み込みが8件待っている所に高い優先度の読み込みを足す
+        {
+            fbx::AsyncLoader async_loader(1);
+            std::vector<std::shared_ptr<fbx::AsyncLoadTask<SyntheticLoader>>> low_list;
+            for (int i = 0; i < 8; i++) {
+                low_list.push_back(async_loader.Load<SyntheticLoader>("low", nullptr, fbx::LoadListener(), 0));
+            }
+            auto high = async_loader.Load<SyntheticLoader>("high", nullptr, fbx::LoadListener(), 10);
+            high->Wait();
+            double high_ms = high->GetTotalTime();
+            for (auto& task : low_list) {
+                task->Wait();
+            }
+            double last_low_ms = 0.0;
+            for (auto& task : low_list) {
+                last_low_ms = std::max(last_low_ms, task->GetTotalTime());
+            }
+            printf("priority: high priority done after %.2f ms, 8 low priority done after %.2f ms\n", high_ms, last_low_ms);
+        }
+
+        //中止: 最初のメッシュが届いたら中止して、止まるまでの時間を測る
+        {
+            fbx::AsyncLoader async_loader(1);
+            std::atomic<bool> first(false);
+            fbx::LoadListener listener;
+            listener.onMesh = [&first](size_t, const fbx::ModelMesh&) {
+                first.store(true);
+            };
+            auto task = async_loader.Load<SyntheticLoader>("cancel", nullptr, listener, 0);
+            while (!first.load()) {
+                std::this_thread::yield();
+            }
+            Timer timer;
+            task->Cancel();
+            task->Wait();
+            printf("cancel: stopped after %.2f ms, %d/%d meshes delivered, state:%s\n", timer.ElapsedMs(),
+                (int)task->GetDeliveredMeshCount(), SyntheticLoader::kMeshCount, task->GetState() == fbx::kAsyncLoadCanceled ? "canceled" : "not canceled");
+        }
+    }
+    //------------------------------------------------------------------------------------------
+}
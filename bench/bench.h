@@ -0,0 +1,147 @@
+﻿/********************************************************/
+/*          ベンチマーク共通部分                        */
+/********************************************************/
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <cstddef>
+#include <string>
+#include <algorithm>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <unistd.h>
+#include <sys/resource.h>
+#endif
+
+namespace bench{
+
+struct SceneSpec;
+
+class Timer
+{
+public:
+    Timer() : mStart(std::chrono::steady_clock::now()) {}
+
+    double ElapsedMs() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mStart).count();
+    }
+private:
+    std::chrono::steady_clock::time_point mStart;
+};
+
+//repeat回実行して一番速かった時間(ms)を返す
+template<class Func>
+double Measure(int repeat, Func func) {
+    double best = 1e30;
+    for (int i = 0; i < repeat; i++) {
+        Timer timer;
+        func();
+        best = std::min(best, timer.ElapsedMs());
+    }
+    return best;
+}
+
+//プロセスのピークRSS(バイト)
+inline size_t GetPeakRss() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return (size_t)counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        return (size_t)usage.ru_maxrss * 1024;
+    }
+    return 0;
+#endif
+}
+
+//今のRSS(バイト)
+inline size_t GetCurrentRss() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return (size_t)counters.WorkingSetSize;
+    }
+    return 0;
+#else
+    long pages = 0;
+    long resident = 0;
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (file == nullptr) {
+        return 0;
+    }
+    if (fscanf(file, "%ld %ld", &pages, &resident) != 2) {
+        resident = 0;
+    }
+    fclose(file);
+    return (size_t)resident * (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+//fullがtrueなら時間のかかるケース(旧実装での大きなメッシュなど)も計測する
+void RunWeldBenchmark(bool full);
+//バイナリFBXの直接読み込みとFBX SDK経由の読み込みの比較
+void RunBinaryBenchmark(const char* resource_dir);
+//メッシュ解析のスレッド数ごとの速度。scene_pathはメッシュの多いFBXを指定する
+void RunParallelBenchmark(const char* scene_path);
+//カーブ評価とベイク済みクリップでのボーン行列の計算時間
+void RunAnimationBenchmark(const char* resource_dir);
+//クリップの圧縮率・誤差・デコード速度
+void RunCompressionBenchmark(const char* resource_dir);
+//200ボーンでの名前検索と結び付け済みの姿勢計算の比較
+void RunBindingBenchmark();
+//Skeletonを使った1回の走査での姿勢計算
+void RunSkeletonBenchmark();
+//CPUスキニングのカーネルごと・スレッド数ごとの頂点/秒
+void RunSkinningBenchmark();
+//群衆の姿勢の一括計算と1体ずつの呼び出しの比較
+void RunCrowdBenchmark();
+//サンプルと生成した大きなシーンでの、キャッシュが無い時(最初の起動)・ある時(2回目以降)のInitializeの時間
+void RunCacheBenchmark(const char* resource_dir, const SceneSpec& spec);
+//非同期読み込みでの最初のメッシュまでの時間・優先度・中止
+void RunAsyncBenchmark(const char* resource_dir);
+//読み込みの区間ごとの時間とChromeのトレース出力
+void RunProfileBenchmark(const char* resource_dir);
+//生成したシーンでの区間ごとの読み込み時間・メモリ・姿勢の計算時間
+void RunSceneBenchmark(const SceneSpec& spec);
+//生成したシーンのメッシュでの頂点キャッシュの並べ替えの効果(ACMR/ATVR)と時間
+void RunOptimizeBenchmark(const SceneSpec& spec);
+//10万三角形以上のメッシュでのLOD生成の時間と、各段の三角形数・誤差
+void RunLodBenchmark(const SceneSpec& spec);
+//サンプルと生成したシーンでのメッシュレットの生成時間と、法線の円錐で除ける三角形の割合
+void RunMeshletBenchmark(const char* resource_dir, const SceneSpec& spec);
+//アニメーションの範囲の表を引く時間と、スキニングして箱を作る時間の比較。範囲からはみ出す頂点も数える
+void RunBoundsBenchmark(const SceneSpec& spec);
+//大きなシーンでのピーク・読み込み後のメモリの、vectorのままとアリーナに詰め直した時の比較
+void RunArenaBenchmark(const SceneSpec& spec);
+//RunArenaBenchmarkが--arena-measure path use_arena fdで起動し直したプロセスの処理。1つ読み込んで結果をfdに書く
+int RunArenaMeasureProcess(const char* path, bool use_arena, int fd);
+//静的なメッシュとスキンメッシュが半分ずつのシーンでの、頂点の形式ごとの大きさ・溶接時間・誤差
+void RunFormatBenchmark(const SceneSpec& spec);
+//FBX SDKのシーンとマネージャーを解放する前後の、アセットごとのRSSと取り出し済みデータの大きさ
+void RunDetachBenchmark(const char* resource_dir);
+//生成した同じモデルとアニメーションを使う50体を、ローダーごとに読む時と登録簿で共有する時の読み込み回数・ヒット率・メモリ
+void RunRegistryBenchmark(const SceneSpec& spec);
+//60チャンネルのブレンドシェイプを持つメッシュでの、差分を疎に持つ時と全頂点分持つ時の大きさと、カーネルごとの適用時間
+void RunBlendShapeBenchmark(const SceneSpec& spec);
+//接線の生成時間と、QTangent・半精度UV・16bitウェイト・量子化した位置で詰めた頂点の大きさと誤差
+void RunPackedBenchmark(const SceneSpec& spec);
+//1つのメッシュを複数のノードに置いたシーンでの、まとめない時・Geometryでまとめる時・中身でまとめる時の読み込み時間とメッシュの大きさ
+void RunInstanceBenchmark(const SceneSpec& spec);
+
+//計測結果を1件記録する。mainに--jsonを渡すと最後にまとめて書き出す
+void Report(const char* suite, const std::string& name, double value, const char* unit);
+bool WriteReport(const char* filepath);
+
+}
@@ -0,0 +1,73 @@
+﻿#include "bench.h"
+
+#include <string>
+#include <cstring>
+#include <fbx_binary.h>
+#ifndef BENCH_NO_FBXSDK
+#include <fbx.h>
+#endif
+
+namespace bench {
+
+#ifndef BENCH_NO_FBXSDK
+    namespace {
+        //頂点とインデックスがバイト単位で同じかどうか
+        bool IsSameMeshList(const std::vector<fbx::ModelMesh>& a, const std::vector<fbx::ModelMesh>& b) {
+            if (a.size() != b.size()) {
+                return false;
+            }
+            for (size_t i = 0; i < a.size(); i++) {
+                if (a[i].vertexList.size() != b[i].vertexList.size()
+                    || a[i].indexList != b[i].indexList
+                    || a[i].indexList32 != b[i].indexList32) {
+                    return false;
+                }
+                if (!a[i].vertexList.empty() && std::memcmp(a[i].vertexList.data(), b[i].vertexList.data(), a[i].vertexList.size() * sizeof(fbx::ModelVertex)) != 0) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+#endif
+
+    //------------------------------------------------------------------------------------------
+    void RunBinaryBenchmark(const char* resource_dir) {
+        printf("---- binary fbx ---------------------------------\n");
+        std::string model_path = std::string(resource_dir) + "oma_2.fbx";
+        std::string anim_path = std::string(resource_dir) + "oma_2_anim.fbx";
+        const std::string path_list[] = { model_path, anim_path };
+
+        //ピークRSSはプロセス全体の値なので、直接読み込みを先に測る
+        for (const auto& path : path_list) {
+            bool ok = false;
+            size_t mesh_count = 0;
+            double ms = Measure(5, [&]() {
+                fbx::binary::BinaryFbxLoader loader;
+                ok = loader.Initialize(path.c_str(), anim_path.c_str());
+                mesh_count = loader.GetMeshList().size();
+            });
+            printf("[binary] %-40s %s %8.3f ms meshes:%d peakRSS:%.1f MB\n", path.c_str(), ok ? "ok  " : "fail", ms, (int)mesh_count, GetPeakRss() / (1024.0 * 1024.0));
+        }
+
+#ifndef BENCH_NO_FBXSDK
+        for (const auto& path : path_list) {
+            fbx::binary::BinaryFbxLoader binary_loader;
+            bool binary_ok = binary_loader.Initialize(path.c_str(), anim_path.c_str());
+
+            fbx::FbxLoader* sdk_loader = nullptr;
+            bool sdk_ok = false;
+            double ms = Measure(1, [&]() {
+                sdk_loader = new fbx::FbxLoader();
+                sdk_ok = sdk_loader->Initialize(path.c_str(), anim_path.c_str());
+            });
+            printf("[sdk]    %-40s %s %8.3f ms meshes:%d peakRSS:%.1f MB\n", path.c_str(), sdk_ok ? "ok  " : "fail", ms, (int)sdk_loader->GetMeshList().size(), GetPeakRss() / (1024.0 * 1024.0));
+            if (binary_ok && sdk_ok) {
+                printf("         vertex/index identical: %s\n", IsSameMeshList(binary_loader.GetMeshList(), sdk_loader->GetMeshList()) ? "yes" : "NO");
+            }
+            delete sdk_loader;
+        }
+#endif
+    }
+    //------------------------------------------------------------------------------------------
+} // bench
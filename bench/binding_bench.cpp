@@ -0,0 +1,292 @@
+﻿#include "bench.h"
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <thread>
+#include <fbx_binary.h>
+
+namespace bench {
+
+    namespace {
+        //mAnimationArrayに直接シーンを入れるためのローダー
+        class SceneLoader : public fbx::binary::BinaryFbxLoader
+        {
+        public:
+            void AddAnimation(const fbx::binary::AnimationScene& scene) {
+                this->mAnimationArray.push_back(scene);
+            }
+        };
+
+        //背骨と手足4本の木構造で、全ノードの回転にカーブを持つシーン
+        fbx::binary::AnimationScene MakeSyntheticScene(int bone_count, float end_frame) {
+            fbx::binary::AnimationScene scene;
+            scene.animationStartFrame = 0.0f;
+            scene.animationEndFrame = end_frame;
+            int spine_count = std::max(1, bone_count / 3);
+            for (int i = 0; i < bone_count; i++) {
+                fbx::binary::AnimationNode node;
+                node.name = "bone" + std::to_string(i);
+                if (i == 0) {
+                    node.parent = -1;
+                }
+                else if (i < spine_count) {
+                    node.parent = i - 1;
+                }
+                else {
+                    int limb = (i - spine_count) % 4;
+                    int previous = i - 4;
+                    node.parent = previous >= spine_count ? previous : (spine_count - 1) * (limb + 1) / 4;
+                }
+                node.translation = glm::vec3(0.0f, 10.0f, 0.0f);
+                node.rotation = glm::vec3(0.0f);
+                node.scaling = glm::vec3(1.0f);
+                node.preRotation = glm::vec3(0.0f);
+                node.postRotation = glm::vec3(0.0f);
+                node.rotationOffset = glm::vec3(0.0f);
+                node.rotationPivot = glm::vec3(0.0f);
+                node.scalingOffset = glm::vec3(0.0f);
+                node.scalingPivot = glm::vec3(0.0f);
+                node.rotationOrder = 0;
+                node.rotationActive = false;
+                for (int c = 0; c < 9; c++) {
+                    node.curve[c] = -1;
+                }
+                //回転XYZに5フレームごとのキーを打つ
+                for (int c = 0; c < 3; c++) {
+                    fbx::binary::AnimationCurve curve;
+                    for (float frame = 0.0f; frame <= end_frame; frame += 5.0f) {
+                        curve.keyFrameList.push_back(frame);
+                        curve.keyValueList.push_back(30.0f * std::sin(frame * 0.05f * (1 + c) + i * 0.7f));
+                        curve.keyConstantList.push_back(0);
+                    }
+                    node.curve[3 + c] = (int)scene.curveList.size();
+                    scene.curveList.push_back(curve);
+                }
+                scene.nodeIdDictionaryAnimation.insert({ node.name, i });
+                scene.nodeList.push_back(node);
+            }
+            return scene;
+        }
+
+        //1フレーム分のボーン行列を求めるのにかかる時間(us)
+        template<class Func>
+        double MeasurePerFrame(int frame_count, float end_frame, Func func) {
+            double ms = Measure(3, [&]() {
+                for (int i = 0; i < frame_count; i++) {
+                    func(std::fmod(i * 0.37f, end_frame));
+                }
+            });
+            return ms * 1000.0 / frame_count;
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    void RunBindingBenchmark() {
+        printf("---- skeleton binding ---------------------------\n");
+        const int bone_count = 200;
+        const float end_frame = 600.0f;
+
+        auto scene = MakeSyntheticScene(bone_count, end_frame);
+        fbx::ModelMesh mesh;
+        mesh.nodeName = scene.nodeList[0].name;
+        for (const auto& node : scene.nodeList) {
+            mesh.boneNodeNameList.push_back(node.name);
+        }
+        mesh.invBoneBaseposeMatrixList.assign(bone_count, glm::mat4(1.0f));
+
+        SceneLoader curve_loader;
+        curve_loader.AddAnimation(scene);
+        fbx::BakeOption bake_option;
+        bake_option.enable = true;
+        fbx::binary::BakeAnimationScene(&scene, bake_option);
+        SceneLoader baked_loader;
+        baked_loader.AddAnimation(scene);
+
+        printf("bones:%d\n", bone_count);
+        printf("%8s %16s %16s %10s %12s\n", "source", "name[us/frame]", "bind[us/frame]", "speedup", "max diff");
+        const SceneLoader* loader_list[] = { &curve_loader, &baked_loader };
+        const char* source_name[] = { "curve", "baked" };
+        for (int l = 0; l < 2; l++) {
+            const auto& loader = *loader_list[l];
+            fbx::SkeletonBinding binding;
+            Timer bind_timer;
+            if (!loader.CreateSkeletonBinding(&binding, mesh, 0)) {
+                printf("binding failed\n");
+                return;
+            }
+            double bind_us = bind_timer.ElapsedMs() * 1000.0;
+
+            std::vector<glm::mat4> name_matrix_list(bone_count);
+            std::vector<glm::mat4> bind_matrix_list(bone_count);
+            int frame_count = (l == 0) ? 200 : 2000;
+            double name_us = MeasurePerFrame(frame_count, end_frame, [&](float frame) {
+                loader.GetAnimationBoneMatrix(name_matrix_list.data(), frame, mesh, bone_count, 0);
+            });
+            double bind_frame_us = MeasurePerFrame(frame_count, end_frame, [&](float frame) {
+                loader.GetAnimationBoneMatrix(bind_matrix_list.data(), frame, mesh, binding);
+            });
+
+            //両方の結果が一致するか確かめる
+            float max_diff = 0.0f;
+            for (float frame = 0.0f; frame < end_frame; frame += 17.3f) {
+                loader.GetAnimationBoneMatrix(name_matrix_list.data(), frame, mesh, bone_count, 0);
+                loader.GetAnimationBoneMatrix(bind_matrix_list.data(), frame, mesh, binding);
+                for (int b = 0; b < bone_count; b++) {
+                    for (int j = 0; j < 16; j++) {
+                        max_diff = std::max(max_diff, std::abs(name_matrix_list[b][j / 4][j % 4] - bind_matrix_list[b][j / 4][j % 4]));
+                    }
+                }
+            }
+            printf("%8s %16.2f %16.2f %10.2f %12g (bind:%.1fus)\n", source_name[l], name_us, bind_frame_us, name_us / bind_frame_us, max_diff, bind_us);
+        }
+
+        //見つからないボーンは作る時に報告され、姿勢の計算では単位行列になる
+        fbx::ModelMesh missing_mesh = mesh;
+        missing_mesh.boneNodeNameList[bone_count - 1] = "missing_bone";
+        fbx::SkeletonBinding missing_binding;
+        bool bound = baked_loader.CreateSkeletonBinding(&missing_binding, missing_mesh, 0);
+        printf("missing bone: bound=%d missing=%d\n", (int)bound, (int)missing_binding.missingBoneList.size());
+    }
+    //------------------------------------------------------------------------------------------
+    void RunSkeletonBenchmark() {
+        printf("---- skeleton pose ------------------------------\n");
+        const int bone_count = 200;
+        const float end_frame = 600.0f;
+
+        auto scene = MakeSyntheticScene(bone_count, end_frame);
+        fbx::ModelMesh mesh;
+        mesh.nodeName = scene.nodeList[0].name;
+        std::vector<std::string> joint_name_list;
+        std::vector<int> parent_list;
+        std::vector<glm::mat4> rest_local_list;
+        for (int i = 0; i < bone_count; i++) {
+            joint_name_list.push_back(scene.nodeList[i].name);
+            parent_list.push_back(scene.nodeList[i].parent);
+            rest_local_list.push_back(scene.EvaluateLocalTransform(i, -1.0f));
+            mesh.boneNodeNameList.push_back(scene.nodeList[i].name);
+            mesh.invBoneBaseposeMatrixList.push_back(glm::inverse(scene.EvaluateGlobalTransform(i, -1.0f)));
+        }
+        mesh.skeleton.Initialize(joint_name_list, parent_list, rest_local_list, mesh.boneNodeNameList, mesh.invBoneBaseposeMatrixList);
+
+        SceneLoader curve_loader;
+        curve_loader.AddAnimation(scene);
+        fbx::BakeOption bake_option;
+        bake_option.enable = true;
+        fbx::binary::BakeAnimationScene(&scene, bake_option);
+        SceneLoader baked_loader;
+        baked_loader.AddAnimation(scene);
+
+        printf("bones:%d\n", bone_count);
+        printf("%8s %16s %16s %16s %12s\n", "source", "name[us/frame]", "bind[us/frame]", "pose[us/frame]", "max diff");
+        const SceneLoader* loader_list[] = { &curve_loader, &baked_loader };
+        const char* source_name[] = { "curve", "baked" };
+        for (int l = 0; l < 2; l++) {
+            const auto& loader = *loader_list[l];
+            fbx::SkeletonBinding binding;
+            loader.CreateSkeletonBinding(&binding, mesh, 0);
+
+            std::vector<glm::mat4> name_matrix_list(bone_count);
+            std::vector<glm::mat4> bind_matrix_list(bone_count);
+            std::vector<glm::mat4> palette(bone_count);
+            int frame_count = (l == 0) ? 200 : 2000;
+            double name_us = MeasurePerFrame(frame_count, end_frame, [&](float frame) {
+                loader.GetAnimationBoneMatrix(name_matrix_list.data(), frame, mesh, bone_count, 0);
+            });
+            double bind_us = MeasurePerFrame(frame_count, end_frame, [&](float frame) {
+                loader.GetAnimationBoneMatrix(bind_matrix_list.data(), frame, mesh, binding);
+            });
+            double pose_us = MeasurePerFrame(frame_count, end_frame, [&](float frame) {
+                loader.GetAnimationPose(palette.data(), nullptr, frame, mesh, binding);
+            });
+
+            float max_diff = 0.0f;
+            for (float frame = 0.0f; frame < end_frame; frame += 17.3f) {
+                loader.GetAnimationBoneMatrix(name_matrix_list.data(), frame, mesh, bone_count, 0);
+                loader.GetAnimationPose(palette.data(), nullptr, frame, mesh, binding);
+                for (int b = 0; b < bone_count; b++) {
+                    for (int j = 0; j < 16; j++) {
+                        max_diff = std::max(max_diff, std::abs(name_matrix_list[b][j / 4][j % 4] - palette[b][j / 4][j % 4]));
+                    }
+                }
+            }
+            printf("%8s %16.2f %16.2f %16.2f %12g\n", source_name[l], name_us, bind_us, pose_us, max_diff);
+        }
+
+        //ローカル行列がそろっている時の階層の走査だけの時間
+        std::vector<glm::mat4> global_list(bone_count);
+        std::vector<glm::mat4> palette(bone_count);
+        const int solve_count = 20000;
+        double solve_ms = Measure(3, [&]() {
+            for (int i = 0; i < solve_count; i++) {
+                mesh.skeleton.SolvePose(rest_local_list.data(), global_list.data(), palette.data());
+            }
+        });
+        printf("solve only: %.2f us/frame\n", solve_ms * 1000.0 / solve_count);
+    }
+    //------------------------------------------------------------------------------------------
+    void RunCrowdBenchmark() {
+        printf("---- crowd pose batch ---------------------------\n");
+        //群衆用の軽いリグに長さの違うクリップを4つ
+        const int bone_count = 40;
+        const int clip_count = 4;
+        SceneLoader loader;
+        fbx::ModelMesh mesh;
+        fbx::BakeOption bake_option;
+        bake_option.enable = true;
+        for (int c = 0; c < clip_count; c++) {
+            auto scene = MakeSyntheticScene(bone_count, 120.0f * (c + 1));
+            if (c == 0) {
+                std::vector<std::string> joint_name_list;
+                std::vector<int> parent_list;
+                std::vector<glm::mat4> rest_local_list;
+                for (int i = 0; i < bone_count; i++) {
+                    joint_name_list.push_back(scene.nodeList[i].name);
+                    parent_list.push_back(scene.nodeList[i].parent);
+                    rest_local_list.push_back(scene.EvaluateLocalTransform(i, -1.0f));
+                    mesh.boneNodeNameList.push_back(scene.nodeList[i].name);
+                    mesh.invBoneBaseposeMatrixList.push_back(glm::inverse(scene.EvaluateGlobalTransform(i, -1.0f)));
+                }
+                mesh.skeleton.Initialize(joint_name_list, parent_list, rest_local_list, mesh.boneNodeNameList, mesh.invBoneBaseposeMatrixList);
+            }
+            fbx::binary::BakeAnimationScene(&scene, bake_option);
+            loader.AddAnimation(scene);
+        }
+        std::vector<fbx::SkeletonBinding> binding_list;
+        loader.CreateSkeletonBindingList(&binding_list, mesh);
+
+        int max_thread = std::max(1, (int)std::thread::hardware_concurrency());
+        fbx::ThreadPool thread_pool(max_thread);
+        printf("bones:%d clips:%d threads:%d\n", bone_count, clip_count, max_thread);
+        printf("%10s %14s %14s %14s %10s\n", "instances", "per-call[ms]", "batch 1T[ms]", "batch[ms]", "speedup");
+        const int instance_counts[] = { 1000, 10000, 100000 };
+        for (int instance_count : instance_counts) {
+            //インスタンスごとにばらばらなクリップと時刻
+            std::vector<fbx::PoseRequest> request_list(instance_count);
+            unsigned int seed = 7;
+            for (int i = 0; i < instance_count; i++) {
+                seed = seed * 1103515245u + 12345u;
+                int anim_index = (seed >> 16) % clip_count;
+                seed = seed * 1103515245u + 12345u;
+                float end_frame = loader.GetAnimationArray()[anim_index].GetAnimationEndFrame();
+                request_list[i] = { i, anim_index, ((seed >> 8) & 0xFFFF) / 65536.0f * end_frame };
+            }
+            std::vector<glm::mat4> palette_list((size_t)instance_count * bone_count);
+            int repeat = instance_count >= 100000 ? 1 : 3;
+
+            double per_call_ms = Measure(repeat, [&]() {
+                for (const auto& request : request_list) {
+                    loader.GetAnimationBoneMatrix(&palette_list[(size_t)request.instance * bone_count], request.frame, mesh, bone_count, request.animIndex);
+                }
+            });
+            double batch_serial_ms = Measure(repeat, [&]() {
+                loader.GetAnimationPoseBatch(palette_list.data(), mesh, binding_list, request_list.data(), request_list.size(), nullptr);
+            });
+            double batch_ms = Measure(repeat, [&]() {
+                loader.GetAnimationPoseBatch(palette_list.data(), mesh, binding_list, request_list.data(), request_list.size(), &thread_pool);
+            });
+            printf("%10d %14.2f %14.2f %14.2f %10.2f\n", instance_count, per_call_ms, batch_serial_ms, batch_ms, per_call_ms / batch_ms);
+        }
+    }
+    //------------------------------------------------------------------------------------------
+} // bench
@@ -0,0 +1,169 @@
+﻿#include "bench.h"
+#include "scene_generator.h"
+
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <blend_shape.h>
+#include <skinning.h>
+#include <fbx_binary.h>
+
+namespace bench {
+
+    namespace {
+        //全頂点の差分を持つ今までの持ち方。[ターゲット][頂点]
+        std::vector<fbx::ModelBlendShapeDelta> MakeDenseDeltaList(const fbx::ModelMesh& mesh) {
+            size_t vertex_count = mesh.GetVertexSpan().size();
+            std::vector<fbx::ModelBlendShapeDelta> dense_list(fbx::GetBlendShapeTargetCount(mesh) * vertex_count);
+            std::fill(dense_list.begin(), dense_list.end(), fbx::ModelBlendShapeDelta{ glm::vec3(0.0f), glm::vec3(0.0f) });
+            size_t target_index = 0;
+            for (const auto& channel : mesh.blendShapeList) {
+                for (const auto& target : channel.targetList) {
+                    for (size_t i = 0; i < target.deltaList.size(); i++) {
+                        dense_list[target_index * vertex_count + target.vertexIndexList[i]] = target.deltaList[i];
+                    }
+                    target_index++;
+                }
+            }
+            return dense_list;
+        }
+        //------------------------------------------------------------------------------------------
+        void ApplyDense(fbx::ModelVertex* out_vertex_list, const fbx::ModelMesh& mesh, const std::vector<fbx::ModelBlendShapeDelta>& dense_list, const float* target_weight_list) {
+            auto vertex_list = mesh.GetVertexSpan();
+            std::copy(vertex_list.begin(), vertex_list.end(), out_vertex_list);
+            size_t target_count = fbx::GetBlendShapeTargetCount(mesh);
+            for (size_t t = 0; t < target_count; t++) {
+                float weight = target_weight_list[t];
+                if (weight == 0.0f) {
+                    continue;
+                }
+                const fbx::ModelBlendShapeDelta* delta = dense_list.data() + t * vertex_list.size();
+                for (size_t v = 0; v < vertex_list.size(); v++) {
+                    out_vertex_list[v].position += delta[v].position * weight;
+                    out_vertex_list[v].normal += delta[v].normal * weight;
+                }
+            }
+        }
+        //------------------------------------------------------------------------------------------
+        float GetMaxDiff(const std::vector<fbx::ModelVertex>& a, const std::vector<fbx::ModelVertex>& b) {
+            float max_diff = 0.0f;
+            for (size_t i = 0; i < a.size() && i < b.size(); i++) {
+                for (int k = 0; k < 3; k++) {
+                    max_diff = std::max(max_diff, std::abs(a[i].position[k] - b[i].position[k]));
+                    max_diff = std::max(max_diff, std::abs(a[i].normal[k] - b[i].normal[k]));
+                }
+                max_diff = std::max(max_diff, std::abs(a[i].uv.x - b[i].uv.x) + std::abs(a[i].uv.y - b[i].uv.y));
+            }
+            return max_diff;
+        }
+        //------------------------------------------------------------------------------------------
+        //頂点の順番によらずに比べられるように、uv(生成したシーンではコントロールポイントごとに違う)の順に並べる
+        std::vector<fbx::ModelVertex> SortByUv(std::vector<fbx::ModelVertex> vertex_list) {
+            std::sort(vertex_list.begin(), vertex_list.end(), [](const fbx::ModelVertex& a, const fbx::ModelVertex& b) {
+                return a.uv.x != b.uv.x ? a.uv.x < b.uv.x : a.uv.y < b.uv.y;
+            });
+            return vertex_list;
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    void RunBlendShapeBenchmark(const SceneSpec& spec) {
+        //顔のメッシュ1つに60チャンネル。全チャンネルのDeformPercentにキーが入る
+        SceneSpec face_spec = spec;
+        face_spec.meshCount = 1;
+        face_spec.boneCount = std::max(1, std::min(spec.boneCount, 16));
+        face_spec.clipFrameCount = std::max(spec.clipFrameCount, 60);
+        face_spec.blendShapeCount = 60;
+        printf("---- blend shape %s ----\n", face_spec.GetName().c_str());
+        std::string path = "bench_blendshape_" + face_spec.GetName() + ".fbx";
+        if (!WriteSceneFbx(path.c_str(), face_spec)) {
+            return;
+        }
+        //並べ替えなしと並べ替えありで読み、頂点番号の付け替えを確かめる
+        fbx::binary::BinaryFbxLoader loader;
+        fbx::binary::BinaryFbxLoader optimized_loader;
+        fbx::OptimizeOption optimize_option;
+        optimize_option.enable = true;
+        optimized_loader.SetOptimizeOption(optimize_option);
+        bool result = loader.Initialize(path.c_str(), path.c_str()) && optimized_loader.Initialize(path.c_str(), path.c_str());
+        std::remove(path.c_str());
+        if (!result || loader.GetMeshList().empty() || loader.GetAnimationArray().empty()) {
+            printf("load failed\n");
+            return;
+        }
+        const auto& mesh = optimized_loader.GetMeshList()[0];
+        size_t vertex_count = mesh.GetVertexSpan().size();
+        size_t channel_count = mesh.blendShapeList.size();
+        size_t target_count = fbx::GetBlendShapeTargetCount(mesh);
+        size_t delta_count = 0;
+        for (const auto& channel : mesh.blendShapeList) {
+            for (const auto& target : channel.targetList) {
+                delta_count += target.deltaList.size();
+            }
+        }
+        const double mb = 1024.0 * 1024.0;
+        size_t sparse_bytes = fbx::GetBlendShapeMemorySize(mesh);
+        size_t dense_bytes = fbx::GetBlendShapeDenseMemorySize(mesh);
+        printf("  %d vertices  %d channels  %d targets  %.1f deltas/target  curves %d\n", (int)vertex_count, (int)channel_count, (int)target_count,
+            target_count == 0 ? 0.0 : (double)delta_count / target_count, (int)optimized_loader.GetAnimationArray()[0].blendShapeCurveList.size());
+        printf("  memory  sparse %8.3f MB  dense %8.3f MB  (%.1f%%)\n", sparse_bytes / mb, dense_bytes / mb, dense_bytes == 0 ? 0.0 : 100.0 * sparse_bytes / dense_bytes);
+        Report("blendshape", "sparse_bytes", (double)sparse_bytes, "bytes");
+        Report("blendshape", "dense_bytes", (double)dense_bytes, "bytes");
+        if (target_count == 0) {
+            return;
+        }
+
+        //アニメーションの途中の重み。全チャンネルが動いている
+        std::vector<float> channel_weight_list(channel_count);
+        optimized_loader.GetAnimationBlendShapeWeight(channel_weight_list.data(), 30.0f, mesh, 0);
+        std::vector<float> target_weight_list(target_count);
+        fbx::GetBlendShapeTargetWeights(target_weight_list.data(), mesh, channel_weight_list.data());
+        int active_count = (int)std::count_if(target_weight_list.begin(), target_weight_list.end(), [](float weight) { return weight != 0.0f; });
+
+        //並べ替えの前後で同じ形になるか
+        {
+            const auto& plain_mesh = loader.GetMeshList()[0];
+            std::vector<float> plain_weight_list(plain_mesh.blendShapeList.size());
+            loader.GetAnimationBlendShapeWeight(plain_weight_list.data(), 30.0f, plain_mesh, 0);
+            std::vector<fbx::ModelVertex> plain_result(plain_mesh.GetVertexSpan().size());
+            std::vector<fbx::ModelVertex> optimized_result(vertex_count);
+            fbx::ApplyBlendShapes(plain_result.data(), plain_mesh, plain_weight_list.data());
+            fbx::ApplyBlendShapes(optimized_result.data(), mesh, channel_weight_list.data());
+            printf("  remap check (optimized vs plain): max diff %g\n", GetMaxDiff(SortByUv(plain_result), SortByUv(optimized_result)));
+        }
+
+        //カーネルごとの1回の適用の時間。全頂点の差分を持つ場合と比べる
+        auto dense_list = MakeDenseDeltaList(mesh);
+        std::vector<fbx::ModelVertex> reference(vertex_count);
+        std::vector<fbx::ModelVertex> output(vertex_count);
+        ApplyDense(reference.data(), mesh, dense_list, target_weight_list.data());
+        const int repeat = 50;
+        printf("[%d active targets]\n", active_count);
+        printf("%8s %12s %14s %12s\n", "kernel", "us/apply", "Mdeltas/s", "max diff");
+        double dense_ms = Measure(repeat, [&]() {
+            ApplyDense(output.data(), mesh, dense_list, target_weight_list.data());
+        });
+        printf("%8s %12.2f %14.1f %12s\n", "dense", dense_ms * 1000.0, (double)target_count * vertex_count / dense_ms / 1000.0, "-");
+        Report("blendshape", "dense/apply", dense_ms * 1000.0, "us");
+        auto default_kernel = fbx::GetSkinningKernel();
+        const fbx::SkinningKernel kernel_list[] = { fbx::kSkinningScalar, fbx::kSkinningSse41, fbx::kSkinningAvx2 };
+        for (auto kernel : kernel_list) {
+            const char* name = fbx::GetSkinningKernelName(kernel);
+            if (!fbx::SetSkinningKernel(kernel)) {
+                printf("%8s %12s\n", name, "unsupported");
+                continue;
+            }
+            double ms = Measure(repeat, [&]() {
+                fbx::ApplyBlendShapeTargets(output.data(), mesh, target_weight_list.data());
+            });
+            float max_diff = GetMaxDiff(output, reference);
+            printf("%8s %12.2f %14.1f %12g\n", name, ms * 1000.0, delta_count / ms / 1000.0, max_diff);
+            Report("blendshape", std::string(name) + "/apply", ms * 1000.0, "us");
+            Report("blendshape", std::string(name) + "/max_diff", max_diff, "abs");
+        }
+        fbx::SetSkinningKernel(default_kernel);
+    }
+    //------------------------------------------------------------------------------------------
+}
@@ -0,0 +1,160 @@
+﻿#include "bench.h"
+#include "scene_generator.h"
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <mesh_bounds.h>
+#include <skinning.h>
+#include <fbx_binary.h>
+
+namespace bench {
+
+    namespace {
+        //------------------------------------------------------------------------------------------
+        bool IsInside(const fbx::ModelBounds& bounds, const glm::vec3& point, float epsilon) {
+            for (int i = 0; i < 3; i++) {
+                if (point[i] < bounds.min[i] - epsilon || point[i] > bounds.max[i] + epsilon) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    void RunBoundsBenchmark(const SceneSpec& spec) {
+        //カリングの判定は1体ずつ行うので、メッシュ数は少なくてよい
+        SceneSpec bounds_spec = spec;
+        bounds_spec.meshCount = std::min(spec.meshCount, 2);
+        if (bounds_spec.clipFrameCount == 0) {
+            bounds_spec.clipFrameCount = 120;
+        }
+        std::string suite = "bounds/" + bounds_spec.GetName();
+        printf("---- bounds %s ----\n", bounds_spec.GetName().c_str());
+
+        std::string path = "bench_bounds_" + bounds_spec.GetName() + ".fbx";
+        if (!WriteSceneFbx(path.c_str(), bounds_spec)) {
+            return;
+        }
+        fbx::BakeOption bake_option;
+        bake_option.enable = true;
+
+        //表を作る分の読み込み時間
+        const float segment_length_list[] = { 1.0f, 8.0f };
+        for (int i = 0; i < 3; i++) {
+            fbx::binary::BinaryFbxLoader loader;
+            fbx::BoundsOption option;
+            option.animation = (i > 0);
+            option.segmentLength = (i > 0) ? segment_length_list[i - 1] : 1.0f;
+            loader.SetBakeOption(bake_option);
+            loader.SetBoundsOption(option);
+            Timer timer;
+            if (!loader.Initialize(path.c_str(), path.c_str())) {
+                std::remove(path.c_str());
+                return;
+            }
+            double load_ms = timer.ElapsedMs();
+            std::string name = option.animation ? "load/segment" + std::to_string((int)option.segmentLength) : std::string("load/plain");
+            printf("  %-12s %9.3f ms\n", name.c_str(), load_ms);
+            Report(suite.c_str(), name, load_ms, "ms");
+        }
+
+        for (float segment_length : segment_length_list) {
+            fbx::binary::BinaryFbxLoader loader;
+            fbx::BoundsOption option;
+            option.animation = true;
+            option.segmentLength = segment_length;
+            loader.SetBakeOption(bake_option);
+            loader.SetBoundsOption(option);
+            loader.Initialize(path.c_str(), path.c_str());
+            const auto& animation = loader.GetAnimationArray()[0];
+            float start_frame = animation.GetAnimationStartFrame();
+            float end_frame = animation.GetAnimationEndFrame();
+            std::string segment_name = "segment" + std::to_string((int)segment_length);
+
+            for (size_t m = 0; m < loader.GetMeshList().size(); m++) {
+                const auto& mesh = loader.GetMeshList()[m];
+                fbx::SkeletonBinding binding;
+                loader.CreateSkeletonBinding(&binding, mesh, 0);
+                std::vector<glm::mat4> palette(std::max<size_t>(mesh.boneNodeNameList.size(), 1));
+                std::vector<fbx::SkinnedVertex> skinned_list(mesh.vertexList.size());
+
+                //キーの間も確かめるため、フレームの間の時刻も使う
+                std::vector<float> frame_list;
+                for (float frame = start_frame; frame <= end_frame; frame += 0.5f) {
+                    frame_list.push_back(frame);
+                }
+
+                //今までのやり方: 姿勢を求めて全頂点をスキニングし、箱を作る
+                fbx::ModelBounds skinned_bounds;
+                double skin_ms = Measure(3, [&]() {
+                    for (float frame : frame_list) {
+                        loader.GetAnimationPose(palette.data(), nullptr, frame, mesh, binding);
+                        fbx::SkinMesh(skinned_list.data(), mesh, palette.data());
+                        skinned_bounds = fbx::ModelBounds();
+                        for (const auto& vertex : skinned_list) {
+                            fbx::ExtendBounds(&skinned_bounds, vertex.position);
+                        }
+                    }
+                });
+                //表が無い時: 姿勢を求めてボーンごとの範囲を移す
+                fbx::ModelBounds pose_bounds;
+                double pose_ms = Measure(3, [&]() {
+                    for (float frame : frame_list) {
+                        loader.GetAnimationPose(palette.data(), nullptr, frame, mesh, binding);
+                        fbx::ComputePoseBounds(&pose_bounds, mesh, palette.data());
+                    }
+                });
+                //表を引くだけ
+                fbx::ModelBounds table_bounds;
+                const int query_repeat = 100;
+                double query_ms = Measure(3, [&]() {
+                    for (int r = 0; r < query_repeat; r++) {
+                        for (float frame : frame_list) {
+                            loader.GetAnimationBounds(&table_bounds, frame, (int)m, 0);
+                        }
+                    }
+                });
+
+                //スキニングした頂点が範囲に入っているかと、範囲がどれだけ大きいか
+                int outside_count = 0;
+                double diagonal_ratio = 0.0;
+                for (float frame : frame_list) {
+                    loader.GetAnimationPose(palette.data(), nullptr, frame, mesh, binding);
+                    fbx::SkinMesh(skinned_list.data(), mesh, palette.data());
+                    loader.GetAnimationBounds(&table_bounds, frame, (int)m, 0);
+                    skinned_bounds = fbx::ModelBounds();
+                    for (const auto& vertex : skinned_list) {
+                        fbx::ExtendBounds(&skinned_bounds, vertex.position);
+                        if (!IsInside(table_bounds, vertex.position, 1e-4f)) {
+                            outside_count++;
+                        }
+                    }
+                    diagonal_ratio += glm::length(table_bounds.max - table_bounds.min) / std::max(glm::length(skinned_bounds.max - skinned_bounds.min), 1e-6f);
+                }
+                diagonal_ratio /= frame_list.size();
+
+                size_t frame_count = frame_list.size();
+                double skin_us = skin_ms * 1000.0 / frame_count;
+                double pose_us = pose_ms * 1000.0 / frame_count;
+                double query_ns = query_ms * 1e6 / (frame_count * query_repeat);
+                size_t table_bytes = animation.meshBoundsList[m].segmentBoundsList.size() * sizeof(fbx::ModelBounds);
+                printf("  %s mesh%d: %d vertices %d bones  skin+aabb %.2f us  pose+bounds %.2f us  table %.1f ns (%d bytes)  outside %d  diagonal x%.3f\n",
+                    segment_name.c_str(), (int)m, (int)mesh.vertexList.size(), (int)mesh.boneNodeNameList.size(), skin_us, pose_us, query_ns,
+                    (int)table_bytes, outside_count, diagonal_ratio);
+                std::string prefix = segment_name + "/mesh" + std::to_string(m);
+                Report(suite.c_str(), prefix + "/skin_aabb", skin_us, "us/frame");
+                Report(suite.c_str(), prefix + "/pose_bounds", pose_us, "us/frame");
+                Report(suite.c_str(), prefix + "/table_query", query_ns, "ns/frame");
+                Report(suite.c_str(), prefix + "/table_bytes", (double)table_bytes, "bytes");
+                Report(suite.c_str(), prefix + "/outside", outside_count, "count");
+                Report(suite.c_str(), prefix + "/diagonal_ratio", diagonal_ratio, "ratio");
+            }
+        }
+
+        std::remove(path.c_str());
+    }
+    //------------------------------------------------------------------------------------------
+}
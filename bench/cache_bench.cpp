@@ -0,0 +1,84 @@
+﻿#include "bench.h"
+#include "scene_generator.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <asset_cache.h>
+#include <fbx_binary.h>
+#ifndef BENCH_NO_FBXSDK
+#include <fbx.h>
+#endif
+
+namespace bench {
+
+    namespace {
+        //キャッシュを作らない時・作る時・読む時のInitializeの時間
+        template<class Loader>
+        void MeasureLoaderCache(const char* name, const std::string& path, const fbx::CacheOption& cache_option) {
+            std::string cache_path = fbx::GetAssetCachePath(path.c_str(), cache_option);
+            std::remove(cache_path.c_str());
+            size_t mesh_count = 0;
+            double no_cache_ms = Measure(1, [&]() {
+                Loader loader;
+                loader.Initialize(path.c_str(), nullptr);
+                mesh_count = loader.GetMeshList().size();
+            });
+            double cold_ms = Measure(1, [&]() {
+                Loader loader;
+                loader.SetCacheOption(cache_option);
+                loader.Initialize(path.c_str(), nullptr);
+            });
+            size_t warm_mesh_count = 0;
+            double warm_ms = Measure(5, [&]() {
+                Loader loader;
+                loader.SetCacheOption(cache_option);
+                loader.Initialize(path.c_str(), nullptr);
+                warm_mesh_count = loader.GetMeshList().size();
+            });
+            fbx::binary::MappedFile cache_file;
+            size_t cache_size = cache_file.Open(cache_path.c_str()) ? cache_file.GetSize() : 0;
+            cache_file.Close();
+            printf("[%s] %-32s meshes:%d/%d no cache:%.2f ms cold:%.2f ms warm:%.2f ms cache:%.1f KB\n",
+                name, path.c_str(), (int)mesh_count, (int)warm_mesh_count, no_cache_ms, cold_ms, warm_ms, cache_size / 1024.0);
+            std::remove(cache_path.c_str());
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    void RunCacheBenchmark(const char* resource_dir, const SceneSpec& spec) {
+        printf("---- asset cache --------------------------------\n");
+        //キャッシュはカレントディレクトリに作って最後に消す
+        fbx::CacheOption cache_option;
+        cache_option.enable = true;
+        cache_option.directory = ".";
+        const std::string path_list[] = { std::string(resource_dir) + "oma_2.fbx", std::string(resource_dir) + "oma_2_anim.fbx" };
+        for (const auto& path : path_list) {
+            MeasureLoaderCache<fbx::binary::BinaryFbxLoader>("binary", path, cache_option);
+#ifndef BENCH_NO_FBXSDK
+            MeasureLoaderCache<fbx::FbxLoader>("sdk", path, cache_option);
+#endif
+        }
+
+        //メッシュの多い大きなシーンを生成して、キャッシュの無い最初の起動と2回目以降の起動を比べる
+        SceneSpec cache_spec = spec;
+        cache_spec.meshCount = std::max(spec.meshCount, 64);
+        cache_spec.clipFrameCount = 0;
+        std::string scene_path = "bench_cache_" + cache_spec.GetName() + ".fbx";
+        if (WriteSceneFbx(scene_path.c_str(), cache_spec)) {
+            MeasureLoaderCache<fbx::binary::BinaryFbxLoader>("binary", scene_path, cache_option);
+#ifndef BENCH_NO_FBXSDK
+            MeasureLoaderCache<fbx::FbxLoader>("sdk", scene_path, cache_option);
+#endif
+            std::remove(scene_path.c_str());
+        }
+        //中身のハッシュの速度(キーを作るたびに元ファイル全体を読むので)
+        std::vector<uint8_t> hash_data(256 << 20, 1);
+        double hash_ms = Measure(3, [&]() {
+            volatile uint64_t hash = fbx::HashBytes(hash_data.data(), hash_data.size(), 0);
+            (void)hash;
+        });
+        printf("content hash: %.2f GB/s\n", hash_data.size() / (hash_ms / 1000.0) / (1024.0 * 1024.0 * 1024.0));
+    }
+    //------------------------------------------------------------------------------------------
+} // bench
@@ -0,0 +1,130 @@
+﻿#include "bench.h"
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <fbx_binary.h>
+#include <animation_compression.h>
+
+namespace bench {
+
+    namespace {
+        //背骨と手足4本の木構造で、ボーンごとに周期の違う揺れを与えたクリップ
+        fbx::AnimationClip MakeSyntheticClip(int bone_count, float seconds) {
+            std::vector<std::string> node_name_list;
+            std::vector<int> parent_list;
+            int spine_count = std::max(1, bone_count / 3);
+            for (int i = 0; i < bone_count; i++) {
+                node_name_list.push_back("bone" + std::to_string(i));
+                if (i == 0) {
+                    parent_list.push_back(-1);
+                }
+                else if (i < spine_count) {
+                    parent_list.push_back(i - 1);
+                }
+                else {
+                    //手足は背骨のどこかから生やして、そこから鎖状につなぐ
+                    int limb = (i - spine_count) % 4;
+                    int previous = i - 4;
+                    parent_list.push_back(previous >= spine_count ? previous : (spine_count - 1) * (limb + 1) / 4);
+                }
+            }
+
+            fbx::AnimationClip clip;
+            clip.Initialize(node_name_list, parent_list, 0.0f, seconds * 60.0f, 60.0f);
+            for (int key = 0; key < clip.GetKeyCount(); key++) {
+                float t = key / 60.0f;
+                for (int i = 0; i < bone_count; i++) {
+                    float phase = i * 0.7f;
+                    glm::vec3 axis = glm::normalize(glm::vec3(std::sin(phase), 1.0f, std::cos(phase * 1.3f)));
+                    float angle = 0.6f * std::sin(t * (1.0f + 0.13f * (i % 7)) + phase) + 0.1f * std::sin(t * 7.0f + phase);
+                    glm::quat rotation(std::cos(angle * 0.5f), axis.x * std::sin(angle * 0.5f), axis.y * std::sin(angle * 0.5f), axis.z * std::sin(angle * 0.5f));
+                    glm::vec3 translation = (i == 0) ? glm::vec3(t * 100.0f, 5.0f * std::sin(t * 3.0f), 0.0f) : glm::vec3(0.0f, 10.0f, 0.0f);
+                    clip.SetKey(i, key, fbx::ComposeMatrix(translation, rotation, glm::vec3(1.0f)));
+                }
+            }
+            return clip;
+        }
+
+        void ReportClip(const char* name, const fbx::AnimationClip& clip, const fbx::CompressOption& option) {
+            fbx::CompressedClip compressed;
+            Timer timer;
+            if (!fbx::CompressAnimationClip(&compressed, clip, option)) {
+                printf("%s: compress failed\n", name);
+                return;
+            }
+            double compress_ms = timer.ElapsedMs();
+
+            //キーの位置と、キーの間の位置で分けて元のクリップと比べる。許容誤差が保証されるのはキーの位置だけ
+            int node_count = clip.GetNodeCount();
+            std::vector<glm::mat4> reference(node_count);
+            std::vector<glm::mat4> decoded(node_count);
+            double error_sum[2] = { 0.0, 0.0 };
+            float error_max[2] = { 0.0f, 0.0f };
+            size_t error_count[2] = { 0, 0 };
+            for (int key = 0; key < clip.GetKeyCount(); key++) {
+                for (int between = 0; between < 2; between++) {
+                    //最後のキーの後ろは元のクリップも外挿になるので測らない
+                    if (between && key + 1 == clip.GetKeyCount()) {
+                        continue;
+                    }
+                    float frame = clip.GetKeyFrame(key) + between * 0.5f * 60.0f / clip.GetSampleRate();
+                    clip.EvaluatePose(frame, reference.data());
+                    compressed.EvaluatePose(frame, decoded.data());
+                    for (int n = 0; n < node_count; n++) {
+                        glm::vec4 diff = decoded[n][3] - reference[n][3];
+                        float error = std::sqrt(glm::dot(diff, diff));
+                        error_sum[between] += error;
+                        error_max[between] = std::max(error_max[between], error);
+                        error_count[between]++;
+                    }
+                }
+            }
+
+            //デコード速度。時刻はばらばらに取る
+            int pose_count = std::max(1000, 2000000 / std::max(1, node_count));
+            float duration = clip.GetAnimationEndFrame() - clip.GetAnimationStartFrame();
+            auto decode = [&](auto& source) {
+                return Measure(3, [&]() {
+                    for (int i = 0; i < pose_count; i++) {
+                        float frame = clip.GetAnimationStartFrame() + std::fmod(i * 7.31f, std::max(duration, 1.0f));
+                        source.EvaluatePose(frame, decoded.data());
+                    }
+                });
+            };
+            double raw_ms = decode(clip);
+            double compressed_ms = decode(compressed);
+            double bone_count = (double)pose_count * node_count;
+
+            size_t raw_key_count = (size_t)clip.GetKeyCount() * node_count * 3;
+            printf("[%s] nodes:%d keys:%d\n", name, node_count, clip.GetKeyCount());
+            printf("  memory      raw:%10.1f KB  compressed:%10.1f KB  ratio:%.1fx\n", clip.GetKeyMemorySize() / 1024.0, compressed.GetKeyMemorySize() / 1024.0, (double)clip.GetKeyMemorySize() / compressed.GetKeyMemorySize());
+            printf("  keys kept   %.1f%% (%d / %d)  compress:%.1f ms\n", 100.0 * compressed.GetKeyCount() / raw_key_count, (int)compressed.GetKeyCount(), (int)raw_key_count, compress_ms);
+            printf("  error key   max:%.5f  mean:%.5f  (tolerance %.5f)\n", error_max[0], error_sum[0] / std::max<size_t>(error_count[0], 1), option.errorTolerance);
+            printf("  error half  max:%.5f  mean:%.5f  (between keys, not bounded)\n", error_max[1], error_sum[1] / std::max<size_t>(error_count[1], 1));
+            printf("  decode      raw:%8.2f Mbones/s  compressed:%8.2f Mbones/s\n", bone_count / raw_ms / 1000.0, bone_count / compressed_ms / 1000.0);
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    void RunCompressionBenchmark(const char* resource_dir) {
+        printf("---- animation compression ----------------------\n");
+        fbx::CompressOption option;
+
+        std::string anim_path = std::string(resource_dir) + "oma_2_anim.fbx";
+        fbx::binary::BinaryFbxLoader loader;
+        fbx::BakeOption bake_option;
+        bake_option.enable = true;
+        loader.SetBakeOption(bake_option);
+        if (loader.LoadAnimation(anim_path.c_str())) {
+            ReportClip("oma_2_anim.fbx", loader.GetAnimationArray()[0].clip, option);
+        }
+        else {
+            printf("load failed: %s\n", anim_path.c_str());
+        }
+
+        ReportClip("synthetic 60 bones 60s", MakeSyntheticClip(60, 60.0f), option);
+        ReportClip("synthetic 200 bones 30s", MakeSyntheticClip(200, 30.0f), option);
+    }
+    //------------------------------------------------------------------------------------------
+} // bench
@@ -0,0 +1,87 @@
+﻿#include "bench.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <glm/glm.hpp>
+#ifndef BENCH_NO_FBXSDK
+#include <fbx.h>
+#endif
+
+namespace bench {
+
+#ifndef BENCH_NO_FBXSDK
+    namespace {
+        //ローダーが持ち続ける取り出し済みのデータのバイト数
+        size_t GetExtractedBytes(const fbx::FbxLoader& loader) {
+            size_t bytes = 0;
+            for (const auto& mesh : loader.GetMeshList()) {
+                bytes += mesh.GetVertexSpan().size() * sizeof(fbx::ModelVertex);
+                bytes += mesh.GetIndexSpan().size() * sizeof(unsigned short);
+                bytes += mesh.GetIndexSpan32().size() * sizeof(unsigned int);
+            }
+            for (const auto& animation : loader.GetAnimationArray()) {
+                bytes += animation.clip.GetKeyMemorySize();
+            }
+            return bytes;
+        }
+
+        //全メッシュ・全アニメーションのボーン行列を一通り求めて、結果を足し合わせる(切り離す前後で同じになること)
+        float SumBoneMatrix(const fbx::FbxLoader& loader) {
+            std::vector<glm::mat4> matrix_list;
+            float sum = 0.0f;
+            for (int anim = 0; anim < (int)loader.GetAnimationArray().size(); anim++) {
+                float frame = loader.GetAnimationArray()[anim].GetAnimationEndFrame() * 0.5f;
+                for (const auto& mesh : loader.GetMeshList()) {
+                    matrix_list.assign(std::max<size_t>(1, mesh.boneNodeNameList.size()), glm::mat4(1.0f));
+                    loader.GetAnimationBoneMatrix(matrix_list.data(), frame, mesh, (int)matrix_list.size(), anim);
+                    for (const auto& matrix : matrix_list) {
+                        sum += matrix[3][0] + matrix[3][1] + matrix[3][2];
+                    }
+                }
+            }
+            return sum;
+        }
+    }
+#endif
+
+    //------------------------------------------------------------------------------------------
+    void RunDetachBenchmark(const char* resource_dir) {
+        printf("---- detach -------------------------------------\n");
+#ifdef BENCH_NO_FBXSDK
+        printf("skipped (needs FBX SDK): %s\n", resource_dir);
+#else
+        std::string anim_path = std::string(resource_dir) + "oma_2_anim.fbx";
+        const std::string path_list[] = { std::string(resource_dir) + "oma_2.fbx", anim_path };
+        printf("%-40s %12s %12s %12s %12s\n", "asset", "RSS before", "RSS after", "released", "extracted");
+        for (const auto& path : path_list) {
+            size_t base_rss = GetCurrentRss();
+            fbx::FbxLoader loader;
+            fbx::BakeOption bake_option;
+            bake_option.enable = true;
+            loader.SetBakeOption(bake_option);
+            if (!loader.Initialize(path.c_str(), anim_path.c_str())) {
+                printf("load failed: %s\n", path.c_str());
+                continue;
+            }
+            float attached_sum = SumBoneMatrix(loader);
+            size_t before_rss = GetCurrentRss();
+            loader.Detach();
+            size_t after_rss = GetCurrentRss();
+            float detached_sum = SumBoneMatrix(loader);
+
+            //ローダーを作る前からの増え方で比べる
+            double before_mb = ((double)before_rss - (double)base_rss) / (1024.0 * 1024.0);
+            double after_mb = ((double)after_rss - (double)base_rss) / (1024.0 * 1024.0);
+            double extracted_mb = GetExtractedBytes(loader) / (1024.0 * 1024.0);
+            printf("%-40s %9.1f MB %9.1f MB %9.1f MB %9.1f MB %s\n", path.c_str(), before_mb, after_mb, before_mb - after_mb, extracted_mb,
+                attached_sum == detached_sum ? "same pose" : "POSE MISMATCH");
+            Report("detach", path + " rss before", before_mb, "MB");
+            Report("detach", path + " rss after", after_mb, "MB");
+            Report("detach", path + " extracted", extracted_mb, "MB");
+        }
+#endif
+    }
+    //------------------------------------------------------------------------------------------
+} // bench
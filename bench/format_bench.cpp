@@ -0,0 +1,141 @@
+﻿#include "bench.h"
+#include "scene_generator.h"
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <vertex_format.h>
+#include <weld.h>
+#include <fbx_binary.h>
+
+namespace bench {
+
+    namespace {
+        //形式ごとの合計
+        struct FormatTotal {
+            size_t vertexCount = 0;
+            size_t byteSize = 0;
+            //詰めた頂点の溶接だけの時間と、詰めるところからインデックスを写すまでの時間
+            double weldMs = 0.0;
+            double buildMs = 0.0;
+            //読み戻した時の最大の誤差
+            float normalError = 0.0f;
+            float uvError = 0.0f;
+            float weightError = 0.0f;
+        };
+
+        //------------------------------------------------------------------------------------------
+        template<class Format>
+        void AddMesh(FormatTotal* total, const fbx::ModelMesh& mesh) {
+            fbx::VertexBuffer<Format> buffer;
+            total->buildMs += Measure(3, [&]() {
+                fbx::BuildVertexBuffer(&buffer, mesh);
+            });
+            total->vertexCount += buffer.vertexList.size();
+            total->byteSize += buffer.GetByteSize();
+
+            auto vertex_list = mesh.GetVertexSpan();
+            std::vector<typename Format::Vertex> encoded_list(vertex_list.size());
+            for (size_t i = 0; i < vertex_list.size(); i++) {
+                Format::Encode(&encoded_list[i], vertex_list[i]);
+            }
+            total->weldMs += Measure(3, [&]() {
+                fbx::BasicVertexWelder<typename Format::Vertex> welder(encoded_list.size());
+                for (const auto& vertex : encoded_list) {
+                    welder.Add(vertex);
+                }
+            });
+            for (size_t i = 0; i < vertex_list.size(); i++) {
+                const auto& source = vertex_list[i];
+                fbx::ModelVertex decoded;
+                Format::Decode(&decoded, buffer.vertexList[buffer.remapList[i]]);
+                float cos_angle = glm::dot(glm::normalize(source.normal), glm::normalize(decoded.normal));
+                total->normalError = std::max(total->normalError, std::acos(std::min(std::max(cos_angle, -1.0f), 1.0f)) * 57.29578f);
+                total->uvError = std::max(total->uvError, std::max(std::fabs(source.uv.x - decoded.uv.x), std::fabs(source.uv.y - decoded.uv.y)));
+                if (Format::kSkinned) {
+                    for (int j = 0; j < 4; j++) {
+                        total->weightError = std::max(total->weightError, std::fabs(source.boneWeight[j] - decoded.boneWeight[j]));
+                    }
+                }
+            }
+        }
+        //------------------------------------------------------------------------------------------
+        void ReportTotal(const std::string& suite, const char* name, const FormatTotal& total, size_t base_size) {
+            printf("  %-8s vertices %7zu  %7.2f MB (%5.1f%%)  weld %7.3f ms  build %7.3f ms  normal %.3f deg  uv %.6f  weight %.4f\n", name,
+                total.vertexCount, total.byteSize / (1024.0 * 1024.0), base_size > 0 ? total.byteSize * 100.0 / base_size : 0.0, total.weldMs,
+                total.buildMs, total.normalError, total.uvError, total.weightError);
+            Report(suite.c_str(), std::string(name) + "/bytes", (double)total.byteSize, "bytes");
+            Report(suite.c_str(), std::string(name) + "/weld", total.weldMs, "ms");
+            Report(suite.c_str(), std::string(name) + "/build", total.buildMs, "ms");
+            Report(suite.c_str(), std::string(name) + "/normal_error", total.normalError, "deg");
+            Report(suite.c_str(), std::string(name) + "/weight_error", total.weightError, "ratio");
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    void RunFormatBenchmark(const SceneSpec& spec) {
+        //半分を静的なメッシュ、半分をスキンメッシュにする
+        SceneSpec skinned_spec = spec;
+        skinned_spec.meshCount = std::max(spec.meshCount / 2, 1);
+        skinned_spec.clipFrameCount = 0;
+        SceneSpec static_spec = skinned_spec;
+        static_spec.boneCount = 0;
+        std::string suite = "format/" + skinned_spec.GetName();
+        printf("---- vertex format %s + static ----\n", skinned_spec.GetName().c_str());
+
+        std::vector<fbx::ModelMesh> mesh_list;
+        const SceneSpec* spec_list[] = { &static_spec, &skinned_spec };
+        for (const SceneSpec* scene_spec : spec_list) {
+            std::string path = "bench_format_" + scene_spec->GetName() + ".fbx";
+            if (!WriteSceneFbx(path.c_str(), *scene_spec)) {
+                return;
+            }
+            fbx::binary::BinaryFbxLoader loader;
+            bool result = loader.Initialize(path.c_str(), nullptr);
+            std::remove(path.c_str());
+            if (!result) {
+                return;
+            }
+            mesh_list.insert(mesh_list.end(), loader.GetMeshList().begin(), loader.GetMeshList().end());
+        }
+
+        //ModelVertexのまま(ローダーの出力をそのまま上げた場合)
+        FormatTotal model_total;
+        for (const auto& mesh : mesh_list) {
+            std::vector<fbx::ModelVertex> vertex_list(mesh.vertexList.begin(), mesh.vertexList.end());
+            std::vector<fbx::ModelVertex> welded_list;
+            std::vector<unsigned int> index_list;
+            model_total.weldMs += Measure(3, [&]() {
+                fbx::WeldVertices(&welded_list, &index_list, vertex_list, fbx::WeldOption());
+            });
+            model_total.vertexCount += mesh.vertexList.size();
+            model_total.byteSize += mesh.vertexList.size() * sizeof(fbx::ModelVertex)
+                + mesh.indexList.size() * sizeof(unsigned short) + mesh.indexList32.size() * sizeof(unsigned int);
+        }
+        //全部を1つの形式にした場合と、メッシュごとに選んだ場合
+        FormatTotal full_total;
+        FormatTotal skinned_total;
+        FormatTotal mixed_total;
+        int static_count = 0;
+        for (const auto& mesh : mesh_list) {
+            AddMesh<fbx::FullVertexFormat>(&full_total, mesh);
+            AddMesh<fbx::SkinnedVertexFormat>(&skinned_total, mesh);
+            if (mesh.boneNodeNameList.empty()) {
+                AddMesh<fbx::StaticVertexFormat>(&mixed_total, mesh);
+                static_count++;
+            }
+            else {
+                AddMesh<fbx::SkinnedVertexFormat>(&mixed_total, mesh);
+            }
+        }
+        printf("  %d static + %d skinned meshes, stride ModelVertex %d / full %d / skinned %d / static %d bytes\n", static_count,
+            (int)mesh_list.size() - static_count, (int)sizeof(fbx::ModelVertex), (int)fbx::FullVertexFormat::kStride,
+            (int)fbx::SkinnedVertexFormat::kStride, (int)fbx::StaticVertexFormat::kStride);
+        ReportTotal(suite, "model", model_total, model_total.byteSize);
+        ReportTotal(suite, "full", full_total, model_total.byteSize);
+        ReportTotal(suite, "skinned", skinned_total, model_total.byteSize);
+        ReportTotal(suite, "mixed", mixed_total, model_total.byteSize);
+    }
+    //------------------------------------------------------------------------------------------
+}
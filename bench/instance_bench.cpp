@@ -0,0 +1,93 @@
+﻿#include "bench.h"
+#include "scene_generator.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <mesh_instance.h>
+#include <fbx_binary.h>
+
+namespace bench {
+
+    namespace {
+        //1回分の読み込みの結果
+        struct InstanceResult {
+            double loadMs = 0.0;
+            size_t meshCount = 0;
+            size_t instanceCount = 0;
+            size_t meshBytes = 0;
+            //インスタンスが参照する頂点数の合計。まとめ方によらず同じになること
+            size_t placedVertexCount = 0;
+        };
+
+        bool MeasureInstance(InstanceResult* out_result, const std::string& path, const fbx::InstanceOption& option) {
+            bool result = true;
+            out_result->loadMs = Measure(3, [&]() {
+                fbx::binary::BinaryFbxLoader loader;
+                loader.SetInstanceOption(option);
+                result = result && loader.Initialize(path.c_str(), nullptr);
+            });
+            fbx::binary::BinaryFbxLoader loader;
+            loader.SetInstanceOption(option);
+            if (!result || !loader.Initialize(path.c_str(), nullptr)) {
+                return false;
+            }
+            const auto& mesh_list = loader.GetMeshList();
+            out_result->meshCount = mesh_list.size();
+            out_result->instanceCount = loader.GetInstanceList().size();
+            out_result->meshBytes = fbx::GetInstanceMemorySize(loader.GetInstanceList());
+            for (const auto& mesh : mesh_list) {
+                out_result->meshBytes += mesh.GetVertexSpan().size() * sizeof(fbx::ModelVertex);
+                out_result->meshBytes += mesh.GetIndexSpan().size() * sizeof(unsigned short) + mesh.GetIndexSpan32().size() * sizeof(unsigned int);
+            }
+            for (const auto& instance : loader.GetInstanceList()) {
+                out_result->placedVertexCount += mesh_list[instance.meshIndex].GetVertexSpan().size();
+            }
+            return true;
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    void RunInstanceBenchmark(const SceneSpec& spec) {
+        //メッシュ1つを8つのノードに置く。4つは同じGeometry、3つは中身が同じ複製のGeometryを使う
+        SceneSpec instance_spec = spec;
+        instance_spec.instanceCount = std::max(spec.instanceCount, 7);
+        instance_spec.clipFrameCount = 0;
+        std::string suite = "instance/" + instance_spec.GetName();
+        printf("---- instance %s ----\n", instance_spec.GetName().c_str());
+
+        std::string path = "bench_instance_" + instance_spec.GetName() + ".fbx";
+        if (!WriteSceneFbx(path.c_str(), instance_spec)) {
+            return;
+        }
+        const char* name_list[] = { "off", "geometry", "content" };
+        fbx::InstanceOption option_list[3];
+        option_list[1].enable = true;
+        option_list[1].matchContent = false;
+        option_list[2].enable = true;
+        InstanceResult base_result;
+        for (int i = 0; i < 3; i++) {
+            InstanceResult result;
+            if (!MeasureInstance(&result, path, option_list[i])) {
+                printf("  %-8s failed\n", name_list[i]);
+                continue;
+            }
+            if (i == 0) {
+                base_result = result;
+            }
+            const double mb = 1024.0 * 1024.0;
+            printf("  %-8s load %9.3f ms (%5.2fx)  meshes %5zu  instances %5zu  mesh data %8.2f MB (%5.1f%%)  %s\n", name_list[i], result.loadMs,
+                result.loadMs > 0.0 ? base_result.loadMs / result.loadMs : 0.0, result.meshCount, result.instanceCount, result.meshBytes / mb,
+                base_result.meshBytes > 0 ? result.meshBytes * 100.0 / base_result.meshBytes : 0.0,
+                result.placedVertexCount == base_result.placedVertexCount ? "same placement" : "PLACEMENT MISMATCH");
+            std::string prefix = name_list[i];
+            Report(suite.c_str(), prefix + "/load", result.loadMs, "ms");
+            Report(suite.c_str(), prefix + "/meshes", (double)result.meshCount, "count");
+            Report(suite.c_str(), prefix + "/instances", (double)result.instanceCount, "count");
+            Report(suite.c_str(), prefix + "/mesh_bytes", (double)result.meshBytes, "bytes");
+        }
+        std::remove(path.c_str());
+    }
+    //------------------------------------------------------------------------------------------
+}
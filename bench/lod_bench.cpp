@@ -0,0 +1,83 @@
+﻿#include "bench.h"
+#include "scene_generator.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <mesh_simplify.h>
+#include <fbx_binary.h>
+
+namespace bench {
+
+    //------------------------------------------------------------------------------------------
+    void RunLodBenchmark(const SceneSpec& spec) {
+        //簡略化の時間は大きなメッシュで見たいので、1メッシュ10万三角形より小さければ引き上げる
+        SceneSpec lod_spec = spec;
+        lod_spec.triangleCount = std::max(spec.triangleCount, 100000);
+        lod_spec.meshCount = std::min(spec.meshCount, 2);
+        lod_spec.clipFrameCount = 0;
+        std::string suite = "lod/" + lod_spec.GetName();
+        printf("---- lod %s ----\n", lod_spec.GetName().c_str());
+
+        std::string path = "bench_lod_" + lod_spec.GetName() + ".fbx";
+        if (!WriteSceneFbx(path.c_str(), lod_spec)) {
+            return;
+        }
+        std::vector<fbx::ModelMesh> mesh_list;
+        {
+            fbx::binary::BinaryFbxLoader loader;
+            if (!loader.Initialize(path.c_str(), nullptr)) {
+                std::remove(path.c_str());
+                return;
+            }
+            mesh_list = loader.GetMeshList();
+        }
+
+        fbx::LodOption option;
+        option.enable = true;
+        option.levelCount = 4;
+        for (size_t i = 0; i < mesh_list.size(); i++) {
+            fbx::ModelMesh mesh;
+            size_t triangle_count = (mesh_list[i].indexList.size() + mesh_list[i].indexList32.size()) / 3;
+            double ms = Measure(3, [&]() {
+                mesh = mesh_list[i];
+                fbx::GenerateLodList(&mesh, option);
+            });
+            std::string prefix = "mesh" + std::to_string(i);
+            printf("  %s: %d triangles, %d vertices, %d levels in %.2f ms (%.2f Mtri/s)\n", prefix.c_str(), (int)triangle_count,
+                (int)mesh.vertexList.size(), (int)mesh.lodList.size(), ms, triangle_count / (ms * 1000.0));
+            Report(suite.c_str(), prefix + "/triangles", (double)triangle_count, "count");
+            Report(suite.c_str(), prefix + "/time", ms, "ms");
+
+            //1080p・縦60度で、メッシュの大きさの10倍の距離に置いた時の画面上の誤差
+            float extent = fbx::GetMeshExtent(mesh.vertexList.data(), mesh.vertexList.size());
+            for (size_t l = 0; l < mesh.lodList.size(); l++) {
+                const auto& lod = mesh.lodList[l];
+                size_t lod_triangle_count = (lod.indexList.size() + lod.indexList32.size()) / 3;
+                float pixel = fbx::GetLodScreenError(lod.error, extent * 10.0f, 1080.0f, 1.0472f);
+                printf("    LOD%d %8d triangles (%5.1f%%) error %.5f (%.3f%% of extent, %.2f px at 10x extent)\n", (int)l + 1, (int)lod_triangle_count,
+                    lod_triangle_count * 100.0 / triangle_count, lod.error, lod.error * 100.0f / extent, pixel);
+                std::string level = prefix + "/lod" + std::to_string(l + 1);
+                Report(suite.c_str(), level + "/triangles", (double)lod_triangle_count, "count");
+                Report(suite.c_str(), level + "/error", lod.error, "units");
+            }
+        }
+
+        //読み込み全体に対するLOD生成の割合
+        for (int i = 0; i < 2; i++) {
+            fbx::binary::BinaryFbxLoader loader;
+            fbx::LodOption load_option = option;
+            load_option.enable = (i == 1);
+            loader.SetLodOption(load_option);
+            Timer timer;
+            loader.Initialize(path.c_str(), nullptr);
+            double load_ms = timer.ElapsedMs();
+            const char* name = load_option.enable ? "load/lod" : "load/plain";
+            printf("  %-12s %9.3f ms\n", name, load_ms);
+            Report(suite.c_str(), name, load_ms, "ms");
+        }
+
+        std::remove(path.c_str());
+    }
+    //------------------------------------------------------------------------------------------
+}
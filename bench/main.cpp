@@ -0,0 +1,139 @@
+﻿#include "bench.h"
+#include "scene_generator.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+int main(int argc, char** argv)
+{
+    if (argc == 5 && std::strcmp(argv[1], "--arena-measure") == 0) {
+        return bench::RunArenaMeasureProcess(argv[2], std::atoi(argv[3]) != 0, std::atoi(argv[4]));
+    }
+    bool full = false;
+    const char* resource_dir = "../FBXLoader/Resources/";
+    const char* scene_path = nullptr;
+    const char* json_path = nullptr;
+    const char* suite = nullptr;
+    bench::SceneSpec spec;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--full") == 0) {
+            full = true;
+        }
+        else if (std::strcmp(argv[i], "--resource") == 0 && i + 1 < argc) {
+            resource_dir = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--scene") == 0 && i + 1 < argc) {
+            scene_path = argv[++i];
+        }
+        //結果をJSONで書き出す
+        else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        }
+        //指定した1つだけ実行する(weld, binary, ..., lod, meshlet, bounds, arena, format, detach, registry, blendshape, packed, instance)
+        else if (std::strcmp(argv[i], "--suite") == 0 && i + 1 < argc) {
+            suite = argv[++i];
+        }
+        //生成するシーンの大きさ
+        else if (std::strcmp(argv[i], "--meshes") == 0 && i + 1 < argc) {
+            spec.meshCount = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--triangles") == 0 && i + 1 < argc) {
+            spec.triangleCount = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--bones") == 0 && i + 1 < argc) {
+            spec.boneCount = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--weights") == 0 && i + 1 < argc) {
+            spec.weightsPerVertex = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            spec.clipFrameCount = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            spec.seed = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        }
+    }
+    auto run = [suite](const char* name) {
+        return suite == nullptr || std::strcmp(suite, name) == 0;
+    };
+
+    if (run("weld")) {
+        bench::RunWeldBenchmark(full);
+    }
+    if (run("binary")) {
+        bench::RunBinaryBenchmark(resource_dir);
+    }
+    std::string default_scene = std::string(resource_dir) + "oma_2.fbx";
+    if (run("parallel")) {
+        bench::RunParallelBenchmark(scene_path ? scene_path : default_scene.c_str());
+    }
+    if (run("animation")) {
+        bench::RunAnimationBenchmark(resource_dir);
+    }
+    if (run("compression")) {
+        bench::RunCompressionBenchmark(resource_dir);
+    }
+    if (run("binding")) {
+        bench::RunBindingBenchmark();
+    }
+    if (run("skeleton")) {
+        bench::RunSkeletonBenchmark();
+    }
+    if (run("skinning")) {
+        bench::RunSkinningBenchmark();
+    }
+    if (run("crowd")) {
+        bench::RunCrowdBenchmark();
+    }
+    if (run("cache")) {
+        bench::RunCacheBenchmark(resource_dir, spec);
+    }
+    if (run("async")) {
+        bench::RunAsyncBenchmark(resource_dir);
+    }
+    if (run("profile")) {
+        bench::RunProfileBenchmark(resource_dir);
+    }
+    if (run("scene")) {
+        bench::RunSceneBenchmark(spec);
+    }
+    if (run("optimize")) {
+        bench::RunOptimizeBenchmark(spec);
+    }
+    if (run("lod")) {
+        bench::RunLodBenchmark(spec);
+    }
+    if (run("meshlet")) {
+        bench::RunMeshletBenchmark(resource_dir, spec);
+    }
+    if (run("bounds")) {
+        bench::RunBoundsBenchmark(spec);
+    }
+    if (run("arena")) {
+        bench::RunArenaBenchmark(spec);
+    }
+    if (run("format")) {
+        bench::RunFormatBenchmark(spec);
+    }
+    if (run("detach")) {
+        bench::RunDetachBenchmark(resource_dir);
+    }
+    if (run("registry")) {
+        bench::RunRegistryBenchmark(spec);
+    }
+    if (run("blendshape")) {
+        bench::RunBlendShapeBenchmark(spec);
+    }
+    if (run("packed")) {
+        bench::RunPackedBenchmark(spec);
+    }
+    if (run("instance")) {
+        bench::RunInstanceBenchmark(spec);
+    }
+
+    if (json_path != nullptr && !bench::WriteReport(json_path)) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,139 @@
+﻿#include "bench.h"
+#include "scene_generator.h"
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <meshlet.h>
+#include <mesh_simplify.h>
+#include <fbx_binary.h>
+
+namespace bench {
+
+    namespace {
+        //メッシュを囲む球の上に均等に置いたカメラの位置(フィボナッチ格子)
+        std::vector<glm::vec3> MakeViewList(const glm::vec3& center, float distance, int count) {
+            std::vector<glm::vec3> view_list;
+            const float kGoldenAngle = 2.39996323f;
+            for (int i = 0; i < count; i++) {
+                float y = 1.0f - (i + 0.5f) * 2.0f / count;
+                float r = std::sqrt(std::max(0.0f, 1.0f - y * y));
+                float angle = kGoldenAngle * i;
+                view_list.push_back(center + glm::vec3(std::cos(angle) * r, y, std::sin(angle) * r) * distance);
+            }
+            return view_list;
+        }
+
+        //メッシュレットを作る時間と、いろいろな方向から見た時に裏向きで除ける三角形の割合
+        void MeasureMeshlet(const char* suite, const std::string& name, const std::vector<fbx::ModelMesh>& source_list) {
+            fbx::MeshletOption option;
+            option.enable = true;
+            std::vector<fbx::ModelMesh> mesh_list = source_list;
+            double build_ms = Measure(3, [&]() {
+                for (auto& mesh : mesh_list) {
+                    fbx::BuildMeshlets(&mesh, option);
+                }
+            });
+
+            size_t triangle_count = 0;
+            size_t meshlet_count = 0;
+            size_t meshlet_vertex_count = 0;
+            double culled_sum = 0.0;
+            double backface_sum = 0.0;
+            const int kViewCount = 64;
+            for (const auto& mesh : mesh_list) {
+                if (mesh.meshletList.empty()) {
+                    continue;
+                }
+                size_t mesh_triangle_count = 0;
+                for (const auto& meshlet : mesh.meshletList) {
+                    mesh_triangle_count += meshlet.triangleCount;
+                    meshlet_vertex_count += meshlet.vertexCount;
+                }
+                triangle_count += mesh_triangle_count;
+                meshlet_count += mesh.meshletList.size();
+
+                float extent = fbx::GetMeshExtent(mesh.vertexList.data(), mesh.vertexList.size());
+                glm::vec3 center(0.0f, 0.0f, 0.0f);
+                for (const auto& vertex : mesh.vertexList) {
+                    center += vertex.position;
+                }
+                center /= (float)mesh.vertexList.size();
+                for (const auto& camera : MakeViewList(center, extent * 2.0f, kViewCount)) {
+                    size_t culled = 0;
+                    size_t backface = 0;
+                    for (const auto& meshlet : mesh.meshletList) {
+                        if (fbx::IsMeshletBackfacing(meshlet, camera)) {
+                            culled += meshlet.triangleCount;
+                        }
+                        //三角形ごとに見た場合(ラスタライザの裏面カリングで消える数)
+                        const unsigned int* vertex_index = mesh.meshletVertexList.data() + meshlet.vertexOffset;
+                        const uint8_t* local = mesh.meshletTriangleList.data() + meshlet.triangleOffset;
+                        for (uint32_t i = 0; i < meshlet.triangleCount; i++) {
+                            const glm::vec3& p0 = mesh.vertexList[vertex_index[local[i * 3 + 0]]].position;
+                            const glm::vec3& p1 = mesh.vertexList[vertex_index[local[i * 3 + 1]]].position;
+                            const glm::vec3& p2 = mesh.vertexList[vertex_index[local[i * 3 + 2]]].position;
+                            if (glm::dot(glm::cross(p1 - p0, p2 - p0), p0 - camera) >= 0.0f) {
+                                backface++;
+                            }
+                        }
+                    }
+                    culled_sum += (double)culled;
+                    backface_sum += (double)backface;
+                }
+            }
+            if (meshlet_count == 0) {
+                printf("  %-28s no meshes\n", name.c_str());
+                return;
+            }
+            double culled_ratio = culled_sum / ((double)triangle_count * kViewCount);
+            double backface_ratio = backface_sum / ((double)triangle_count * kViewCount);
+            printf("  %-28s %7d meshlets  %5.1f vtx %5.1f tri/meshlet  build %8.2f ms (%.1f Mtri/s)  culled %5.1f%% (backface %5.1f%%)\n",
+                name.c_str(), (int)meshlet_count, (double)meshlet_vertex_count / meshlet_count, (double)triangle_count / meshlet_count,
+                build_ms, triangle_count / (build_ms * 1000.0), culled_ratio * 100.0, backface_ratio * 100.0);
+            Report(suite, name + "/meshlets", (double)meshlet_count, "count");
+            Report(suite, name + "/triangles_per_meshlet", (double)triangle_count / meshlet_count, "count");
+            Report(suite, name + "/build", build_ms, "ms");
+            Report(suite, name + "/culled_ratio", culled_ratio, "ratio");
+            Report(suite, name + "/backface_ratio", backface_ratio, "ratio");
+        }
+
+        //頂点キャッシュ向けに並べた状態で読む(メッシュレットを作る前の普段の手順)
+        bool LoadMeshList(std::vector<fbx::ModelMesh>* out_mesh_list, const std::string& path) {
+            fbx::binary::BinaryFbxLoader loader;
+            fbx::OptimizeOption optimize_option;
+            optimize_option.enable = true;
+            loader.SetOptimizeOption(optimize_option);
+            if (!loader.Initialize(path.c_str(), nullptr)) {
+                return false;
+            }
+            *out_mesh_list = loader.GetMeshList();
+            return true;
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    void RunMeshletBenchmark(const char* resource_dir, const SceneSpec& spec) {
+        printf("---- meshlet (64 vertices, 124 triangles) ----\n");
+        const char* suite = "meshlet";
+
+        const char* sample_list[] = { "oma_2.fbx", "oma_2_anim.fbx" };
+        for (auto sample : sample_list) {
+            std::vector<fbx::ModelMesh> mesh_list;
+            if (LoadMeshList(&mesh_list, std::string(resource_dir) + sample)) {
+                MeasureMeshlet(suite, sample, mesh_list);
+            }
+        }
+
+        std::string path = "bench_meshlet_" + spec.GetName() + ".fbx";
+        if (WriteSceneFbx(path.c_str(), spec)) {
+            std::vector<fbx::ModelMesh> mesh_list;
+            if (LoadMeshList(&mesh_list, path)) {
+                MeasureMeshlet(suite, spec.GetName(), mesh_list);
+            }
+            std::remove(path.c_str());
+        }
+    }
+    //------------------------------------------------------------------------------------------
+}
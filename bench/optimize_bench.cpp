@@ -0,0 +1,141 @@
+﻿#include "bench.h"
+#include "scene_generator.h"
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include <mesh_optimize.h>
+#include <fbx_binary.h>
+
+namespace bench {
+
+    namespace {
+        std::vector<unsigned int> GetIndexList(const fbx::ModelMesh& mesh) {
+            if (mesh.IsIndex32()) {
+                return mesh.indexList32;
+            }
+            return std::vector<unsigned int>(mesh.indexList.begin(), mesh.indexList.end());
+        }
+        void SetIndexList(fbx::ModelMesh* mesh, const std::vector<unsigned int>& index_list) {
+            mesh->indexList.clear();
+            mesh->indexList32.clear();
+            if (mesh->vertexList.size() > 0xffff) {
+                mesh->indexList32 = index_list;
+            }
+            else {
+                mesh->indexList.assign(index_list.begin(), index_list.end());
+            }
+        }
+
+        //三角形の順番を混ぜる。面の順番が整理されていない書き出しを想定したもの
+        fbx::ModelMesh ShuffleTriangles(const fbx::ModelMesh& mesh, uint32_t seed) {
+            auto index_list = GetIndexList(mesh);
+            std::vector<unsigned int> order(index_list.size() / 3);
+            for (size_t i = 0; i < order.size(); i++) {
+                order[i] = (unsigned int)i;
+            }
+            std::mt19937 random(seed);
+            std::shuffle(order.begin(), order.end(), random);
+            std::vector<unsigned int> shuffled_list;
+            shuffled_list.reserve(index_list.size());
+            for (auto triangle : order) {
+                shuffled_list.insert(shuffled_list.end(), index_list.begin() + triangle * 3, index_list.begin() + triangle * 3 + 3);
+            }
+            fbx::ModelMesh shuffled = mesh;
+            SetIndexList(&shuffled, shuffled_list);
+            return shuffled;
+        }
+
+        //メッシュ全体の合計でACMR/ATVRと並べ替えの時間を求める
+        void MeasureOptimize(const std::string& suite, const char* name, const std::vector<fbx::ModelMesh>& mesh_list, const fbx::OptimizeOption& option) {
+            size_t triangle_count = 0;
+            size_t vertex_count = 0;
+            size_t transform_before = 0;
+            size_t transform_after = 0;
+            double best_ms = 1e30;
+            for (int repeat = 0; repeat < 3; repeat++) {
+                double total_ms = 0.0;
+                for (const auto& source : mesh_list) {
+                    fbx::ModelMesh mesh = source;
+                    fbx::OptimizeStat stat;
+                    fbx::OptimizeMesh(&mesh, option, &stat);
+                    total_ms += stat.timeMs;
+                    if (repeat == 0) {
+                        triangle_count += (mesh.indexList.size() + mesh.indexList32.size()) / 3;
+                        vertex_count += mesh.vertexList.size();
+                        transform_before += stat.before.transformCount;
+                        transform_after += stat.after.transformCount;
+                    }
+                }
+                best_ms = std::min(best_ms, total_ms);
+            }
+            if (triangle_count == 0) {
+                return;
+            }
+            double acmr_before = (double)transform_before / triangle_count;
+            double acmr_after = (double)transform_after / triangle_count;
+            double atvr_before = (double)transform_before / vertex_count;
+            double atvr_after = (double)transform_after / vertex_count;
+            printf("  %-24s ACMR %.3f -> %.3f  ATVR %.3f -> %.3f  %9.3f ms (%.1f Mtri/s)\n", name, acmr_before, acmr_after, atvr_before, atvr_after,
+                best_ms, triangle_count / (best_ms * 1000.0));
+            std::string prefix = name;
+            Report(suite.c_str(), prefix + "/acmr_before", acmr_before, "ratio");
+            Report(suite.c_str(), prefix + "/acmr_after", acmr_after, "ratio");
+            Report(suite.c_str(), prefix + "/atvr_before", atvr_before, "ratio");
+            Report(suite.c_str(), prefix + "/atvr_after", atvr_after, "ratio");
+            Report(suite.c_str(), prefix + "/time", best_ms, "ms");
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    void RunOptimizeBenchmark(const SceneSpec& spec) {
+        std::string suite = "optimize/" + spec.GetName();
+        printf("---- vertex cache optimize %s ----\n", spec.GetName().c_str());
+
+        std::string path = "bench_optimize_" + spec.GetName() + ".fbx";
+        if (!WriteSceneFbx(path.c_str(), spec)) {
+            return;
+        }
+        std::vector<fbx::ModelMesh> mesh_list;
+        {
+            fbx::binary::BinaryFbxLoader loader;
+            if (!loader.Initialize(path.c_str(), nullptr)) {
+                std::remove(path.c_str());
+                return;
+            }
+            mesh_list = loader.GetMeshList();
+        }
+        std::vector<fbx::ModelMesh> shuffled_list;
+        for (size_t i = 0; i < mesh_list.size(); i++) {
+            shuffled_list.push_back(ShuffleTriangles(mesh_list[i], spec.seed + (uint32_t)i));
+        }
+
+        fbx::OptimizeOption cache_option;
+        cache_option.enable = true;
+        fbx::OptimizeOption overdraw_option = cache_option;
+        overdraw_option.overdraw = true;
+
+        MeasureOptimize(suite, "polygon/cache", mesh_list, cache_option);
+        MeasureOptimize(suite, "polygon/cache+overdraw", mesh_list, overdraw_option);
+        MeasureOptimize(suite, "shuffled/cache", shuffled_list, cache_option);
+        MeasureOptimize(suite, "shuffled/cache+overdraw", shuffled_list, overdraw_option);
+
+        //読み込み全体に対する並べ替えの割合
+        for (int i = 0; i < 2; i++) {
+            fbx::binary::BinaryFbxLoader loader;
+            fbx::OptimizeOption option;
+            option.enable = (i == 1);
+            loader.SetOptimizeOption(option);
+            Timer timer;
+            loader.Initialize(path.c_str(), nullptr);
+            double load_ms = timer.ElapsedMs();
+            const char* name = option.enable ? "load/optimize" : "load/plain";
+            printf("  %-24s %9.3f ms\n", name, load_ms);
+            Report(suite.c_str(), name, load_ms, "ms");
+        }
+
+        std::remove(path.c_str());
+    }
+    //------------------------------------------------------------------------------------------
+}
@@ -0,0 +1,183 @@
+﻿#include "bench.h"
+#include "scene_generator.h"
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <vertex_format.h>
+#include <tangent.h>
+#include <fbx_binary.h>
+
+namespace bench {
+
+    namespace {
+        //形式ごとの合計
+        struct PackedTotal {
+            size_t vertexCount = 0;
+            size_t vertexBytes = 0;
+            size_t byteSize = 0;
+            double buildMs = 0.0;
+            //読み戻した時の最大の誤差。位置はメッシュの箱の対角線に対する割合も見る
+            float positionError = 0.0f;
+            float positionRelativeError = 0.0f;
+            float normalError = 0.0f;
+            float tangentError = 0.0f;
+            size_t signError = 0;
+            float uvError = 0.0f;
+            float weightError = 0.0f;
+        };
+
+        float GetAngle(const glm::vec3& a, const glm::vec3& b) {
+            float cos_angle = glm::dot(glm::normalize(a), glm::normalize(b));
+            return std::acos(std::min(std::max(cos_angle, -1.0f), 1.0f)) * 57.29578f;
+        }
+
+        //------------------------------------------------------------------------------------------
+        template<class Format>
+        void AddMesh(PackedTotal* total, const fbx::ModelMesh& mesh) {
+            fbx::VertexBuffer<Format> buffer;
+            total->buildMs += Measure(3, [&]() {
+                fbx::BuildVertexBuffer(&buffer, mesh);
+            });
+            total->vertexCount += buffer.vertexList.size();
+            total->vertexBytes += buffer.vertexList.size() * sizeof(typename Format::Vertex);
+            total->byteSize += buffer.GetByteSize();
+
+            auto vertex_list = mesh.GetVertexSpan();
+            float diagonal = glm::length(buffer.param.positionExtent);
+            for (size_t i = 0; i < vertex_list.size(); i++) {
+                const auto& source = vertex_list[i];
+                const glm::vec4& source_tangent = mesh.tangentList[i];
+                fbx::ModelVertex decoded;
+                glm::vec4 tangent;
+                Format::Decode(&decoded, &tangent, buffer.vertexList[buffer.remapList[i]], buffer.param);
+                glm::vec3 diff = glm::abs(source.position - decoded.position);
+                float position_error = std::max(std::max(diff.x, diff.y), diff.z);
+                total->positionError = std::max(total->positionError, position_error);
+                total->positionRelativeError = std::max(total->positionRelativeError, position_error / diagonal);
+                total->normalError = std::max(total->normalError, GetAngle(source.normal, decoded.normal));
+                total->uvError = std::max(total->uvError, std::max(std::fabs(source.uv.x - decoded.uv.x), std::fabs(source.uv.y - decoded.uv.y)));
+                if (tangent.w != 0.0f) {
+                    total->tangentError = std::max(total->tangentError, GetAngle(glm::vec3(source_tangent), glm::vec3(tangent)));
+                    if (tangent.w != source_tangent.w) {
+                        total->signError++;
+                    }
+                }
+                if (Format::kSkinned) {
+                    for (int j = 0; j < 4; j++) {
+                        total->weightError = std::max(total->weightError, std::fabs(source.boneWeight[j] - decoded.boneWeight[j]));
+                    }
+                }
+            }
+        }
+        //------------------------------------------------------------------------------------------
+        void ReportTotal(const std::string& suite, const char* name, const PackedTotal& total, size_t base_size) {
+            double bytes_per_vertex = total.vertexCount > 0 ? (double)total.vertexBytes / total.vertexCount : 0.0;
+            printf("  %-14s %5.1f B/vertex  %7.2f MB (%5.1f%%)  build %7.3f ms  pos %.6f (%.1e of box)  normal %.3f deg  tangent %.3f deg  sign %zu  uv %.6f  weight %.6f\n",
+                name, bytes_per_vertex, total.byteSize / (1024.0 * 1024.0), base_size > 0 ? total.byteSize * 100.0 / base_size : 0.0, total.buildMs,
+                total.positionError, total.positionRelativeError, total.normalError, total.tangentError, total.signError, total.uvError, total.weightError);
+            Report(suite.c_str(), std::string(name) + "/bytes_per_vertex", bytes_per_vertex, "bytes");
+            Report(suite.c_str(), std::string(name) + "/bytes", (double)total.byteSize, "bytes");
+            Report(suite.c_str(), std::string(name) + "/build", total.buildMs, "ms");
+            Report(suite.c_str(), std::string(name) + "/position_error", total.positionRelativeError, "ratio");
+            Report(suite.c_str(), std::string(name) + "/normal_error", total.normalError, "deg");
+            Report(suite.c_str(), std::string(name) + "/tangent_error", total.tangentError, "deg");
+            Report(suite.c_str(), std::string(name) + "/uv_error", total.uvError, "uv");
+            Report(suite.c_str(), std::string(name) + "/weight_error", total.weightError, "ratio");
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    void RunPackedBenchmark(const SceneSpec& spec) {
+        //RunFormatBenchmarkと同じく半分を静的なメッシュ、半分をスキンメッシュにする
+        SceneSpec skinned_spec = spec;
+        skinned_spec.meshCount = std::max(spec.meshCount / 2, 1);
+        skinned_spec.clipFrameCount = 0;
+        SceneSpec static_spec = skinned_spec;
+        static_spec.boneCount = 0;
+        std::string suite = "packed/" + skinned_spec.GetName();
+        printf("---- packed vertex %s + static ----\n", skinned_spec.GetName().c_str());
+
+        //接線を作ったメッシュと作らないメッシュ
+        std::vector<fbx::ModelMesh> mesh_list;
+        std::vector<fbx::ModelMesh> plain_mesh_list;
+        const SceneSpec* spec_list[] = { &static_spec, &skinned_spec };
+        for (const SceneSpec* scene_spec : spec_list) {
+            std::string path = "bench_packed_" + scene_spec->GetName() + ".fbx";
+            if (!WriteSceneFbx(path.c_str(), *scene_spec)) {
+                return;
+            }
+            fbx::binary::BinaryFbxLoader loader;
+            fbx::TangentOption tangent_option;
+            tangent_option.enable = true;
+            loader.SetTangentOption(tangent_option);
+            fbx::binary::BinaryFbxLoader plain_loader;
+            bool result = loader.Initialize(path.c_str(), nullptr) && plain_loader.Initialize(path.c_str(), nullptr);
+            std::remove(path.c_str());
+            if (!result) {
+                return;
+            }
+            mesh_list.insert(mesh_list.end(), loader.GetMeshList().begin(), loader.GetMeshList().end());
+            plain_mesh_list.insert(plain_mesh_list.end(), plain_loader.GetMeshList().begin(), plain_loader.GetMeshList().end());
+        }
+
+        //接線の生成だけの時間。メッシュを書き換えるので毎回写してから測る
+        double tangent_ms = 1e30;
+        size_t split_count = 0;
+        for (int r = 0; r < 3; r++) {
+            std::vector<fbx::ModelMesh> work_list(plain_mesh_list);
+            split_count = 0;
+            Timer timer;
+            for (auto& mesh : work_list) {
+                split_count += fbx::GenerateTangents(&mesh);
+            }
+            tangent_ms = std::min(tangent_ms, timer.ElapsedMs());
+        }
+        size_t vertex_count = 0;
+        for (const auto& mesh : mesh_list) {
+            vertex_count += mesh.vertexList.size();
+        }
+        printf("  %zu vertices, tangent generation %.3f ms (%.1f ns/vertex), %zu vertices split at mirrored UVs\n", vertex_count, tangent_ms,
+            vertex_count > 0 ? tangent_ms * 1e6 / vertex_count : 0.0, split_count);
+        Report(suite.c_str(), "tangent/time", tangent_ms, "ms");
+
+        //ModelVertexのまま、ModelVertexに浮動小数点の接線を足した場合
+        PackedTotal model_total;
+        PackedTotal tangent_total;
+        for (const auto& mesh : mesh_list) {
+            size_t index_bytes = mesh.indexList.size() * sizeof(unsigned short) + mesh.indexList32.size() * sizeof(unsigned int);
+            model_total.vertexCount += mesh.vertexList.size();
+            model_total.vertexBytes += mesh.vertexList.size() * sizeof(fbx::ModelVertex);
+            model_total.byteSize += mesh.vertexList.size() * sizeof(fbx::ModelVertex) + index_bytes;
+            tangent_total.vertexCount += mesh.vertexList.size();
+            tangent_total.vertexBytes += mesh.vertexList.size() * (sizeof(fbx::ModelVertex) + sizeof(glm::vec4));
+            tangent_total.byteSize += mesh.vertexList.size() * (sizeof(fbx::ModelVertex) + sizeof(glm::vec4)) + index_bytes;
+        }
+        //メッシュごとに静的な形式とスキンの形式を選ぶ
+        PackedTotal float3_total;
+        PackedTotal packed_total;
+        PackedTotal skinned_total;
+        for (const auto& mesh : mesh_list) {
+            if (mesh.boneNodeNameList.empty()) {
+                AddMesh<fbx::PackedStaticFloat3VertexFormat>(&float3_total, mesh);
+                AddMesh<fbx::PackedStaticVertexFormat>(&packed_total, mesh);
+            }
+            else {
+                AddMesh<fbx::PackedSkinnedFloat3VertexFormat>(&float3_total, mesh);
+                AddMesh<fbx::PackedSkinnedVertexFormat>(&packed_total, mesh);
+                AddMesh<fbx::SkinnedVertexFormat>(&skinned_total, mesh);
+            }
+        }
+        printf("  stride ModelVertex %d (+tangent %d) / packed float3 %d, %d / packed %d, %d bytes (static, skinned)\n", (int)sizeof(fbx::ModelVertex),
+            (int)(sizeof(fbx::ModelVertex) + sizeof(glm::vec4)), (int)fbx::PackedStaticFloat3VertexFormat::kStride, (int)fbx::PackedSkinnedFloat3VertexFormat::kStride,
+            (int)fbx::PackedStaticVertexFormat::kStride, (int)fbx::PackedSkinnedVertexFormat::kStride);
+        ReportTotal(suite, "model", model_total, tangent_total.byteSize);
+        ReportTotal(suite, "model+tangent", tangent_total, tangent_total.byteSize);
+        ReportTotal(suite, "packed-float3", float3_total, tangent_total.byteSize);
+        ReportTotal(suite, "packed", packed_total, tangent_total.byteSize);
+        //接線を持たない既存の形式(スキンメッシュだけ)
+        ReportTotal(suite, "skinned(no tan)", skinned_total, tangent_total.byteSize);
+    }
+    //------------------------------------------------------------------------------------------
+}
@@ -0,0 +1,98 @@
+﻿#include "bench.h"
+
+#include <string>
+#include <thread>
+#include <cstring>
+#include <weld.h>
+#include "scene_generator.h"
+#include <thread_pool.h>
+#ifndef BENCH_NO_FBXSDK
+#include <fbx.h>
+#endif
+
+namespace bench {
+
+    namespace {
+        //大きさがばらばらなメッシュの角頂点。大きいメッシュが一部のスレッドに偏るようにしておく
+        std::vector<std::vector<fbx::ModelVertex>> MakeMeshCornerList(int mesh_count) {
+            std::vector<std::vector<fbx::ModelVertex>> mesh_list(mesh_count);
+            for (int m = 0; m < mesh_count; m++) {
+                int side = (m % 8 == 0) ? 200 : 30 + (m * 7) % 40;
+                mesh_list[m] = MakeGridCornerList(side, (size_t)side * side, (float)m);
+            }
+            return mesh_list;
+        }
+
+        std::vector<int> GetThreadCountList() {
+            int max_thread = std::max(1, (int)std::thread::hardware_concurrency());
+            std::vector<int> thread_count_list;
+            for (int n = 1; n < max_thread; n *= 2) {
+                thread_count_list.push_back(n);
+            }
+            thread_count_list.push_back(max_thread);
+            return thread_count_list;
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    void RunParallelBenchmark(const char* scene_path) {
+        printf("---- parallel mesh extraction -------------------\n");
+
+        //FBX SDKが無くても測れるように、メッシュごとの重複頂点の除去だけをプールで回す
+        auto mesh_corner_list = MakeMeshCornerList(64);
+        std::vector<fbx::ModelMesh> mesh_list(mesh_corner_list.size());
+        double base_ms = 0.0;
+        printf("[weld x%d meshes]\n", (int)mesh_corner_list.size());
+        printf("%8s %12s %10s\n", "threads", "time[ms]", "speedup");
+        for (int thread_count : GetThreadCountList()) {
+            fbx::ThreadPool thread_pool(thread_count);
+            double ms = Measure(5, [&]() {
+                thread_pool.ParallelFor(mesh_corner_list.size(), [&](size_t i) {
+                    fbx::WeldVertices(&mesh_list[i], mesh_corner_list[i], fbx::WeldOption());
+                });
+            });
+            if (thread_count == 1) {
+                base_ms = ms;
+            }
+            printf("%8d %12.3f %10.2f\n", thread_count, ms, base_ms / ms);
+        }
+
+#ifndef BENCH_NO_FBXSDK
+        //SDK経由の読み込み全体。結果がスレッド数によらず同じかも確認する
+        printf("[FbxLoader %s]\n", scene_path);
+        printf("%8s %12s %10s %10s\n", "threads", "time[ms]", "speedup", "identical");
+        std::vector<fbx::ModelMesh> reference_list;
+        for (int thread_count : GetThreadCountList()) {
+            bool ok = false;
+            bool identical = true;
+            double ms = Measure(3, [&]() {
+                fbx::FbxLoader loader;
+                ok = loader.Initialize(scene_path, scene_path, thread_count);
+                if (thread_count == 1) {
+                    reference_list = loader.GetMeshList();
+                }
+                const auto& list = loader.GetMeshList();
+                identical = identical && list.size() == reference_list.size();
+                for (size_t i = 0; identical && i < list.size(); i++) {
+                    identical = list[i].nodeName == reference_list[i].nodeName
+                        && list[i].indexList == reference_list[i].indexList
+                        && list[i].indexList32 == reference_list[i].indexList32
+                        && list[i].vertexList.size() == reference_list[i].vertexList.size()
+                        && (list[i].vertexList.empty() || std::memcmp(list[i].vertexList.data(), reference_list[i].vertexList.data(), list[i].vertexList.size() * sizeof(fbx::ModelVertex)) == 0);
+                }
+            });
+            if (!ok) {
+                printf("load failed\n");
+                break;
+            }
+            if (thread_count == 1) {
+                base_ms = ms;
+            }
+            printf("%8d %12.3f %10.2f %10s\n", thread_count, ms, base_ms / ms, identical ? "yes" : "NO");
+        }
+#else
+        (void)scene_path;
+#endif
+    }
+    //------------------------------------------------------------------------------------------
+} // bench
@@ -0,0 +1,52 @@
+﻿#include "bench.h"
+
+#include <cstdio>
+#include <string>
+#include <load_profiler.h>
+#include <fbx_binary.h>
+#ifndef BENCH_NO_FBXSDK
+#include <fbx.h>
+#endif
+
+namespace bench {
+
+    namespace {
+        template<class Loader>
+        void ProfileLoader(const char* name, const std::string& path, const char* trace_path) {
+            Loader loader;
+            fbx::BakeOption bake_option;
+            bake_option.enable = true;
+            loader.SetBakeOption(bake_option);
+            Timer timer;
+            bool result = loader.Initialize(path.c_str(), path.c_str());
+            double total_ms = timer.ElapsedMs();
+            printf("[%s] %s %s %.2f ms\n", name, path.c_str(), result ? "ok" : "failed", total_ms);
+            loader.GetProfiler().PrintSummary();
+            if (loader.GetProfiler().WriteChromeTrace(trace_path)) {
+                printf("  trace: %s\n", trace_path);
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    void RunProfileBenchmark(const char* resource_dir) {
+        printf("---- load profiler ------------------------------\n");
+        std::string path = std::string(resource_dir) + "oma_2_anim.fbx";
+        ProfileLoader<fbx::binary::BinaryFbxLoader>("binary", path, "load_trace_binary.json");
+#ifndef BENCH_NO_FBXSDK
+        ProfileLoader<fbx::FbxLoader>("sdk", std::string(resource_dir) + "oma_2.fbx", "load_trace_sdk.json");
+#endif
+
+        //区間1つ分の記録にかかる時間
+        fbx::LoadProfiler profiler;
+        const int kScopeCount = 200000;
+        double scope_ms = Measure(3, [&]() {
+            profiler.Clear();
+            for (int i = 0; i < kScopeCount; i++) {
+                FBX_PROFILE_SCOPE(&profiler, "scope");
+            }
+        });
+        printf("scope overhead: %.1f ns/scope\n", scope_ms * 1e6 / kScopeCount);
+    }
+    //------------------------------------------------------------------------------------------
+}
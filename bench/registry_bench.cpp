@@ -0,0 +1,125 @@
+﻿#include "bench.h"
+#include "scene_generator.h"
+
+#include <cstdio>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include <asset_registry.h>
+#include <thread_pool.h>
+#include <fbx_binary.h>
+
+namespace bench {
+
+    namespace {
+        const int kCharacterCount = 50;
+
+        struct RegistryResult {
+            double loadMs;
+            double steadyBytes;
+            double assetBytes;
+            uint64_t loadCount;
+            double hitRate;
+        };
+
+        //------------------------------------------------------------------------------------------
+        //キャラクターごとにローダーを持つ今までのやり方。モデルとアニメーションを毎回読む
+        void MeasureWithoutRegistry(RegistryResult* out_result, const std::string& model_path, const std::string& anim_path) {
+            size_t base_rss = GetCurrentRss();
+            std::vector<std::unique_ptr<fbx::binary::BinaryFbxLoader>> loader_list(kCharacterCount);
+            fbx::BakeOption bake_option;
+            bake_option.enable = true;
+            bake_option.releaseScene = true;
+            fbx::ThreadPool thread_pool(0);
+            Timer timer;
+            thread_pool.ParallelFor(loader_list.size(), [&](size_t i) {
+                loader_list[i].reset(new fbx::binary::BinaryFbxLoader());
+                loader_list[i]->SetBakeOption(bake_option);
+                loader_list[i]->Initialize(model_path.c_str(), anim_path.c_str());
+            });
+            out_result->loadMs = timer.ElapsedMs();
+            out_result->steadyBytes = (double)GetCurrentRss() - (double)base_rss;
+            size_t asset_bytes = 0;
+            for (const auto& loader : loader_list) {
+                fbx::MeshSet mesh_set;
+                mesh_set.meshList = loader->GetMeshList();
+                asset_bytes += mesh_set.GetMemorySize();
+                for (const auto& animation : loader->GetAnimationArray()) {
+                    asset_bytes += animation.clip.GetKeyMemorySize();
+                }
+            }
+            out_result->assetBytes = (double)asset_bytes;
+            out_result->loadCount = (uint64_t)kCharacterCount * 2;
+            out_result->hitRate = 0.0;
+        }
+        //------------------------------------------------------------------------------------------
+        //全キャラクターが同時に同じファイルを求める。読み込みは1回にまとまるはず
+        void MeasureWithRegistry(RegistryResult* out_result, fbx::AssetRegistry* registry, const std::string& model_path, const std::string& anim_path) {
+            size_t base_rss = GetCurrentRss();
+            std::vector<std::shared_ptr<const fbx::MeshSet>> mesh_set_list(kCharacterCount);
+            std::vector<std::shared_ptr<const fbx::AnimationSet>> animation_set_list(kCharacterCount);
+            fbx::ThreadPool thread_pool(0);
+            Timer timer;
+            thread_pool.ParallelFor(kCharacterCount, [&](size_t i) {
+                mesh_set_list[i] = registry->AcquireMeshSet<fbx::binary::BinaryFbxLoader>(model_path.c_str());
+                animation_set_list[i] = registry->AcquireAnimationSet<fbx::binary::BinaryFbxLoader>(anim_path.c_str());
+            });
+            out_result->loadMs = timer.ElapsedMs();
+            out_result->steadyBytes = (double)GetCurrentRss() - (double)base_rss;
+            auto stats = registry->GetStats();
+            out_result->assetBytes = (double)stats.residentBytes;
+            out_result->loadCount = stats.loadCount;
+            out_result->hitRate = stats.GetHitRate();
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    void RunRegistryBenchmark(const SceneSpec& spec) {
+        //キャラクター1体分のモデルと、全員で使う歩きのアニメーション
+        SceneSpec model_spec = spec;
+        model_spec.meshCount = std::min(spec.meshCount, 4);
+        model_spec.triangleCount = std::min(spec.triangleCount, 10000);
+        model_spec.clipFrameCount = 0;
+        SceneSpec anim_spec = spec;
+        anim_spec.meshCount = 1;
+        anim_spec.triangleCount = 2;
+        anim_spec.clipFrameCount = std::max(spec.clipFrameCount, 60);
+        printf("---- asset registry (%d characters) %s ----\n", kCharacterCount, model_spec.GetName().c_str());
+        std::string model_path = "bench_registry_" + model_spec.GetName() + ".fbx";
+        std::string anim_path = "bench_registry_" + anim_spec.GetName() + ".fbx";
+        if (!WriteSceneFbx(model_path.c_str(), model_spec) || !WriteSceneFbx(anim_path.c_str(), anim_spec)) {
+            return;
+        }
+        //解放したメモリは次の計測で使い回されてRSSが増えないので、小さい方を先に測る
+        const char* name_list[] = { "registry", "loader" };
+        for (int i = 0; i < 2; i++) {
+            RegistryResult result;
+            fbx::AssetRegistry registry;
+            if (i == 0) {
+                MeasureWithRegistry(&result, &registry, model_path, anim_path);
+            }
+            else {
+                MeasureWithoutRegistry(&result, model_path, anim_path);
+            }
+            const double mb = 1024.0 * 1024.0;
+            printf("  %-8s load %9.3f ms  loads %4d  hit rate %5.1f%%  assets %8.2f MB  steady +%8.2f MB\n", name_list[i],
+                result.loadMs, (int)result.loadCount, result.hitRate * 100.0, result.assetBytes / mb, result.steadyBytes / mb);
+            std::string prefix = name_list[i];
+            Report("registry", prefix + "/load", result.loadMs, "ms");
+            Report("registry", prefix + "/load_count", (double)result.loadCount, "count");
+            Report("registry", prefix + "/hit_rate", result.hitRate, "ratio");
+            Report("registry", prefix + "/assets", result.assetBytes, "bytes");
+            Report("registry", prefix + "/steady_rss", result.steadyBytes, "bytes");
+            if (i == 0) {
+                //誰も持たなくなったアセットは予算を下げた所で捨てられる
+                registry.SetMemoryBudget(0);
+                auto stats = registry.GetStats();
+                printf("  after release: entries %d  evicted %d  resident %.2f MB\n", (int)stats.entryCount, (int)stats.evictCount, stats.residentBytes / mb);
+            }
+        }
+        std::remove(model_path.c_str());
+        std::remove(anim_path.c_str());
+    }
+    //------------------------------------------------------------------------------------------
+}
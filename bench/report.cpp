@@ -0,0 +1,81 @@
+﻿#include "bench.h"
+
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+    namespace {
+        struct Record {
+            std::string suite;
+            std::string name;
+            double value;
+            std::string unit;
+        };
+
+        std::vector<Record>& GetRecordList() {
+            static std::vector<Record> record_list;
+            return record_list;
+        }
+
+        void WriteJsonString(FILE* fp, const std::string& str) {
+            fputc('"', fp);
+            for (char c : str) {
+                if (c == '"' || c == '\\') {
+                    fputc('\\', fp);
+                }
+                fputc(c, fp);
+            }
+            fputc('"', fp);
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    void Report(const char* suite, const std::string& name, double value, const char* unit) {
+        GetRecordList().push_back({ suite, name, value, unit });
+    }
+    //------------------------------------------------------------------------------------------
+    bool WriteReport(const char* filepath) {
+        FILE* fp = fopen(filepath, "wb");
+        if (fp == nullptr) {
+            printf("report: cannot open [%s]\n", filepath);
+            return false;
+        }
+        //バージョン間で比べやすいように、1件1行で書く
+        char date[32];
+        std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+        fprintf(fp, "{\n\"format\": 1,\n\"date\": \"%s\",\n", date);
+#if defined(_MSC_VER)
+        fprintf(fp, "\"compiler\": \"msvc %d\",\n", _MSC_VER);
+#elif defined(__clang__)
+        fprintf(fp, "\"compiler\": \"clang %d.%d\",\n", __clang_major__, __clang_minor__);
+#elif defined(__GNUC__)
+        fprintf(fp, "\"compiler\": \"gcc %d.%d\",\n", __GNUC__, __GNUC_MINOR__);
+#else
+        fprintf(fp, "\"compiler\": \"unknown\",\n");
+#endif
+        fprintf(fp, "\"results\": [\n");
+        const auto& record_list = GetRecordList();
+        for (size_t i = 0; i < record_list.size(); i++) {
+            const auto& record = record_list[i];
+            fprintf(fp, "{\"suite\": ");
+            WriteJsonString(fp, record.suite);
+            fprintf(fp, ", \"name\": ");
+            WriteJsonString(fp, record.name);
+            fprintf(fp, ", \"value\": %.6g, \"unit\": ", record.value);
+            WriteJsonString(fp, record.unit);
+            fprintf(fp, "}%s\n", i + 1 < record_list.size() ? "," : "");
+        }
+        fprintf(fp, "]\n}\n");
+        bool result = ferror(fp) == 0;
+        fclose(fp);
+        if (result) {
+            printf("report: %d results -> %s\n", (int)record_list.size(), filepath);
+        }
+        return result;
+    }
+    //------------------------------------------------------------------------------------------
+}
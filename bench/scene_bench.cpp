@@ -0,0 +1,165 @@
+﻿#include "bench.h"
+#include "scene_generator.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include <load_profiler.h>
+#include <fbx_binary.h>
+#ifndef BENCH_NO_FBXSDK
+#include <fbx.h>
+#endif
+
+namespace bench {
+
+    namespace {
+        //区間ごとの合計時間を記録する
+        void ReportProfile(const char* suite, const char* prefix, const fbx::LoadProfiler& profiler) {
+            std::vector<std::pair<const char*, double>> phase_list;
+            for (const auto& event : profiler.GetEventList()) {
+                auto it = phase_list.begin();
+                while (it != phase_list.end() && std::strcmp(it->first, event.name) != 0) {
+                    ++it;
+                }
+                if (it == phase_list.end()) {
+                    phase_list.push_back({ event.name, 0.0 });
+                    it = phase_list.end() - 1;
+                }
+                it->second += event.durationUs / 1000.0;
+            }
+            for (const auto& phase : phase_list) {
+                printf("  %-6s %-20s %10.3f ms\n", prefix, phase.first, phase.second);
+                Report(suite, std::string(prefix) + "/phase/" + phase.first, phase.second, "ms");
+            }
+            printf("  %-6s vertices %lld -> %lld after weld, %lld skin clusters\n", prefix, (long long)profiler.GetCounter(fbx::kCounterVertexBeforeWeld),
+                (long long)profiler.GetCounter(fbx::kCounterVertexAfterWeld), (long long)profiler.GetCounter(fbx::kCounterSkinCluster));
+            for (int i = 0; i < fbx::kLoadCounterCount; i++) {
+                auto counter = (fbx::LoadCounter)i;
+                Report(suite, std::string(prefix) + "/count/" + fbx::LoadProfiler::GetCounterName(counter), (double)profiler.GetCounter(counter),
+                    counter == fbx::kCounterMeshBytes ? "bytes" : "count");
+            }
+        }
+
+        //Initializeを繰り返して一番速かった回の区間を記録する
+        template<class Loader>
+        void MeasureLoad(const char* suite, const char* prefix, const std::string& path, const fbx::BakeOption& bake_option) {
+            double best_ms = 1e30;
+            std::unique_ptr<Loader> best_loader;
+            for (int i = 0; i < 3; i++) {
+                std::unique_ptr<Loader> loader(new Loader());
+                loader->SetBakeOption(bake_option);
+                Timer timer;
+                loader->Initialize(path.c_str(), path.c_str());
+                double ms = timer.ElapsedMs();
+                if (ms < best_ms) {
+                    best_ms = ms;
+                    best_loader = std::move(loader);
+                }
+            }
+            printf("  %-6s load %.2f ms\n", prefix, best_ms);
+            Report(suite, std::string(prefix) + "/load", best_ms, "ms");
+            ReportProfile(suite, prefix, best_loader->GetProfiler());
+        }
+
+        template<class Func>
+        double MeasurePerFrame(int frame_count, float end_frame, Func func) {
+            double ms = Measure(3, [&]() {
+                for (int i = 0; i < frame_count; i++) {
+                    func(std::fmod(i * 0.37f, end_frame));
+                }
+            });
+            return ms * 1000.0 / frame_count;
+        }
+
+        //名前で引く版・結び付け版・1回の走査の版の1フレームあたりの時間
+        void MeasurePose(const char* suite, const char* prefix, const fbx::binary::BinaryFbxLoader& loader) {
+            if (loader.GetMeshList().empty() || loader.GetAnimationArray().empty()) {
+                return;
+            }
+            const auto& mesh = loader.GetMeshList()[0];
+            int bone_count = std::max(1, (int)mesh.boneNodeNameList.size());
+            float end_frame = std::max(1.0f, loader.GetAnimationArray()[0].GetAnimationEndFrame());
+            std::vector<glm::mat4> matrix_list(bone_count);
+            glm::mat4 mesh_matrix;
+            const int frame_count = 200;
+
+            double bone_us = MeasurePerFrame(frame_count, end_frame, [&](float frame) {
+                loader.GetAnimationBoneMatrix(matrix_list.data(), frame, mesh, bone_count, 0);
+            });
+            double mesh_us = MeasurePerFrame(frame_count, end_frame, [&](float frame) {
+                loader.GetAnimationMeshMatrix(&mesh_matrix, frame, mesh, 0);
+            });
+            fbx::SkeletonBinding binding;
+            loader.CreateSkeletonBinding(&binding, mesh, 0);
+            double pose_us = MeasurePerFrame(frame_count, end_frame, [&](float frame) {
+                loader.GetAnimationPose(matrix_list.data(), nullptr, frame, mesh, binding);
+            });
+            printf("  %-6s %d bones  GetAnimationBoneMatrix %.2f us  GetAnimationMeshMatrix %.2f us  GetAnimationPose %.2f us\n",
+                prefix, bone_count, bone_us, mesh_us, pose_us);
+            Report(suite, std::string(prefix) + "/pose/GetAnimationBoneMatrix", bone_us, "us/frame");
+            Report(suite, std::string(prefix) + "/pose/GetAnimationMeshMatrix", mesh_us, "us/frame");
+            Report(suite, std::string(prefix) + "/pose/GetAnimationPose", pose_us, "us/frame");
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    void RunSceneBenchmark(const SceneSpec& spec) {
+        std::string name = spec.GetName();
+        std::string suite = "scene/" + name;
+        printf("---- synthetic scene %s ----\n", name.c_str());
+
+        //生成したファイルはカレントディレクトリに置いて最後に消す
+        std::string path = "bench_scene_" + name + ".fbx";
+        std::vector<uint8_t> data;
+        double generate_ms = Measure(1, [&]() {
+            data = GenerateSceneFbx(spec);
+        });
+        if (!WriteSceneFbx(path.c_str(), spec)) {
+            return;
+        }
+        printf("  generated %.1f KB in %.2f ms\n", data.size() / 1024.0, generate_ms);
+        Report(suite.c_str(), "file_size", (double)data.size(), "bytes");
+
+        //メモリ: 1回目の読み込みでのピークRSSの増え方と、出来上がったメッシュのバッファの大きさ
+        {
+            size_t rss_before = GetPeakRss();
+            fbx::binary::BinaryFbxLoader loader;
+            loader.Initialize(path.c_str(), path.c_str());
+            size_t rss_after = GetPeakRss();
+            size_t mesh_bytes = (size_t)loader.GetProfiler().GetCounter(fbx::kCounterMeshBytes);
+            size_t curve_bytes = 0;
+            for (const auto& animation : loader.GetAnimationArray()) {
+                for (const auto& curve : animation.curveList) {
+                    curve_bytes += curve.keyFrameList.size() * sizeof(float) + curve.keyValueList.size() * sizeof(float) + curve.keyConstantList.size();
+                }
+            }
+            printf("  memory: mesh buffers %.1f KB, animation curves %.1f KB, peak RSS +%.1f MB\n",
+                mesh_bytes / 1024.0, curve_bytes / 1024.0, (rss_after - rss_before) / (1024.0 * 1024.0));
+            Report(suite.c_str(), "memory/mesh_buffers", (double)mesh_bytes, "bytes");
+            Report(suite.c_str(), "memory/animation_curves", (double)curve_bytes, "bytes");
+            Report(suite.c_str(), "memory/peak_rss_growth", (double)(rss_after - rss_before), "bytes");
+            MeasurePose(suite.c_str(), "curve", loader);
+        }
+
+        fbx::BakeOption no_bake;
+        MeasureLoad<fbx::binary::BinaryFbxLoader>(suite.c_str(), "binary", path, no_bake);
+#ifndef BENCH_NO_FBXSDK
+        MeasureLoad<fbx::FbxLoader>(suite.c_str(), "sdk", path, no_bake);
+#endif
+
+        fbx::BakeOption bake_option;
+        bake_option.enable = true;
+        {
+            fbx::binary::BinaryFbxLoader loader;
+            loader.SetBakeOption(bake_option);
+            loader.Initialize(path.c_str(), path.c_str());
+            MeasurePose(suite.c_str(), "baked", loader);
+        }
+
+        std::remove(path.c_str());
+    }
+    //------------------------------------------------------------------------------------------
+}
@@ -0,0 +1,760 @@
+﻿#include "scene_generator.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+namespace bench {
+
+    namespace {
+        //60fpsの1フレームをFBXの時間単位で表したもの
+        const int64_t kOneFrameTime = 46186158000LL / 60;
+
+        //シードだけで決まる乱数(xorshift32)
+        class Random
+        {
+        public:
+            explicit Random(uint32_t seed) : mState(seed != 0 ? seed : 0x9E3779B9u) {}
+
+            uint32_t Next() {
+                mState ^= mState << 13;
+                mState ^= mState >> 17;
+                mState ^= mState << 5;
+                return mState;
+            }
+            //[0,1)
+            float NextFloat() {
+                return (Next() >> 8) * (1.0f / 16777216.0f);
+            }
+        private:
+            uint32_t mState;
+        };
+
+        //ノードレコードを順に書く。BeginNodeのあとプロパティを足してから子を書き、EndNodeで閉じる
+        class FbxWriter
+        {
+        public:
+            FbxWriter() {
+                static const char kMagic[] = "Kaydara FBX Binary  ";
+                mData.insert(mData.end(), kMagic, kMagic + sizeof(kMagic));
+                mData.push_back(0x1A);
+                mData.push_back(0x00);
+                Append<uint32_t>(7400);
+            }
+
+            void BeginNode(const char* name) {
+                ClosePropertyList();
+                Record record;
+                record.begin = mData.size();
+                record.propertyBegin = 0;
+                record.propertyCount = 0;
+                record.hasChild = false;
+                if (!mStack.empty()) {
+                    mStack.back().hasChild = true;
+                }
+                Append<uint32_t>(0);
+                Append<uint32_t>(0);
+                Append<uint32_t>(0);
+                uint8_t name_length = (uint8_t)std::strlen(name);
+                mData.push_back(name_length);
+                mData.insert(mData.end(), name, name + name_length);
+                record.propertyBegin = mData.size();
+                record.propertyOpen = true;
+                mStack.push_back(record);
+            }
+            void EndNode() {
+                ClosePropertyList();
+                Record record = mStack.back();
+                mStack.pop_back();
+                //子があるか、プロパティが無いレコードは空のレコードで閉じる
+                if (record.hasChild || record.propertyCount == 0) {
+                    mData.insert(mData.end(), 13, 0);
+                }
+                Patch<uint32_t>(record.begin, (uint32_t)mData.size());
+            }
+
+            void AddInt(int32_t value) {
+                AddTag('I');
+                Append<int32_t>(value);
+            }
+            void AddLong(int64_t value) {
+                AddTag('L');
+                Append<int64_t>(value);
+            }
+            void AddDouble(double value) {
+                AddTag('D');
+                Append<double>(value);
+            }
+            void AddString(const std::string& value) {
+                AddTag('S');
+                Append<uint32_t>((uint32_t)value.size());
+                mData.insert(mData.end(), value.begin(), value.end());
+            }
+            //オブジェクト名は「名前\x00\x01クラス」
+            void AddObjectName(const std::string& name, const char* class_name) {
+                std::string value = name;
+                value.push_back('\0');
+                value.push_back('\x01');
+                value += class_name;
+                AddString(value);
+            }
+            template<class T>
+            void AddArray(char type, const std::vector<T>& value) {
+                AddTag(type);
+                Append<uint32_t>((uint32_t)value.size());
+                Append<uint32_t>(0);
+                Append<uint32_t>((uint32_t)(value.size() * sizeof(T)));
+                const uint8_t* bytes = (const uint8_t*)value.data();
+                mData.insert(mData.end(), bytes, bytes + value.size() * sizeof(T));
+            }
+
+            //子の無いノードを1つ書く
+            void StringNode(const char* name, const std::string& value) {
+                BeginNode(name);
+                AddString(value);
+                EndNode();
+            }
+            void IntNode(const char* name, int32_t value) {
+                BeginNode(name);
+                AddInt(value);
+                EndNode();
+            }
+            template<class T>
+            void ArrayNode(const char* name, char type, const std::vector<T>& value) {
+                BeginNode(name);
+                AddArray(type, value);
+                EndNode();
+            }
+            //Properties70のP。vectorならx,y,zを続けて渡す
+            void Property70(const char* name, const char* type, const char* label, const char* flags, const double* value, int value_count) {
+                BeginNode("P");
+                AddString(name);
+                AddString(type);
+                AddString(label);
+                AddString(flags);
+                for (int i = 0; i < value_count; i++) {
+                    AddDouble(value[i]);
+                }
+                EndNode();
+            }
+            void Property70Time(const char* name, int64_t value) {
+                BeginNode("P");
+                AddString(name);
+                AddString("KTime");
+                AddString("Time");
+                AddString("");
+                AddLong(value);
+                EndNode();
+            }
+
+            std::vector<uint8_t> Finish() {
+                //最上位のリストの終わり
+                mData.insert(mData.end(), 13, 0);
+                //フッター(FBX SDKが書くものと同じ並び)
+                static const uint8_t kFooterId[16] = { 0xfa, 0xbc, 0xab, 0x09, 0xd0, 0xc8, 0xd4, 0x66, 0xb1, 0x76, 0xfb, 0x83, 0x1c, 0xf7, 0x26, 0x7e };
+                static const uint8_t kFooterMagic[16] = { 0xf8, 0x5a, 0x8c, 0x6a, 0xde, 0xf5, 0xd9, 0x7e, 0xec, 0xe9, 0x0c, 0xe3, 0x75, 0x8f, 0x29, 0x0b };
+                mData.insert(mData.end(), kFooterId, kFooterId + 16);
+                mData.insert(mData.end(), (16 - mData.size() % 16) % 16, 0);
+                Append<uint32_t>(0);
+                Append<uint32_t>(7400);
+                mData.insert(mData.end(), 120, 0);
+                mData.insert(mData.end(), kFooterMagic, kFooterMagic + 16);
+                return std::move(mData);
+            }
+
+        private:
+            struct Record {
+                size_t begin;
+                size_t propertyBegin;
+                uint32_t propertyCount;
+                bool propertyOpen;
+                bool hasChild;
+            };
+
+            template<class T>
+            void Append(T value) {
+                uint8_t bytes[sizeof(T)];
+                std::memcpy(bytes, &value, sizeof(T));
+                mData.insert(mData.end(), bytes, bytes + sizeof(T));
+            }
+            template<class T>
+            void Patch(size_t offset, T value) {
+                std::memcpy(mData.data() + offset, &value, sizeof(T));
+            }
+            void AddTag(char type) {
+                mStack.back().propertyCount++;
+                mData.push_back((uint8_t)type);
+            }
+            //プロパティの数と長さを確定させる
+            void ClosePropertyList() {
+                if (mStack.empty() || !mStack.back().propertyOpen) {
+                    return;
+                }
+                Record& record = mStack.back();
+                record.propertyOpen = false;
+                Patch<uint32_t>(record.begin + 4, record.propertyCount);
+                Patch<uint32_t>(record.begin + 8, (uint32_t)(mData.size() - record.propertyBegin));
+            }
+
+            std::vector<uint8_t> mData;
+            std::vector<Record> mStack;
+        };
+
+        void WriteConnection(FbxWriter* writer, int64_t child, int64_t parent, const char* property = nullptr) {
+            writer->BeginNode("C");
+            writer->AddString(property != nullptr ? "OP" : "OO");
+            writer->AddLong(child);
+            writer->AddLong(parent);
+            if (property != nullptr) {
+                writer->AddString(property);
+            }
+            writer->EndNode();
+        }
+
+        //オブジェクトのIDの振り方
+        int64_t BoneId(int bone) { return 1000000 + bone; }
+        int64_t MeshModelId(int mesh) { return 2000000 + mesh; }
+        int64_t GeometryId(int mesh) { return 3000000 + mesh; }
+        int64_t MaterialId(int mesh) { return 4000000 + mesh; }
+        int64_t TextureId(int mesh) { return 5000000 + mesh; }
+        int64_t SkinId(int mesh) { return 6000000 + mesh; }
+        int64_t ClusterId(int mesh, int bone) { return 10000000 + (int64_t)mesh * 100000 + bone; }
+        int64_t CurveNodeId(int bone) { return 7000000 + bone; }
+        int64_t CurveId(int bone, int axis) { return 8000000 + (int64_t)bone * 3 + axis; }
+        int64_t BlendShapeId(int mesh) { return 20000000 + mesh; }
+        int64_t ChannelId(int mesh, int channel) { return 30000000 + (int64_t)mesh * 10000 + channel; }
+        int64_t ShapeId(int mesh, int channel) { return 40000000 + (int64_t)mesh * 10000 + channel; }
+        int64_t ChannelCurveNodeId(int mesh, int channel) { return 50000000 + (int64_t)mesh * 10000 + channel; }
+        int64_t ChannelCurveId(int mesh, int channel) { return 60000000 + (int64_t)mesh * 10000 + channel; }
+        //足したノードと複製したGeometryは、メッシュの後ろの番号でIDを振る
+        int InstanceMesh(const SceneSpec& spec, int mesh, int instance) { return spec.meshCount + mesh * spec.instanceCount + instance; }
+        //奇数番目のインスタンスは中身が同じ別のGeometryを持つ
+        bool IsCopiedGeometry(int instance) { return instance % 2 == 1; }
+        const int64_t kStackId = 9000000;
+        const int64_t kLayerId = 9000001;
+
+        //格子の1辺の四角形の数
+        int GetGridSide(const SceneSpec& spec) {
+            int side = 1;
+            while (2 * side * side < spec.triangleCount) {
+                side++;
+            }
+            return side;
+        }
+
+        void WriteInstanceModel(FbxWriter* writer, const SceneSpec& spec, int mesh, int instance) {
+            writer->BeginNode("Model");
+            writer->AddLong(MeshModelId(InstanceMesh(spec, mesh, instance)));
+            writer->AddObjectName("instance" + std::to_string(mesh) + "_" + std::to_string(instance), "Model");
+            writer->AddString("Mesh");
+            writer->IntNode("Version", 232);
+            writer->BeginNode("Properties70");
+            const double translation[3] = { (instance + 1) * 50.0, 0.0, mesh * 50.0 };
+            writer->Property70("Lcl Translation", "Lcl Translation", "", "A", translation, 3);
+            writer->EndNode();
+            writer->EndNode();
+        }
+
+        void WriteBone(FbxWriter* writer, int bone, Random* random) {
+            writer->BeginNode("Model");
+            writer->AddLong(BoneId(bone));
+            writer->AddObjectName("bone" + std::to_string(bone), "Model");
+            writer->AddString("LimbNode");
+            writer->IntNode("Version", 232);
+            writer->BeginNode("Properties70");
+            const double translation[3] = { 0.0, bone == 0 ? 0.0 : 10.0, 0.0 };
+            const double rotation[3] = { random->NextFloat() * 30.0 - 15.0, random->NextFloat() * 30.0 - 15.0, 0.0 };
+            writer->Property70("Lcl Translation", "Lcl Translation", "", "A", translation, 3);
+            writer->Property70("Lcl Rotation", "Lcl Rotation", "", "A", rotation, 3);
+            writer->EndNode();
+            writer->EndNode();
+        }
+
+        //格子を三角形に分けて、triangle_count個だけ使う。shapeは形を決める番号で、複製では元のメッシュの番号
+        void WriteGeometry(FbxWriter* writer, const SceneSpec& spec, int mesh, int shape, Random* random) {
+            int side = GetGridSide(spec);
+            int point_side = side + 1;
+            std::vector<double> vertices;
+            vertices.reserve((size_t)point_side * point_side * 3);
+            for (int y = 0; y < point_side; y++) {
+                for (int x = 0; x < point_side; x++) {
+                    vertices.push_back((double)x);
+                    vertices.push_back(std::sin(x * 0.3 + shape) * 2.0);
+                    vertices.push_back((double)y);
+                }
+            }
+            std::vector<int32_t> polygon_vertex_index;
+            polygon_vertex_index.reserve((size_t)spec.triangleCount * 3);
+            std::vector<double> normals;
+            normals.reserve((size_t)spec.triangleCount * 9);
+            std::vector<int32_t> uv_index;
+            uv_index.reserve((size_t)spec.triangleCount * 3);
+            for (int t = 0; t < spec.triangleCount; t++) {
+                int cell = t / 2;
+                int x = cell % side;
+                int y = cell / side;
+                int p00 = y * point_side + x;
+                int p10 = p00 + 1;
+                int p01 = p00 + point_side;
+                int p11 = p01 + 1;
+                int corner[3] = { p00, p10, p11 };
+                if (t % 2 == 1) {
+                    corner[1] = p11;
+                    corner[2] = p01;
+                }
+                for (int c = 0; c < 3; c++) {
+                    //ポリゴンの最後の頂点はビット反転する
+                    polygon_vertex_index.push_back(c == 2 ? ~corner[c] : corner[c]);
+                    uv_index.push_back(corner[c]);
+                    //法線はコントロールポイントごとに同じ値にして、溶接で頂点が共有されるようにする
+                    double nx = std::cos(corner[c] % point_side * 0.3 + shape) * -0.6;
+                    double length = std::sqrt(nx * nx + 1.0);
+                    normals.push_back(nx / length);
+                    normals.push_back(1.0 / length);
+                    normals.push_back(0.0);
+                }
+            }
+            std::vector<double> uv;
+            uv.reserve((size_t)point_side * point_side * 2);
+            for (int y = 0; y < point_side; y++) {
+                for (int x = 0; x < point_side; x++) {
+                    uv.push_back((double)x / side);
+                    uv.push_back((double)y / side);
+                }
+            }
+
+            writer->BeginNode("Geometry");
+            writer->AddLong(GeometryId(mesh));
+            writer->AddObjectName("mesh" + std::to_string(mesh), "Geometry");
+            writer->AddString("Mesh");
+            writer->ArrayNode("Vertices", 'd', vertices);
+            writer->ArrayNode("PolygonVertexIndex", 'i', polygon_vertex_index);
+            writer->IntNode("GeometryVersion", 124);
+
+            writer->BeginNode("LayerElementNormal");
+            writer->AddInt(0);
+            writer->IntNode("Version", 101);
+            writer->StringNode("Name", "");
+            writer->StringNode("MappingInformationType", "ByPolygonVertex");
+            writer->StringNode("ReferenceInformationType", "Direct");
+            writer->ArrayNode("Normals", 'd', normals);
+            writer->EndNode();
+
+            writer->BeginNode("LayerElementUV");
+            writer->AddInt(0);
+            writer->IntNode("Version", 101);
+            writer->StringNode("Name", "map1");
+            writer->StringNode("MappingInformationType", "ByPolygonVertex");
+            writer->StringNode("ReferenceInformationType", "IndexToDirect");
+            writer->ArrayNode("UV", 'd', uv);
+            writer->ArrayNode("UVIndex", 'i', uv_index);
+            writer->EndNode();
+
+            writer->BeginNode("Layer");
+            writer->AddInt(0);
+            writer->IntNode("Version", 100);
+            const char* element_list[2] = { "LayerElementNormal", "LayerElementUV" };
+            for (const char* element : element_list) {
+                writer->BeginNode("LayerElement");
+                writer->StringNode("Type", element);
+                writer->IntNode("TypedIndex", 0);
+                writer->EndNode();
+            }
+            writer->EndNode();
+            writer->EndNode();
+
+            if (spec.boneCount <= 0) {
+                return;
+            }
+            //コントロールポイントごとにweightsPerVertex本のボーンを選ぶ。近い番号のボーンに偏らせる
+            int point_count = point_side * point_side;
+            int weights_per_vertex = std::max(1, std::min(spec.weightsPerVertex, spec.boneCount));
+            std::vector<std::vector<int32_t>> index_list(spec.boneCount);
+            std::vector<std::vector<double>> weight_list(spec.boneCount);
+            std::vector<int> bone_list(weights_per_vertex);
+            std::vector<float> raw_weight(weights_per_vertex);
+            for (int p = 0; p < point_count; p++) {
+                int base = (int)((int64_t)p * spec.boneCount / point_count);
+                float total = 0.0f;
+                for (int w = 0; w < weights_per_vertex; w++) {
+                    int bone = (base + w * 7 + (int)(random->Next() % 3)) % spec.boneCount;
+                    //同じボーンを2回選ばない
+                    while (std::find(bone_list.begin(), bone_list.begin() + w, bone) != bone_list.begin() + w) {
+                        bone = (bone + 1) % spec.boneCount;
+                    }
+                    bone_list[w] = bone;
+                    raw_weight[w] = 0.05f + random->NextFloat();
+                    total += raw_weight[w];
+                }
+                for (int w = 0; w < weights_per_vertex; w++) {
+                    index_list[bone_list[w]].push_back(p);
+                    weight_list[bone_list[w]].push_back(raw_weight[w] / total);
+                }
+            }
+
+            writer->BeginNode("Deformer");
+            writer->AddLong(SkinId(mesh));
+            writer->AddObjectName("skin" + std::to_string(mesh), "Deformer");
+            writer->AddString("Skin");
+            writer->IntNode("Version", 101);
+            writer->EndNode();
+            const std::vector<double> identity = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+            for (int bone = 0; bone < spec.boneCount; bone++) {
+                writer->BeginNode("Deformer");
+                writer->AddLong(ClusterId(mesh, bone));
+                writer->AddObjectName("cluster" + std::to_string(mesh) + "_" + std::to_string(bone), "SubDeformer");
+                writer->AddString("Cluster");
+                writer->IntNode("Version", 100);
+                writer->ArrayNode("Indexes", 'i', index_list[bone]);
+                writer->ArrayNode("Weights", 'd', weight_list[bone]);
+                writer->ArrayNode("Transform", 'd', identity);
+                writer->ArrayNode("TransformLink", 'd', identity);
+                writer->EndNode();
+            }
+        }
+
+        //チャンネルごとにコントロールポイントの連続した5%を盛り上げるシェイプを1つ作る
+        //Shapeの位置と法線は元の形からの差分で書く
+        void WriteBlendShape(FbxWriter* writer, const SceneSpec& spec, int mesh, Random* random) {
+            int point_side = GetGridSide(spec) + 1;
+            int point_count = point_side * point_side;
+            int shape_point_count = std::max(1, point_count / 20);
+            writer->BeginNode("Deformer");
+            writer->AddLong(BlendShapeId(mesh));
+            writer->AddObjectName("blendshape" + std::to_string(mesh), "Deformer");
+            writer->AddString("BlendShape");
+            writer->IntNode("Version", 100);
+            writer->EndNode();
+            std::vector<int32_t> indexes(shape_point_count);
+            std::vector<double> vertices(shape_point_count * 3);
+            std::vector<double> normals(shape_point_count * 3);
+            const std::vector<double> full_weights = { 100.0 };
+            for (int channel = 0; channel < spec.blendShapeCount; channel++) {
+                std::string name = "shape" + std::to_string(channel);
+                int begin = (int)(random->Next() % (uint32_t)(point_count - shape_point_count + 1));
+                float height = 0.5f + random->NextFloat() * 2.0f;
+                for (int i = 0; i < shape_point_count; i++) {
+                    //端を0にして山の形にする
+                    double t = std::sin((i + 0.5) / shape_point_count * 3.14159265);
+                    indexes[i] = begin + i;
+                    vertices[i * 3 + 0] = 0.0;
+                    vertices[i * 3 + 1] = height * t;
+                    vertices[i * 3 + 2] = 0.0;
+                    normals[i * 3 + 0] = 0.1 * t;
+                    normals[i * 3 + 1] = 0.0;
+                    normals[i * 3 + 2] = -0.1 * t;
+                }
+
+                writer->BeginNode("Deformer");
+                writer->AddLong(ChannelId(mesh, channel));
+                writer->AddObjectName(name, "SubDeformer");
+                writer->AddString("BlendShapeChannel");
+                writer->IntNode("Version", 100);
+                writer->BeginNode("DeformPercent");
+                writer->AddDouble(0.0);
+                writer->EndNode();
+                writer->ArrayNode("FullWeights", 'd', full_weights);
+                writer->EndNode();
+
+                writer->BeginNode("Geometry");
+                writer->AddLong(ShapeId(mesh, channel));
+                writer->AddObjectName(name, "Geometry");
+                writer->AddString("Shape");
+                writer->IntNode("Version", 100);
+                writer->ArrayNode("Indexes", 'i', indexes);
+                writer->ArrayNode("Vertices", 'd', vertices);
+                writer->ArrayNode("Normals", 'd', normals);
+                writer->EndNode();
+            }
+        }
+
+        void WriteMaterial(FbxWriter* writer, int mesh) {
+            writer->BeginNode("Material");
+            writer->AddLong(MaterialId(mesh));
+            writer->AddObjectName("material" + std::to_string(mesh), "Material");
+            writer->AddString("");
+            writer->IntNode("Version", 102);
+            writer->StringNode("ShadingModel", "lambert");
+            writer->EndNode();
+
+            std::string texture_name = "texture" + std::to_string(mesh) + ".png";
+            writer->BeginNode("Texture");
+            writer->AddLong(TextureId(mesh));
+            writer->AddObjectName("texture" + std::to_string(mesh), "Texture");
+            writer->AddString("");
+            writer->StringNode("Type", "TextureVideoClip");
+            writer->StringNode("FileName", "textures/" + texture_name);
+            writer->StringNode("RelativeFilename", "textures/" + texture_name);
+            writer->EndNode();
+        }
+
+        void WriteAnimation(FbxWriter* writer, const SceneSpec& spec, Random* random) {
+            writer->BeginNode("AnimationStack");
+            writer->AddLong(kStackId);
+            writer->AddObjectName("Take 001", "AnimStack");
+            writer->AddString("");
+            writer->BeginNode("Properties70");
+            writer->Property70Time("LocalStart", 0);
+            writer->Property70Time("LocalStop", spec.clipFrameCount * kOneFrameTime);
+            writer->Property70Time("ReferenceStart", 0);
+            writer->Property70Time("ReferenceStop", spec.clipFrameCount * kOneFrameTime);
+            writer->EndNode();
+            writer->EndNode();
+
+            writer->BeginNode("AnimationLayer");
+            writer->AddLong(kLayerId);
+            writer->AddObjectName("BaseLayer", "AnimLayer");
+            writer->AddString("");
+            writer->EndNode();
+
+            std::vector<int64_t> key_time(spec.clipFrameCount + 1);
+            for (int frame = 0; frame <= spec.clipFrameCount; frame++) {
+                key_time[frame] = frame * kOneFrameTime;
+            }
+            //3次補間のフラグを全キーに付ける
+            const std::vector<int32_t> key_attr_flags = { 0x00000008 };
+            const std::vector<float> key_attr_data = { 0.0f, 0.0f, 0.0f, 0.0f };
+            const std::vector<int32_t> key_attr_ref_count = { spec.clipFrameCount + 1 };
+            std::vector<float> key_value(spec.clipFrameCount + 1);
+            for (int bone = 0; bone < spec.boneCount; bone++) {
+                writer->BeginNode("AnimationCurveNode");
+                writer->AddLong(CurveNodeId(bone));
+                writer->AddObjectName("R", "AnimCurveNode");
+                writer->AddString("");
+                writer->EndNode();
+                for (int axis = 0; axis < 3; axis++) {
+                    float amplitude = 5.0f + random->NextFloat() * 40.0f;
+                    float phase = random->NextFloat() * 6.2831853f;
+                    float speed = 0.02f + random->NextFloat() * 0.1f;
+                    for (int frame = 0; frame <= spec.clipFrameCount; frame++) {
+                        key_value[frame] = amplitude * std::sin(phase + frame * speed);
+                    }
+                    writer->BeginNode("AnimationCurve");
+                    writer->AddLong(CurveId(bone, axis));
+                    writer->AddObjectName("", "AnimCurve");
+                    writer->AddString("");
+                    writer->BeginNode("Default");
+                    writer->AddDouble(0.0);
+                    writer->EndNode();
+                    writer->IntNode("KeyVer", 4009);
+                    writer->ArrayNode("KeyTime", 'l', key_time);
+                    writer->ArrayNode("KeyValueFloat", 'f', key_value);
+                    writer->ArrayNode("KeyAttrFlags", 'i', key_attr_flags);
+                    writer->ArrayNode("KeyAttrDataFloat", 'f', key_attr_data);
+                    writer->ArrayNode("KeyAttrRefCount", 'i', key_attr_ref_count);
+                    writer->EndNode();
+                }
+            }
+            //ブレンドシェイプの重みは0～100の間で揺らす
+            for (int mesh = 0; mesh < spec.meshCount && spec.blendShapeCount > 0; mesh++) {
+                for (int channel = 0; channel < spec.blendShapeCount; channel++) {
+                    writer->BeginNode("AnimationCurveNode");
+                    writer->AddLong(ChannelCurveNodeId(mesh, channel));
+                    writer->AddObjectName("DeformPercent", "AnimCurveNode");
+                    writer->AddString("");
+                    writer->EndNode();
+                    float phase = random->NextFloat() * 6.2831853f;
+                    float speed = 0.02f + random->NextFloat() * 0.1f;
+                    for (int frame = 0; frame <= spec.clipFrameCount; frame++) {
+                        key_value[frame] = 50.0f + 50.0f * std::sin(phase + frame * speed);
+                    }
+                    writer->BeginNode("AnimationCurve");
+                    writer->AddLong(ChannelCurveId(mesh, channel));
+                    writer->AddObjectName("", "AnimCurve");
+                    writer->AddString("");
+                    writer->BeginNode("Default");
+                    writer->AddDouble(0.0);
+                    writer->EndNode();
+                    writer->IntNode("KeyVer", 4009);
+                    writer->ArrayNode("KeyTime", 'l', key_time);
+                    writer->ArrayNode("KeyValueFloat", 'f', key_value);
+                    writer->ArrayNode("KeyAttrFlags", 'i', key_attr_flags);
+                    writer->ArrayNode("KeyAttrDataFloat", 'f', key_attr_data);
+                    writer->ArrayNode("KeyAttrRefCount", 'i', key_attr_ref_count);
+                    writer->EndNode();
+                }
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    std::string SceneSpec::GetName() const {
+        char name[128];
+        snprintf(name, sizeof(name), "m%d_t%d_b%d_w%d_f%d_s%u", this->meshCount, this->triangleCount, this->boneCount,
+            this->weightsPerVertex, this->clipFrameCount, this->seed);
+        std::string result = name;
+        if (this->blendShapeCount > 0) {
+            result += "_bs" + std::to_string(this->blendShapeCount);
+        }
+        if (this->instanceCount > 0) {
+            result += "_i" + std::to_string(this->instanceCount);
+        }
+        return result;
+    }
+    //------------------------------------------------------------------------------------------
+    std::vector<uint8_t> GenerateSceneFbx(const SceneSpec& spec) {
+        Random random(spec.seed);
+        FbxWriter writer;
+        bool has_animation = spec.boneCount > 0 && spec.clipFrameCount > 0;
+
+        writer.BeginNode("FBXHeaderExtension");
+        writer.IntNode("FBXHeaderVersion", 1003);
+        writer.IntNode("FBXVersion", 7400);
+        writer.StringNode("Creator", "FBXLoader bench scene generator");
+        writer.EndNode();
+
+        writer.BeginNode("GlobalSettings");
+        writer.IntNode("Version", 1000);
+        writer.BeginNode("Properties70");
+        const double up_axis = 1.0;
+        const double unit_scale = 1.0;
+        writer.Property70("UpAxis", "int", "Integer", "", &up_axis, 1);
+        writer.Property70("UnitScaleFactor", "double", "Number", "", &unit_scale, 1);
+        writer.EndNode();
+        writer.EndNode();
+
+        writer.BeginNode("Objects");
+        for (int bone = 0; bone < spec.boneCount; bone++) {
+            WriteBone(&writer, bone, &random);
+        }
+        for (int mesh = 0; mesh < spec.meshCount; mesh++) {
+            writer.BeginNode("Model");
+            writer.AddLong(MeshModelId(mesh));
+            writer.AddObjectName("mesh" + std::to_string(mesh), "Model");
+            writer.AddString("Mesh");
+            writer.IntNode("Version", 232);
+            writer.EndNode();
+            //複製は同じ乱数の続きから書いて、元と同じ中身にする。元の乱数の進み方は変えない
+            Random copy_random_base = random;
+            WriteGeometry(&writer, spec, mesh, mesh, &random);
+            if (spec.blendShapeCount > 0) {
+                WriteBlendShape(&writer, spec, mesh, &random);
+            }
+            WriteMaterial(&writer, mesh);
+            for (int instance = 0; instance < spec.instanceCount; instance++) {
+                WriteInstanceModel(&writer, spec, mesh, instance);
+                if (!IsCopiedGeometry(instance)) {
+                    continue;
+                }
+                Random copy_random = copy_random_base;
+                WriteGeometry(&writer, spec, InstanceMesh(spec, mesh, instance), mesh, &copy_random);
+                if (spec.blendShapeCount > 0) {
+                    WriteBlendShape(&writer, spec, InstanceMesh(spec, mesh, instance), &copy_random);
+                }
+            }
+        }
+        if (has_animation) {
+            WriteAnimation(&writer, spec, &random);
+        }
+        writer.EndNode();
+
+        writer.BeginNode("Connections");
+        for (int bone = 0; bone < spec.boneCount; bone++) {
+            WriteConnection(&writer, BoneId(bone), bone == 0 ? 0 : BoneId((bone - 1) / 2));
+        }
+        for (int mesh = 0; mesh < spec.meshCount; mesh++) {
+            WriteConnection(&writer, MeshModelId(mesh), 0);
+            WriteConnection(&writer, GeometryId(mesh), MeshModelId(mesh));
+            WriteConnection(&writer, MaterialId(mesh), MeshModelId(mesh));
+            WriteConnection(&writer, TextureId(mesh), MaterialId(mesh), "DiffuseColor");
+            if (spec.boneCount > 0) {
+                WriteConnection(&writer, SkinId(mesh), GeometryId(mesh));
+                for (int bone = 0; bone < spec.boneCount; bone++) {
+                    WriteConnection(&writer, ClusterId(mesh, bone), SkinId(mesh));
+                    WriteConnection(&writer, BoneId(bone), ClusterId(mesh, bone));
+                }
+            }
+            if (spec.blendShapeCount > 0) {
+                WriteConnection(&writer, BlendShapeId(mesh), GeometryId(mesh));
+                for (int channel = 0; channel < spec.blendShapeCount; channel++) {
+                    WriteConnection(&writer, ChannelId(mesh, channel), BlendShapeId(mesh));
+                    WriteConnection(&writer, ShapeId(mesh, channel), ChannelId(mesh, channel));
+                }
+            }
+            for (int instance = 0; instance < spec.instanceCount; instance++) {
+                int instance_mesh = InstanceMesh(spec, mesh, instance);
+                int geometry_mesh = IsCopiedGeometry(instance) ? instance_mesh : mesh;
+                WriteConnection(&writer, MeshModelId(instance_mesh), 0);
+                WriteConnection(&writer, GeometryId(geometry_mesh), MeshModelId(instance_mesh));
+                WriteConnection(&writer, MaterialId(mesh), MeshModelId(instance_mesh));
+                if (!IsCopiedGeometry(instance)) {
+                    continue;
+                }
+                if (spec.boneCount > 0) {
+                    WriteConnection(&writer, SkinId(instance_mesh), GeometryId(instance_mesh));
+                    for (int bone = 0; bone < spec.boneCount; bone++) {
+                        WriteConnection(&writer, ClusterId(instance_mesh, bone), SkinId(instance_mesh));
+                        WriteConnection(&writer, BoneId(bone), ClusterId(instance_mesh, bone));
+                    }
+                }
+                if (spec.blendShapeCount > 0) {
+                    WriteConnection(&writer, BlendShapeId(instance_mesh), GeometryId(instance_mesh));
+                    for (int channel = 0; channel < spec.blendShapeCount; channel++) {
+                        WriteConnection(&writer, ChannelId(instance_mesh, channel), BlendShapeId(instance_mesh));
+                        WriteConnection(&writer, ShapeId(instance_mesh, channel), ChannelId(instance_mesh, channel));
+                    }
+                }
+            }
+        }
+        if (has_animation) {
+            WriteConnection(&writer, kLayerId, kStackId);
+            for (int bone = 0; bone < spec.boneCount; bone++) {
+                WriteConnection(&writer, CurveNodeId(bone), kLayerId);
+                WriteConnection(&writer, CurveNodeId(bone), BoneId(bone), "Lcl Rotation");
+                for (int axis = 0; axis < 3; axis++) {
+                    static const char* kChannelName[3] = { "d|X", "d|Y", "d|Z" };
+                    WriteConnection(&writer, CurveId(bone, axis), CurveNodeId(bone), kChannelName[axis]);
+                }
+            }
+            for (int mesh = 0; mesh < spec.meshCount && spec.blendShapeCount > 0; mesh++) {
+                for (int channel = 0; channel < spec.blendShapeCount; channel++) {
+                    WriteConnection(&writer, ChannelCurveNodeId(mesh, channel), kLayerId);
+                    WriteConnection(&writer, ChannelCurveNodeId(mesh, channel), ChannelId(mesh, channel), "DeformPercent");
+                    WriteConnection(&writer, ChannelCurveId(mesh, channel), ChannelCurveNodeId(mesh, channel), "d|DeformPercent");
+                }
+            }
+        }
+        writer.EndNode();
+        return writer.Finish();
+    }
+    //------------------------------------------------------------------------------------------
+    std::vector<fbx::ModelVertex> MakeGridCornerList(int side, size_t quad_count, float height) {
+        auto make_vertex = [side, height](int x, int y) {
+            fbx::ModelVertex vertex{};
+            vertex.position = glm::vec3((float)x, height, (float)y);
+            vertex.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+            vertex.uv = glm::vec2((float)x / side, (float)y / side);
+            vertex.boneIndex[0] = (uint8_t)(x % 4);
+            vertex.boneWeight = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+            return vertex;
+        };
+
+        std::vector<fbx::ModelVertex> corner_list;
+        corner_list.reserve(quad_count * 6);
+        for (size_t i = 0; i < quad_count; i++) {
+            int x = (int)(i % side);
+            int y = (int)(i / side);
+            corner_list.push_back(make_vertex(x, y));
+            corner_list.push_back(make_vertex(x + 1, y));
+            corner_list.push_back(make_vertex(x, y + 1));
+            corner_list.push_back(make_vertex(x + 1, y));
+            corner_list.push_back(make_vertex(x + 1, y + 1));
+            corner_list.push_back(make_vertex(x, y + 1));
+        }
+        return corner_list;
+    }
+    //------------------------------------------------------------------------------------------
+    bool WriteSceneFbx(const char* filepath, const SceneSpec& spec) {
+        std::vector<uint8_t> data = GenerateSceneFbx(spec);
+        FILE* fp = fopen(filepath, "wb");
+        if (fp == nullptr) {
+            printf("scene generator: cannot open [%s]\n", filepath);
+            return false;
+        }
+        bool result = fwrite(data.data(), 1, data.size(), fp) == data.size();
+        fclose(fp);
+        return result;
+    }
+    //------------------------------------------------------------------------------------------
+}
@@ -0,0 +1,43 @@
+﻿/********************************************************/
+/*          ベンチマーク用のFBXシーンの生成             */
+/********************************************************/
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <model.h>
+
+namespace bench{
+
+//生成するシーンの大きさ。同じ値なら常に同じバイト列になる
+struct SceneSpec {
+    int meshCount = 8;
+    //メッシュ1つあたりの三角形数
+    int triangleCount = 20000;
+    int boneCount = 64;
+    //頂点1つに影響するボーンの数(1～8)。ローダーは大きい方から4つまで使う
+    int weightsPerVertex = 4;
+    //クリップの長さ(60fpsのフレーム数)。0ならアニメーションを入れない
+    int clipFrameCount = 240;
+    //メッシュ1つあたりのブレンドシェイプのチャンネル数。チャンネルごとにシェイプを1つ持ち、コントロールポイントの一部だけを動かす
+    int blendShapeCount = 0;
+    //メッシュ1つあたりに足すノードの数。元と同じGeometryを使うノードと、中身が同じ別のGeometryを持つノードを交互に作る
+    int instanceCount = 0;
+    uint32_t seed = 1;
+
+    //「m8_t20000_b64_w4_f240_s1」のような名前。ブレンドシェイプがあれば「_bs60」、インスタンスがあれば「_i4」が付く
+    std::string GetName() const;
+};
+
+//バイナリFBX(7.4、配列は無圧縮)のバイト列を作る
+//ボーンは2分木の階層、メッシュは格子を三角形に分けたもので、各ボーンのRx,Ry,Rzにキーが毎フレーム入る
+//ブレンドシェイプのチャンネルにもアニメーションがあればDeformPercentにキーが毎フレーム入る
+std::vector<uint8_t> GenerateSceneFbx(const SceneSpec& spec);
+bool WriteSceneFbx(const char* filepath, const SceneSpec& spec);
+
+//溶接の入力にする格子の角頂点(三角形リスト)。1行side個の四角形をquad_count個並べ、高さはheight
+//1頂点は最大6回参照される。uvは位置から、ボーンはxから決まるので、溶接で同じ位置の角は1つになる
+std::vector<fbx::ModelVertex> MakeGridCornerList(int side, size_t quad_count, float height);
+
+}
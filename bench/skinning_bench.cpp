@@ -0,0 +1,123 @@
+﻿#include "bench.h"
+
+#include <cmath>
+#include <thread>
+#include <vector>
+#include <skinning.h>
+
+namespace bench {
+
+    namespace {
+        //ボーン4本までのウェイトをばらばらに持つ頂点
+        fbx::ModelMesh MakeSkinnedMesh(int vertex_count, int bone_count) {
+            fbx::ModelMesh mesh;
+            for (int b = 0; b < bone_count; b++) {
+                mesh.boneNodeNameList.push_back("bone" + std::to_string(b));
+                mesh.invBoneBaseposeMatrixList.push_back(glm::mat4(1.0f));
+            }
+            unsigned int seed = 12345;
+            auto next = [&seed]() {
+                seed = seed * 1103515245u + 12345u;
+                return (seed >> 8) & 0xFFFF;
+            };
+            mesh.vertexList.resize(vertex_count);
+            for (int i = 0; i < vertex_count; i++) {
+                auto& vertex = mesh.vertexList[i];
+                vertex.position = glm::vec3((float)(i % 100), (float)(i / 100 % 100), (float)(i / 10000));
+                vertex.normal = glm::normalize(glm::vec3(1.0f, (float)(i % 7) - 3.0f, 0.5f));
+                vertex.uv = glm::vec2(0.0f, 0.0f);
+                //1〜4本をまんべんなく
+                int influence = 1 + i % 4;
+                float total = 0.0f;
+                for (int j = 0; j < 4; j++) {
+                    vertex.boneIndex[j] = (uint8_t)(next() % bone_count);
+                    vertex.boneWeight[j] = j < influence ? 1.0f + (next() % 100) : 0.0f;
+                    total += vertex.boneWeight[j];
+                }
+                for (int j = 0; j < 4; j++) {
+                    vertex.boneWeight[j] /= total;
+                }
+            }
+            return mesh;
+        }
+
+        std::vector<glm::mat4> MakePalette(int bone_count, int instance_count) {
+            std::vector<glm::mat4> palette_list;
+            for (int i = 0; i < instance_count; i++) {
+                for (int b = 0; b < bone_count; b++) {
+                    float angle = 0.1f * b + 0.01f * i;
+                    glm::mat4 matrix(1.0f);
+                    matrix[0] = glm::vec4(std::cos(angle), std::sin(angle), 0.0f, 0.0f);
+                    matrix[1] = glm::vec4(-std::sin(angle), std::cos(angle), 0.0f, 0.0f);
+                    matrix[3] = glm::vec4((float)b, (float)i, 0.0f, 1.0f);
+                    palette_list.push_back(matrix);
+                }
+            }
+            return palette_list;
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    void RunSkinningBenchmark() {
+        printf("---- cpu skinning -------------------------------\n");
+        const int vertex_count = 100000;
+        const int bone_count = 64;
+        auto mesh = MakeSkinnedMesh(vertex_count, bone_count);
+        auto palette = MakePalette(bone_count, 1);
+        auto default_kernel = fbx::GetSkinningKernel();
+        printf("detected kernel: %s\n", fbx::GetSkinningKernelName(default_kernel));
+
+        //1コアでの速度と、スカラー版との差
+        std::vector<fbx::SkinnedVertex> reference(vertex_count);
+        std::vector<fbx::SkinnedVertex> result(vertex_count);
+        fbx::SetSkinningKernel(fbx::kSkinningScalar);
+        fbx::SkinMesh(reference.data(), mesh, palette.data());
+        printf("[1 core, %d vertices, %d bones]\n", vertex_count, bone_count);
+        printf("%8s %14s %12s\n", "kernel", "Mvertices/s", "max diff");
+        const fbx::SkinningKernel kernel_list[] = { fbx::kSkinningScalar, fbx::kSkinningSse41, fbx::kSkinningAvx2 };
+        for (auto kernel : kernel_list) {
+            if (!fbx::SetSkinningKernel(kernel)) {
+                printf("%8s %14s\n", fbx::GetSkinningKernelName(kernel), "unsupported");
+                continue;
+            }
+            double ms = Measure(5, [&]() {
+                fbx::SkinMesh(result.data(), mesh, palette.data());
+            });
+            float max_diff = 0.0f;
+            for (int i = 0; i < vertex_count; i++) {
+                for (int k = 0; k < 3; k++) {
+                    max_diff = std::max(max_diff, std::abs(result[i].position[k] - reference[i].position[k]));
+                    max_diff = std::max(max_diff, std::abs(result[i].normal[k] - reference[i].normal[k]));
+                }
+            }
+            printf("%8s %14.1f %12g\n", fbx::GetSkinningKernelName(kernel), vertex_count / ms / 1000.0, max_diff);
+        }
+        fbx::SetSkinningKernel(default_kernel);
+
+        //同じメッシュの複数インスタンスをまとめて変換する
+        const int instance_count = 64;
+        const int instance_vertex_count = 8000;
+        auto instance_mesh = MakeSkinnedMesh(instance_vertex_count, bone_count);
+        auto palette_list = MakePalette(bone_count, instance_count);
+        std::vector<fbx::SkinnedVertex> instance_result((size_t)instance_count * instance_vertex_count);
+        printf("[%d instances x %d vertices, kernel:%s]\n", instance_count, instance_vertex_count, fbx::GetSkinningKernelName(default_kernel));
+        printf("%8s %14s %10s\n", "threads", "Mvertices/s", "speedup");
+        int max_thread = std::max(1, (int)std::thread::hardware_concurrency());
+        double base = 0.0;
+        for (int thread_count = 1; ; thread_count = std::min(thread_count * 2, max_thread)) {
+            fbx::ThreadPool thread_pool(thread_count);
+            double ms = Measure(5, [&]() {
+                fbx::SkinMeshInstances(instance_result.data(), instance_mesh, palette_list.data(), instance_count, &thread_pool);
+            });
+            double rate = (double)instance_count * instance_vertex_count / ms / 1000.0;
+            if (thread_count == 1) {
+                base = rate;
+            }
+            printf("%8d %14.1f %10.2f\n", thread_count, rate, rate / base);
+            if (thread_count == max_thread) {
+                break;
+            }
+        }
+    }
+    //------------------------------------------------------------------------------------------
+} // bench
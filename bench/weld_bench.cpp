@@ -0,0 +1,61 @@
+﻿#include "bench.h"
+
+#include <cmath>
+#include <weld.h>
+#include "scene_generator.h"
+
+namespace bench {
+
+    namespace {
+        //ほぼ正方形のグリッドをcorner_count個の角頂点の三角形リストにしたもの
+        std::vector<fbx::ModelVertex> MakeGridCorners(size_t corner_count) {
+            size_t quad_count = std::max<size_t>(1, corner_count / 6);
+            int side = std::max(1, (int)std::sqrt((double)quad_count));
+            return MakeGridCornerList(side, quad_count, 0.0f);
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    void RunWeldBenchmark(bool full) {
+        printf("---- weld ---------------------------------------\n");
+        printf("%10s %10s %14s %14s %14s\n", "corners", "welded", "find[ms]", "hash[ms]", "quantized[ms]");
+
+        const size_t corner_counts[] = { 1000, 10000, 100000, 1000000 };
+        for (auto corner_count : corner_counts) {
+            auto corner_list = MakeGridCorners(corner_count);
+
+            std::vector<fbx::ModelVertex> vertex_list;
+            std::vector<unsigned int> index_list;
+
+            int repeat = corner_count <= 10000 ? 10 : 3;
+            double hash_ms = Measure(repeat, [&]() {
+                fbx::WeldVertices(&vertex_list, &index_list, corner_list, fbx::WeldOption());
+            });
+            size_t welded = vertex_list.size();
+
+            fbx::WeldOption quantized;
+            quantized.positionEpsilon = 1e-4f;
+            quantized.normalEpsilon = 1e-3f;
+            quantized.uvEpsilon = 1e-5f;
+            double quantized_ms = Measure(repeat, [&]() {
+                fbx::WeldVertices(&vertex_list, &index_list, corner_list, quantized);
+            });
+
+            //旧実装はO(n^2)なので、大きなメッシュは--fullの時だけ計測する
+            double find_ms = -1.0;
+            if (full || corner_count <= 100000) {
+                find_ms = Measure(1, [&]() {
+                    fbx::WeldVerticesLinearSearch(&vertex_list, &index_list, corner_list);
+                });
+            }
+
+            if (find_ms < 0.0) {
+                printf("%10d %10d %14s %14.3f %14.3f\n", (int)corner_list.size(), (int)welded, "skip", hash_ms, quantized_ms);
+            }
+            else {
+                printf("%10d %10d %14.3f %14.3f %14.3f\n", (int)corner_list.size(), (int)welded, find_ms, hash_ms, quantized_ms);
+            }
+        }
+    }
+    //------------------------------------------------------------------------------------------
+} // bench
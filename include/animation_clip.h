@@ -0,0 +1,115 @@
+﻿/********************************************************/
+/*          ベイク済みアニメーションクリップ            */
+/********************************************************/
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "model.h"
+
+namespace fbx{
+
+struct BakeOption {
+    //trueならLoadAnimationでクリップを作り、姿勢の計算はクリップで行う
+    bool enable = false;
+    //1秒あたりのサンプル数
+    float sampleRate = 60.0f;
+    //ベイクした後に元のシーン(カーブ)を解放する
+    bool releaseScene = false;
+};
+
+//ノードごとのローカルTRSを一定間隔でサンプリングしたもの
+//キーはチャンネルごとの配列に[node * keyCount + key]の順で並ぶ
+class AnimationClip
+{
+public:
+    AnimationClip();
+
+    //parent_listは親が子より前に来ていること。フレームは60fps単位
+    void Initialize(const std::vector<std::string>& node_name_list, const std::vector<int>& parent_list, float start_frame, float end_frame, float sample_rate);
+    //ローカル行列をTRSに分解して入れる。シアーは捨てる
+    void SetKey(int node_id, int key, const glm::mat4& local_matrix);
+    //keyをサンプリングする時刻(60fps単位のフレーム)
+    float GetKeyFrame(int key) const;
+
+    bool IsEmpty() const {
+        return mKeyCount == 0;
+    }
+    int GetNodeCount() const {
+        return (int)mParentList.size();
+    }
+    int GetKeyCount() const {
+        return mKeyCount;
+    }
+    float GetSampleRate() const {
+        return mSampleRate;
+    }
+    float GetAnimationStartFrame() const {
+        return mStartFrame;
+    }
+    float GetAnimationEndFrame() const {
+        return mEndFrame;
+    }
+    const std::string& GetNodeName(int node_id) const {
+        return mNodeNameList[node_id];
+    }
+    int GetParent(int node_id) const {
+        return mParentList[node_id];
+    }
+    //無ければ-1
+    int FindNode(const std::string& node_name) const;
+    //キーの値そのもの(圧縮などで使う)
+    const glm::vec3& GetTranslationKey(int node_id, int key) const {
+        return mTranslationList[(size_t)node_id * mKeyCount + key];
+    }
+    const glm::quat& GetRotationKey(int node_id, int key) const {
+        return mRotationList[(size_t)node_id * mKeyCount + key];
+    }
+    const glm::vec3& GetScalingKey(int node_id, int key) const {
+        return mScalingList[(size_t)node_id * mKeyCount + key];
+    }
+    //キーの配列が使っているバイト数
+    size_t GetKeyMemorySize() const;
+
+    //frameは60fps単位。キーの間は補間する
+    void EvaluateLocalTransform(int node_id, float frame, glm::vec3* out_translation, glm::quat* out_rotation, glm::vec3* out_scaling) const;
+    glm::mat4 EvaluateLocalMatrix(int node_id, float frame) const;
+    glm::mat4 EvaluateGlobalMatrix(int node_id, float frame) const;
+    //全ノードのグローバル行列。out_global_listにはGetNodeCount()個入る
+    void EvaluatePose(float frame, glm::mat4* out_global_list) const;
+
+private:
+    void GetKeyPosition(float frame, int* out_key, float* out_alpha) const;
+
+    float mSampleRate;
+    float mStartFrame;
+    float mEndFrame;
+    int mKeyCount;
+
+    std::vector<std::string> mNodeNameList;
+    std::vector<int> mParentList;
+    std::map<std::string, int> mNodeIdDictionary;
+
+    std::vector<glm::vec3> mTranslationList;
+    std::vector<glm::quat> mRotationList;
+    std::vector<glm::vec3> mScalingList;
+};
+
+//クリップを使ったGetAnimationMeshMatrix/GetAnimationBoneMatrix。どちらのローダーからも使う
+//フレームは切り捨てずにキーの間を補間する。見つからないノードは単位行列にする
+void GetClipMeshMatrix(glm::mat4* out_matrix, const AnimationClip& clip, float frame, const ModelMesh& mesh);
+void GetClipBoneMatrix(glm::mat4* out_matrix_list, const AnimationClip& clip, float frame, const ModelMesh& mesh);
+
+//親が子より前になる並び順を返す。戻り値[新しい番号] = 元の番号
+std::vector<int> SortNodeByHierarchy(const std::vector<int>& parent_list);
+
+//TRSから行列を作る(T * R * S)
+glm::mat4 ComposeMatrix(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scaling);
+//行列をTRSに分解する。シアーは捨てる
+void DecomposeMatrix(const glm::mat4& matrix, glm::vec3* out_translation, glm::quat* out_rotation, glm::vec3* out_scaling);
+
+}
@@ -0,0 +1,120 @@
+﻿/********************************************************/
+/*          アニメーションクリップの圧縮                */
+/********************************************************/
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "animation_clip.h"
+
+namespace fbx{
+
+struct CompressOption {
+    //ワールド空間での許容誤差(シーンの単位)。全ノード共通
+    //確かめるのは元のクリップのキーの時刻だけで、キーの間の時刻では少し超えることがある
+    float errorTolerance = 0.01f;
+    //ノードごとの許容誤差。空でなければerrorToleranceの代わりに使う(クリップのノード順)
+    std::vector<float> nodeErrorToleranceList;
+    //回転の誤差を測る点までの距離。末端のボーンでも回転の誤差が見えるようにする
+    float shellDistance = 1.0f;
+};
+
+//圧縮したクリップ
+//回転はsmallest-threeで48bit、平行移動と拡縮はチャンネルごとの範囲で16bitずつに量子化し、
+//線形補間で誤差が許容範囲に収まるキーを間引いている(元のキーの時刻で測る)。量子化で誤差が収まらないチャンネルはfloatのまま持つ
+class CompressedClip
+{
+public:
+    CompressedClip();
+
+    bool IsEmpty() const {
+        return mTrackList.empty();
+    }
+    int GetNodeCount() const {
+        return (int)mParentList.size();
+    }
+    float GetAnimationStartFrame() const {
+        return mStartFrame;
+    }
+    float GetAnimationEndFrame() const {
+        return mEndFrame;
+    }
+    const std::string& GetNodeName(int node_id) const {
+        return mNodeNameList[node_id];
+    }
+    int GetParent(int node_id) const {
+        return mParentList[node_id];
+    }
+    int FindNode(const std::string& node_name) const;
+    //残ったキーの数(全ノード・全チャンネルの合計)
+    size_t GetKeyCount() const {
+        return mKeyFrameList.size();
+    }
+    //トラックとキーが使っているバイト数
+    size_t GetKeyMemorySize() const;
+
+    //frameは60fps単位
+    void EvaluateLocalTransform(int node_id, float frame, glm::vec3* out_translation, glm::quat* out_rotation, glm::vec3* out_scaling) const;
+    glm::mat4 EvaluateLocalMatrix(int node_id, float frame) const;
+    //全ノードのグローバル行列。out_global_listにはGetNodeCount()個入る
+    void EvaluatePose(float frame, glm::mat4* out_global_list) const;
+
+private:
+    friend bool CompressAnimationClip(CompressedClip* out_clip, const AnimationClip& clip, const CompressOption& option);
+
+    enum Channel {
+        kTranslation,
+        kRotation,
+        kScaling,
+        kChannelCount,
+    };
+    enum Format {
+        kQuantized,
+        kRaw,
+    };
+    //キー1つの値が使うuint16_tの数
+    static int GetValueStride(int channel, int format) {
+        if (format == kQuantized) {
+            return 3;
+        }
+        return channel == kRotation ? 8 : 6;
+    }
+    //ノード1つの1チャンネル分
+    struct Track {
+        uint32_t keyOffset;
+        uint32_t keyCount;
+        uint32_t valueOffset;
+        uint32_t format;
+        //平行移動と拡縮の量子化の範囲
+        glm::vec3 rangeMin;
+        glm::vec3 rangeExtent;
+    };
+
+    //sample_positionを含む区間のキーと補間係数を探す
+    void FindKey(const Track& track, float sample_position, uint32_t* out_key0, uint32_t* out_key1, float* out_alpha) const;
+    glm::vec3 DecodeVector(const Track& track, uint32_t key) const;
+    glm::quat DecodeRotation(const Track& track, uint32_t key) const;
+
+    float mSampleRate;
+    float mStartFrame;
+    float mEndFrame;
+
+    std::vector<std::string> mNodeNameList;
+    std::vector<int> mParentList;
+
+    //[node * kChannelCount + channel]
+    std::vector<Track> mTrackList;
+    //残したキーのサンプル番号
+    std::vector<uint16_t> mKeyFrameList;
+    //量子化したキー1つにつき3つ。floatのままのキーはビット列をそのまま入れる
+    std::vector<uint16_t> mKeyValueList;
+};
+
+//clipを圧縮する。キーが65536個を超えるクリップは扱えない
+bool CompressAnimationClip(CompressedClip* out_clip, const AnimationClip& clip, const CompressOption& option);
+
+}
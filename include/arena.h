@@ -0,0 +1,161 @@
+﻿/********************************************************/
+/*          線形アロケーターと読み取り専用のビュー      */
+/********************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace fbx{
+
+//連続した要素の読み取り専用のビュー。持ち主(std::vectorやLinearArena)より長く使わないこと
+template<class T>
+class Span
+{
+public:
+    Span() : mData(nullptr), mSize(0) {}
+    Span(const T* data, size_t size) : mData(data), mSize(size) {}
+    template<class Allocator>
+    Span(const std::vector<T, Allocator>& list) : mData(list.data()), mSize(list.size()) {}
+
+    const T* data() const {
+        return mData;
+    }
+    size_t size() const {
+        return mSize;
+    }
+    bool empty() const {
+        return mSize == 0;
+    }
+    const T* begin() const {
+        return mData;
+    }
+    const T* end() const {
+        return mData + mSize;
+    }
+    const T& operator[](size_t index) const {
+        return mData[index];
+    }
+private:
+    const T* mData;
+    size_t mSize;
+};
+
+//-- LinearArena --//
+//大きなブロックから前から順に切り出す。1つずつの解放は無く、マーカーまで巻き戻すかResetでまとめて捨てる
+//スレッドセーフではない
+class LinearArena
+{
+public:
+    //巻き戻す位置
+    struct Marker {
+        size_t block;
+        size_t offset;
+    };
+
+    //block_sizeより大きい確保はその大きさのブロックを1つ作る
+    explicit LinearArena(size_t block_size = 1 << 20);
+    LinearArena(const LinearArena&) = delete;
+    LinearArena& operator=(const LinearArena&) = delete;
+
+    void* Allocate(size_t size, size_t alignment);
+    template<class T>
+    T* AllocateArray(size_t count) {
+        return static_cast<T*>(this->Allocate(sizeof(T) * count, alignof(T)));
+    }
+    //直前に確保した領域なら巻き戻す。それ以外は何もしない(std::vectorの伸長で前のバッファを返す時用)
+    void Free(void* ptr, size_t size);
+
+    Marker GetMarker() const;
+    void Rewind(const Marker& marker);
+    //すべて捨てる。先頭のブロックがkeep_bytes以下なら次に使うために残す
+    void Reset(size_t keep_bytes = 0);
+
+    //切り出したバイト数(詰め物を含む)
+    size_t GetUsedBytes() const {
+        return mUsedBytes;
+    }
+    //GetUsedBytesの最大値
+    size_t GetPeakBytes() const {
+        return mPeakBytes;
+    }
+    //ブロックとして確保しているバイト数
+    size_t GetReservedBytes() const;
+private:
+    struct Block {
+        std::unique_ptr<uint8_t[]> data;
+        size_t size;
+        size_t used;
+    };
+    std::vector<Block> mBlockList;
+    size_t mCurrent;
+    size_t mBlockSize;
+    size_t mUsedBytes;
+    size_t mPeakBytes;
+};
+
+//LinearArenaから確保するSTLのアロケーター。作業用の一時配列に使う
+template<class T>
+class ArenaAllocator
+{
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(LinearArena* arena) : mArena(arena) {}
+    template<class U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : mArena(other.GetArena()) {}
+
+    T* allocate(size_t count) {
+        return mArena->AllocateArray<T>(count);
+    }
+    void deallocate(T* ptr, size_t count) {
+        mArena->Free(ptr, sizeof(T) * count);
+    }
+    LinearArena* GetArena() const {
+        return mArena;
+    }
+    template<class U>
+    bool operator==(const ArenaAllocator<U>& other) const {
+        return mArena == other.GetArena();
+    }
+    template<class U>
+    bool operator!=(const ArenaAllocator<U>& other) const {
+        return mArena != other.GetArena();
+    }
+private:
+    LinearArena* mArena;
+};
+
+template<class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+//スレッドごとの作業用アリーナ。ScratchScopeの中で使う
+LinearArena* GetScratchArena();
+
+//-- ScratchScope --//
+//作った時の位置を覚えておき、抜ける時に作業用アリーナをそこまで巻き戻す
+//一番外側のスコープを抜けたら、先頭の小さなブロック以外をヒープに返す
+class ScratchScope
+{
+public:
+    ScratchScope();
+    ~ScratchScope();
+    ScratchScope(const ScratchScope&) = delete;
+    ScratchScope& operator=(const ScratchScope&) = delete;
+
+    LinearArena* GetArena() const {
+        return mArena;
+    }
+    //このスコープで使う一時配列
+    template<class T>
+    ArenaVector<T> MakeVector() const {
+        return ArenaVector<T>(ArenaAllocator<T>(mArena));
+    }
+private:
+    LinearArena* mArena;
+    LinearArena::Marker mMarker;
+};
+
+}
@@ -0,0 +1,66 @@
+﻿/********************************************************/
+/*          読み込み結果のキャッシュファイル            */
+/********************************************************/
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "model.h"
+#include "weld.h"
+#include "mesh_optimize.h"
+#include "mesh_simplify.h"
+#include "meshlet.h"
+#include "tangent.h"
+#include "mesh_instance.h"
+
+namespace fbx{
+
+//メッシュの作り方が変わったら上げる。古いキャッシュは作り直される
+const uint32_t kAssetCacheLoaderVersion = 2;
+
+//どのローダーで作ったか。ローダーによって結果が少し違うので分けておく
+enum AssetCacheLoader {
+    kAssetCacheFbxSdk = 1,
+    kAssetCacheBinary = 2,
+};
+
+struct CacheOption {
+    //trueならInitializeでキャッシュを読み、無いか古ければ作り直して書く
+    bool enable = false;
+    //キャッシュを置くディレクトリ。空ならモデルと同じ場所
+    std::string directory;
+};
+
+//この値がすべて一致するキャッシュだけを使う
+struct AssetCacheKey {
+    uint64_t contentHash;
+    uint64_t contentSize;
+    //溶接の設定など、結果が変わる設定のハッシュ
+    uint64_t optionHash;
+    uint32_t loader;
+    uint32_t loaderVersion;
+};
+
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed);
+//ファイルの中身と設定からキーを作る
+AssetCacheKey MakeAssetCacheKey(const void* content, size_t content_size, AssetCacheLoader loader, const void* option, size_t option_size);
+//ローダーの溶接・並べ替え・LOD・メッシュレット・接線・インスタンスの設定からキーを作る。溶接以外が無効なら溶接の設定だけのキーと同じになる
+AssetCacheKey MakeAssetCacheKey(const void* content, size_t content_size, AssetCacheLoader loader, const WeldOption& weld_option,
+    const OptimizeOption& optimize_option, const LodOption& lod_option, const MeshletOption& meshlet_option, const TangentOption& tangent_option,
+    const InstanceOption& instance_option);
+//モデルのパスからキャッシュファイルのパスを作る(「ファイル名.meshcache」)
+std::string GetAssetCachePath(const char* source_path, const CacheOption& option);
+
+//キャッシュを読んでリストの後ろに足す。ファイルが無い・壊れている・キーが違う場合はfalseで、リストは変わらない
+//インスタンスのmeshIndexはout_mesh_listに足した位置を指す。out_instance_listはnullptrでもよい
+bool LoadAssetCache(const char* cache_path, const AssetCacheKey& key, std::vector<ModelMesh>* out_mesh_list, std::vector<ModelMaterial>* out_material_list,
+    std::vector<ModelInstance>* out_instance_list = nullptr);
+//キャッシュを書く。一時ファイルに書いてから置き換えるので、途中で止まっても壊れたキャッシュは残らない
+//インスタンスのmeshIndexからinstance_mesh_offsetを引いたものがmesh_listの番号になる
+bool SaveAssetCache(const char* cache_path, const AssetCacheKey& key, const ModelMesh* mesh_list, size_t mesh_count, const ModelMaterial* material_list, size_t material_count,
+    const ModelInstance* instance_list = nullptr, size_t instance_count = 0, int instance_mesh_offset = 0);
+
+}
@@ -0,0 +1,182 @@
+﻿/********************************************************/
+/*          読み込み結果をプロセスで共有する登録簿      */
+/********************************************************/
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include "model.h"
+#include "animation_clip.h"
+#include "geometry_arena.h"
+#include "asset_cache.h"
+
+namespace fbx{
+
+//共有されるメッシュとマテリアル。登録簿から受け取った後は変更しないこと
+struct MeshSet {
+    std::vector<ModelMesh> meshList;
+    std::vector<ModelMaterial> materialList;
+    //InstanceOptionが有効なローダーなら、同じメッシュを置くノードがここに並ぶ
+    std::vector<ModelInstance> instanceList;
+    //頂点・インデックス・LOD・メッシュレットなどの配列のバイト数
+    size_t GetMemorySize() const;
+};
+
+//アニメーションファイル1つ分のベイク済みクリップ。[スタック番号]
+struct AnimationSet {
+    std::vector<AnimationClip> clipList;
+    size_t GetMemorySize() const;
+};
+
+struct AssetRegistryStats {
+    //Acquireの呼ばれた回数
+    uint64_t requestCount = 0;
+    //登録済み(読み込み中を含む)で、読み込まずに済んだ回数
+    uint64_t hitCount = 0;
+    //実際に読み込んだ回数(失敗を含む)
+    uint64_t loadCount = 0;
+    uint64_t failCount = 0;
+    //予算を超えて捨てた数
+    uint64_t evictCount = 0;
+    //登録簿が持っているアセットのバイト数と数
+    size_t residentBytes = 0;
+    size_t entryCount = 0;
+
+    double GetHitRate() const {
+        return this->requestCount == 0 ? 0.0 : (double)this->hitCount / (double)this->requestCount;
+    }
+};
+
+//読み込み結果の登録簿。スレッドセーフ
+//正規化したパス・中身のハッシュ・設定が同じ要求には、同じ読み込み結果を参照カウント付きで渡す
+//読み込み中に来た同じ要求は、その読み込みが終わるのを待って同じ結果を受け取る(読み込みは1回だけ)
+//誰も持っていないアセットは、予算を超えた時に使われたのが古いものから捨てる
+class AssetRegistry
+{
+public:
+    //読み込んでバイト数をout_bytesに書く。失敗ならnullptr
+    typedef std::function<std::shared_ptr<const void>(const char* filepath, size_t* out_bytes)> LoadFunction;
+    //Acquireのkind。独自の種類は100から使う
+    enum AssetKind {
+        kAssetMeshSet = 1,
+        kAssetAnimationSet = 2,
+    };
+
+    AssetRegistry();
+    AssetRegistry(const AssetRegistry&) = delete;
+    AssetRegistry& operator=(const AssetRegistry&) = delete;
+
+    //プロセスで1つの登録簿
+    static AssetRegistry& GetInstance();
+
+    //誰も持っていないアセットを、合計がbytes以下になるまで捨てる。既定は上限なし
+    void SetMemoryBudget(size_t bytes);
+    //誰も持っていないアセットをすべて捨てる
+    void Trim();
+    AssetRegistryStats GetStats() const;
+
+    //LoaderでfilepathのメッシュとマテリアルをMeshSetにする。アニメーションは読まない
+    //setupで溶接などを設定する(ArenaOptionは無効にされる)。option_hashはsetupの設定を区別する値で、同じファイルを違う設定で読むなら変えること
+    template<class Loader>
+    std::shared_ptr<const MeshSet> AcquireMeshSet(const char* filepath, uint64_t option_hash = 0, const std::function<void(Loader*)>& setup = nullptr) {
+        auto asset = this->Acquire(kAssetMeshSet, filepath, HashLoaderType<Loader>(option_hash), [&setup](const char* path, size_t* out_bytes) -> std::shared_ptr<const void> {
+            Loader loader;
+            if (setup) {
+                setup(&loader);
+            }
+            //アリーナはローダーと一緒に消えるので、vectorのまま受け取る
+            loader.SetArenaOption(ArenaOption());
+            if (!loader.Initialize(path, nullptr)) {
+                return nullptr;
+            }
+            auto mesh_set = std::make_shared<MeshSet>();
+            mesh_set->meshList.swap(*loader.GetMeshListPtr());
+            mesh_set->materialList.swap(*loader.GetMaterialListPtr());
+            mesh_set->instanceList.swap(*loader.GetInstanceListPtr());
+            *out_bytes = mesh_set->GetMemorySize();
+            return mesh_set;
+        });
+        return std::static_pointer_cast<const MeshSet>(asset);
+    }
+    //Loaderでfilepathのスタックをすべてsample_rateでベイクしてAnimationSetにする
+    template<class Loader>
+    std::shared_ptr<const AnimationSet> AcquireAnimationSet(const char* filepath, float sample_rate = 60.0f) {
+        uint64_t option_hash = HashBytes(&sample_rate, sizeof(sample_rate), 0);
+        auto asset = this->Acquire(kAssetAnimationSet, filepath, HashLoaderType<Loader>(option_hash), [sample_rate](const char* path, size_t* out_bytes) -> std::shared_ptr<const void> {
+            Loader loader;
+            BakeOption bake_option;
+            bake_option.enable = true;
+            bake_option.sampleRate = sample_rate;
+            bake_option.releaseScene = true;
+            loader.SetBakeOption(bake_option);
+            if (!loader.LoadAnimation(path)) {
+                return nullptr;
+            }
+            auto animation_set = std::make_shared<AnimationSet>();
+            for (const auto& animation : loader.GetAnimationArray()) {
+                animation_set->clipList.push_back(animation.clip);
+            }
+            *out_bytes = animation_set->GetMemorySize();
+            return animation_set;
+        });
+        return std::static_pointer_cast<const AnimationSet>(asset);
+    }
+
+    //種類ごとの読み込み。kindとoption_hashが違えば別のアセットになる
+    std::shared_ptr<const void> Acquire(int kind, const char* filepath, uint64_t option_hash, const LoadFunction& load);
+
+private:
+    struct AssetKey {
+        int kind;
+        uint64_t optionHash;
+        std::string path;
+
+        bool operator < (const AssetKey& key) const {
+            if (this->kind != key.kind) {
+                return this->kind < key.kind;
+            }
+            if (this->optionHash != key.optionHash) {
+                return this->optionHash < key.optionHash;
+            }
+            return this->path < key.path;
+        }
+    };
+    struct Entry {
+        uint64_t contentHash = 0;
+        std::shared_future<std::shared_ptr<const void>> future;
+        //読み込みが終わるまでfalse
+        bool loaded = false;
+        size_t bytes = 0;
+        //最後に使われた順番
+        uint64_t lastUse = 0;
+    };
+
+    //ローダーが違えば結果も少し違うので別のアセットにする
+    template<class Loader>
+    static uint64_t HashLoaderType(uint64_t option_hash) {
+        const char* name = typeid(Loader).name();
+        return HashBytes(name, std::strlen(name), option_hash);
+    }
+    void Evict(size_t budget);
+
+    mutable std::mutex mMutex;
+    std::map<AssetKey, Entry> mEntryMap;
+    AssetRegistryStats mStats;
+    size_t mMemoryBudget;
+    uint64_t mUseCount;
+};
+
+//正規化した絶対パス。Windowsでは大文字と小文字を区別しない。ファイルが無ければ空
+std::string GetCanonicalPath(const char* filepath);
+
+}
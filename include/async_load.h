@@ -0,0 +1,176 @@
+﻿/********************************************************/
+/*          非同期・段階的な読み込み                    */
+/********************************************************/
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "model.h"
+
+namespace fbx{
+
+//Initializeの途中経過を受け取る。読み込んでいるスレッドから呼ばれるが、同時に2つ呼ばれることは無い
+struct LoadListener {
+    //メッシュが1つできるたびに呼ばれる。indexはGetMeshList()での番号。参照は呼ばれている間だけ有効
+    std::function<void(size_t index, const ModelMesh& mesh)> onMesh;
+    //マテリアルが登録されるたびに呼ばれる。indexはGetMaterialList()での番号
+    std::function<void(size_t index, const ModelMaterial& material)> onMaterial;
+    //trueになったら次のメッシュに進まず、Initializeはfalseを返す
+    const std::atomic<bool>* cancel = nullptr;
+
+    bool IsCanceled() const {
+        return this->cancel != nullptr && this->cancel->load(std::memory_order_relaxed);
+    }
+};
+
+enum AsyncLoadState {
+    kAsyncLoadPending,
+    kAsyncLoadRunning,
+    kAsyncLoadSucceeded,
+    kAsyncLoadFailed,
+    kAsyncLoadCanceled,
+};
+
+//読み込み1件分。AsyncLoader::Loadが返す
+class AsyncLoadJob
+{
+public:
+    AsyncLoadJob(const LoadListener& listener, int priority);
+    virtual ~AsyncLoadJob() {}
+    AsyncLoadJob(const AsyncLoadJob&) = delete;
+    AsyncLoadJob& operator=(const AsyncLoadJob&) = delete;
+
+    AsyncLoadState GetState() const {
+        return this->mState.load();
+    }
+    bool IsFinished() const {
+        AsyncLoadState state = this->GetState();
+        return state != kAsyncLoadPending && state != kAsyncLoadRunning;
+    }
+    //終わるまで待つ。成功していればtrue
+    bool Wait();
+    //始まる前なら実行せずに終わる。実行中なら次のメッシュの前で止まる
+    void Cancel();
+
+    //大きいほど先に始まる。始まった後に変えても意味は無い
+    void SetPriority(int priority) {
+        this->mPriority.store(priority);
+    }
+    int GetPriority() const {
+        return this->mPriority.load();
+    }
+
+    //Loadを呼んでから最初のメッシュが届くまでの時間(ms)。まだ届いていなければ負
+    double GetFirstMeshTime() const {
+        return this->mFirstMeshTime.load();
+    }
+    //Loadを呼んでから終わるまでの時間(ms)。終わっていなければ負
+    double GetTotalTime() const {
+        return this->mTotalTime.load();
+    }
+    //今までに届いたメッシュの数
+    size_t GetDeliveredMeshCount() const {
+        return this->mDeliveredMeshCount.load();
+    }
+
+protected:
+    //読み込みを行う。listenerは経過の通知と中止の確認に使う
+    virtual bool Run(const LoadListener& listener) = 0;
+
+private:
+    friend class AsyncLoader;
+
+    void Execute();
+    void Finish(AsyncLoadState state);
+    double GetElapsedMs() const;
+
+    LoadListener mListener;
+    std::atomic<bool> mCancel;
+    std::atomic<int> mPriority;
+    std::atomic<AsyncLoadState> mState;
+    std::atomic<double> mFirstMeshTime;
+    std::atomic<double> mTotalTime;
+    std::atomic<size_t> mDeliveredMeshCount;
+    std::chrono::steady_clock::time_point mRequestTime;
+
+    std::mutex mMutex;
+    std::condition_variable mDoneCondition;
+};
+
+//Loader(FbxLoaderかBinaryFbxLoader)1つ分の読み込み
+template<class Loader>
+class AsyncLoadTask : public AsyncLoadJob
+{
+public:
+    AsyncLoadTask(const char* filepath, const char* animation_path, const LoadListener& listener, int priority)
+        : AsyncLoadJob(listener, priority), mFilepath(filepath), mAnimationPath(animation_path != nullptr ? animation_path : "") {}
+
+    //SetWeldOptionなどはLoadに渡す前に行う。読み込みが終わるまでは触らないこと
+    Loader* GetLoader() {
+        return &this->mLoader;
+    }
+    const Loader* GetLoader() const {
+        return &this->mLoader;
+    }
+
+protected:
+    bool Run(const LoadListener& listener) override {
+        this->mLoader.SetLoadListener(&listener);
+        bool result = this->mLoader.Initialize(this->mFilepath.c_str(), this->mAnimationPath.empty() ? nullptr : this->mAnimationPath.c_str());
+        this->mLoader.SetLoadListener(nullptr);
+        return result;
+    }
+
+private:
+    Loader mLoader;
+    std::string mFilepath;
+    std::string mAnimationPath;
+};
+
+//読み込み専用のスレッドを持ち、優先度の高い順に読み込む
+class AsyncLoader
+{
+public:
+    //thread_countが0以下ならハードウェアのスレッド数にする
+    explicit AsyncLoader(int thread_count);
+    //始まっていない読み込みは中止し、実行中の読み込みは止めてから終わる
+    ~AsyncLoader();
+    AsyncLoader(const AsyncLoader&) = delete;
+    AsyncLoader& operator=(const AsyncLoader&) = delete;
+
+    //すぐに戻る。listenerの関数は読み込み用のスレッドから呼ばれる
+    //listener.cancelは使われないので、中止は返したタスクのCancelで行う
+    template<class Loader>
+    std::shared_ptr<AsyncLoadTask<Loader>> Load(const char* filepath, const char* animation_path, const LoadListener& listener, int priority) {
+        auto task = std::make_shared<AsyncLoadTask<Loader>>(filepath, animation_path, listener, priority);
+        this->Submit(task);
+        return task;
+    }
+    //設定を済ませたタスクを渡す版
+    void Submit(const std::shared_ptr<AsyncLoadJob>& job);
+
+    int GetThreadCount() const {
+        return (int)this->mThreadList.size();
+    }
+
+private:
+    void WorkerMain();
+    std::shared_ptr<AsyncLoadJob> PopJob();
+
+    std::vector<std::thread> mThreadList;
+    std::vector<std::shared_ptr<AsyncLoadJob>> mPendingList;
+    std::vector<std::shared_ptr<AsyncLoadJob>> mRunningList;
+    std::mutex mMutex;
+    std::condition_variable mWakeCondition;
+    bool mExit;
+};
+
+}
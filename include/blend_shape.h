@@ -0,0 +1,84 @@
+﻿/********************************************************/
+/*          ブレンドシェイプ(モーフターゲット)          */
+/********************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "model.h"
+
+namespace fbx{
+
+//チャンネルの重み(DeformPercent、0～100)のカーブ。キーは60fpsのフレーム単位
+struct BlendShapeCurve {
+    //ModelMesh::nodeNameとModelBlendShapeChannel::name
+    std::string meshName;
+    std::string channelName;
+    std::vector<float> keyFrameList;
+    std::vector<float> keyValueList;
+    //キーごとの補間が定数補間かどうか
+    std::vector<uint8_t> keyConstantList;
+
+    float Evaluate(float frame) const;
+};
+
+//溶接の時にコントロールポイントと溶接後の頂点の組を集め、コントロールポイントごとの差分を頂点ごとに広げる
+class BlendShapeVertexMap
+{
+public:
+    explicit BlendShapeVertexMap(size_t control_point_count);
+
+    //角ごとに呼ぶ。vertexはVertexWelder::Addの戻り値
+    void Add(int control_point, unsigned int vertex);
+    //Addが終わったら1回呼ぶ
+    void Build();
+
+    //コントロールポイントから作られた溶接後の頂点
+    const unsigned int* GetVertexBegin(int control_point) const {
+        return mVertexList.data() + mOffsetList[control_point];
+    }
+    const unsigned int* GetVertexEnd(int control_point) const {
+        return mVertexList.data() + mOffsetList[control_point + 1];
+    }
+    size_t GetControlPointCount() const {
+        return mOffsetList.size() - 1;
+    }
+private:
+    std::vector<std::pair<int, unsigned int>> mPairList;
+    std::vector<unsigned int> mOffsetList;
+    std::vector<unsigned int> mVertexList;
+};
+
+//コントロールポイントごとの差分から溶接後の頂点ごとの差分を作る。normal_delta_listはnullptrでもよい
+//差分が0の頂点は入れない。溶接で2つのコントロールポイントが1つの頂点になった時は先のものを使う
+void BuildBlendShapeTarget(ModelBlendShapeTarget* out_target, const BlendShapeVertexMap& vertex_map, const int* control_point_list,
+    const glm::vec3* position_delta_list, const glm::vec3* normal_delta_list, size_t count);
+
+//頂点を並べ直した後に呼ぶ。remap_list[古い番号]が新しい番号で、0xffffffffなら消えた頂点
+void RemapBlendShapeVertices(ModelMesh* mesh, const std::vector<unsigned int>& remap_list);
+
+//全チャンネルのターゲットの数
+size_t GetBlendShapeTargetCount(const ModelMesh& mesh);
+//チャンネルの重み(0～100)からターゲットごとの重み(0～1)を求める。中間の形はfullWeightの間を直線で補間する
+//out_target_weight_listはGetBlendShapeTargetCount個で、チャンネルの順にtargetListを並べたもの
+void GetBlendShapeTargetWeights(float* out_target_weight_list, const ModelMesh& mesh, const float* channel_weight_list);
+//frameの時のチャンネルの重みを求める。カーブの無いチャンネルはdefaultWeight。out_weight_listはblendShapeList.size()個
+void EvaluateBlendShapeWeights(float* out_weight_list, float frame, const ModelMesh& mesh, const std::vector<BlendShapeCurve>& curve_list);
+
+//元の頂点にブレンドシェイプをかけてout_vertex_listに書く。out_vertex_listはmesh.GetVertexSpan().size()個
+//重みが0のターゲットは読まない。法線は正規化しないので、SkinVerticesに渡すか使う側で正規化する
+//カーネルはGetSkinningKernelと同じもの(SetSkinningKernelで固定できる)
+void ApplyBlendShapes(ModelVertex* out_vertex_list, const ModelMesh& mesh, const float* channel_weight_list);
+//GetBlendShapeTargetWeightsの結果を直接渡す版
+void ApplyBlendShapeTargets(ModelVertex* out_vertex_list, const ModelMesh& mesh, const float* target_weight_list);
+
+//差分の大きさ(バイト)。GetBlendShapeDenseMemorySizeは全頂点の差分を持った場合
+size_t GetBlendShapeMemorySize(const ModelMesh& mesh);
+size_t GetBlendShapeDenseMemorySize(const ModelMesh& mesh);
+
+}
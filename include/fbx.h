@@ -7,68 +7,39 @@
 #include <vector>
 #include <algorithm>
 #include <map>
+#include <unordered_map>
 #include <glm/glm.hpp>
 #include <fbxsdk.h>
 
+#include "loader_base.h"
+#include "thread_pool.h"
+#include "blend_shape.h"
+#include "skeleton_binding.h"
+#include "pose_batch.h"
+
 namespace fbx{
     
 typedef void(*LoadFun)(const fbxsdk::FbxObject*);
 
-struct ModelBoneWeight {
-    uint8_t boneIndex[4];
-    glm::vec4 boneWeight;
-};
-
-
-struct ModelVertex {
-    glm::vec3 position;
-    glm::vec3 normal;
-    glm::vec2 uv;
-
-    uint8_t boneIndex[4];
-    glm::vec4 boneWeight;
-
-    bool operator == (const ModelVertex& v) const {
-        return std::memcmp(this, &v, sizeof(ModelVertex)) == 0;
-    }
-};
-
-struct ModelMesh {
-    const std::vector<ModelVertex>& GetVertexList() {
-        return vertexList;
-    }
-    const std::vector<unsigned short> GetIndexList() {
-        return indexList;
-    }
-
-    std::string nodeName;
-    std::string materialName;
-
-    std::vector<ModelVertex> vertexList;
-    std::vector<unsigned short> indexList;
-
-    glm::mat4 invMeshBaseposeMatrix;
-    std::vector<std::string> boneNodeNameList;
-    std::vector<glm::mat4> invBoneBaseposeMatrixList;
-
-};
-
-struct ModelMaterial
-{
-    std::string materialName;
-
-    std::string diffuseTextureName;
-    std::string normalTextureName;
-    std::string specularTextureName;
-    std::string falloffTextureName;
-    std::string reflectionMapTextureName;
+struct DetachOption {
+    //trueならInitializeの最後にアニメーションをすべてベイクし、FBX SDKのシーンとマネージャーを解放する
+    //以降のLoadAnimationは一時的にマネージャーを作り、読み終わったらまた解放する
+    bool enable = false;
 };
 
 struct FbxAnimation {
+    //BakeOption::releaseSceneやDetachの後はnullptr
     FbxScene* fbxSceneAnimation;
+    //Detachの後は空
     std::map<std::string, int> nodeIdDictionaryAnimation;
     float animationStartFrame;
     float animationEndFrame;
+    //BakeOption::enableの時だけ作られる。空でなければ姿勢の計算はこちらで行う
+    AnimationClip clip;
+    //BoundsOption::animationの時だけ作られる。[メッシュ番号]
+    std::vector<AnimationBounds> meshBoundsList;
+    //ブレンドシェイプのチャンネルの重みのカーブ。Detachの後も残る
+    std::vector<BlendShapeCurve> blendShapeCurveList;
     float GetAnimationStartFrame() const {
         return this->animationStartFrame;
     }
@@ -78,39 +49,20 @@ struct FbxAnimation {
     }
 };
 
-class FbxLoader
+class FbxLoader : public LoaderBase
 {
 public:
     FbxLoader();
     ~FbxLoader();
 
-    bool Initialize(const char* filepath, const char* animetion_path);
+    //thread_count: メッシュの解析に使うスレッド数。0ならハードウェアのスレッド数
+    bool Initialize(const char* filepath, const char* animetion_path, int thread_count = 1);
     void Finalize();
 
 public:
-    const std::vector<ModelMesh>& GetMeshList() const {
-        return mMeshList;
-    }
-    std::vector<ModelMesh>* GetMeshListPtr() {
-        return &mMeshList;
-    }
-
-    const std::vector<ModelMaterial>& GetMaterialList() const {
-        return mMaterialList;
-    }
-    std::vector<ModelMaterial>* GetMaterialListPtr() {
-        return &mMaterialList;
-    }
-
     const std::vector<FbxAnimation>& GetAnimationArray() const {
         return mAnimationArray;
     }
-    const int GetMaterialId(const std::string& material_name) const {
-        if (this->mMaterialIdDictionary.size() > 0) {
-            return this->mMaterialIdDictionary.at(material_name);
-        }
-        return 0;
-    }
 
     void GetAnimationMeshMatrix(glm::mat4 *out_matrix, float frame, int meshId, int anim_index) const;
     void GetAnimationMeshMatrix(glm::mat4 *out_matrix, float frame, const ModelMesh& mesh, int anim_index) const;
@@ -118,25 +70,66 @@ public:
     void GetAnimationBoneMatrix(glm::mat4 *out_matrixList, float frame, const ModelMesh& mesh, int matrix_count, int anim_index) const;
     void GetAnimationBoneMatrix(glm::mat4 *out_matrixList, int mesh_id, glm::mat4* matrix_list) const;
     void GetAnimationBoneMatrix(glm::mat4 *out_matrixList, const ModelMesh& mesh, glm::mat4* matrix_list) const;
+    //インスタンスのノードのframeでのグローバル行列。ノードにアニメーションが無ければModelInstance::transform
+    void GetAnimationInstanceMatrix(glm::mat4 *out_matrix, float frame, int instance_id, int anim_index) const;
+
+    //ボーン名の解決を前もって行う。見つからないボーンがあればfalse(結び付けは作られ、そのボーンは単位行列になる)
+    bool CreateSkeletonBinding(SkeletonBinding* out_binding, const ModelMesh& mesh, int anim_index) const;
+    //結び付けを使う版。毎フレームの名前の検索と確保が無い
+    void GetAnimationMeshMatrix(glm::mat4 *out_matrix, float frame, const ModelMesh& mesh, const SkeletonBinding& binding) const;
+    void GetAnimationBoneMatrix(glm::mat4 *out_matrixList, float frame, const ModelMesh& mesh, const SkeletonBinding& binding) const;
+
+    //ModelMesh::skeletonで全関節のグローバル行列を親から順に1回の走査で求め、同時にスキニング用の行列を作る
+    //out_paletteはボーン数、out_global_listは関節数(要らなければnullptr)。bindingはCreateSkeletonBindingで作ったもの
+    void GetAnimationPose(glm::mat4 *out_palette, glm::mat4 *out_global_list, float frame, const ModelMesh& mesh, const SkeletonBinding& binding) const;
+    //全アニメーション分の結び付けを作る。out_binding_list[anim_index]
+    bool CreateSkeletonBindingList(std::vector<SkeletonBinding>* out_binding_list, const ModelMesh& mesh) const;
+    //同じメッシュの複数インスタンスの姿勢をまとめて求める。binding_listはCreateSkeletonBindingListで作ったもの
+    //out_palette_listにはインスタンスごとにボーン数(最低1)ずつ書かれる
+    void GetAnimationPoseBatch(glm::mat4 *out_palette_list, const ModelMesh& mesh, const std::vector<SkeletonBinding>& binding_list,
+        const PoseRequest* request_list, size_t request_count, ThreadPool* thread_pool) const;
+
+    //メッシュがアニメーションのframeの時に入る範囲。スキニング後の頂点(ボーンが無ければGetAnimationMeshMatrixで移した頂点)が入る
+    //BoundsOption::animationが有効ならLoadAnimationで作った表を引くだけ。無効ならその場で姿勢を求めて作る
+    void GetAnimationBounds(ModelBounds* out_bounds, float frame, int mesh_id, int anim_index) const;
+    //アニメーションのframeの時のブレンドシェイプのチャンネルの重み(0～100)。out_weight_listはmesh.blendShapeList.size()個
+    //カーブの無いチャンネルはdefaultWeight。ApplyBlendShapesに渡す
+    void GetAnimationBlendShapeWeight(float* out_weight_list, float frame, const ModelMesh& mesh, int anim_index) const;
 
     bool LoadAnimation(const char* filepath);
+
+    //Initialize・LoadAnimationの後に呼ぶ。ベイクされていないアニメーションをベイクしてから、SDKのシーンとマネージャーを解放する
+    //メッシュ・マテリアル・姿勢の取得はそのまま使える。前に作ったSkeletonBindingも使えるが、毎回名前を引くので作り直した方が速い
+    void Detach();
+    bool IsDetached() const {
+        return mDetached;
+    }
+
+    //Initializeの前に呼ぶ
+    void SetDetachOption(const DetachOption& option) {
+        mDetachOption = option;
+    }
 protected:
 
     FbxManager* mManagerPtr;
     FbxScene* mScenePtr;
 
-    ModelMesh ParseMesh(FbxMesh* mesh);
-    void ParseNode(FbxNode *nodee);
+    void CreateManager();
+    void PrepareMesh(FbxMesh* mesh, ModelMesh* out_mesh);
+    void ParseMesh(FbxMesh* mesh, ModelMesh* model_mesh);
+    void ParseNode(FbxNode *nodee, std::vector<FbxMesh*>* out_mesh_list, std::unordered_map<FbxMesh*, int>* out_mesh_index);
     void ParseMaterialList(FbxMesh *mesh);
     void ParseMaterial(FbxSurfaceMaterial *material);
+    void BakeAnimation(FbxAnimation* animation, int stack_index);
+    void EvaluateBoundsPalette(glm::mat4* out_palette, float frame, const ModelMesh& mesh, const SkeletonBinding& binding) const;
+    void BuildAnimationBoundsList(int anim_index);
+    void MergeSameMeshes(size_t mesh_offset, size_t instance_offset, const std::vector<uint64_t>& content_hash_list);
+    void DiscardUndeliveredMeshes(size_t mesh_offset, size_t instance_offset, const std::vector<uint8_t>& delivered_list);
     std::vector<FbxAnimation> mAnimationArray;
 
-    std::vector<ModelMesh> mMeshList;
-    std::vector<ModelMaterial> mMaterialList;
-    std::map<std::string, int> mMaterialIdDictionary;
     std::map<std::string, int> mNodeIdDictionary;
-
-    int mMaterialNum;
+    DetachOption mDetachOption;
+    bool mDetached;
 
 };
 
@@ -0,0 +1,246 @@
+﻿/********************************************************/
+/*          バイナリFBXの直接読み込み(FBX SDK不要)       */
+/********************************************************/
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <glm/glm.hpp>
+
+#include "loader_base.h"
+#include "blend_shape.h"
+#include "skeleton_binding.h"
+#include "pose_batch.h"
+
+namespace fbx{
+namespace binary{
+
+//ファイルをメモリにマップする。読み込み専用
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const char* filepath);
+    void Close();
+
+    const uint8_t* GetData() const {
+        return mData;
+    }
+    size_t GetSize() const {
+        return mSize;
+    }
+private:
+    const uint8_t* mData;
+    size_t mSize;
+#ifdef _WIN32
+    void* mFileHandle;
+    void* mMappingHandle;
+#endif
+};
+
+//zlib形式のデータを展開する。dst_sizeぴったりに展開できた時だけtrue
+bool Inflate(const uint8_t* src, size_t src_size, uint8_t* dst, size_t dst_size);
+
+//ノードレコードのプロパティ。マップしたメモリを直接指している
+struct Property {
+    char type;
+    const uint8_t* data;
+    //S,Rならバイト数、配列なら要素数
+    uint32_t length;
+    //配列の場合のみ。1ならzlibで圧縮されている
+    uint32_t encoding;
+    uint32_t compressedLength;
+
+    bool IsArray() const {
+        return type == 'f' || type == 'd' || type == 'l' || type == 'i' || type == 'b';
+    }
+    int64_t GetInt() const;
+    double GetDouble() const;
+    std::string GetString() const;
+};
+
+//配列プロパティの中身。圧縮されていなければマップしたメモリをそのまま参照する
+class ArrayView
+{
+public:
+    ArrayView() : mType(0), mData(nullptr), mCount(0) {}
+    explicit ArrayView(const Property& property);
+
+    size_t size() const {
+        return mCount;
+    }
+    bool empty() const {
+        return mCount == 0;
+    }
+    double GetDouble(size_t i) const;
+    int64_t GetInt(size_t i) const;
+private:
+    char mType;
+    const uint8_t* mData;
+    size_t mCount;
+    //圧縮されていた場合だけ展開先を持つ
+    std::shared_ptr<std::vector<uint8_t>> mInflated;
+};
+
+struct Node {
+    const char* name;
+    uint32_t nameLength;
+    uint32_t firstProperty;
+    uint32_t propertyCount;
+    int firstChild;
+    int nextSibling;
+
+    bool NameIs(const char* str) const;
+};
+
+//ノードレコードの木。ノードとプロパティの配列だけを持ち、中身はマップしたメモリを指す
+class Document
+{
+public:
+    bool Parse(const uint8_t* data, size_t size);
+
+    uint32_t GetVersion() const {
+        return mVersion;
+    }
+    //最上位のノード(仮想的なルートの子)の先頭
+    int GetFirstTopNode() const {
+        return mNodeList.empty() ? -1 : mNodeList[0].firstChild;
+    }
+    const Node& GetNode(int index) const {
+        return mNodeList[index];
+    }
+    const Property& GetProperty(const Node& node, int index) const {
+        return mPropertyList[node.firstProperty + index];
+    }
+    int FindChild(int node_index, const char* name) const;
+    int FindTopNode(const char* name) const;
+private:
+    bool ParseNodeList(int parent, size_t begin, size_t end);
+
+    const uint8_t* mData = nullptr;
+    size_t mSize = 0;
+    uint32_t mVersion = 0;
+    std::vector<Node> mNodeList;
+    std::vector<Property> mPropertyList;
+};
+
+//キーは60fpsのフレーム単位
+struct AnimationCurve {
+    std::vector<float> keyFrameList;
+    std::vector<float> keyValueList;
+    //キーごとの補間が定数補間かどうか
+    std::vector<uint8_t> keyConstantList;
+
+    float Evaluate(float frame) const;
+};
+
+struct AnimationNode {
+    std::string name;
+    int parent;
+
+    glm::vec3 translation;
+    glm::vec3 rotation;
+    glm::vec3 scaling;
+    glm::vec3 preRotation;
+    glm::vec3 postRotation;
+    glm::vec3 rotationOffset;
+    glm::vec3 rotationPivot;
+    glm::vec3 scalingOffset;
+    glm::vec3 scalingPivot;
+    int rotationOrder;
+    //falseならpreRotation・postRotation・rotationOrderは使わない(FBX SDKと同じ)
+    bool rotationActive;
+
+    //Tx,Ty,Tz,Rx,Ry,Rz,Sx,Sy,Sz の順でcurveListの番号を持つ。無ければ-1
+    int curve[9];
+};
+
+//ノードの階層とアニメーションカーブ。FbxSceneの代わりに使う
+struct AnimationScene {
+    std::vector<AnimationNode> nodeList;
+    std::vector<AnimationCurve> curveList;
+    std::map<std::string, int> nodeIdDictionaryAnimation;
+    float animationStartFrame;
+    float animationEndFrame;
+    //BakeOption::enableの時だけ作られる。空でなければ姿勢の計算はこちらで行う
+    AnimationClip clip;
+    //BoundsOption::animationの時だけ作られる。[メッシュ番号]
+    std::vector<AnimationBounds> meshBoundsList;
+    //ブレンドシェイプのチャンネルの重みのカーブ。ベイクしても残る
+    std::vector<BlendShapeCurve> blendShapeCurveList;
+
+    float GetAnimationStartFrame() const {
+        return this->animationStartFrame;
+    }
+    float GetAnimationEndFrame() const {
+        return this->animationEndFrame;
+    }
+    //frameが負ならアニメーションを使わずにデフォルト値で計算する
+    glm::mat4 EvaluateLocalTransform(int node_id, float frame) const;
+    glm::mat4 EvaluateGlobalTransform(int node_id, float frame) const;
+};
+
+//ノードごとのローカル行列を一定間隔で取り出してscene->clipにする
+void BakeAnimationScene(AnimationScene* scene, const BakeOption& option);
+
+//FbxLoaderと同じ結果をFBX SDKを使わずに作る。7.xのバイナリ形式のみ対応
+class BinaryFbxLoader : public LoaderBase
+{
+public:
+    BinaryFbxLoader();
+    ~BinaryFbxLoader();
+
+    bool Initialize(const char* filepath, const char* animetion_path);
+    void Finalize();
+
+public:
+    const std::vector<AnimationScene>& GetAnimationArray() const {
+        return mAnimationArray;
+    }
+
+    void GetAnimationMeshMatrix(glm::mat4 *out_matrix, float frame, int meshId, int anim_index) const;
+    void GetAnimationMeshMatrix(glm::mat4 *out_matrix, float frame, const ModelMesh& mesh, int anim_index) const;
+    void GetAnimationBoneMatrix(glm::mat4 *out_matrixList, float frame, int meshId, int matrix_count, int anim_index) const;
+    void GetAnimationBoneMatrix(glm::mat4 *out_matrixList, float frame, const ModelMesh& mesh, int matrix_count, int anim_index) const;
+    //インスタンスのノードのframeでのグローバル行列。ノードにアニメーションが無ければModelInstance::transform
+    void GetAnimationInstanceMatrix(glm::mat4 *out_matrix, float frame, int instance_id, int anim_index) const;
+
+    //ボーン名の解決を前もって行う。見つからないボーンがあればfalse(結び付けは作られ、そのボーンは単位行列になる)
+    bool CreateSkeletonBinding(SkeletonBinding* out_binding, const ModelMesh& mesh, int anim_index) const;
+    //結び付けを使う版。毎フレームの名前の検索と確保が無い
+    void GetAnimationMeshMatrix(glm::mat4 *out_matrix, float frame, const ModelMesh& mesh, const SkeletonBinding& binding) const;
+    void GetAnimationBoneMatrix(glm::mat4 *out_matrixList, float frame, const ModelMesh& mesh, const SkeletonBinding& binding) const;
+
+    //ModelMesh::skeletonで全関節のグローバル行列を親から順に1回の走査で求め、同時にスキニング用の行列を作る
+    //out_paletteはボーン数、out_global_listは関節数(要らなければnullptr)。bindingはCreateSkeletonBindingで作ったもの
+    void GetAnimationPose(glm::mat4 *out_palette, glm::mat4 *out_global_list, float frame, const ModelMesh& mesh, const SkeletonBinding& binding) const;
+    //全アニメーション分の結び付けを作る。out_binding_list[anim_index]
+    bool CreateSkeletonBindingList(std::vector<SkeletonBinding>* out_binding_list, const ModelMesh& mesh) const;
+    //同じメッシュの複数インスタンスの姿勢をまとめて求める。binding_listはCreateSkeletonBindingListで作ったもの
+    //out_palette_listにはインスタンスごとにボーン数(最低1)ずつ書かれる
+    void GetAnimationPoseBatch(glm::mat4 *out_palette_list, const ModelMesh& mesh, const std::vector<SkeletonBinding>& binding_list,
+        const PoseRequest* request_list, size_t request_count, ThreadPool* thread_pool) const;
+
+    //メッシュがアニメーションのframeの時に入る範囲。スキニング後の頂点(ボーンが無ければGetAnimationMeshMatrixで移した頂点)が入る
+    //BoundsOption::animationが有効ならLoadAnimationで作った表を引くだけ。無効ならその場で姿勢を求めて作る
+    void GetAnimationBounds(ModelBounds* out_bounds, float frame, int mesh_id, int anim_index) const;
+    //アニメーションのframeの時のブレンドシェイプのチャンネルの重み(0～100)。out_weight_listはmesh.blendShapeList.size()個
+    //カーブの無いチャンネルはdefaultWeight。ApplyBlendShapesに渡す
+    void GetAnimationBlendShapeWeight(float* out_weight_list, float frame, const ModelMesh& mesh, int anim_index) const;
+
+    bool LoadAnimation(const char* filepath);
+protected:
+    std::vector<AnimationScene> mAnimationArray;
+
+    void EvaluateBoundsPalette(glm::mat4* out_palette, float frame, const ModelMesh& mesh, const SkeletonBinding& binding) const;
+    void BuildAnimationBoundsList(int anim_index);
+};
+
+}
+}
@@ -0,0 +1,24 @@
+﻿/********************************************************/
+/*          読み込んだ頂点とインデックスの詰め直し      */
+/********************************************************/
+#pragma once
+
+#include <cstddef>
+#include "model.h"
+#include "arena.h"
+
+namespace fbx{
+
+struct ArenaOption {
+    //trueならメッシュができるたびに頂点とインデックスをローダーのアリーナに移す(キャッシュから読んだ時は全メッシュを1つのブロックに)
+    //ModelMesh::vertexList・indexList・indexList32は空になり、GetVertexSpanなどのビューで読む
+    //注意: vertexListなどを直接読むコードには頂点が無いように見える
+    //注意: ビューはローダーのアリーナを指すので、ModelMeshを写してもローダーを破棄・Finalizeした後は使えない
+    //      ローダーより長く持つならこのオプションを使わないこと(AssetRegistryもそうしている)
+    bool enable = false;
+};
+
+//mesh_listの頂点とインデックスをarenaの1つのブロックに写してビューを張り、元のリストのメモリを返す。戻り値は写したバイト数
+size_t PackMeshGeometry(LinearArena* arena, ModelMesh* mesh_list, size_t mesh_count);
+
+}
@@ -0,0 +1,132 @@
+﻿/********************************************************/
+/*          読み込みの区間ごとの時間と数の記録          */
+/********************************************************/
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//FBX_DISABLE_PROFILERを定義するとFBX_PROFILE_*の呼び出しがすべて消える
+#ifndef FBX_DISABLE_PROFILER
+#define FBX_PROFILE_JOIN_(a, b) a##b
+#define FBX_PROFILE_JOIN(a, b) FBX_PROFILE_JOIN_(a, b)
+#define FBX_PROFILE_SCOPE(profiler, name) fbx::ProfileScope FBX_PROFILE_JOIN(fbx_profile_scope_, __LINE__)((profiler), (name))
+#define FBX_PROFILE_COUNT(profiler, counter, value) (profiler)->AddCounter((counter), (int64_t)(value))
+#else
+#define FBX_PROFILE_SCOPE(profiler, name) ((void)0)
+#define FBX_PROFILE_COUNT(profiler, counter, value) ((void)0)
+#endif
+
+//途中経過の表示。FBX_VERBOSE_LOGを定義した時だけ出す(コンソールへの出力は大きなシーンで無視できない時間になる)
+#ifdef FBX_VERBOSE_LOG
+#define FBX_LOG(...) printf(__VA_ARGS__)
+#else
+#define FBX_LOG(...) ((void)0)
+#endif
+
+namespace fbx{
+
+enum LoadCounter {
+    kCounterMesh,
+    kCounterMaterial,
+    //溶接前(三角形の角ごと)と溶接後の頂点数
+    kCounterVertexBeforeWeld,
+    kCounterVertexAfterWeld,
+    kCounterIndex,
+    //メッシュの頂点・インデックスのバッファに確保したバイト数
+    kCounterMeshBytes,
+    kCounterSkinCluster,
+    kCounterAnimationNode,
+    //並べ替えの前後の頂点シェーダーの実行回数(FIFOキャッシュで数えたもの)。三角形数で割るとACMR
+    kCounterTransformBeforeOptimize,
+    kCounterTransformAfterOptimize,
+    //作ったLODのインデックスの合計
+    kCounterLodIndex,
+    kCounterMeshlet,
+    //ArenaOptionでローダーのアリーナに詰め直したバイト数
+    kCounterArenaBytes,
+    //メッシュを置くノードの数。InstanceOptionが有効ならkCounterMeshより多くなる
+    kCounterInstance,
+    kLoadCounterCount,
+};
+
+class LoadProfiler
+{
+public:
+    struct Event {
+        //文字列リテラルを指す
+        const char* name;
+        //記録した順に0から振った番号
+        int thread;
+        //Clearしてからの時間(us)
+        double beginUs;
+        double durationUs;
+    };
+
+    LoadProfiler();
+    LoadProfiler(const LoadProfiler&) = delete;
+    LoadProfiler& operator=(const LoadProfiler&) = delete;
+
+    //記録を捨てて時間の基準を今にする。読み込みの途中では呼ばないこと
+    void Clear();
+    double GetTimeUs() const {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - this->mOrigin).count();
+    }
+
+    //どのスレッドから呼んでもよい
+    void AddEvent(const char* name, double begin_us, double end_us);
+    void AddCounter(LoadCounter counter, int64_t value) {
+        this->mCounter[counter].fetch_add(value, std::memory_order_relaxed);
+    }
+
+    int64_t GetCounter(LoadCounter counter) const {
+        return this->mCounter[counter].load(std::memory_order_relaxed);
+    }
+    std::vector<Event> GetEventList() const;
+    //同じ名前の区間の合計(ms)。スレッドをまたいだ区間はそのまま足す
+    double GetPhaseTime(const char* name) const;
+
+    //区間ごとの合計時間と数の一覧
+    void PrintSummary() const;
+    //chrome://tracing や Perfetto で開けるJSONを書く
+    bool WriteChromeTrace(const char* filepath) const;
+
+    static const char* GetCounterName(LoadCounter counter);
+
+private:
+    std::chrono::steady_clock::time_point mOrigin;
+    std::atomic<int64_t> mCounter[kLoadCounterCount];
+
+    mutable std::mutex mMutex;
+    std::vector<Event> mEventList;
+    std::vector<std::thread::id> mThreadList;
+};
+
+//作ってから壊れるまでをnameの区間として記録する。profilerがnullptrなら何もしない
+class ProfileScope
+{
+public:
+    ProfileScope(LoadProfiler* profiler, const char* name) : mProfiler(profiler), mName(name) {
+        if (this->mProfiler != nullptr) {
+            this->mBeginUs = this->mProfiler->GetTimeUs();
+        }
+    }
+    ~ProfileScope() {
+        if (this->mProfiler != nullptr) {
+            this->mProfiler->AddEvent(this->mName, this->mBeginUs, this->mProfiler->GetTimeUs());
+        }
+    }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+private:
+    LoadProfiler* mProfiler;
+    const char* mName;
+    double mBeginUs = 0.0;
+};
+
+}
@@ -0,0 +1,163 @@
+﻿/********************************************************/
+/*          ローダー共通部分                            */
+/********************************************************/
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "model.h"
+#include "weld.h"
+#include "mesh_optimize.h"
+#include "mesh_simplify.h"
+#include "meshlet.h"
+#include "tangent.h"
+#include "mesh_instance.h"
+#include "mesh_bounds.h"
+#include "geometry_arena.h"
+#include "animation_clip.h"
+#include "asset_cache.h"
+#include "async_load.h"
+#include "load_profiler.h"
+
+namespace fbx{
+
+//溶接とブレンドシェイプの後の、メッシュごとの共通の処理。接線・LOD・並べ替え・メッシュレット・範囲を作り、頂点数などをprofilerに数える
+//ワーカースレッドから呼んでもよい(meshとprofiler以外は書き換えない)
+void FinishLoadedMesh(ModelMesh* mesh, const TangentOption& tangent_option, const LodOption& lod_option,
+    const OptimizeOption& optimize_option, const MeshletOption& meshlet_option, LoadProfiler* profiler);
+
+//FbxLoaderとBinaryFbxLoaderの共通部分。読み込んだメッシュ・マテリアル・インスタンスと設定を持つ
+class LoaderBase
+{
+public:
+    LoaderBase();
+
+    const std::vector<ModelMesh>& GetMeshList() const {
+        return mMeshList;
+    }
+    std::vector<ModelMesh>* GetMeshListPtr() {
+        return &mMeshList;
+    }
+
+    const std::vector<ModelMaterial>& GetMaterialList() const {
+        return mMaterialList;
+    }
+    std::vector<ModelMaterial>* GetMaterialListPtr() {
+        return &mMaterialList;
+    }
+    //メッシュを置くノードの一覧。InstanceOptionが無効ならメッシュと同じ数・同じ順
+    const std::vector<ModelInstance>& GetInstanceList() const {
+        return mInstanceList;
+    }
+    std::vector<ModelInstance>* GetInstanceListPtr() {
+        return &mInstanceList;
+    }
+
+    int GetMaterialId(const std::string& material_name) const {
+        if (this->mMaterialIdDictionary.size() > 0) {
+            return this->mMaterialIdDictionary.at(material_name);
+        }
+        return 0;
+    }
+
+    //Initializeの前に呼ぶ
+    void SetWeldOption(const WeldOption& option) {
+        mWeldOption = option;
+    }
+    //Initializeの前に呼ぶ。溶接の後に三角形と頂点を頂点キャッシュ向けに並べ替える
+    void SetOptimizeOption(const OptimizeOption& option) {
+        mOptimizeOption = option;
+    }
+    //Initializeの前に呼ぶ。溶接の後にModelMesh::lodListを作る
+    void SetLodOption(const LodOption& option) {
+        mLodOption = option;
+    }
+    //Initializeの前に呼ぶ。メッシュごとの最後にModelMesh::meshletListを作る
+    void SetMeshletOption(const MeshletOption& option) {
+        mMeshletOption = option;
+    }
+    //Initializeの前に呼ぶ。溶接の後にModelMesh::tangentListを作る
+    void SetTangentOption(const TangentOption& option) {
+        mTangentOption = option;
+    }
+    //Initializeの前に呼ぶ。同じジオメトリを使うノードのメッシュを1つにまとめる
+    void SetInstanceOption(const InstanceOption& option) {
+        mInstanceOption = option;
+    }
+    //Initializeの前に呼ぶ。できたメッシュから順に頂点とインデックスをローダーのアリーナに詰め直す
+    void SetArenaOption(const ArenaOption& option) {
+        mArenaOption = option;
+    }
+    //LoadAnimationの前に呼ぶ。アニメーションごとの範囲の表を作るかどうか
+    void SetBoundsOption(const BoundsOption& option) {
+        mBoundsOption = option;
+    }
+    //LoadAnimationの前に呼ぶ
+    void SetBakeOption(const BakeOption& option) {
+        mBakeOption = option;
+    }
+    //Initializeの前に呼ぶ
+    void SetCacheOption(const CacheOption& option) {
+        mCacheOption = option;
+    }
+    //Initializeの途中でメッシュとマテリアルを1つずつ受け取る。nullptrなら通知しない
+    void SetLoadListener(const LoadListener* listener) {
+        mLoadListener = listener;
+    }
+
+    //読み込みの区間ごとの時間と頂点数などの記録。FBX_DISABLE_PROFILERを定義すると何も記録されない
+    const LoadProfiler& GetProfiler() const {
+        return mProfiler;
+    }
+    LoadProfiler* GetProfilerPtr() {
+        return &mProfiler;
+    }
+    //ArenaOptionで詰め直した頂点とインデックスの置き場所
+    const LinearArena& GetGeometryArena() const {
+        return mGeometryArena;
+    }
+protected:
+    std::vector<ModelMesh> mMeshList;
+    std::vector<ModelMaterial> mMaterialList;
+    std::vector<ModelInstance> mInstanceList;
+    std::map<std::string, int> mMaterialIdDictionary;
+
+    int mMaterialNum;
+    WeldOption mWeldOption;
+    OptimizeOption mOptimizeOption;
+    LodOption mLodOption;
+    MeshletOption mMeshletOption;
+    TangentOption mTangentOption;
+    InstanceOption mInstanceOption;
+    BoundsOption mBoundsOption;
+    ArenaOption mArenaOption;
+    BakeOption mBakeOption;
+    CacheOption mCacheOption;
+    const LoadListener* mLoadListener;
+    LoadProfiler mProfiler;
+    LinearArena mGeometryArena;
+
+    //設定をそのまま渡してFinishLoadedMeshを呼ぶ
+    void FinishMesh(ModelMesh* mesh) {
+        FinishLoadedMesh(mesh, this->mTangentOption, this->mLodOption, this->mOptimizeOption, this->mMeshletOption, &this->mProfiler);
+    }
+    //CacheOptionが有効ならキーとパスを作ってキャッシュを読む。各offsetは読む前のリストの要素数
+    //読めたらマテリアルを辞書に登録し、通知と詰め直しまで行ってtrue。読めなければfalseで、out_cache_pathに書き込み先が入る(キャッシュが無効なら空)
+    bool ReadCache(const char* filepath, const void* content, size_t content_size, AssetCacheLoader loader,
+        size_t mesh_offset, size_t material_offset, size_t instance_offset, std::string* out_cache_path, AssetCacheKey* out_cache_key);
+    //各offsetから後ろに足したものをキャッシュに書く。cache_pathが空なら何もしない
+    void WriteCache(const std::string& cache_path, const AssetCacheKey& cache_key, size_t mesh_offset, size_t material_offset, size_t instance_offset);
+    //material_offsetから後ろのマテリアルを辞書に登録する(先に登録した方が優先)
+    void RegisterMaterialList(size_t material_offset);
+    void NotifyMesh(size_t index);
+    void NotifyMaterial(size_t index);
+    //読み込んだメッシュの頂点とインデックスをアリーナの1つのブロックに移す
+    void PackGeometry(size_t mesh_offset, size_t mesh_count);
+    //メッシュ・マテリアル・インスタンスと辞書を空にし、マテリアルの番号とアリーナを戻す
+    void ClearLoadedData();
+};
+
+}
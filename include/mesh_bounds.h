@@ -0,0 +1,56 @@
+﻿/********************************************************/
+/*          メッシュとアニメーションの範囲              */
+/********************************************************/
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <glm/glm.hpp>
+#include "model.h"
+
+namespace fbx{
+
+struct BoundsOption {
+    //trueならLoadAnimationでメッシュとアニメーションの組ごとに範囲の表を作る
+    bool animation = false;
+    //表の1つの範囲がまとめるフレーム数(60fps単位)。大きくすると表は小さくなるが範囲は広がる
+    float segmentLength = 1.0f;
+    //区間の中で姿勢を求める間隔(60fps単位)。区間の両端は必ず求める
+    float sampleStep = 1.0f;
+    //サンプルの間の補間での膨らみを見込んで、範囲の対角線の長さのこの割合だけ広げる
+    float padding = 0.01f;
+};
+
+//メッシュ1つ・アニメーション1つ分の範囲の表
+//segmentBoundsList[i]はstartFrame + i * segmentLengthからsegmentLengthフレームの間の姿勢がすべて入る範囲
+struct AnimationBounds {
+    float startFrame = 0.0f;
+    float segmentLength = 1.0f;
+    std::vector<ModelBounds> segmentBoundsList;
+    //アニメーション全体の範囲
+    ModelBounds total;
+
+    bool IsEmpty() const {
+        return segmentBoundsList.empty();
+    }
+};
+
+void ExtendBounds(ModelBounds* bounds, const glm::vec3& point);
+void MergeBounds(ModelBounds* bounds, const ModelBounds& other);
+//球を箱の中心と対角線の半分で作り直す
+void UpdateBoundsSphere(ModelBounds* bounds);
+//箱を行列で移した箱。球は新しい箱から作る
+ModelBounds TransformBounds(const ModelBounds& bounds, const glm::mat4& matrix);
+
+//mesh->bounds・boneBoundsList・partialWeightを作り直す
+void ComputeMeshBounds(ModelMesh* mesh);
+//paletteで動かしたメッシュが入る範囲。ボーンごとの範囲を移して合わせるので、頂点をスキニングするより小さい計算で済む
+//paletteはGetAnimationPoseなどで得たもの。ボーンが無いメッシュではpalette[0]にGetAnimationMeshMatrixの行列を渡す
+void ComputePoseBounds(ModelBounds* out_bounds, const ModelMesh& mesh, const glm::mat4* palette);
+//start_frameからend_frameまでの範囲の表を作る。evaluate_paletteはフレームのパレット(ComputePoseBoundsと同じもの)を書く関数
+void BuildAnimationBounds(AnimationBounds* out_bounds, const ModelMesh& mesh, float start_frame, float end_frame, const BoundsOption& option,
+    const std::function<void(float, glm::mat4*)>& evaluate_palette);
+//frameを含む区間の範囲。表の外のフレームは端の区間を使う。表が空ならfalse
+bool GetAnimationBounds(ModelBounds* out_bounds, const AnimationBounds& bounds, float frame);
+
+}
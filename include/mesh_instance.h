@@ -0,0 +1,26 @@
+﻿/********************************************************/
+/*          同じジオメトリを使うノードのまとめ          */
+/********************************************************/
+#pragma once
+
+#include <cstdint>
+#include "model.h"
+
+namespace fbx{
+
+struct InstanceOption {
+    //trueなら同じジオメトリを使うノードのメッシュを1つだけ作り、ノードごとの配置はModelInstanceで持つ
+    //falseでもModelInstanceはメッシュごとに1つ作られる
+    bool enable = false;
+    //同じGeometry(FbxMesh)を共有するノードに加えて、溶接した結果が同じメッシュもまとめる
+    //FbxLoaderでは重複を除いてからメッシュを通知するので、できた順の通知にはならない
+    bool matchContent = true;
+};
+
+//溶接した頂点・インデックスとボーン・ブレンドシェイプのハッシュ。LODや並べ替えの前に求める
+//値が同じメッシュは同じジオメトリとみなす(キャッシュのキーと同じく64bitの衝突は考えない)
+uint64_t HashMeshGeometry(const ModelMesh& mesh);
+//インスタンスのバイト数
+size_t GetInstanceMemorySize(const std::vector<ModelInstance>& instance_list);
+
+}
@@ -0,0 +1,57 @@
+﻿/********************************************************/
+/*          頂点キャッシュと頂点読み出しの最適化        */
+/********************************************************/
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "model.h"
+
+namespace fbx{
+
+//溶接の後に行う並べ替えの設定
+struct OptimizeOption {
+    //trueなら溶接の後に三角形と頂点を並べ替える
+    bool enable = false;
+    //想定する頂点キャッシュの大きさ(FIFO)
+    int cacheSize = 16;
+    //三角形をかたまりごとに外側を向いているものから並べ、オーバードローを減らす
+    bool overdraw = false;
+    //オーバードローのためにACMRがどこまで悪くなってよいか(1.05なら5%まで)
+    float overdrawThreshold = 1.05f;
+    //頂点をインデックスで初めて使われる順に並べ直す
+    bool vertexFetch = true;
+};
+
+//ACMR = 頂点シェーダーの実行回数 / 三角形数、ATVR = 頂点シェーダーの実行回数 / 頂点数
+struct VertexCacheStat {
+    float acmr = 0.0f;
+    float atvr = 0.0f;
+    //キャッシュに無かった頂点の数(頂点シェーダーの実行回数)
+    size_t transformCount = 0;
+};
+
+struct OptimizeStat {
+    VertexCacheStat before;
+    VertexCacheStat after;
+    //並べ替えにかかった時間
+    double timeMs = 0.0;
+};
+
+//FIFOキャッシュで頂点シェーダーの実行回数を数える
+VertexCacheStat AnalyzeVertexCache(const unsigned int* index_list, size_t index_count, size_t vertex_count, int cache_size);
+//Tipsify(Sander et al. 2007)で三角形を並べ替える。頂点数に比例する時間で終わる
+void OptimizeVertexCache(unsigned int* out_index_list, const unsigned int* index_list, size_t index_count, size_t vertex_count, int cache_size);
+//OptimizeVertexCacheの結果をキャッシュが途切れる所とACMRの許す所で区切り、
+//かたまりの向きがメッシュの外側を向いているものから描くように並べる
+void OptimizeOverdraw(unsigned int* out_index_list, const unsigned int* index_list, size_t index_count, const ModelVertex* vertex_list, size_t vertex_count,
+    int cache_size, float threshold);
+//頂点をインデックスで初めて使われる順に並べ直し、インデックスを書き換える。使われない頂点は消える。新しい頂点数を返す
+//out_remap_listには[古い番号]に新しい番号(消えた頂点は0xffffffff)が入る。nullptrでもよい
+size_t OptimizeVertexFetch(std::vector<ModelVertex>* vertex_list, unsigned int* index_list, size_t index_count, std::vector<unsigned int>* out_remap_list = nullptr);
+//メッシュのindexList(またはindexList32)とvertexListに上の処理を行う。lodListがあればLODも頂点キャッシュ向けに並べ、頂点番号を合わせる
+//blendShapeListの頂点番号とtangentListの順も合わせる
+//out_statは元のメッシュの分だけ。nullptrでもよい
+void OptimizeMesh(ModelMesh* mesh, const OptimizeOption& option, OptimizeStat* out_stat);
+
+}
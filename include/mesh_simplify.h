@@ -0,0 +1,44 @@
+﻿/********************************************************/
+/*          辺の縮約によるLODの生成                     */
+/********************************************************/
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "model.h"
+
+namespace fbx{
+
+struct LodOption {
+    //trueなら溶接の後にModelMesh::lodListを作る
+    bool enable = false;
+    //作るLODの数(元のメッシュは含まない)
+    int levelCount = 3;
+    //1つ下がるごとの三角形数の割合。0なら三角形数では止めず、誤差だけで決める
+    float triangleRatio = 0.5f;
+    //LOD1で許す誤差(メッシュの大きさに対する割合)。1つ下がるごとに2倍にする。0なら誤差では止めない
+    float targetError = 0.01f;
+    //法線・UV・ボーンウェイトが変わる縮約を後回しにする重み
+    float attributeWeight = 1.0f;
+};
+
+//Quadric Error Metrics(Garland and Heckbert 1997)による辺の縮約で三角形を減らす
+//頂点は動かさずに隣の頂点へ寄せる(half-edge collapse)ので、結果はvertex_listのインデックスのまま
+//UVの継ぎ目(同じ位置で属性の違う頂点)は両側を一緒に継ぎ目に沿って縮約し、穴の縁は縁に沿ってだけ縮約する
+//index_countがtarget_index_count以下になるか、次の縮約の誤差がtarget_error(メッシュの大きさに対する割合)を超えたら止める
+//out_errorには結果の誤差(メッシュの大きさに対する割合)が入る。nullptrでもよい
+void SimplifyMesh(std::vector<unsigned int>* out_index_list, const unsigned int* index_list, size_t index_count,
+    const ModelVertex* vertex_list, size_t vertex_count, size_t target_index_count, float target_error, float attribute_weight, float* out_error);
+//メッシュの大きさ(バウンディングボックスの一番長い辺)
+float GetMeshExtent(const ModelVertex* vertex_list, size_t vertex_count);
+//1つ前のLODから順に縮約してmesh->lodListを作る。減らなくなったらlevelCountより少なくなる
+void GenerateLodList(ModelMesh* mesh, const LodOption& option);
+//全LODのインデックス数の合計
+size_t GetLodIndexCount(const ModelMesh& mesh);
+
+//モデル空間の誤差を画面上のピクセル数にする。distanceはカメラからの距離、fov_yは縦の画角(ラジアン)
+float GetLodScreenError(float error, float distance, float screen_height, float fov_y);
+//画面上の誤差がmax_pixel_error以下になる一番粗いLODを選ぶ。0なら元のメッシュ、1以上はlodList[戻り値 - 1]
+int SelectLod(const ModelMesh& mesh, float distance, float screen_height, float fov_y, float max_pixel_error);
+
+}
@@ -0,0 +1,34 @@
+﻿/********************************************************/
+/*          メッシュレット(三角形のクラスタ)の生成      */
+/********************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "model.h"
+
+namespace fbx{
+
+struct MeshletOption {
+    //trueなら読み込みの最後(並べ替えの後)にModelMesh::meshletListを作る
+    bool enable = false;
+    //1つのメッシュレットの頂点数(3～256)と三角形数(1～512)の上限
+    int maxVertexCount = 64;
+    int maxTriangleCount = 124;
+    //向きの揃った三角形を集める重み。大きいほど法線の円錐が狭くなり、メッシュレットの数は増える
+    float coneWeight = 0.25f;
+};
+
+//隣り合う三角形を、増える頂点が少なく向きの近いものから順に集めてメッシュレットを作る
+//結果はリストの後ろに足される。インデックスは頂点キャッシュ向けに並べた後のものを渡すと、まとまりが良くなる
+void BuildMeshlets(std::vector<ModelMeshlet>* out_meshlet_list, std::vector<unsigned int>* out_vertex_list, std::vector<uint8_t>* out_triangle_list,
+    const unsigned int* index_list, size_t index_count, const ModelVertex* vertex_list, size_t vertex_count, const MeshletOption& option);
+//mesh->indexList(またはindexList32)からmeshletList・meshletVertexList・meshletTriangleListを作り直す
+void BuildMeshlets(ModelMesh* mesh, const MeshletOption& option);
+//カメラの位置(メッシュの空間)から見て、メッシュレットの三角形がすべて裏を向いているか
+//範囲と円錐はバインドポーズでの値なので、スキンメッシュでは動いた後の形には使えない
+bool IsMeshletBackfacing(const ModelMeshlet& meshlet, const glm::vec3& camera_position);
+
+}
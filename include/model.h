@@ -0,0 +1,186 @@
+﻿/********************************************************/
+/*          モデルデータ(FBX SDKに依存しない部分)       */
+/********************************************************/
+#pragma once
+
+#include <cfloat>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "skeleton.h"
+#include "arena.h"
+
+namespace fbx{
+
+struct ModelBoneWeight {
+    uint8_t boneIndex[4];
+    glm::vec4 boneWeight;
+};
+
+
+struct ModelVertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 uv;
+
+    uint8_t boneIndex[4];
+    glm::vec4 boneWeight;
+
+    bool operator == (const ModelVertex& v) const {
+        return std::memcmp(this, &v, sizeof(ModelVertex)) == 0;
+    }
+};
+
+//詳細度を下げたインデックス。頂点はModelMesh::vertexListを共有するので、ボーンウェイトなどはそのまま使える
+struct ModelLod {
+    std::vector<unsigned short> indexList;
+    //ModelMesh::IsIndex32()の時はこちら
+    std::vector<unsigned int> indexList32;
+    //元のメッシュからの最大のずれ(モデル空間の距離)。GetLodScreenErrorで画面上のピクセル数にする
+    float error = 0.0f;
+};
+
+//メッシュシェーダーやクラスタ単位のカリングのための小さな三角形のまとまり
+struct ModelMeshlet {
+    //ModelMesh::meshletVertexListの中の位置と数
+    uint32_t vertexOffset;
+    uint32_t vertexCount;
+    //ModelMesh::meshletTriangleListの中の位置(バイト)と三角形の数
+    uint32_t triangleOffset;
+    uint32_t triangleCount;
+    //バウンディングスフィア(メッシュの空間)
+    glm::vec3 center;
+    float radius;
+    //法線の円錐。IsMeshletBackfacingで使う。coneCutoffが1以上なら向きでは除けない
+    glm::vec3 coneAxis;
+    float coneCutoff;
+};
+
+//ブレンドシェイプのターゲットの頂点1つ分の差分。ModelVertexの先頭と同じ並び
+struct ModelBlendShapeDelta {
+    glm::vec3 position;
+    glm::vec3 normal;
+};
+
+//ブレンドシェイプの形1つ分。動く頂点だけを持つ
+struct ModelBlendShapeTarget {
+    std::string name;
+    //チャンネルの重みがこの値(0～100)の時にこの形になる(FullWeights)
+    float fullWeight = 100.0f;
+    //vertexListの番号。小さい順
+    std::vector<unsigned int> vertexIndexList;
+    //vertexIndexListと同じ順の差分
+    std::vector<ModelBlendShapeDelta> deltaList;
+};
+
+//重みを持つ単位(FbxBlendShapeChannel)。ターゲットが複数あれば中間の形で、fullWeightの小さい順に並ぶ
+struct ModelBlendShapeChannel {
+    std::string name;
+    //アニメーションが無い時の重み(DeformPercent、0～100)
+    float defaultWeight = 0.0f;
+    std::vector<ModelBlendShapeTarget> targetList;
+};
+
+//軸に沿った箱とそれを囲む球。minがmaxより大きければ空
+struct ModelBounds {
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+
+    bool IsEmpty() const {
+        return min.x > max.x;
+    }
+};
+
+struct ModelMesh {
+    //ArenaOptionで詰め直すとvertexListなどは空になるので、どちらの場合も読めるビューを返す(GetVertexSpanなどと同じ)
+    Span<ModelVertex> GetVertexList() const {
+        return GetVertexSpan();
+    }
+    Span<unsigned short> GetIndexList() const {
+        return GetIndexSpan();
+    }
+    //頂点数が65535を超えた場合はこちらに32bitのインデックスが入る
+    Span<unsigned int> GetIndexList32() const {
+        return GetIndexSpan32();
+    }
+    bool IsIndex32() const {
+        return !indexList32.empty() || !packedIndexList32.empty();
+    }
+    //ArenaOptionで詰め直した後も読める頂点とインデックス
+    Span<ModelVertex> GetVertexSpan() const {
+        return vertexList.empty() ? packedVertexList : Span<ModelVertex>(vertexList);
+    }
+    Span<unsigned short> GetIndexSpan() const {
+        return indexList.empty() ? packedIndexList : Span<unsigned short>(indexList);
+    }
+    Span<unsigned int> GetIndexSpan32() const {
+        return indexList32.empty() ? packedIndexList32 : Span<unsigned int>(indexList32);
+    }
+
+    std::string nodeName;
+    std::string materialName;
+
+    std::vector<ModelVertex> vertexList;
+    std::vector<unsigned short> indexList;
+    std::vector<unsigned int> indexList32;
+    //ArenaOptionを有効にした時は、メッシュができた所で頂点とインデックスをローダーのアリーナに移して上のリストを空にする
+    //vertexListなどを直接読むと空に見えるので、GetVertexSpanなどで読むこと
+    //ビューはローダーをFinalizeするか破棄するまで有効。ModelMeshを写してもビューは同じアリーナを指したまま
+    Span<ModelVertex> packedVertexList;
+    Span<unsigned short> packedIndexList;
+    Span<unsigned int> packedIndexList32;
+    //LOD1から順に三角形が少なくなる。LodOptionを有効にした時だけ作られる
+    std::vector<ModelLod> lodList;
+    //MeshletOptionを有効にした時だけ作られる。meshletVertexListはvertexListの番号
+    //meshletTriangleListはメッシュレットの中の頂点番号(8bit)を三角形ごとに3つずつ並べたもの
+    std::vector<ModelMeshlet> meshletList;
+    std::vector<unsigned int> meshletVertexList;
+    std::vector<uint8_t> meshletTriangleList;
+
+    glm::mat4 invMeshBaseposeMatrix;
+    std::vector<std::string> boneNodeNameList;
+    std::vector<glm::mat4> invBoneBaseposeMatrixList;
+    //ボーンとその祖先の階層。ボーンが無ければ空
+    Skeleton skeleton;
+    //vertexListと同じ順の接線。xyzが接線、wが従法線の向き(従法線 = w * cross(法線, 接線))
+    //TangentOptionを有効にした時だけ作られる
+    std::vector<glm::vec4> tangentList;
+    //ブレンドシェイプのチャンネル。無ければ空。ApplyBlendShapesで頂点にかける
+    std::vector<ModelBlendShapeChannel> blendShapeList;
+
+    //ベースポーズでの範囲(メッシュの空間)。読み込み時に作る
+    ModelBounds bounds;
+    //ボーンごとの、そのボーンが動かす頂点の範囲(invBoneBaseposeMatrixListで移したボーンの空間)
+    std::vector<ModelBounds> boneBoundsList;
+    //ウェイトの合計が1にならない頂点がある。スキニングで原点に寄るので姿勢の範囲に原点を含める
+    bool partialWeight = false;
+
+};
+
+//メッシュを置くノード1つ分。InstanceOptionを有効にすると、同じジオメトリを使うノードはmeshIndexが同じになる
+struct ModelInstance {
+    //GetMeshListの番号
+    int meshIndex = 0;
+    std::string nodeName;
+    std::string materialName;
+    //ベースポーズでのノードのグローバル行列(メッシュの空間からモデルの空間へ)
+    glm::mat4 transform = glm::mat4(1.0f);
+};
+
+struct ModelMaterial
+{
+    std::string materialName;
+
+    std::string diffuseTextureName;
+    std::string normalTextureName;
+    std::string specularTextureName;
+    std::string falloffTextureName;
+    std::string reflectionMapTextureName;
+};
+
+}
@@ -0,0 +1,27 @@
+﻿/********************************************************/
+/*          複数インスタンスの姿勢の一括計算            */
+/********************************************************/
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <glm/glm.hpp>
+
+#include "thread_pool.h"
+
+namespace fbx{
+
+//インスタンス1つ分の要求。結果はout_palette_list[instance * パレットの大きさ]から書かれる
+struct PoseRequest {
+    int instance;
+    int animIndex;
+    float frame;
+};
+
+//要求をアニメーションと時刻の順に並べ、近い要求をまとめてスレッドに配る
+//同じアニメーション・同じ時刻の要求は1回だけ計算して写す
+//evaluate_poseは1つの要求のパレットを書く関数。thread_poolがnullptrなら呼び出し元のスレッドだけで行う
+void EvaluatePoseBatch(glm::mat4* out_palette_list, size_t palette_size, const PoseRequest* request_list, size_t request_count,
+    ThreadPool* thread_pool, const std::function<void(const PoseRequest&, glm::mat4*)>& evaluate_pose);
+
+}
@@ -0,0 +1,67 @@
+﻿/********************************************************/
+/*          メッシュのスケルトン                        */
+/********************************************************/
+#pragma once
+
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace fbx{
+
+//out = a * b。SSEが使えればSSEで計算する。outはa,bと同じでもよい
+void MultiplyMatrix(glm::mat4* out, const glm::mat4& a, const glm::mat4& b);
+
+//メッシュのボーンとその祖先を親から順に並べたもの。読み込み時に作る
+//関節(joint)はノード1つ、ボーンはModelMesh::boneNodeNameListの1要素で、複数のボーンが同じ関節を指すこともある
+class Skeleton
+{
+public:
+    Skeleton();
+
+    //関節の並びは任意(内部で親から順に並べ替える)。rest_local_listは関節ごとのベースポーズでのローカル行列
+    //bone_node_name_listとinv_bind_pose_listはModelMeshのものをそのまま渡す
+    void Initialize(const std::vector<std::string>& joint_name_list, const std::vector<int>& parent_list, const std::vector<glm::mat4>& rest_local_list,
+        const std::vector<std::string>& bone_node_name_list, const std::vector<glm::mat4>& inv_bind_pose_list);
+
+    bool IsEmpty() const {
+        return mParentList.empty();
+    }
+    int GetJointCount() const {
+        return (int)mParentList.size();
+    }
+    int GetBoneCount() const {
+        return (int)mInvBindPoseList.size();
+    }
+    const std::string& GetJointName(int joint_id) const {
+        return mJointNameList[joint_id];
+    }
+    //親は必ず子より前。根は-1
+    int GetParent(int joint_id) const {
+        return mParentList[joint_id];
+    }
+    const glm::mat4& GetRestLocalMatrix(int joint_id) const {
+        return mRestLocalList[joint_id];
+    }
+    //ボーンの関節番号
+    int GetBoneJoint(int bone_id) const {
+        return mBoneJointList[bone_id];
+    }
+
+    //ローカル行列から全関節のグローバル行列とスキニング用の行列(ボーン順)を1回の走査で求める
+    //out_global_listはGetJointCount()個、out_paletteはGetBoneCount()個
+    void SolvePose(const glm::mat4* local_list, glm::mat4* out_global_list, glm::mat4* out_palette) const;
+
+private:
+    std::vector<std::string> mJointNameList;
+    std::vector<int> mParentList;
+    std::vector<glm::mat4> mRestLocalList;
+
+    //関節ごとのボーンの範囲。関節jのボーンはmJointBoneList[mJointBoneOffsetList[j]]からmJointBoneOffsetList[j + 1]の手前まで
+    std::vector<int> mJointBoneOffsetList;
+    std::vector<int> mJointBoneList;
+    std::vector<int> mBoneJointList;
+    std::vector<glm::mat4> mInvBindPoseList;
+};
+
+}
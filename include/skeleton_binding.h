@@ -0,0 +1,130 @@
+﻿/********************************************************/
+/*          メッシュのボーンとアニメーションの結び付け  */
+/********************************************************/
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "model.h"
+#include "animation_clip.h"
+
+namespace fbx{
+
+//(ModelMesh, アニメーション)の組ごとに一度だけ作り、姿勢を求める時に渡す
+//ノード名は作る時に解決しておくので、毎フレームの文字列の比較や辞書の検索が無くなる
+struct SkeletonBinding {
+    int animIndex = -1;
+    //trueならノード番号はクリップの番号、falseならアニメーションのシーンの番号
+    bool useClip = false;
+    //見つからなければ-1
+    int meshNodeId = -1;
+    //ボーンごとのノード番号。見つからなければ-1(単位行列になる)
+    std::vector<int> boneNodeIdList;
+    //ボーンとその祖先を親から順に並べたもの。BuildEvaluateOrderで作る(使わないローダーでは空)
+    std::vector<int> evaluateNodeList;
+    //evaluateNodeListの中での親の位置。無ければ-1
+    std::vector<int> evaluateParentList;
+    //ボーンごとのevaluateNodeListの中での位置。見つからなければ-1
+    std::vector<int> boneSlotList;
+    //ModelMesh::skeletonの関節ごとのノード番号。見つからなければ-1(ベースポーズのローカル行列を使う)
+    std::vector<int> jointNodeIdList;
+    //見つからなかったボーンの名前
+    std::vector<std::string> missingBoneList;
+
+    bool IsValid() const {
+        return animIndex >= 0;
+    }
+    bool HasMissingBone() const {
+        return !missingBoneList.empty();
+    }
+};
+
+//find_nodeはノード名から番号を返す関数(無ければ-1)。見つからないボーンはmissingBoneListに入れて表示する
+template<class FindNode>
+void ResolveSkeletonBinding(SkeletonBinding* out_binding, const ModelMesh& mesh, int anim_index, bool use_clip, FindNode find_node);
+
+//ボーンとその祖先だけを親から順に計算するための並びを作る。parent_ofはノード番号から親の番号を返す関数(無ければ-1)
+template<class ParentOf>
+void BuildEvaluateOrder(SkeletonBinding* binding, int node_count, ParentOf parent_of);
+
+//クリップに対する結び付け。ボーンと祖先だけを計算するための並びも作る
+void BindClip(SkeletonBinding* out_binding, const AnimationClip& clip, const ModelMesh& mesh, int anim_index);
+
+//結び付けを使ったGetClipMeshMatrix/GetClipBoneMatrix。作業用の行列はスレッドごとに持ち回すので、確保は最初の1回だけ
+void GetClipMeshMatrix(glm::mat4* out_matrix, const AnimationClip& clip, float frame, const ModelMesh& mesh, const SkeletonBinding& binding);
+void GetClipBoneMatrix(glm::mat4* out_matrix_list, const AnimationClip& clip, float frame, const ModelMesh& mesh, const SkeletonBinding& binding);
+
+//local_ofはノード番号からローカル行列を返す関数。見つからない関節はベースポーズのローカル行列を使う
+//作業用の行列はスレッドごとに持ち回す
+template<class LocalOf>
+void EvaluateSkeletonPose(glm::mat4* out_palette, glm::mat4* out_global_list, const Skeleton& skeleton, const SkeletonBinding& binding, LocalOf local_of);
+
+//------------------------------------------------------------------------------------------
+template<class FindNode>
+void ResolveSkeletonBinding(SkeletonBinding* out_binding, const ModelMesh& mesh, int anim_index, bool use_clip, FindNode find_node) {
+    out_binding->animIndex = anim_index;
+    out_binding->useClip = use_clip;
+    out_binding->meshNodeId = find_node(mesh.nodeName);
+    out_binding->boneNodeIdList.clear();
+    out_binding->evaluateNodeList.clear();
+    out_binding->evaluateParentList.clear();
+    out_binding->boneSlotList.clear();
+    out_binding->missingBoneList.clear();
+    for (const auto& bone_node_name : mesh.boneNodeNameList) {
+        int node_id = find_node(bone_node_name);
+        if (node_id < 0) {
+            out_binding->missingBoneList.push_back(bone_node_name);
+            printf("bind: bone not found in animation %d [mesh:%s][bone:%s]\n", anim_index, mesh.nodeName.c_str(), bone_node_name.c_str());
+        }
+        out_binding->boneNodeIdList.push_back(node_id);
+    }
+    out_binding->jointNodeIdList.clear();
+    for (int j = 0; j < mesh.skeleton.GetJointCount(); j++) {
+        out_binding->jointNodeIdList.push_back(find_node(mesh.skeleton.GetJointName(j)));
+    }
+}
+//------------------------------------------------------------------------------------------
+template<class ParentOf>
+void BuildEvaluateOrder(SkeletonBinding* binding, int node_count, ParentOf parent_of) {
+    binding->evaluateNodeList.clear();
+    binding->evaluateParentList.clear();
+    binding->boneSlotList.clear();
+
+    std::vector<int> slot(node_count, -1);
+    std::vector<int> chain;
+    for (int node_id : binding->boneNodeIdList) {
+        //まだ並べていない祖先をたどって、根に近い方から足す
+        chain.clear();
+        for (int n = node_id; n >= 0 && slot[n] < 0; n = parent_of(n)) {
+            chain.push_back(n);
+        }
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+            int parent = parent_of(*it);
+            slot[*it] = (int)binding->evaluateNodeList.size();
+            binding->evaluateNodeList.push_back(*it);
+            binding->evaluateParentList.push_back(parent >= 0 ? slot[parent] : -1);
+        }
+        binding->boneSlotList.push_back(node_id >= 0 ? slot[node_id] : -1);
+    }
+}
+//------------------------------------------------------------------------------------------
+template<class LocalOf>
+void EvaluateSkeletonPose(glm::mat4* out_palette, glm::mat4* out_global_list, const Skeleton& skeleton, const SkeletonBinding& binding, LocalOf local_of) {
+    thread_local std::vector<glm::mat4> local_list;
+    thread_local std::vector<glm::mat4> global_list;
+    size_t joint_count = (size_t)skeleton.GetJointCount();
+    if (local_list.size() < joint_count) {
+        local_list.resize(joint_count);
+        global_list.resize(joint_count);
+    }
+    for (size_t j = 0; j < joint_count; j++) {
+        int node_id = binding.jointNodeIdList[j];
+        local_list[j] = (node_id < 0) ? skeleton.GetRestLocalMatrix((int)j) : local_of(node_id);
+    }
+    skeleton.SolvePose(local_list.data(), out_global_list ? out_global_list : global_list.data(), out_palette);
+}
+
+}
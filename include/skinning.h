@@ -0,0 +1,44 @@
+﻿/********************************************************/
+/*          CPUスキニング                               */
+/********************************************************/
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+#include "model.h"
+#include "thread_pool.h"
+
+namespace fbx{
+
+//スキニング後の頂点
+struct SkinnedVertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+};
+
+enum SkinningKernel {
+    //CPUが対応している一番速いもの
+    kSkinningAuto,
+    kSkinningScalar,
+    kSkinningSse41,
+    kSkinningAvx2,
+};
+
+//実際に使われるカーネル。初回に一度だけCPUを調べる
+SkinningKernel GetSkinningKernel();
+//カーネルを固定する(ベンチマーク・検証用)。CPUが対応していなければfalseで、変わらない
+bool SetSkinningKernel(SkinningKernel kernel);
+const char* GetSkinningKernelName(SkinningKernel kernel);
+
+//ModelVertexのboneIndex/boneWeightとpaletteで位置と法線を変換する。法線は正規化する
+//paletteはGetAnimationBoneMatrix・GetAnimationPoseで得たもの
+void SkinVertices(SkinnedVertex* out_vertex_list, const ModelVertex* vertex_list, size_t vertex_count, const glm::mat4* palette);
+//メッシュ1つ分。out_vertex_listはmesh.GetVertexSpan().size()個(ArenaOptionで詰め直した後も使える)
+void SkinMesh(SkinnedVertex* out_vertex_list, const ModelMesh& mesh, const glm::mat4* palette);
+//同じメッシュの複数のインスタンスをまとめて変換する
+//palette_listはインスタンスごとにボーン数(最低1)ずつ、out_vertex_listはインスタンスごとに頂点数ずつ並べる
+//thread_poolがnullptrなら呼び出し元のスレッドだけで行う
+void SkinMeshInstances(SkinnedVertex* out_vertex_list, const ModelMesh& mesh, const glm::mat4* palette_list, size_t instance_count, ThreadPool* thread_pool);
+
+}
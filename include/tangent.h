@@ -0,0 +1,25 @@
+﻿/********************************************************/
+/*          法線マップのための接線の生成                */
+/********************************************************/
+#pragma once
+
+#include <cstddef>
+#include "model.h"
+
+namespace fbx{
+
+struct TangentOption {
+    //trueなら溶接の後に接線を作ってModelMesh::tangentListに入れる
+    bool enable = false;
+};
+
+//MikkTSpaceと同じ決まりで頂点ごとの接線を作る
+//三角形ごとのUVの向きを角の法線の面に落として正規化し、角の大きさで重みを付けて頂点ごとに足す
+//UVが裏返った三角形と表の三角形が1つの頂点を共有していれば(ミラーの継ぎ目)、頂点を複製して分ける
+//複製した頂点はvertexListの後ろに足され、ブレンドシェイプの差分も写す。頂点が65535を超えればindexList32に移る
+//LODとメッシュレットを作る前に呼ぶ。複製した頂点の数を返す
+size_t GenerateTangents(ModelMesh* mesh);
+//接線の分のバイト数
+size_t GetTangentMemorySize(const ModelMesh& mesh);
+
+}
@@ -0,0 +1,62 @@
+﻿/********************************************************/
+/*          ワークスティーリングのスレッドプール        */
+/********************************************************/
+#pragma once
+
+#include <cstdint>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fbx{
+
+class ThreadPool
+{
+public:
+    //thread_countが0以下ならハードウェアのスレッド数にする。呼び出し元のスレッドも1つに数える
+    explicit ThreadPool(int thread_count);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int GetThreadCount() const {
+        return (int)mQueueList.size();
+    }
+
+    //[0,count)をfuncで並列に処理して、全部終わるまで待つ
+    //仕事は最初に各スレッドへ均等に配り、手が空いたスレッドは他のキューから盗む
+    void ParallelFor(size_t count, const std::function<void(size_t)>& func);
+
+private:
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<size_t> taskList;
+    };
+
+    void WorkerMain(int worker_index);
+    void RunTasks(int worker_index);
+    bool PopTask(int worker_index, size_t* task);
+
+    std::vector<std::unique_ptr<TaskQueue>> mQueueList;
+    std::vector<std::thread> mThreadList;
+
+    std::mutex mMutex;
+    std::condition_variable mWakeCondition;
+    std::condition_variable mDoneCondition;
+    //ParallelForを呼ぶたびに増える。ワーカーはこれが変わったら起きる
+    uint64_t mGeneration;
+    bool mExit;
+    int mActiveWorker;
+    const std::function<void(size_t)>* mFunc;
+    //funcが投げた例外は最初の1つだけ呼び出し元で投げ直す
+    std::exception_ptr mException;
+    //ParallelForは同時に1つだけ
+    std::mutex mCallMutex;
+};
+
+}
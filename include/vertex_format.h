@@ -0,0 +1,286 @@
+﻿/********************************************************/
+/*          GPUに渡す頂点の形式                        */
+/********************************************************/
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include "model.h"
+#include "weld.h"
+
+namespace fbx{
+
+//頂点属性の意味
+enum VertexSemantic {
+    kSemanticPosition,
+    kSemanticNormal,
+    kSemanticTexcoord,
+    kSemanticBoneIndex,
+    kSemanticBoneWeight,
+    //法線・接線・従法線を表す四元数。wの符号が従法線の向き
+    kSemanticTangentFrame,
+};
+
+//GPUの入力レイアウトでの要素の型
+enum VertexElementType {
+    kElementFloat2,
+    kElementFloat3,
+    kElementFloat4,
+    kElementHalf2,
+    //符号付き正規化の10:10:10:2(wは使わない)
+    kElementSnorm10x3,
+    kElementUint8x4,
+    kElementUnorm8x4,
+    kElementUnorm16x4,
+    kElementSnorm16x4,
+};
+
+struct VertexElement {
+    VertexSemantic semantic;
+    VertexElementType type;
+    //頂点の先頭からのバイト数
+    uint32_t offset;
+};
+
+//メッシュごとに決まる符号化の値。シェーダーにも定数として渡す
+struct VertexEncodeParam {
+    //Unorm16Positionの箱。シェーダーではpositionMin + 値 * positionExtentで戻す
+    glm::vec3 positionMin = glm::vec3(0.0f);
+    glm::vec3 positionExtent = glm::vec3(1.0f);
+};
+
+//-- 属性の符号化 --//
+//どれもkSizeバイトを書くEncode・読み戻すDecode・入力レイアウトの要素を書くGetElementListを持つ
+//kSizeが0なら属性を持たない。接線はModelMesh::tangentListの値で、接線を使わない符号化では無視する
+
+//位置。32bitの浮動小数点3つ
+struct Float3Position {
+    static const uint32_t kSize = 12;
+    static void Encode(uint8_t* out, const ModelVertex& vertex, const glm::vec4& tangent, const VertexEncodeParam& param);
+    static void Decode(ModelVertex* out_vertex, glm::vec4* out_tangent, const uint8_t* data, const VertexEncodeParam& param);
+    static int GetElementList(VertexElement* out_list, uint32_t offset);
+};
+
+//位置。メッシュの箱の中の16bitの正規化3つ(4つ目は0)。誤差は箱の辺の1/131070まで
+struct Unorm16Position {
+    static const uint32_t kSize = 8;
+    static void Encode(uint8_t* out, const ModelVertex& vertex, const glm::vec4& tangent, const VertexEncodeParam& param);
+    static void Decode(ModelVertex* out_vertex, glm::vec4* out_tangent, const uint8_t* data, const VertexEncodeParam& param);
+    static int GetElementList(VertexElement* out_list, uint32_t offset);
+};
+
+//法線。32bitの浮動小数点3つ
+struct Float3Normal {
+    static const uint32_t kSize = 12;
+    static void Encode(uint8_t* out, const ModelVertex& vertex, const glm::vec4& tangent, const VertexEncodeParam& param);
+    static void Decode(ModelVertex* out_vertex, glm::vec4* out_tangent, const uint8_t* data, const VertexEncodeParam& param);
+    static int GetElementList(VertexElement* out_list, uint32_t offset);
+};
+
+//法線。10bitの符号付き正規化3つを4バイトに詰める(誤差は0.1度程度)
+struct Snorm10Normal {
+    static const uint32_t kSize = 4;
+    static void Encode(uint8_t* out, const ModelVertex& vertex, const glm::vec4& tangent, const VertexEncodeParam& param);
+    static void Decode(ModelVertex* out_vertex, glm::vec4* out_tangent, const uint8_t* data, const VertexEncodeParam& param);
+    static int GetElementList(VertexElement* out_list, uint32_t offset);
+};
+
+//法線と接線をまとめた回転(QTangent)。四元数を16bitの符号付き正規化4つにする
+//wを常に正にしておき、従法線が逆向きの時だけ全体の符号を反転する。誤差は0.01度程度
+//接線が無ければ(0ベクトル)法線に垂直な適当な接線を使う
+struct QTangentNormal {
+    static const uint32_t kSize = 8;
+    static void Encode(uint8_t* out, const ModelVertex& vertex, const glm::vec4& tangent, const VertexEncodeParam& param);
+    static void Decode(ModelVertex* out_vertex, glm::vec4* out_tangent, const uint8_t* data, const VertexEncodeParam& param);
+    static int GetElementList(VertexElement* out_list, uint32_t offset);
+};
+
+//UV。32bitの浮動小数点2つ
+struct Float2Uv {
+    static const uint32_t kSize = 8;
+    static void Encode(uint8_t* out, const ModelVertex& vertex, const glm::vec4& tangent, const VertexEncodeParam& param);
+    static void Decode(ModelVertex* out_vertex, glm::vec4* out_tangent, const uint8_t* data, const VertexEncodeParam& param);
+    static int GetElementList(VertexElement* out_list, uint32_t offset);
+};
+
+//UV。16bitの浮動小数点2つ。0～1の範囲で1/2048程度の精度なので、大きなテクスチャやタイリングには向かない
+struct Half2Uv {
+    static const uint32_t kSize = 4;
+    static void Encode(uint8_t* out, const ModelVertex& vertex, const glm::vec4& tangent, const VertexEncodeParam& param);
+    static void Decode(ModelVertex* out_vertex, glm::vec4* out_tangent, const uint8_t* data, const VertexEncodeParam& param);
+    static int GetElementList(VertexElement* out_list, uint32_t offset);
+};
+
+//ボーン番号4つとウェイト4つ(32bitの浮動小数点)。ModelVertexと同じ
+struct FloatSkin {
+    static const uint32_t kSize = 20;
+    static void Encode(uint8_t* out, const ModelVertex& vertex, const glm::vec4& tangent, const VertexEncodeParam& param);
+    static void Decode(ModelVertex* out_vertex, glm::vec4* out_tangent, const uint8_t* data, const VertexEncodeParam& param);
+    static int GetElementList(VertexElement* out_list, uint32_t offset);
+};
+
+//ボーン番号4つとウェイト4つ(16bitの正規化)。ウェイトの合計はちょうど65535になるように丸める
+struct Unorm16Skin {
+    static const uint32_t kSize = 12;
+    static void Encode(uint8_t* out, const ModelVertex& vertex, const glm::vec4& tangent, const VertexEncodeParam& param);
+    static void Decode(ModelVertex* out_vertex, glm::vec4* out_tangent, const uint8_t* data, const VertexEncodeParam& param);
+    static int GetElementList(VertexElement* out_list, uint32_t offset);
+};
+
+//ボーン番号4つとウェイト4つ(8bitの正規化)。ウェイトの合計はちょうど255になるように丸める
+struct Unorm8Skin {
+    static const uint32_t kSize = 8;
+    static void Encode(uint8_t* out, const ModelVertex& vertex, const glm::vec4& tangent, const VertexEncodeParam& param);
+    static void Decode(ModelVertex* out_vertex, glm::vec4* out_tangent, const uint8_t* data, const VertexEncodeParam& param);
+    static int GetElementList(VertexElement* out_list, uint32_t offset);
+};
+
+//属性を持たない(法線・UV・スキンに使う)
+struct NoAttribute {
+    static const uint32_t kSize = 0;
+    static void Encode(uint8_t*, const ModelVertex&, const glm::vec4&, const VertexEncodeParam&) {}
+    static void Decode(ModelVertex*, glm::vec4*, const uint8_t*, const VertexEncodeParam&) {}
+    static int GetElementList(VertexElement*, uint32_t) {
+        return 0;
+    }
+};
+
+//-- VertexFormat --//
+//属性ごとの符号化を選んだ頂点の形式。属性は位置・法線・UV・スキンの順に隙間なく並ぶ
+template<class PositionEncoding, class NormalEncoding, class UvEncoding, class SkinEncoding>
+struct VertexFormat {
+    static const uint32_t kPositionOffset = 0;
+    static const uint32_t kNormalOffset = kPositionOffset + PositionEncoding::kSize;
+    static const uint32_t kUvOffset = kNormalOffset + NormalEncoding::kSize;
+    static const uint32_t kSkinOffset = kUvOffset + UvEncoding::kSize;
+    static const uint32_t kStride = kSkinOffset + SkinEncoding::kSize;
+    static const bool kSkinned = SkinEncoding::kSize > 0;
+    //GetElementListが書く最大の数
+    static const int kMaxElementCount = 5;
+    static_assert(kStride % 4 == 0, "vertex stride must be a multiple of 4 bytes");
+
+    struct Vertex {
+        uint8_t data[kStride];
+    };
+
+    static void Encode(Vertex* out_vertex, const ModelVertex& vertex, const glm::vec4& tangent, const VertexEncodeParam& param) {
+        PositionEncoding::Encode(out_vertex->data + kPositionOffset, vertex, tangent, param);
+        NormalEncoding::Encode(out_vertex->data + kNormalOffset, vertex, tangent, param);
+        UvEncoding::Encode(out_vertex->data + kUvOffset, vertex, tangent, param);
+        SkinEncoding::Encode(out_vertex->data + kSkinOffset, vertex, tangent, param);
+    }
+    static void Encode(Vertex* out_vertex, const ModelVertex& vertex) {
+        Encode(out_vertex, vertex, glm::vec4(0.0f), VertexEncodeParam());
+    }
+    //持たない属性は0、スキンが無ければボーン0に1.0で読み戻す
+    static void Decode(ModelVertex* out_vertex, glm::vec4* out_tangent, const Vertex& vertex, const VertexEncodeParam& param) {
+        out_vertex->position = glm::vec3(0.0f);
+        out_vertex->normal = glm::vec3(0.0f);
+        out_vertex->uv = glm::vec2(0.0f);
+        for (int i = 0; i < 4; i++) {
+            out_vertex->boneIndex[i] = 0;
+        }
+        out_vertex->boneWeight = glm::vec4(1, 0, 0, 0);
+        *out_tangent = glm::vec4(0.0f);
+        PositionEncoding::Decode(out_vertex, out_tangent, vertex.data + kPositionOffset, param);
+        NormalEncoding::Decode(out_vertex, out_tangent, vertex.data + kNormalOffset, param);
+        UvEncoding::Decode(out_vertex, out_tangent, vertex.data + kUvOffset, param);
+        SkinEncoding::Decode(out_vertex, out_tangent, vertex.data + kSkinOffset, param);
+    }
+    static void Decode(ModelVertex* out_vertex, const Vertex& vertex) {
+        glm::vec4 tangent;
+        Decode(out_vertex, &tangent, vertex, VertexEncodeParam());
+    }
+    //入力レイアウトの要素を書いて数を返す
+    static int GetElementList(VertexElement* out_list) {
+        int count = 0;
+        count += PositionEncoding::GetElementList(out_list + count, kPositionOffset);
+        count += NormalEncoding::GetElementList(out_list + count, kNormalOffset);
+        count += UvEncoding::GetElementList(out_list + count, kUvOffset);
+        count += SkinEncoding::GetElementList(out_list + count, kSkinOffset);
+        return count;
+    }
+};
+
+//静的なメッシュ用(24バイト)
+typedef VertexFormat<Float3Position, Snorm10Normal, Float2Uv, NoAttribute> StaticVertexFormat;
+//スキンメッシュ用(32バイト)
+typedef VertexFormat<Float3Position, Snorm10Normal, Float2Uv, Unorm8Skin> SkinnedVertexFormat;
+//ModelVertexと同じ精度(52バイト)
+typedef VertexFormat<Float3Position, Float3Normal, Float2Uv, FloatSkin> FullVertexFormat;
+//接線を持つ詰めた形式。位置はメッシュの箱で量子化する(静的20バイト、スキン32バイト)
+typedef VertexFormat<Unorm16Position, QTangentNormal, Half2Uv, NoAttribute> PackedStaticVertexFormat;
+typedef VertexFormat<Unorm16Position, QTangentNormal, Half2Uv, Unorm16Skin> PackedSkinnedVertexFormat;
+//位置を量子化しない場合(静的24バイト、スキン36バイト)。大きなメッシュで箱の1/65535が粗すぎる時に使う
+typedef VertexFormat<Float3Position, QTangentNormal, Half2Uv, NoAttribute> PackedStaticFloat3VertexFormat;
+typedef VertexFormat<Float3Position, QTangentNormal, Half2Uv, Unorm16Skin> PackedSkinnedFloat3VertexFormat;
+
+//形式に詰めた頂点とインデックス
+template<class Format>
+struct VertexBuffer {
+    std::vector<typename Format::Vertex> vertexList;
+    std::vector<unsigned short> indexList;
+    //頂点数が65535を超えた場合はこちら
+    std::vector<unsigned int> indexList32;
+    //ModelMeshの頂点番号からvertexListの番号へ。LODやメッシュレットのインデックスを写す時に使う
+    std::vector<unsigned int> remapList;
+    //詰めた時の箱など。シェーダーで戻す時に使う
+    VertexEncodeParam param;
+
+    bool IsIndex32() const {
+        return !indexList32.empty();
+    }
+    size_t GetByteSize() const {
+        return vertexList.size() * sizeof(typename Format::Vertex) + indexList.size() * sizeof(unsigned short) + indexList32.size() * sizeof(unsigned int);
+    }
+};
+
+//頂点を囲む箱をUnorm16Positionの箱にする。厚さが0の軸は1にする
+VertexEncodeParam MakeVertexEncodeParam(const ModelMesh& mesh);
+
+//メッシュの頂点をFormatに詰め、詰めた後のバイト列で溶接し直す
+//スキンを持たない形式ではボーンだけが違う頂点、精度を落とした形式では丸めると同じになる頂点がまとまる
+//接線はmesh.tangentListがあれば使う
+template<class Format>
+void BuildVertexBuffer(VertexBuffer<Format>* out_buffer, const ModelMesh& mesh) {
+    auto vertex_list = mesh.GetVertexSpan();
+    bool has_tangent = mesh.tangentList.size() == vertex_list.size();
+    out_buffer->param = MakeVertexEncodeParam(mesh);
+    BasicVertexWelder<typename Format::Vertex> welder(vertex_list.size());
+    out_buffer->remapList.resize(vertex_list.size());
+    typename Format::Vertex vertex;
+    for (size_t i = 0; i < vertex_list.size(); i++) {
+        Format::Encode(&vertex, vertex_list[i], has_tangent ? mesh.tangentList[i] : glm::vec4(0.0f), out_buffer->param);
+        out_buffer->remapList[i] = welder.Add(vertex);
+    }
+    out_buffer->vertexList.assign(welder.GetVertexList().begin(), welder.GetVertexList().end());
+
+    out_buffer->indexList.clear();
+    out_buffer->indexList32.clear();
+    bool index32 = out_buffer->vertexList.size() > 0xffff;
+    auto remap_index = [out_buffer, index32](const auto& index_list) {
+        const auto& remap_list = out_buffer->remapList;
+        if (index32) {
+            out_buffer->indexList32.resize(index_list.size());
+            for (size_t i = 0; i < index_list.size(); i++) {
+                out_buffer->indexList32[i] = remap_list[index_list[i]];
+            }
+        }
+        else {
+            out_buffer->indexList.resize(index_list.size());
+            for (size_t i = 0; i < index_list.size(); i++) {
+                out_buffer->indexList[i] = (unsigned short)remap_list[index_list[i]];
+            }
+        }
+    };
+    if (mesh.IsIndex32()) {
+        remap_index(mesh.GetIndexSpan32());
+    }
+    else {
+        remap_index(mesh.GetIndexSpan());
+    }
+}
+
+}
@@ -0,0 +1,140 @@
+﻿/********************************************************/
+/*          頂点の溶接(重複頂点の除去)                  */
+/********************************************************/
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "model.h"
+#include "arena.h"
+
+namespace fbx{
+
+//溶接の許容誤差。0なら完全一致(バイト比較)で溶接する
+//0より大きい場合はその幅のグリッドに量子化して比較する。値/幅がint32の範囲を超える分は範囲の端にそろえる
+struct WeldOption {
+    float positionEpsilon = 0.0f;
+    float normalEpsilon = 0.0f;
+    float uvEpsilon = 0.0f;
+};
+
+//溶接のキーのハッシュ(MurmurHash3(32bit)と同じ混ぜ方)。キーは頂点を4バイトずつにしたもの
+uint32_t HashWeldKey(const uint32_t* word, size_t word_count);
+//ハッシュテーブルの大きさ。負荷率が0.5以下になる2の冪
+size_t GetWeldTableCapacity(size_t vertex_count);
+
+//頂点のバイト列をそのままキーにする。量子化は頂点の形式(vertex_format.h)の符号化で済んでいる場合に使う
+template<class Vertex>
+struct RawWeldKey {
+    static_assert(sizeof(Vertex) % 4 == 0, "Vertex must be a multiple of 4 bytes");
+    static const size_t kWordCount = sizeof(Vertex) / 4;
+
+    void operator()(uint32_t* out_word, const Vertex& vertex) const {
+        std::memcpy(out_word, &vertex, sizeof(Vertex));
+    }
+};
+
+//ModelVertex用。量子化しない要素はfloatのビット列をそのまま入れる
+struct ModelVertexWeldKey {
+    static_assert(sizeof(ModelVertex) % 4 == 0, "ModelVertex must be a multiple of 4 bytes");
+    static const size_t kWordCount = sizeof(ModelVertex) / 4;
+    WeldOption option;
+
+    void operator()(uint32_t* out_word, const ModelVertex& vertex) const;
+};
+
+//-- BasicVertexWelder Class --//
+//頂点を1つずつ受け取りながらハッシュテーブル(オープンアドレス法)で重複頂点を除く。頂点は最初に出てきた順に並ぶ
+//溶接前の頂点の配列を作らずに、ポリゴンを走査しながらそのまま溶接できる
+//比較するのはKeyMakerが作るkWordCount個の4バイトなので、小さな頂点の形式ほど速い
+//途中の配列は作った時点の作業用アリーナから取り、破棄した時に巻き戻す
+template<class Vertex, class KeyMaker = RawWeldKey<Vertex>>
+class BasicVertexWelder
+{
+public:
+    //max_vertex_countはAddを呼ぶ回数の上限(溶接前の角の数)
+    explicit BasicVertexWelder(size_t max_vertex_count, const KeyMaker& key_maker = KeyMaker())
+        : mKeyMaker(key_maker), mTable(mScratch.MakeVector<uint32_t>()), mHashList(mScratch.MakeVector<uint32_t>()),
+        mVertexList(mScratch.MakeVector<Vertex>()), mIndexList(mScratch.MakeVector<unsigned int>()) {
+        //途中で伸ばすと作業用アリーナに古い領域が残るので、最大の数で先に確保する
+        size_t capacity = GetWeldTableCapacity(max_vertex_count);
+        mMask = capacity - 1;
+        mTable.assign(capacity, (uint32_t)kEmptySlot);
+        mHashList.reserve(max_vertex_count);
+        mVertexList.reserve(max_vertex_count);
+        mIndexList.reserve(max_vertex_count);
+    }
+    BasicVertexWelder(const BasicVertexWelder&) = delete;
+    BasicVertexWelder& operator=(const BasicVertexWelder&) = delete;
+
+    //溶接後の頂点番号を返す
+    unsigned int Add(const Vertex& vertex) {
+        uint32_t key[KeyMaker::kWordCount];
+        mKeyMaker(key, vertex);
+        uint32_t hash = HashWeldKey(key, KeyMaker::kWordCount);
+        size_t slot = hash & mMask;
+        uint32_t index;
+        for (;;) {
+            index = mTable[slot];
+            if (index == kEmptySlot) {
+                //重複していない
+                index = (uint32_t)mVertexList.size();
+                mTable[slot] = index;
+                mHashList.push_back(hash);
+                mVertexList.push_back(vertex);
+                break;
+            }
+            //溶接後の頂点ごとのハッシュ値でキーの比較をする前に弾く
+            if (mHashList[index] == hash) {
+                uint32_t other[KeyMaker::kWordCount];
+                mKeyMaker(other, mVertexList[index]);
+                if (std::memcmp(key, other, sizeof(key)) == 0) {
+                    //重複している
+                    break;
+                }
+            }
+            slot = (slot + 1) & mMask;
+        }
+        mIndexList.push_back(index);
+        return index;
+    }
+
+    const ArenaVector<Vertex>& GetVertexList() const {
+        return mVertexList;
+    }
+    const ArenaVector<unsigned int>& GetIndexList() const {
+        return mIndexList;
+    }
+private:
+    static const uint32_t kEmptySlot = 0xffffffffu;
+    //配列より先に作り、後に破棄されるように最初に置く
+    ScratchScope mScratch;
+    KeyMaker mKeyMaker;
+    size_t mMask;
+    ArenaVector<uint32_t> mTable;
+    ArenaVector<uint32_t> mHashList;
+    ArenaVector<Vertex> mVertexList;
+    ArenaVector<unsigned int> mIndexList;
+};
+
+//-- VertexWelder Class --//
+//ローダーが使うModelVertexの溶接。WeldOptionの幅で位置・法線・UVを量子化して比べる
+class VertexWelder : public BasicVertexWelder<ModelVertex, ModelVertexWeldKey>
+{
+public:
+    VertexWelder(size_t max_vertex_count, const WeldOption& option);
+
+    //結果をメッシュに入れる。頂点数が65535を超えたらindexList32を使う
+    void Store(ModelMesh* mesh) const;
+};
+
+//VertexWelderで重複頂点を除く
+void WeldVertices(std::vector<ModelVertex>* out_vertex_list, std::vector<unsigned int>* out_index_list, const std::vector<ModelVertex>& vertex_list, const WeldOption& option);
+//溶接結果をメッシュに入れる。メッシュのリストは溶接後の大きさだけ確保する
+void WeldVertices(ModelMesh* mesh, const ModelVertex* vertex_list, size_t vertex_count, const WeldOption& option);
+void WeldVertices(ModelMesh* mesh, const std::vector<ModelVertex>& vertex_list, const WeldOption& option);
+//以前のstd::findによる溶接(O(n^2))。ベンチマークの比較用
+void WeldVerticesLinearSearch(std::vector<ModelVertex>* out_vertex_list, std::vector<unsigned int>* out_index_list, const std::vector<ModelVertex>& vertex_list);
+
+}
@@ -0,0 +1,205 @@
+﻿#include "../include/animation_clip.h"
+
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+
+namespace fbx {
+
+    //------------------------------------------------------------------------------------------
+    glm::mat4 ComposeMatrix(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scaling) {
+        glm::mat4 matrix = glm::mat4_cast(rotation);
+        matrix[0] = matrix[0] * scaling.x;
+        matrix[1] = matrix[1] * scaling.y;
+        matrix[2] = matrix[2] * scaling.z;
+        matrix[3] = glm::vec4(translation, 1.0f);
+        return matrix;
+    }
+    //------------------------------------------------------------------------------------------
+    void DecomposeMatrix(const glm::mat4& matrix, glm::vec3* out_translation, glm::quat* out_rotation, glm::vec3* out_scaling) {
+        *out_translation = glm::vec3(matrix[3].x, matrix[3].y, matrix[3].z);
+
+        glm::vec3 axis[3];
+        for (int i = 0; i < 3; i++) {
+            axis[i] = glm::vec3(matrix[i].x, matrix[i].y, matrix[i].z);
+        }
+        glm::vec3 scaling(glm::length(axis[0]), glm::length(axis[1]), glm::length(axis[2]));
+        //鏡像ならX軸を反転したことにする
+        if (glm::dot(glm::cross(axis[0], axis[1]), axis[2]) < 0.0f) {
+            scaling.x = -scaling.x;
+        }
+        glm::mat3 rotation(1.0f);
+        for (int i = 0; i < 3; i++) {
+            if (scaling[i] != 0.0f) {
+                rotation[i] = axis[i] / scaling[i];
+            }
+        }
+        *out_rotation = glm::normalize(glm::quat_cast(rotation));
+        *out_scaling = scaling;
+    }
+    //------------------------------------------------------------------------------------------
+    std::vector<int> SortNodeByHierarchy(const std::vector<int>& parent_list) {
+        int node_count = (int)parent_list.size();
+        std::vector<std::vector<int>> child_list(node_count);
+        std::vector<int> order;
+        order.reserve(node_count);
+        for (int i = 0; i < node_count; i++) {
+            if (parent_list[i] >= 0) {
+                child_list[parent_list[i]].push_back(i);
+            }
+            else {
+                order.push_back(i);
+            }
+        }
+        //幅優先で子を後ろに足していく
+        for (size_t i = 0; i < order.size(); i++) {
+            for (int child : child_list[order[i]]) {
+                order.push_back(child);
+            }
+        }
+        assert((int)order.size() == node_count);
+        return order;
+    }
+
+    //-- AnimationClip Class --//
+    AnimationClip::AnimationClip() {
+        mSampleRate = 60.0f;
+        mStartFrame = 0.0f;
+        mEndFrame = 0.0f;
+        mKeyCount = 0;
+    }
+    //------------------------------------------------------------------------------------------
+    void AnimationClip::Initialize(const std::vector<std::string>& node_name_list, const std::vector<int>& parent_list, float start_frame, float end_frame, float sample_rate) {
+        assert(node_name_list.size() == parent_list.size());
+        assert(sample_rate > 0.0f);
+
+        this->mSampleRate = sample_rate;
+        this->mStartFrame = start_frame;
+        this->mEndFrame = std::max(start_frame, end_frame);
+        //最後のキーが終わりのフレームを越えるようにする
+        this->mKeyCount = (int)std::ceil((this->mEndFrame - this->mStartFrame) * sample_rate / 60.0f) + 1;
+
+        this->mNodeNameList = node_name_list;
+        this->mParentList = parent_list;
+        this->mNodeIdDictionary.clear();
+        for (int i = 0; i < (int)node_name_list.size(); i++) {
+            assert(parent_list[i] < i);
+            this->mNodeIdDictionary.insert({ node_name_list[i], i });
+        }
+
+        size_t key_total = node_name_list.size() * (size_t)this->mKeyCount;
+        this->mTranslationList.assign(key_total, glm::vec3(0.0f));
+        this->mRotationList.assign(key_total, glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+        this->mScalingList.assign(key_total, glm::vec3(1.0f));
+    }
+    //------------------------------------------------------------------------------------------
+    void AnimationClip::SetKey(int node_id, int key, const glm::mat4& local_matrix) {
+        size_t index = (size_t)node_id * this->mKeyCount + key;
+        glm::quat rotation;
+        DecomposeMatrix(local_matrix, &this->mTranslationList[index], &rotation, &this->mScalingList[index]);
+        //補間で遠回りしないように、前のキーと同じ半球にそろえる
+        if (key > 0 && glm::dot(this->mRotationList[index - 1], rotation) < 0.0f) {
+            rotation = -rotation;
+        }
+        this->mRotationList[index] = rotation;
+    }
+    //------------------------------------------------------------------------------------------
+    float AnimationClip::GetKeyFrame(int key) const {
+        return this->mStartFrame + key * 60.0f / this->mSampleRate;
+    }
+    //------------------------------------------------------------------------------------------
+    int AnimationClip::FindNode(const std::string& node_name) const {
+        auto it = this->mNodeIdDictionary.find(node_name);
+        return it == this->mNodeIdDictionary.end() ? -1 : it->second;
+    }
+    //------------------------------------------------------------------------------------------
+    size_t AnimationClip::GetKeyMemorySize() const {
+        return this->mTranslationList.size() * sizeof(glm::vec3)
+            + this->mRotationList.size() * sizeof(glm::quat)
+            + this->mScalingList.size() * sizeof(glm::vec3);
+    }
+    //------------------------------------------------------------------------------------------
+    void AnimationClip::GetKeyPosition(float frame, int* out_key, float* out_alpha) const {
+        float position = (frame - this->mStartFrame) * this->mSampleRate / 60.0f;
+        if (!(position > 0.0f)) {
+            *out_key = 0;
+            *out_alpha = 0.0f;
+            return;
+        }
+        int last = this->mKeyCount - 1;
+        if (position >= (float)last) {
+            *out_key = std::max(last - 1, 0);
+            *out_alpha = last > 0 ? 1.0f : 0.0f;
+            return;
+        }
+        *out_key = (int)position;
+        *out_alpha = position - (float)*out_key;
+    }
+    //------------------------------------------------------------------------------------------
+    void AnimationClip::EvaluateLocalTransform(int node_id, float frame, glm::vec3* out_translation, glm::quat* out_rotation, glm::vec3* out_scaling) const {
+        assert(!this->IsEmpty());
+        int key;
+        float alpha;
+        GetKeyPosition(frame, &key, &alpha);
+
+        size_t index0 = (size_t)node_id * this->mKeyCount + key;
+        size_t index1 = (key + 1 < this->mKeyCount) ? index0 + 1 : index0;
+
+        *out_translation = glm::mix(this->mTranslationList[index0], this->mTranslationList[index1], alpha);
+        *out_scaling = glm::mix(this->mScalingList[index0], this->mScalingList[index1], alpha);
+
+        //キーが密なので線形補間して正規化する(nlerp)
+        const glm::quat& q0 = this->mRotationList[index0];
+        const glm::quat& q1 = this->mRotationList[index1];
+        float sign = glm::dot(q0, q1) < 0.0f ? -1.0f : 1.0f;
+        *out_rotation = glm::normalize(q0 * (1.0f - alpha) + q1 * (alpha * sign));
+    }
+    //------------------------------------------------------------------------------------------
+    glm::mat4 AnimationClip::EvaluateLocalMatrix(int node_id, float frame) const {
+        glm::vec3 translation;
+        glm::quat rotation;
+        glm::vec3 scaling;
+        EvaluateLocalTransform(node_id, frame, &translation, &rotation, &scaling);
+        return ComposeMatrix(translation, rotation, scaling);
+    }
+    //------------------------------------------------------------------------------------------
+    glm::mat4 AnimationClip::EvaluateGlobalMatrix(int node_id, float frame) const {
+        glm::mat4 global = EvaluateLocalMatrix(node_id, frame);
+        for (int parent = this->mParentList[node_id]; parent >= 0; parent = this->mParentList[parent]) {
+            global = EvaluateLocalMatrix(parent, frame) * global;
+        }
+        return global;
+    }
+    //------------------------------------------------------------------------------------------
+    void AnimationClip::EvaluatePose(float frame, glm::mat4* out_global_list) const {
+        int node_count = this->GetNodeCount();
+        for (int i = 0; i < node_count; i++) {
+            glm::mat4 local = EvaluateLocalMatrix(i, frame);
+            int parent = this->mParentList[i];
+            out_global_list[i] = (parent >= 0) ? out_global_list[parent] * local : local;
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    void GetClipMeshMatrix(glm::mat4* out_matrix, const AnimationClip& clip, float frame, const ModelMesh& mesh) {
+        int node_id = clip.FindNode(mesh.nodeName);
+        if (node_id < 0) {
+            *out_matrix = glm::mat4(1.0);
+            return;
+        }
+        *out_matrix = clip.EvaluateGlobalMatrix(node_id, frame) * mesh.invMeshBaseposeMatrix;
+    }
+    //------------------------------------------------------------------------------------------
+    void GetClipBoneMatrix(glm::mat4* out_matrix_list, const AnimationClip& clip, float frame, const ModelMesh& mesh) {
+        //ボーンごとに親をたどるより、全ノードを親から順に1回で計算したほうが速い
+        thread_local std::vector<glm::mat4> pose;
+        pose.resize(clip.GetNodeCount());
+        clip.EvaluatePose(frame, pose.data());
+
+        unsigned int size = (unsigned int)mesh.boneNodeNameList.size();
+        for (unsigned int i = 0; i < size; ++i) {
+            int node_id = clip.FindNode(mesh.boneNodeNameList[i]);
+            out_matrix_list[i] = (node_id < 0) ? glm::mat4(1.0) : pose[node_id] * mesh.invBoneBaseposeMatrixList[i];
+        }
+    }
+    //------------------------------------------------------------------------------------------
+} // fbx
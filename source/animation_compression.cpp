@@ -0,0 +1,454 @@
+﻿#include "../include/animation_compression.h"
+
+#include <cmath>
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+
+namespace fbx {
+
+    namespace {
+        //smallest-threeで残す3成分は必ずこの範囲に入る
+        const float kRotationRange = 0.70710678f;
+        const float kRotationScale = 32767.0f;
+        const float kVectorScale = 65535.0f;
+
+        uint16_t Quantize(float value, float scale) {
+            float clamped = std::min(std::max(value, 0.0f), 1.0f);
+            return (uint16_t)(clamped * scale + 0.5f);
+        }
+
+        //最大の成分を捨てて残り3つを15bitずつにする。捨てた成分の番号は上位bitに入れる
+        void EncodeRotation(const glm::quat& rotation, uint16_t* out_value) {
+            float component[4] = { rotation.x, rotation.y, rotation.z, rotation.w };
+            int largest = 0;
+            for (int i = 1; i < 4; i++) {
+                if (std::fabs(component[i]) > std::fabs(component[largest])) {
+                    largest = i;
+                }
+            }
+            float sign = component[largest] < 0.0f ? -1.0f : 1.0f;
+            uint16_t value[3];
+            int n = 0;
+            for (int i = 0; i < 4; i++) {
+                if (i != largest) {
+                    value[n++] = Quantize(component[i] * sign / kRotationRange * 0.5f + 0.5f, kRotationScale);
+                }
+            }
+            out_value[0] = (uint16_t)(value[0] | ((largest >> 1) << 15));
+            out_value[1] = (uint16_t)(value[1] | ((largest & 1) << 15));
+            out_value[2] = value[2];
+        }
+
+        glm::quat DecodeRotationValue(const uint16_t* value) {
+            int largest = ((value[0] >> 15) << 1) | (value[1] >> 15);
+            float component[4];
+            float sum = 0.0f;
+            int n = 0;
+            for (int i = 0; i < 4; i++) {
+                if (i == largest) {
+                    continue;
+                }
+                float c = ((value[n++] & 0x7fff) / kRotationScale * 2.0f - 1.0f) * kRotationRange;
+                component[i] = c;
+                sum += c * c;
+            }
+            component[largest] = std::sqrt(std::max(0.0f, 1.0f - sum));
+            return glm::quat(component[3], component[0], component[1], component[2]);
+        }
+
+        void EncodeVector(const glm::vec3& vector, const glm::vec3& range_min, const glm::vec3& range_extent, uint16_t* out_value) {
+            for (int i = 0; i < 3; i++) {
+                out_value[i] = range_extent[i] > 0.0f ? Quantize((vector[i] - range_min[i]) / range_extent[i], kVectorScale) : 0;
+            }
+        }
+
+        glm::vec3 DecodeVectorValue(const uint16_t* value, const glm::vec3& range_min, const glm::vec3& range_extent) {
+            return glm::vec3(
+                range_min.x + range_extent.x * (value[0] / kVectorScale),
+                range_min.y + range_extent.y * (value[1] / kVectorScale),
+                range_min.z + range_extent.z * (value[2] / kVectorScale));
+        }
+
+        glm::quat Nlerp(const glm::quat& q0, const glm::quat& q1, float alpha) {
+            float sign = glm::dot(q0, q1) < 0.0f ? -1.0f : 1.0f;
+            return glm::normalize(q0 * (1.0f - alpha) + q1 * (alpha * sign));
+        }
+
+        glm::vec3 GetPosition(const glm::mat4& matrix) {
+            return glm::vec3(matrix[3].x, matrix[3].y, matrix[3].z);
+        }
+    }
+
+    //-- CompressedClip Class --//
+    CompressedClip::CompressedClip() {
+        mSampleRate = 60.0f;
+        mStartFrame = 0.0f;
+        mEndFrame = 0.0f;
+    }
+    //------------------------------------------------------------------------------------------
+    int CompressedClip::FindNode(const std::string& node_name) const {
+        for (int i = 0; i < (int)this->mNodeNameList.size(); i++) {
+            if (this->mNodeNameList[i] == node_name) {
+                return i;
+            }
+        }
+        return -1;
+    }
+    //------------------------------------------------------------------------------------------
+    size_t CompressedClip::GetKeyMemorySize() const {
+        return this->mTrackList.size() * sizeof(Track)
+            + this->mKeyFrameList.size() * sizeof(uint16_t)
+            + this->mKeyValueList.size() * sizeof(uint16_t);
+    }
+    //------------------------------------------------------------------------------------------
+    void CompressedClip::FindKey(const Track& track, float sample_position, uint32_t* out_key0, uint32_t* out_key1, float* out_alpha) const {
+        const uint16_t* begin = this->mKeyFrameList.data() + track.keyOffset;
+        const uint16_t* end = begin + track.keyCount;
+        if (track.keyCount == 1 || !(sample_position > begin[0])) {
+            *out_key0 = *out_key1 = track.keyOffset;
+            *out_alpha = 0.0f;
+            return;
+        }
+        if (sample_position >= end[-1]) {
+            *out_key0 = *out_key1 = track.keyOffset + track.keyCount - 1;
+            *out_alpha = 0.0f;
+            return;
+        }
+        const uint16_t* upper = std::upper_bound(begin, end, sample_position, [](float position, uint16_t frame) { return position < frame; });
+        *out_key1 = (uint32_t)(upper - this->mKeyFrameList.data());
+        *out_key0 = *out_key1 - 1;
+        float frame0 = this->mKeyFrameList[*out_key0];
+        float frame1 = this->mKeyFrameList[*out_key1];
+        *out_alpha = (sample_position - frame0) / (frame1 - frame0);
+    }
+    //------------------------------------------------------------------------------------------
+    glm::vec3 CompressedClip::DecodeVector(const Track& track, uint32_t key) const {
+        const uint16_t* value = &this->mKeyValueList[track.valueOffset + (size_t)(key - track.keyOffset) * GetValueStride(kTranslation, track.format)];
+        if (track.format == kRaw) {
+            float component[3];
+            std::memcpy(component, value, sizeof(component));
+            return glm::vec3(component[0], component[1], component[2]);
+        }
+        return DecodeVectorValue(value, track.rangeMin, track.rangeExtent);
+    }
+    //------------------------------------------------------------------------------------------
+    glm::quat CompressedClip::DecodeRotation(const Track& track, uint32_t key) const {
+        const uint16_t* value = &this->mKeyValueList[track.valueOffset + (size_t)(key - track.keyOffset) * GetValueStride(kRotation, track.format)];
+        if (track.format == kRaw) {
+            float component[4];
+            std::memcpy(component, value, sizeof(component));
+            return glm::quat(component[3], component[0], component[1], component[2]);
+        }
+        return DecodeRotationValue(value);
+    }
+    //------------------------------------------------------------------------------------------
+    void CompressedClip::EvaluateLocalTransform(int node_id, float frame, glm::vec3* out_translation, glm::quat* out_rotation, glm::vec3* out_scaling) const {
+        float sample_position = (frame - this->mStartFrame) * this->mSampleRate / 60.0f;
+        const Track* track = &this->mTrackList[(size_t)node_id * kChannelCount];
+        uint32_t key0, key1;
+        float alpha;
+
+        FindKey(track[kTranslation], sample_position, &key0, &key1, &alpha);
+        *out_translation = glm::mix(DecodeVector(track[kTranslation], key0), DecodeVector(track[kTranslation], key1), alpha);
+
+        FindKey(track[kRotation], sample_position, &key0, &key1, &alpha);
+        //キーちょうどの時刻は補間しない。圧縮の時の誤差の確認と同じ値にする
+        *out_rotation = (key0 == key1 || alpha == 0.0f) ? DecodeRotation(track[kRotation], key0) : Nlerp(DecodeRotation(track[kRotation], key0), DecodeRotation(track[kRotation], key1), alpha);
+
+        FindKey(track[kScaling], sample_position, &key0, &key1, &alpha);
+        *out_scaling = glm::mix(DecodeVector(track[kScaling], key0), DecodeVector(track[kScaling], key1), alpha);
+    }
+    //------------------------------------------------------------------------------------------
+    glm::mat4 CompressedClip::EvaluateLocalMatrix(int node_id, float frame) const {
+        glm::vec3 translation;
+        glm::quat rotation;
+        glm::vec3 scaling;
+        EvaluateLocalTransform(node_id, frame, &translation, &rotation, &scaling);
+        return ComposeMatrix(translation, rotation, scaling);
+    }
+    //------------------------------------------------------------------------------------------
+    void CompressedClip::EvaluatePose(float frame, glm::mat4* out_global_list) const {
+        int node_count = this->GetNodeCount();
+        for (int i = 0; i < node_count; i++) {
+            glm::mat4 local = EvaluateLocalMatrix(i, frame);
+            int parent = this->mParentList[i];
+            out_global_list[i] = (parent >= 0) ? out_global_list[parent] * local : local;
+        }
+    }
+
+    //-- Compression --//
+    //ノードを親から順に圧縮する。ノードのキーを間引く時は、親は圧縮後の値、子孫は元の値で
+    //ノード自身と子孫のワールド座標の誤差を測り、全部が許容範囲に収まる間だけキーを飛ばす
+    bool CompressAnimationClip(CompressedClip* out_clip, const AnimationClip& clip, const CompressOption& option) {
+        if (clip.IsEmpty() || clip.GetKeyCount() > 65536) {
+            return false;
+        }
+        int node_count = clip.GetNodeCount();
+        int key_count = clip.GetKeyCount();
+        assert(option.nodeErrorToleranceList.empty() || (int)option.nodeErrorToleranceList.size() == node_count);
+
+        out_clip->mSampleRate = clip.GetSampleRate();
+        out_clip->mStartFrame = clip.GetAnimationStartFrame();
+        out_clip->mEndFrame = clip.GetAnimationEndFrame();
+        out_clip->mNodeNameList.clear();
+        out_clip->mParentList.clear();
+        out_clip->mTrackList.clear();
+        out_clip->mKeyFrameList.clear();
+        out_clip->mKeyValueList.clear();
+        out_clip->mTrackList.resize((size_t)node_count * CompressedClip::kChannelCount);
+
+        std::vector<std::vector<int>> child_list(node_count);
+        for (int n = 0; n < node_count; n++) {
+            out_clip->mNodeNameList.push_back(clip.GetNodeName(n));
+            out_clip->mParentList.push_back(clip.GetParent(n));
+            if (clip.GetParent(n) >= 0) {
+                child_list[clip.GetParent(n)].push_back(n);
+            }
+        }
+        auto get_tolerance = [&](int node_id) {
+            return option.nodeErrorToleranceList.empty() ? option.errorTolerance : option.nodeErrorToleranceList[node_id];
+        };
+
+        //元のクリップのローカル行列とワールド行列。元のクリップをキーの時刻で評価した値と丸めまで同じになるように作る
+        std::vector<glm::mat4> raw_local_list((size_t)node_count * key_count);
+        std::vector<glm::mat4> reference_world_list((size_t)node_count * key_count);
+        for (int n = 0; n < node_count; n++) {
+            int parent = clip.GetParent(n);
+            for (int k = 0; k < key_count; k++) {
+                size_t index = (size_t)n * key_count + k;
+                raw_local_list[index] = clip.EvaluateLocalMatrix(n, clip.GetKeyFrame(k));
+                reference_world_list[index] = (parent >= 0)
+                    ? reference_world_list[(size_t)parent * key_count + k] * raw_local_list[index]
+                    : raw_local_list[index];
+            }
+        }
+
+        //圧縮が終わったノードのワールド行列
+        std::vector<glm::mat4> lossy_world_list((size_t)node_count * key_count);
+        std::vector<glm::vec3> lossy_translation(key_count);
+        std::vector<glm::quat> lossy_rotation(key_count);
+        std::vector<glm::quat> raw_rotation(key_count);
+        std::vector<glm::vec3> lossy_scaling(key_count);
+        std::vector<glm::vec3> candidate_vector(key_count);
+        std::vector<glm::quat> candidate_rotation(key_count);
+        std::vector<uint16_t> encoded;
+        std::vector<int> descendant_list;
+        std::vector<int> descendant_parent_list;
+        std::vector<glm::mat4> descendant_world_list;
+        std::vector<int> kept_key_list;
+
+        const glm::vec4 shell_point[4] = {
+            glm::vec4(0.0f, 0.0f, 0.0f, 1.0f),
+            glm::vec4(option.shellDistance, 0.0f, 0.0f, 1.0f),
+            glm::vec4(0.0f, option.shellDistance, 0.0f, 1.0f),
+            glm::vec4(0.0f, 0.0f, option.shellDistance, 1.0f),
+        };
+
+        for (int n = 0; n < node_count; n++) {
+            int parent = clip.GetParent(n);
+            float tolerance = get_tolerance(n);
+
+            //子孫を親から順に並べ、それぞれの親の位置を覚える(このノードなら-1)
+            //子孫のワールド行列は再生の時と同じく親から1つずつ掛けて求める。まとめた相対行列を掛けると丸めが変わり、長い鎖で許容誤差を超える
+            descendant_list.clear();
+            descendant_parent_list.clear();
+            for (int child : child_list[n]) {
+                descendant_list.push_back(child);
+                descendant_parent_list.push_back(-1);
+            }
+            for (size_t i = 0; i < descendant_list.size(); i++) {
+                for (int child : child_list[descendant_list[i]]) {
+                    descendant_list.push_back(child);
+                    descendant_parent_list.push_back((int)i);
+                }
+            }
+            descendant_world_list.resize(descendant_list.size());
+
+            //まだ決まっていないチャンネルは元の値のまま誤差を測る
+            for (int k = 0; k < key_count; k++) {
+                //回転はキーの値ではなく、元のクリップが返す正規化した値を使う
+                clip.EvaluateLocalTransform(n, clip.GetKeyFrame(k), &lossy_translation[k], &raw_rotation[k], &lossy_scaling[k]);
+                lossy_rotation[k] = raw_rotation[k];
+            }
+
+            //キーkでの誤差が許容範囲に収まるか
+            auto check_error = [&](int k, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scaling) {
+                glm::mat4 world = ComposeMatrix(translation, rotation, scaling);
+                if (parent >= 0) {
+                    world = lossy_world_list[(size_t)parent * key_count + k] * world;
+                }
+                const glm::mat4& reference = reference_world_list[(size_t)n * key_count + k];
+                for (const auto& point : shell_point) {
+                    glm::vec4 diff = world * point - reference * point;
+                    if (glm::dot(diff, diff) > tolerance * tolerance) {
+                        return false;
+                    }
+                }
+                for (size_t i = 0; i < descendant_list.size(); i++) {
+                    int d = descendant_list[i];
+                    float d_tolerance = get_tolerance(d);
+                    int d_parent = descendant_parent_list[i];
+                    descendant_world_list[i] = ((d_parent >= 0) ? descendant_world_list[d_parent] : world) * raw_local_list[(size_t)d * key_count + k];
+                    glm::vec3 diff = GetPosition(descendant_world_list[i]) - GetPosition(reference_world_list[(size_t)d * key_count + k]);
+                    if (glm::dot(diff, diff) > d_tolerance * d_tolerance) {
+                        return false;
+                    }
+                }
+                return true;
+            };
+            //キーkのチャンネルcだけをvector/rotationに差し替えて誤差を測る
+            auto check_channel = [&](int c, int k, const glm::vec3& vector, const glm::quat& rotation) {
+                return check_error(k,
+                    (c == CompressedClip::kTranslation) ? vector : lossy_translation[k],
+                    (c == CompressedClip::kRotation) ? rotation : lossy_rotation[k],
+                    (c == CompressedClip::kScaling) ? vector : lossy_scaling[k]);
+            };
+
+            for (int c : { (int)CompressedClip::kRotation, (int)CompressedClip::kTranslation, (int)CompressedClip::kScaling }) {
+                auto get_raw_vector = [&](int k) {
+                    return (c == CompressedClip::kTranslation) ? clip.GetTranslationKey(n, k) : clip.GetScalingKey(n, k);
+                };
+
+                CompressedClip::Track track;
+                track.format = CompressedClip::kQuantized;
+                track.rangeMin = glm::vec3(0.0f);
+                track.rangeExtent = glm::vec3(0.0f);
+                if (c != CompressedClip::kRotation) {
+                    glm::vec3 range_max = get_raw_vector(0);
+                    track.rangeMin = range_max;
+                    for (int k = 1; k < key_count; k++) {
+                        track.rangeMin = glm::min(track.rangeMin, get_raw_vector(k));
+                        range_max = glm::max(range_max, get_raw_vector(k));
+                    }
+                    track.rangeExtent = range_max - track.rangeMin;
+                }
+
+                //量子化した値で全キーの誤差を確かめ、収まらなければこのチャンネルは量子化しない
+                encoded.resize((size_t)key_count * 3);
+                bool quantize_ok = true;
+                for (int k = 0; k < key_count; k++) {
+                    uint16_t* value = &encoded[(size_t)k * 3];
+                    if (c == CompressedClip::kRotation) {
+                        EncodeRotation(raw_rotation[k], value);
+                        candidate_rotation[k] = DecodeRotationValue(value);
+                    }
+                    else {
+                        EncodeVector(get_raw_vector(k), track.rangeMin, track.rangeExtent, value);
+                        candidate_vector[k] = DecodeVectorValue(value, track.rangeMin, track.rangeExtent);
+                    }
+                    if (quantize_ok) {
+                        quantize_ok = check_channel(c, k, candidate_vector[k], candidate_rotation[k]);
+                    }
+                }
+                if (!quantize_ok) {
+                    track.format = CompressedClip::kRaw;
+                    int stride = CompressedClip::GetValueStride(c, track.format);
+                    encoded.resize((size_t)key_count * stride);
+                    for (int k = 0; k < key_count; k++) {
+                        if (c == CompressedClip::kRotation) {
+                            const glm::quat& rotation = raw_rotation[k];
+                            float component[4] = { rotation.x, rotation.y, rotation.z, rotation.w };
+                            std::memcpy(&encoded[(size_t)k * stride], component, sizeof(component));
+                            candidate_rotation[k] = rotation;
+                        }
+                        else {
+                            glm::vec3 vector = get_raw_vector(k);
+                            float component[3] = { vector.x, vector.y, vector.z };
+                            std::memcpy(&encoded[(size_t)k * stride], component, sizeof(component));
+                            candidate_vector[k] = vector;
+                        }
+                    }
+                }
+                int stride = CompressedClip::GetValueStride(c, track.format);
+
+                //a,bのキーを補間した値を間のキーに入れて誤差を確認する
+                auto segment_ok = [&](int a, int b) {
+                    for (int k = a + 1; k < b; k++) {
+                        float alpha = (float)(k - a) / (float)(b - a);
+                        glm::vec3 vector;
+                        glm::quat rotation;
+                        if (c == CompressedClip::kRotation) {
+                            rotation = Nlerp(candidate_rotation[a], candidate_rotation[b], alpha);
+                        }
+                        else {
+                            vector = glm::mix(candidate_vector[a], candidate_vector[b], alpha);
+                        }
+                        if (!check_channel(c, k, vector, rotation)) {
+                            return false;
+                        }
+                    }
+                    return true;
+                };
+
+                kept_key_list.clear();
+                kept_key_list.push_back(0);
+                bool constant = true;
+                for (int k = 1; k < key_count && constant; k++) {
+                    constant = std::equal(&encoded[(size_t)k * stride], &encoded[(size_t)k * stride + stride], &encoded[0]);
+                }
+                if (!constant) {
+                    //区間を倍々に伸ばして失敗したところから二分探索する。1つずつ伸ばすと長い区間で2乗の時間がかかる
+                    int a = 0;
+                    while (a < key_count - 1) {
+                        int good = a + 1;
+                        int bad = key_count;
+                        for (int step = 1; good + step < key_count; step *= 2) {
+                            if (!segment_ok(a, good + step)) {
+                                bad = good + step;
+                                break;
+                            }
+                            good += step;
+                        }
+                        while (bad - good > 1) {
+                            int middle = (good + bad) / 2;
+                            if (segment_ok(a, middle)) {
+                                good = middle;
+                            }
+                            else {
+                                bad = middle;
+                            }
+                        }
+                        kept_key_list.push_back(good);
+                        a = good;
+                    }
+                }
+
+                //残したキーで補間した値に置き換えて、次のチャンネルの判定に使う
+                for (size_t i = 0; i < kept_key_list.size(); i++) {
+                    int a = kept_key_list[i];
+                    int next = (i + 1 < kept_key_list.size()) ? kept_key_list[i + 1] : a;
+                    int end = (i + 1 < kept_key_list.size()) ? next : key_count;
+                    for (int k = a; k < end; k++) {
+                        float alpha = (next == a) ? 0.0f : (float)(k - a) / (float)(next - a);
+                        if (c == CompressedClip::kTranslation) {
+                            lossy_translation[k] = glm::mix(candidate_vector[a], candidate_vector[next], alpha);
+                        }
+                        else if (c == CompressedClip::kRotation) {
+                            lossy_rotation[k] = (next == a || k == a) ? candidate_rotation[a] : Nlerp(candidate_rotation[a], candidate_rotation[next], alpha);
+                        }
+                        else {
+                            lossy_scaling[k] = glm::mix(candidate_vector[a], candidate_vector[next], alpha);
+                        }
+                    }
+                }
+
+                track.keyOffset = (uint32_t)out_clip->mKeyFrameList.size();
+                track.keyCount = (uint32_t)kept_key_list.size();
+                track.valueOffset = (uint32_t)out_clip->mKeyValueList.size();
+                for (int key : kept_key_list) {
+                    out_clip->mKeyFrameList.push_back((uint16_t)key);
+                    out_clip->mKeyValueList.insert(out_clip->mKeyValueList.end(), &encoded[(size_t)key * stride], &encoded[(size_t)key * stride + stride]);
+                }
+                out_clip->mTrackList[(size_t)n * CompressedClip::kChannelCount + c] = track;
+            }
+
+            for (int k = 0; k < key_count; k++) {
+                glm::mat4 local = ComposeMatrix(lossy_translation[k], lossy_rotation[k], lossy_scaling[k]);
+                lossy_world_list[(size_t)n * key_count + k] = (parent >= 0) ? lossy_world_list[(size_t)parent * key_count + k] * local : local;
+            }
+        }
+        return true;
+    }
+    //------------------------------------------------------------------------------------------
+} // fbx
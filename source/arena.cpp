@@ -0,0 +1,108 @@
+﻿#include "../include/arena.h"
+
+#include <algorithm>
+
+namespace fbx {
+
+    namespace {
+        //一番外側のScratchScopeを抜けた時に残しておくブロックの大きさ
+        const size_t kScratchKeepBytes = 1 << 20;
+
+        thread_local int gScratchDepth = 0;
+    }
+
+    //------------------------------------------------------------------------------------------
+    LinearArena::LinearArena(size_t block_size) : mCurrent(0), mBlockSize(std::max<size_t>(block_size, 64)), mUsedBytes(0), mPeakBytes(0) {
+    }
+    //------------------------------------------------------------------------------------------
+    void* LinearArena::Allocate(size_t size, size_t alignment) {
+        if (size == 0) {
+            size = 1;
+        }
+        //今のブロックから順に入る所を探す。巻き戻した後は後ろのブロックを使い回す
+        for (; mCurrent < mBlockList.size(); mCurrent++) {
+            auto& block = mBlockList[mCurrent];
+            uintptr_t base = (uintptr_t)block.data.get();
+            size_t offset = (size_t)(((base + block.used + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base);
+            if (offset + size <= block.size) {
+                mUsedBytes += offset + size - block.used;
+                mPeakBytes = std::max(mPeakBytes, mUsedBytes);
+                block.used = offset + size;
+                return block.data.get() + offset;
+            }
+        }
+        Block block;
+        block.size = std::max(mBlockSize, size + alignment);
+        block.data.reset(new uint8_t[block.size]);
+        block.used = 0;
+        mBlockList.push_back(std::move(block));
+        mCurrent = mBlockList.size() - 1;
+        return this->Allocate(size, alignment);
+    }
+    //------------------------------------------------------------------------------------------
+    void LinearArena::Free(void* ptr, size_t size) {
+        if (ptr == nullptr || mCurrent >= mBlockList.size()) {
+            return;
+        }
+        auto& block = mBlockList[mCurrent];
+        if ((uint8_t*)ptr + size == block.data.get() + block.used) {
+            block.used -= size;
+            mUsedBytes -= size;
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    LinearArena::Marker LinearArena::GetMarker() const {
+        Marker marker;
+        marker.block = mCurrent;
+        marker.offset = (mCurrent < mBlockList.size()) ? mBlockList[mCurrent].used : 0;
+        return marker;
+    }
+    //------------------------------------------------------------------------------------------
+    void LinearArena::Rewind(const Marker& marker) {
+        for (size_t i = marker.block; i < mBlockList.size(); i++) {
+            auto& block = mBlockList[i];
+            size_t used = (i == marker.block) ? std::min(marker.offset, block.used) : 0;
+            mUsedBytes -= block.used - used;
+            block.used = used;
+        }
+        mCurrent = std::min(marker.block, mBlockList.size());
+    }
+    //------------------------------------------------------------------------------------------
+    void LinearArena::Reset(size_t keep_bytes) {
+        bool keep_first = !mBlockList.empty() && mBlockList[0].size <= keep_bytes;
+        mBlockList.resize(keep_first ? 1 : 0);
+        if (keep_first) {
+            mBlockList[0].used = 0;
+        }
+        mCurrent = 0;
+        mUsedBytes = 0;
+    }
+    //------------------------------------------------------------------------------------------
+    size_t LinearArena::GetReservedBytes() const {
+        size_t total = 0;
+        for (const auto& block : mBlockList) {
+            total += block.size;
+        }
+        return total;
+    }
+    //------------------------------------------------------------------------------------------
+    LinearArena* GetScratchArena() {
+        thread_local LinearArena arena;
+        return &arena;
+    }
+    //------------------------------------------------------------------------------------------
+    ScratchScope::ScratchScope() : mArena(GetScratchArena()), mMarker(mArena->GetMarker()) {
+        gScratchDepth++;
+    }
+    //------------------------------------------------------------------------------------------
+    ScratchScope::~ScratchScope() {
+        gScratchDepth--;
+        if (gScratchDepth == 0) {
+            mArena->Reset(kScratchKeepBytes);
+        }
+        else {
+            mArena->Rewind(mMarker);
+        }
+    }
+    //------------------------------------------------------------------------------------------
+} // fbx
@@ -0,0 +1,688 @@
+﻿#include "../include/asset_cache.h"
+#include "../include/fbx_binary.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <algorithm>
+
+namespace fbx {
+
+    namespace {
+        const char kCacheMagic[8] = { 'F', 'B', 'X', 'M', 'E', 'S', 'H', '\0' };
+        const uint32_t kCacheFormatVersion = 7;
+        //各セクションの先頭をそろえる。mmapしたまま頂点をSIMDで読めるように
+        const size_t kSectionAlignment = 16;
+
+        struct FileHeader {
+            char magic[8];
+            uint32_t formatVersion;
+            uint32_t meshCount;
+            uint32_t materialCount;
+            uint32_t instanceCount;
+            AssetCacheKey key;
+            uint64_t fileSize;
+            uint64_t meshTableOffset;
+            uint64_t materialTableOffset;
+            uint64_t instanceTableOffset;
+            uint64_t stringOffset;
+            uint64_t stringSize;
+        };
+
+        //文字列はすべて文字列セクションの中の位置(0終端)で持つ
+        struct MeshRecord {
+            uint32_t nameString;
+            uint32_t materialString;
+            uint32_t vertexCount;
+            uint32_t indexCount;
+            //2か4
+            uint32_t indexSize;
+            uint32_t boneCount;
+            uint32_t jointCount;
+            uint32_t lodCount;
+            uint64_t vertexOffset;
+            uint64_t indexOffset;
+            //uint32_t(文字列の位置) x boneCount
+            uint64_t boneNameOffset;
+            //glm::mat4 x boneCount
+            uint64_t bindPoseOffset;
+            //uint32_t x jointCount, int32_t x jointCount, glm::mat4 x jointCount
+            uint64_t jointNameOffset;
+            uint64_t jointParentOffset;
+            uint64_t jointRestOffset;
+            //LodRecord x lodCount
+            uint64_t lodOffset;
+            //ModelMeshlet x meshletCount, uint32_t x meshletVertexCount, uint8_t x meshletTriangleSize
+            uint32_t meshletCount;
+            uint32_t meshletVertexCount;
+            uint32_t meshletTriangleSize;
+            //ModelMesh::partialWeight
+            uint32_t partialWeight;
+            uint64_t meshletOffset;
+            uint64_t meshletVertexOffset;
+            uint64_t meshletTriangleOffset;
+            //ModelBounds x boneCount
+            uint64_t boneBoundsOffset;
+            //BlendShapeChannelRecord x blendShapeChannelCount, BlendShapeTargetRecord x blendShapeTargetCount
+            uint32_t blendShapeChannelCount;
+            uint32_t blendShapeTargetCount;
+            uint64_t blendShapeChannelOffset;
+            uint64_t blendShapeTargetOffset;
+            //glm::vec4 x tangentCount。0かvertexCount
+            uint32_t tangentCount;
+            uint32_t reserved;
+            uint64_t tangentOffset;
+            //ModelBounds::min, max, center, radius
+            float bounds[10];
+            float invMeshBaseposeMatrix[16];
+        };
+
+        //インデックスの大きさはメッシュと同じ
+        struct LodRecord {
+            uint64_t indexOffset;
+            uint32_t indexCount;
+            float error;
+        };
+
+        struct BlendShapeChannelRecord {
+            uint32_t nameString;
+            uint32_t targetCount;
+            float defaultWeight;
+            uint32_t reserved;
+        };
+
+        //ターゲットはチャンネルの順に並ぶ。uint32_t x deltaCount, ModelBlendShapeDelta x deltaCount
+        struct BlendShapeTargetRecord {
+            uint32_t nameString;
+            uint32_t deltaCount;
+            float fullWeight;
+            uint32_t reserved;
+            uint64_t vertexIndexOffset;
+            uint64_t deltaOffset;
+        };
+
+        struct MaterialRecord {
+            uint32_t nameString[6];
+        };
+
+        //meshIndexはこのファイルの中のメッシュの番号
+        struct InstanceRecord {
+            uint32_t meshIndex;
+            uint32_t nodeString;
+            uint32_t materialString;
+            uint32_t reserved;
+            float transform[16];
+        };
+
+        //------------------------------------------------------------------------------------------
+        void WriteBounds(float* out, const ModelBounds& bounds) {
+            for (int i = 0; i < 3; i++) {
+                out[i] = bounds.min[i];
+                out[3 + i] = bounds.max[i];
+                out[6 + i] = bounds.center[i];
+            }
+            out[9] = bounds.radius;
+        }
+        //------------------------------------------------------------------------------------------
+        void ReadBounds(ModelBounds* out, const float* bounds) {
+            for (int i = 0; i < 3; i++) {
+                out->min[i] = bounds[i];
+                out->max[i] = bounds[3 + i];
+                out->center[i] = bounds[6 + i];
+            }
+            out->radius = bounds[9];
+        }
+        //------------------------------------------------------------------------------------------
+        inline uint64_t RotateLeft(uint64_t value, int shift) {
+            return (value << shift) | (value >> (64 - shift));
+        }
+        //------------------------------------------------------------------------------------------
+        inline uint64_t ReadWord(const uint8_t* p) {
+            uint64_t value;
+            std::memcpy(&value, p, sizeof(value));
+            return value;
+        }
+
+        //-- CacheWriter --//
+        class CacheWriter
+        {
+        public:
+            CacheWriter() {
+                mBuffer.resize(sizeof(FileHeader));
+                //0は空文字列にしておく
+                mStringList.push_back('\0');
+            }
+            template<class T>
+            uint64_t Append(const T* data, size_t count) {
+                size_t offset = (mBuffer.size() + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment;
+                mBuffer.resize(offset + sizeof(T) * count);
+                if (count > 0) {
+                    std::memcpy(&mBuffer[offset], data, sizeof(T) * count);
+                }
+                return offset;
+            }
+            uint32_t AddString(const std::string& str) {
+                if (str.empty()) {
+                    return 0;
+                }
+                uint32_t offset = (uint32_t)mStringList.size();
+                mStringList.insert(mStringList.end(), str.begin(), str.end());
+                mStringList.push_back('\0');
+                return offset;
+            }
+            const std::vector<char>& GetStringList() const {
+                return mStringList;
+            }
+            std::vector<uint8_t>* GetBuffer() {
+                return &mBuffer;
+            }
+        private:
+            std::vector<uint8_t> mBuffer;
+            std::vector<char> mStringList;
+        };
+
+        //-- CacheReader --//
+        //mmapしたファイルの範囲を確かめながら読む
+        class CacheReader
+        {
+        public:
+            CacheReader(const uint8_t* data, size_t size, const FileHeader& header) : mData(data), mSize(size), mHeader(header) {
+            }
+            template<class T>
+            bool Read(uint64_t offset, size_t count, std::vector<T>* out) const {
+                if (offset > mSize || count > (mSize - offset) / sizeof(T)) {
+                    return false;
+                }
+                out->resize(count);
+                if (count > 0) {
+                    std::memcpy(out->data(), mData + offset, sizeof(T) * count);
+                }
+                return true;
+            }
+            bool ReadString(uint32_t offset, std::string* out) const {
+                if (offset >= mHeader.stringSize) {
+                    return false;
+                }
+                const char* begin = (const char*)mData + mHeader.stringOffset + offset;
+                const void* end = std::memchr(begin, '\0', (size_t)(mHeader.stringSize - offset));
+                if (end == nullptr) {
+                    return false;
+                }
+                out->assign(begin, (const char*)end);
+                return true;
+            }
+            bool ReadStringList(uint64_t offset, size_t count, std::vector<std::string>* out) const {
+                std::vector<uint32_t> string_list;
+                if (!Read(offset, count, &string_list)) {
+                    return false;
+                }
+                out->resize(count);
+                for (size_t i = 0; i < count; i++) {
+                    if (!ReadString(string_list[i], &(*out)[i])) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+        private:
+            const uint8_t* mData;
+            size_t mSize;
+            const FileHeader& mHeader;
+        };
+
+        //------------------------------------------------------------------------------------------
+        bool ReadMesh(ModelMesh* out_mesh, const CacheReader& reader, const MeshRecord& record) {
+            if (!reader.ReadString(record.nameString, &out_mesh->nodeName) || !reader.ReadString(record.materialString, &out_mesh->materialName)) {
+                return false;
+            }
+            if (!reader.Read(record.vertexOffset, record.vertexCount, &out_mesh->vertexList)) {
+                return false;
+            }
+            if (record.indexSize == 4) {
+                if (!reader.Read(record.indexOffset, record.indexCount, &out_mesh->indexList32)) {
+                    return false;
+                }
+            }
+            else if (record.indexSize != 2 || !reader.Read(record.indexOffset, record.indexCount, &out_mesh->indexList)) {
+                return false;
+            }
+            std::vector<LodRecord> lod_record_list;
+            if (!reader.Read(record.lodOffset, record.lodCount, &lod_record_list)) {
+                return false;
+            }
+            out_mesh->lodList.resize(record.lodCount);
+            for (size_t i = 0; i < lod_record_list.size(); i++) {
+                auto& lod = out_mesh->lodList[i];
+                const auto& lod_record = lod_record_list[i];
+                lod.error = lod_record.error;
+                bool result = (record.indexSize == 4) ? reader.Read(lod_record.indexOffset, lod_record.indexCount, &lod.indexList32)
+                    : reader.Read(lod_record.indexOffset, lod_record.indexCount, &lod.indexList);
+                if (!result) {
+                    return false;
+                }
+            }
+            if (!reader.Read(record.meshletOffset, record.meshletCount, &out_mesh->meshletList)
+                || !reader.Read(record.meshletVertexOffset, record.meshletVertexCount, &out_mesh->meshletVertexList)
+                || !reader.Read(record.meshletTriangleOffset, record.meshletTriangleSize, &out_mesh->meshletTriangleList)) {
+                return false;
+            }
+            //メッシュレットの範囲が壊れていないか
+            for (const auto& meshlet : out_mesh->meshletList) {
+                if ((uint64_t)meshlet.vertexOffset + meshlet.vertexCount > out_mesh->meshletVertexList.size()
+                    || (uint64_t)meshlet.triangleOffset + meshlet.triangleCount * 3ULL > out_mesh->meshletTriangleList.size()) {
+                    return false;
+                }
+            }
+            for (int i = 0; i < 16; i++) {
+                out_mesh->invMeshBaseposeMatrix[i / 4][i % 4] = record.invMeshBaseposeMatrix[i];
+            }
+            if (!reader.ReadStringList(record.boneNameOffset, record.boneCount, &out_mesh->boneNodeNameList)
+                || !reader.Read(record.bindPoseOffset, record.boneCount, &out_mesh->invBoneBaseposeMatrixList)
+                || !reader.Read(record.boneBoundsOffset, record.boneCount, &out_mesh->boneBoundsList)) {
+                return false;
+            }
+            ReadBounds(&out_mesh->bounds, record.bounds);
+            out_mesh->partialWeight = record.partialWeight != 0;
+            if ((record.tangentCount != 0 && record.tangentCount != record.vertexCount)
+                || !reader.Read(record.tangentOffset, record.tangentCount, &out_mesh->tangentList)) {
+                return false;
+            }
+            std::vector<BlendShapeChannelRecord> channel_record_list;
+            std::vector<BlendShapeTargetRecord> target_record_list;
+            if (!reader.Read(record.blendShapeChannelOffset, record.blendShapeChannelCount, &channel_record_list)
+                || !reader.Read(record.blendShapeTargetOffset, record.blendShapeTargetCount, &target_record_list)) {
+                return false;
+            }
+            out_mesh->blendShapeList.resize(channel_record_list.size());
+            size_t target_index = 0;
+            for (size_t c = 0; c < channel_record_list.size(); c++) {
+                auto& channel = out_mesh->blendShapeList[c];
+                const auto& channel_record = channel_record_list[c];
+                if (!reader.ReadString(channel_record.nameString, &channel.name) || channel_record.targetCount > target_record_list.size() - target_index) {
+                    return false;
+                }
+                channel.defaultWeight = channel_record.defaultWeight;
+                channel.targetList.resize(channel_record.targetCount);
+                for (auto& target : channel.targetList) {
+                    const auto& target_record = target_record_list[target_index++];
+                    target.fullWeight = target_record.fullWeight;
+                    if (!reader.ReadString(target_record.nameString, &target.name)
+                        || !reader.Read(target_record.vertexIndexOffset, target_record.deltaCount, &target.vertexIndexList)
+                        || !reader.Read(target_record.deltaOffset, target_record.deltaCount, &target.deltaList)) {
+                        return false;
+                    }
+                    //頂点の範囲外を指していないか
+                    for (unsigned int vertex : target.vertexIndexList) {
+                        if (vertex >= record.vertexCount) {
+                            return false;
+                        }
+                    }
+                }
+            }
+            if (record.jointCount == 0) {
+                return true;
+            }
+            std::vector<std::string> joint_name_list;
+            std::vector<int32_t> parent_list;
+            std::vector<glm::mat4> rest_local_list;
+            if (!reader.ReadStringList(record.jointNameOffset, record.jointCount, &joint_name_list)
+                || !reader.Read(record.jointParentOffset, record.jointCount, &parent_list)
+                || !reader.Read(record.jointRestOffset, record.jointCount, &rest_local_list)) {
+                return false;
+            }
+            //親が子より前にあることを確かめてから渡す
+            for (int32_t i = 0; i < (int32_t)parent_list.size(); i++) {
+                if (parent_list[i] >= i) {
+                    return false;
+                }
+            }
+            out_mesh->skeleton.Initialize(joint_name_list, std::vector<int>(parent_list.begin(), parent_list.end()), rest_local_list,
+                out_mesh->boneNodeNameList, out_mesh->invBoneBaseposeMatrixList);
+            return true;
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    //xxHash64と同じ組み立て(4レーンで32バイトずつ)
+    uint64_t HashBytes(const void* data, size_t size, uint64_t seed) {
+        const uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+        const uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+        const uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+        const uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+        const uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+        auto round = [&](uint64_t acc, uint64_t input) {
+            return RotateLeft(acc + input * kPrime2, 31) * kPrime1;
+        };
+
+        const uint8_t* p = (const uint8_t*)data;
+        const uint8_t* end = p + size;
+        uint64_t hash;
+        if (size >= 32) {
+            uint64_t lane[4] = { seed + kPrime1 + kPrime2, seed + kPrime2, seed, seed - kPrime1 };
+            for (; p + 32 <= end; p += 32) {
+                for (int i = 0; i < 4; i++) {
+                    lane[i] = round(lane[i], ReadWord(p + i * 8));
+                }
+            }
+            hash = RotateLeft(lane[0], 1) + RotateLeft(lane[1], 7) + RotateLeft(lane[2], 12) + RotateLeft(lane[3], 18);
+            for (int i = 0; i < 4; i++) {
+                hash = (hash ^ round(0, lane[i])) * kPrime1 + kPrime4;
+            }
+        }
+        else {
+            hash = seed + kPrime5;
+        }
+        hash += (uint64_t)size;
+        for (; p + 8 <= end; p += 8) {
+            hash = RotateLeft(hash ^ round(0, ReadWord(p)), 27) * kPrime1 + kPrime4;
+        }
+        for (; p < end; p++) {
+            hash = RotateLeft(hash ^ (*p * kPrime5), 11) * kPrime1;
+        }
+        hash ^= hash >> 33;
+        hash *= kPrime2;
+        hash ^= hash >> 29;
+        hash *= kPrime3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+    //------------------------------------------------------------------------------------------
+    AssetCacheKey MakeAssetCacheKey(const void* content, size_t content_size, AssetCacheLoader loader, const void* option, size_t option_size) {
+        AssetCacheKey key;
+        key.contentHash = HashBytes(content, content_size, 0);
+        key.contentSize = content_size;
+        key.optionHash = HashBytes(option, option_size, 0);
+        key.loader = (uint32_t)loader;
+        key.loaderVersion = kAssetCacheLoaderVersion;
+        return key;
+    }
+    //------------------------------------------------------------------------------------------
+    AssetCacheKey MakeAssetCacheKey(const void* content, size_t content_size, AssetCacheLoader loader, const WeldOption& weld_option,
+        const OptimizeOption& optimize_option, const LodOption& lod_option, const MeshletOption& meshlet_option, const TangentOption& tangent_option,
+        const InstanceOption& instance_option) {
+        if (!optimize_option.enable && !lod_option.enable && !meshlet_option.enable && !tangent_option.enable && !instance_option.enable) {
+            return MakeAssetCacheKey(content, content_size, loader, &weld_option, sizeof(weld_option));
+        }
+        //構造体の詰め物が入らないようにfloatに揃えて並べる
+        const float option_list[] = {
+            weld_option.positionEpsilon,
+            weld_option.normalEpsilon,
+            weld_option.uvEpsilon,
+            optimize_option.enable ? (float)optimize_option.cacheSize : 0.0f,
+            optimize_option.enable && optimize_option.overdraw ? 1.0f : 0.0f,
+            optimize_option.enable && optimize_option.overdraw ? optimize_option.overdrawThreshold : 0.0f,
+            optimize_option.enable && optimize_option.vertexFetch ? 1.0f : 0.0f,
+            lod_option.enable ? (float)lod_option.levelCount : 0.0f,
+            lod_option.enable ? lod_option.triangleRatio : 0.0f,
+            lod_option.enable ? lod_option.targetError : 0.0f,
+            lod_option.enable ? lod_option.attributeWeight : 0.0f,
+            meshlet_option.enable ? (float)meshlet_option.maxVertexCount : 0.0f,
+            meshlet_option.enable ? (float)meshlet_option.maxTriangleCount : 0.0f,
+            meshlet_option.enable ? meshlet_option.coneWeight : 0.0f,
+            tangent_option.enable ? 1.0f : 0.0f,
+            instance_option.enable ? (instance_option.matchContent ? 2.0f : 1.0f) : 0.0f,
+        };
+        return MakeAssetCacheKey(content, content_size, loader, option_list, sizeof(option_list));
+    }
+    //------------------------------------------------------------------------------------------
+    std::string GetAssetCachePath(const char* source_path, const CacheOption& option) {
+        std::string path = source_path;
+        if (!option.directory.empty()) {
+            size_t slash = path.find_last_of("/\\");
+            std::string file_name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+            path = option.directory;
+            if (path.back() != '/' && path.back() != '\\') {
+                path += '/';
+            }
+            path += file_name;
+        }
+        return path + ".meshcache";
+    }
+    //------------------------------------------------------------------------------------------
+    bool LoadAssetCache(const char* cache_path, const AssetCacheKey& key, std::vector<ModelMesh>* out_mesh_list, std::vector<ModelMaterial>* out_material_list,
+        std::vector<ModelInstance>* out_instance_list) {
+        binary::MappedFile file;
+        if (!file.Open(cache_path)) {
+            return false;
+        }
+        const uint8_t* data = file.GetData();
+        size_t size = file.GetSize();
+        FileHeader header;
+        if (size < sizeof(header)) {
+            printf("cache: broken file [%s]\n", cache_path);
+            return false;
+        }
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, kCacheMagic, sizeof(kCacheMagic)) != 0 || header.formatVersion != kCacheFormatVersion || header.fileSize != size
+            || header.stringOffset > size || header.stringSize > size - header.stringOffset) {
+            printf("cache: broken file [%s]\n", cache_path);
+            return false;
+        }
+        if (header.key.contentHash != key.contentHash || header.key.contentSize != key.contentSize || header.key.optionHash != key.optionHash
+            || header.key.loader != key.loader || header.key.loaderVersion != key.loaderVersion) {
+            printf("cache: stale [%s]\n", cache_path);
+            return false;
+        }
+
+        CacheReader reader(data, size, header);
+        std::vector<MeshRecord> mesh_record_list;
+        std::vector<MaterialRecord> material_record_list;
+        std::vector<InstanceRecord> instance_record_list;
+        if (!reader.Read(header.meshTableOffset, header.meshCount, &mesh_record_list) || !reader.Read(header.materialTableOffset, header.materialCount, &material_record_list)
+            || !reader.Read(header.instanceTableOffset, header.instanceCount, &instance_record_list)) {
+            printf("cache: broken file [%s]\n", cache_path);
+            return false;
+        }
+
+        std::vector<ModelMesh> mesh_list(mesh_record_list.size());
+        for (size_t i = 0; i < mesh_record_list.size(); i++) {
+            if (!ReadMesh(&mesh_list[i], reader, mesh_record_list[i])) {
+                printf("cache: broken mesh %d [%s]\n", (int)i, cache_path);
+                return false;
+            }
+        }
+        std::vector<ModelMaterial> material_list(material_record_list.size());
+        for (size_t i = 0; i < material_record_list.size(); i++) {
+            auto& material = material_list[i];
+            std::string* field_list[6] = { &material.materialName, &material.diffuseTextureName, &material.normalTextureName,
+                &material.specularTextureName, &material.falloffTextureName, &material.reflectionMapTextureName };
+            for (int f = 0; f < 6; f++) {
+                if (!reader.ReadString(material_record_list[i].nameString[f], field_list[f])) {
+                    printf("cache: broken material %d [%s]\n", (int)i, cache_path);
+                    return false;
+                }
+            }
+        }
+        //メッシュの番号は読み込み先のリストの後ろに足した位置にずらす
+        std::vector<ModelInstance> instance_list(instance_record_list.size());
+        for (size_t i = 0; i < instance_record_list.size(); i++) {
+            auto& instance = instance_list[i];
+            const auto& instance_record = instance_record_list[i];
+            if (instance_record.meshIndex >= mesh_list.size() || !reader.ReadString(instance_record.nodeString, &instance.nodeName)
+                || !reader.ReadString(instance_record.materialString, &instance.materialName)) {
+                printf("cache: broken instance %d [%s]\n", (int)i, cache_path);
+                return false;
+            }
+            instance.meshIndex = (int)(out_mesh_list->size() + instance_record.meshIndex);
+            for (int k = 0; k < 16; k++) {
+                instance.transform[k / 4][k % 4] = instance_record.transform[k];
+            }
+        }
+
+        if (out_instance_list != nullptr) {
+            std::move(instance_list.begin(), instance_list.end(), std::back_inserter(*out_instance_list));
+        }
+        std::move(mesh_list.begin(), mesh_list.end(), std::back_inserter(*out_mesh_list));
+        std::move(material_list.begin(), material_list.end(), std::back_inserter(*out_material_list));
+        return true;
+    }
+    //------------------------------------------------------------------------------------------
+    bool SaveAssetCache(const char* cache_path, const AssetCacheKey& key, const ModelMesh* mesh_list, size_t mesh_count, const ModelMaterial* material_list, size_t material_count,
+        const ModelInstance* instance_list, size_t instance_count, int instance_mesh_offset) {
+        CacheWriter writer;
+        std::vector<MeshRecord> mesh_record_list(mesh_count);
+        for (size_t i = 0; i < mesh_count; i++) {
+            const auto& mesh = mesh_list[i];
+            auto& record = mesh_record_list[i];
+            std::memset(&record, 0, sizeof(record));
+            record.nameString = writer.AddString(mesh.nodeName);
+            record.materialString = writer.AddString(mesh.materialName);
+            //ArenaOptionで詰め直した後でも書けるようにビューから読む
+            auto vertex_list = mesh.GetVertexSpan();
+            record.vertexCount = (uint32_t)vertex_list.size();
+            record.vertexOffset = writer.Append(vertex_list.data(), vertex_list.size());
+            if (mesh.IsIndex32()) {
+                auto index_list = mesh.GetIndexSpan32();
+                record.indexSize = 4;
+                record.indexCount = (uint32_t)index_list.size();
+                record.indexOffset = writer.Append(index_list.data(), index_list.size());
+            }
+            else {
+                auto index_list = mesh.GetIndexSpan();
+                record.indexSize = 2;
+                record.indexCount = (uint32_t)index_list.size();
+                record.indexOffset = writer.Append(index_list.data(), index_list.size());
+            }
+            std::vector<LodRecord> lod_record_list(mesh.lodList.size());
+            for (size_t l = 0; l < mesh.lodList.size(); l++) {
+                const auto& lod = mesh.lodList[l];
+                auto& lod_record = lod_record_list[l];
+                std::memset(&lod_record, 0, sizeof(lod_record));
+                lod_record.error = lod.error;
+                if (mesh.IsIndex32()) {
+                    lod_record.indexCount = (uint32_t)lod.indexList32.size();
+                    lod_record.indexOffset = writer.Append(lod.indexList32.data(), lod.indexList32.size());
+                }
+                else {
+                    lod_record.indexCount = (uint32_t)lod.indexList.size();
+                    lod_record.indexOffset = writer.Append(lod.indexList.data(), lod.indexList.size());
+                }
+            }
+            record.lodCount = (uint32_t)lod_record_list.size();
+            record.lodOffset = writer.Append(lod_record_list.data(), lod_record_list.size());
+            record.meshletCount = (uint32_t)mesh.meshletList.size();
+            record.meshletOffset = writer.Append(mesh.meshletList.data(), mesh.meshletList.size());
+            record.meshletVertexCount = (uint32_t)mesh.meshletVertexList.size();
+            record.meshletVertexOffset = writer.Append(mesh.meshletVertexList.data(), mesh.meshletVertexList.size());
+            record.meshletTriangleSize = (uint32_t)mesh.meshletTriangleList.size();
+            record.meshletTriangleOffset = writer.Append(mesh.meshletTriangleList.data(), mesh.meshletTriangleList.size());
+            for (int k = 0; k < 16; k++) {
+                record.invMeshBaseposeMatrix[k] = mesh.invMeshBaseposeMatrix[k / 4][k % 4];
+            }
+
+            std::vector<uint32_t> bone_name_list;
+            for (const auto& name : mesh.boneNodeNameList) {
+                bone_name_list.push_back(writer.AddString(name));
+            }
+            record.boneCount = (uint32_t)bone_name_list.size();
+            record.boneNameOffset = writer.Append(bone_name_list.data(), bone_name_list.size());
+            record.bindPoseOffset = writer.Append(mesh.invBoneBaseposeMatrixList.data(), mesh.invBoneBaseposeMatrixList.size());
+            record.boneBoundsOffset = writer.Append(mesh.boneBoundsList.data(), mesh.boneBoundsList.size());
+            WriteBounds(record.bounds, mesh.bounds);
+            record.partialWeight = mesh.partialWeight ? 1 : 0;
+            record.tangentCount = (uint32_t)mesh.tangentList.size();
+            record.tangentOffset = writer.Append(mesh.tangentList.data(), mesh.tangentList.size());
+
+            std::vector<BlendShapeChannelRecord> channel_record_list;
+            std::vector<BlendShapeTargetRecord> target_record_list;
+            for (const auto& channel : mesh.blendShapeList) {
+                BlendShapeChannelRecord channel_record;
+                std::memset(&channel_record, 0, sizeof(channel_record));
+                channel_record.nameString = writer.AddString(channel.name);
+                channel_record.targetCount = (uint32_t)channel.targetList.size();
+                channel_record.defaultWeight = channel.defaultWeight;
+                channel_record_list.push_back(channel_record);
+                for (const auto& target : channel.targetList) {
+                    BlendShapeTargetRecord target_record;
+                    std::memset(&target_record, 0, sizeof(target_record));
+                    target_record.nameString = writer.AddString(target.name);
+                    target_record.deltaCount = (uint32_t)target.deltaList.size();
+                    target_record.fullWeight = target.fullWeight;
+                    target_record.vertexIndexOffset = writer.Append(target.vertexIndexList.data(), target.vertexIndexList.size());
+                    target_record.deltaOffset = writer.Append(target.deltaList.data(), target.deltaList.size());
+                    target_record_list.push_back(target_record);
+                }
+            }
+            record.blendShapeChannelCount = (uint32_t)channel_record_list.size();
+            record.blendShapeChannelOffset = writer.Append(channel_record_list.data(), channel_record_list.size());
+            record.blendShapeTargetCount = (uint32_t)target_record_list.size();
+            record.blendShapeTargetOffset = writer.Append(target_record_list.data(), target_record_list.size());
+
+            const auto& skeleton = mesh.skeleton;
+            std::vector<uint32_t> joint_name_list;
+            std::vector<int32_t> parent_list;
+            std::vector<glm::mat4> rest_local_list;
+            for (int j = 0; j < skeleton.GetJointCount(); j++) {
+                joint_name_list.push_back(writer.AddString(skeleton.GetJointName(j)));
+                parent_list.push_back(skeleton.GetParent(j));
+                rest_local_list.push_back(skeleton.GetRestLocalMatrix(j));
+            }
+            record.jointCount = (uint32_t)joint_name_list.size();
+            record.jointNameOffset = writer.Append(joint_name_list.data(), joint_name_list.size());
+            record.jointParentOffset = writer.Append(parent_list.data(), parent_list.size());
+            record.jointRestOffset = writer.Append(rest_local_list.data(), rest_local_list.size());
+        }
+        std::vector<MaterialRecord> material_record_list(material_count);
+        for (size_t i = 0; i < material_count; i++) {
+            const auto& material = material_list[i];
+            const std::string* field_list[6] = { &material.materialName, &material.diffuseTextureName, &material.normalTextureName,
+                &material.specularTextureName, &material.falloffTextureName, &material.reflectionMapTextureName };
+            for (int f = 0; f < 6; f++) {
+                material_record_list[i].nameString[f] = writer.AddString(*field_list[f]);
+            }
+        }
+
+        std::vector<InstanceRecord> instance_record_list(instance_count);
+        for (size_t i = 0; i < instance_count; i++) {
+            const auto& instance = instance_list[i];
+            auto& instance_record = instance_record_list[i];
+            std::memset(&instance_record, 0, sizeof(instance_record));
+            instance_record.meshIndex = (uint32_t)(instance.meshIndex - instance_mesh_offset);
+            instance_record.nodeString = writer.AddString(instance.nodeName);
+            instance_record.materialString = writer.AddString(instance.materialName);
+            for (int k = 0; k < 16; k++) {
+                instance_record.transform[k] = instance.transform[k / 4][k % 4];
+            }
+        }
+
+        FileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+        header.formatVersion = kCacheFormatVersion;
+        header.meshCount = (uint32_t)mesh_count;
+        header.materialCount = (uint32_t)material_count;
+        header.instanceCount = (uint32_t)instance_count;
+        header.key = key;
+        header.meshTableOffset = writer.Append(mesh_record_list.data(), mesh_record_list.size());
+        header.materialTableOffset = writer.Append(material_record_list.data(), material_record_list.size());
+        header.instanceTableOffset = writer.Append(instance_record_list.data(), instance_record_list.size());
+        header.stringSize = writer.GetStringList().size();
+        header.stringOffset = writer.Append(writer.GetStringList().data(), writer.GetStringList().size());
+        auto buffer = writer.GetBuffer();
+        header.fileSize = buffer->size();
+        std::memcpy(buffer->data(), &header, sizeof(header));
+
+        std::string temp_path = std::string(cache_path) + ".tmp";
+        FILE* fp = std::fopen(temp_path.c_str(), "wb");
+        if (fp == nullptr) {
+            printf("cache: cannot write [%s]\n", temp_path.c_str());
+            return false;
+        }
+        bool written = std::fwrite(buffer->data(), 1, buffer->size(), fp) == buffer->size();
+        written &= std::fclose(fp) == 0;
+        if (!written) {
+            std::remove(temp_path.c_str());
+            printf("cache: cannot write [%s]\n", temp_path.c_str());
+            return false;
+        }
+        //Windowsのrenameは上書きしないので先に消す
+        std::remove(cache_path);
+        if (std::rename(temp_path.c_str(), cache_path) != 0) {
+            std::remove(temp_path.c_str());
+            printf("cache: cannot replace [%s]\n", cache_path);
+            return false;
+        }
+        return true;
+    }
+    //------------------------------------------------------------------------------------------
+} // fbx
@@ -0,0 +1,185 @@
+﻿#include "../include/asset_registry.h"
+#include "../include/fbx_binary.h"
+#include "../include/blend_shape.h"
+#include "../include/tangent.h"
+#include "../include/mesh_instance.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+namespace fbx {
+
+    namespace {
+        template<class T>
+        size_t GetVectorBytes(const std::vector<T>& list) {
+            return list.size() * sizeof(T);
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    size_t MeshSet::GetMemorySize() const {
+        size_t bytes = GetVectorBytes(this->meshList) + GetVectorBytes(this->materialList) + GetInstanceMemorySize(this->instanceList);
+        for (const auto& mesh : this->meshList) {
+            bytes += GetVectorBytes(mesh.vertexList) + GetVectorBytes(mesh.indexList) + GetVectorBytes(mesh.indexList32);
+            for (const auto& lod : mesh.lodList) {
+                bytes += GetVectorBytes(lod.indexList) + GetVectorBytes(lod.indexList32);
+            }
+            bytes += GetVectorBytes(mesh.meshletList) + GetVectorBytes(mesh.meshletVertexList) + GetVectorBytes(mesh.meshletTriangleList);
+            bytes += GetVectorBytes(mesh.invBoneBaseposeMatrixList) + GetVectorBytes(mesh.boneBoundsList);
+            bytes += GetBlendShapeMemorySize(mesh) + GetTangentMemorySize(mesh);
+        }
+        return bytes;
+    }
+    //------------------------------------------------------------------------------------------
+    size_t AnimationSet::GetMemorySize() const {
+        size_t bytes = GetVectorBytes(this->clipList);
+        for (const auto& clip : this->clipList) {
+            bytes += clip.GetKeyMemorySize();
+        }
+        return bytes;
+    }
+    //------------------------------------------------------------------------------------------
+    std::string GetCanonicalPath(const char* filepath) {
+#ifdef _WIN32
+        char buffer[_MAX_PATH];
+        if (_fullpath(buffer, filepath, _MAX_PATH) == nullptr) {
+            return std::string();
+        }
+        std::string path = buffer;
+        std::transform(path.begin(), path.end(), path.begin(), [](char c) { return c == '/' ? '\\' : (char)std::tolower((unsigned char)c); });
+        return path;
+#else
+        char* resolved = realpath(filepath, nullptr);
+        if (resolved == nullptr) {
+            return std::string();
+        }
+        std::string path = resolved;
+        free(resolved);
+        return path;
+#endif
+    }
+
+    //-- AssetRegistry Class --//
+    AssetRegistry::AssetRegistry() {
+        mMemoryBudget = (size_t)-1;
+        mUseCount = 0;
+    }
+    //------------------------------------------------------------------------------------------
+    AssetRegistry& AssetRegistry::GetInstance() {
+        static AssetRegistry registry;
+        return registry;
+    }
+    //------------------------------------------------------------------------------------------
+    void AssetRegistry::SetMemoryBudget(size_t bytes) {
+        std::lock_guard<std::mutex> lock(this->mMutex);
+        this->mMemoryBudget = bytes;
+        this->Evict(bytes);
+    }
+    //------------------------------------------------------------------------------------------
+    void AssetRegistry::Trim() {
+        std::lock_guard<std::mutex> lock(this->mMutex);
+        this->Evict(0);
+    }
+    //------------------------------------------------------------------------------------------
+    AssetRegistryStats AssetRegistry::GetStats() const {
+        std::lock_guard<std::mutex> lock(this->mMutex);
+        AssetRegistryStats stats = this->mStats;
+        stats.entryCount = this->mEntryMap.size();
+        return stats;
+    }
+    //------------------------------------------------------------------------------------------
+    //ロックした状態で呼ぶ。登録簿の外で持たれているもの(参照が登録簿の分だけでないもの)は捨てない
+    void AssetRegistry::Evict(size_t budget) {
+        while (this->mStats.residentBytes > budget) {
+            auto oldest = this->mEntryMap.end();
+            for (auto it = this->mEntryMap.begin(); it != this->mEntryMap.end(); ++it) {
+                if (!it->second.loaded || it->second.future.get().use_count() > 1) {
+                    continue;
+                }
+                if (oldest == this->mEntryMap.end() || it->second.lastUse < oldest->second.lastUse) {
+                    oldest = it;
+                }
+            }
+            if (oldest == this->mEntryMap.end()) {
+                return;
+            }
+            this->mStats.residentBytes -= oldest->second.bytes;
+            this->mStats.evictCount++;
+            this->mEntryMap.erase(oldest);
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    std::shared_ptr<const void> AssetRegistry::Acquire(int kind, const char* filepath, uint64_t option_hash, const LoadFunction& load) {
+        //中身のハッシュはロックの外で求める
+        AssetKey key;
+        key.kind = kind;
+        key.optionHash = option_hash;
+        key.path = GetCanonicalPath(filepath);
+        uint64_t content_hash = 0;
+        binary::MappedFile file;
+        if (key.path.empty() || !file.Open(key.path.c_str())) {
+            printf("asset registry: file not found [%s]\n", filepath);
+            std::lock_guard<std::mutex> lock(this->mMutex);
+            this->mStats.requestCount++;
+            this->mStats.failCount++;
+            return nullptr;
+        }
+        content_hash = HashBytes(file.GetData(), file.GetSize(), 0);
+        file.Close();
+
+        std::promise<std::shared_ptr<const void>> promise;
+        std::shared_future<std::shared_ptr<const void>> future;
+        {
+            std::lock_guard<std::mutex> lock(this->mMutex);
+            this->mStats.requestCount++;
+            auto it = this->mEntryMap.find(key);
+            if (it != this->mEntryMap.end() && it->second.contentHash == content_hash) {
+                this->mStats.hitCount++;
+                it->second.lastUse = ++this->mUseCount;
+                future = it->second.future;
+            }
+            else {
+                //ファイルが書き換わっていたら古いものは登録簿から外す。持っている所はそのまま使える
+                if (it != this->mEntryMap.end()) {
+                    this->mStats.residentBytes -= it->second.bytes;
+                    this->mEntryMap.erase(it);
+                }
+                Entry entry;
+                entry.contentHash = content_hash;
+                entry.future = promise.get_future().share();
+                entry.lastUse = ++this->mUseCount;
+                this->mEntryMap.insert({ key, entry });
+                this->mStats.loadCount++;
+            }
+        }
+        //他のスレッドが読み込んでいれば終わるのを待つ
+        if (future.valid()) {
+            return future.get();
+        }
+
+        size_t bytes = 0;
+        std::shared_ptr<const void> asset = load(key.path.c_str(), &bytes);
+        promise.set_value(asset);
+
+        std::lock_guard<std::mutex> lock(this->mMutex);
+        auto it = this->mEntryMap.find(key);
+        //読み込み中に書き換わって別の読み込みに置き換わっていれば何もしない
+        if (it == this->mEntryMap.end() || it->second.contentHash != content_hash || it->second.loaded) {
+            return asset;
+        }
+        if (asset == nullptr) {
+            //失敗は覚えずに、次の要求でもう一度読む
+            this->mStats.failCount++;
+            this->mEntryMap.erase(it);
+            return asset;
+        }
+        it->second.loaded = true;
+        it->second.bytes = bytes;
+        this->mStats.residentBytes += bytes;
+        this->Evict(this->mMemoryBudget);
+        return asset;
+    }
+    //------------------------------------------------------------------------------------------
+} // fbx
@@ -0,0 +1,141 @@
+﻿#include "../include/async_load.h"
+
+#include <algorithm>
+
+namespace fbx {
+
+    //-- AsyncLoadJob Class --//
+    AsyncLoadJob::AsyncLoadJob(const LoadListener& listener, int priority)
+        : mListener(listener), mCancel(false), mPriority(priority), mState(kAsyncLoadPending),
+        mFirstMeshTime(-1.0), mTotalTime(-1.0), mDeliveredMeshCount(0), mRequestTime(std::chrono::steady_clock::now()) {
+    }
+    //------------------------------------------------------------------------------------------
+    bool AsyncLoadJob::Wait() {
+        std::unique_lock<std::mutex> lock(this->mMutex);
+        this->mDoneCondition.wait(lock, [this]() { return this->IsFinished(); });
+        return this->GetState() == kAsyncLoadSucceeded;
+    }
+    //------------------------------------------------------------------------------------------
+    void AsyncLoadJob::Cancel() {
+        this->mCancel.store(true);
+    }
+    //------------------------------------------------------------------------------------------
+    double AsyncLoadJob::GetElapsedMs() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - this->mRequestTime).count();
+    }
+    //------------------------------------------------------------------------------------------
+    void AsyncLoadJob::Execute() {
+        if (this->mCancel.load()) {
+            this->Finish(kAsyncLoadCanceled);
+            return;
+        }
+        this->mState.store(kAsyncLoadRunning);
+
+        //届いた時間と数を記録してから呼び出し元のリスナーに渡す
+        LoadListener listener;
+        listener.onMesh = [this](size_t index, const ModelMesh& mesh) {
+            if (this->mDeliveredMeshCount.fetch_add(1) == 0) {
+                this->mFirstMeshTime.store(this->GetElapsedMs());
+            }
+            if (this->mListener.onMesh) {
+                this->mListener.onMesh(index, mesh);
+            }
+        };
+        listener.onMaterial = this->mListener.onMaterial;
+        listener.cancel = &this->mCancel;
+
+        bool result = this->Run(listener);
+        if (this->mCancel.load()) {
+            this->Finish(kAsyncLoadCanceled);
+        }
+        else {
+            this->Finish(result ? kAsyncLoadSucceeded : kAsyncLoadFailed);
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    void AsyncLoadJob::Finish(AsyncLoadState state) {
+        this->mTotalTime.store(this->GetElapsedMs());
+        {
+            std::lock_guard<std::mutex> lock(this->mMutex);
+            this->mState.store(state);
+        }
+        this->mDoneCondition.notify_all();
+    }
+    //------------------------------------------------------------------------------------------
+    //-- AsyncLoader Class --//
+    AsyncLoader::AsyncLoader(int thread_count) : mExit(false) {
+        if (thread_count <= 0) {
+            thread_count = std::max(1, (int)std::thread::hardware_concurrency());
+        }
+        for (int i = 0; i < thread_count; i++) {
+            this->mThreadList.emplace_back(&AsyncLoader::WorkerMain, this);
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    AsyncLoader::~AsyncLoader() {
+        std::vector<std::shared_ptr<AsyncLoadJob>> pending_list;
+        {
+            std::lock_guard<std::mutex> lock(this->mMutex);
+            this->mExit = true;
+            pending_list.swap(this->mPendingList);
+            for (auto& job : this->mRunningList) {
+                job->Cancel();
+            }
+        }
+        this->mWakeCondition.notify_all();
+        for (auto& thread : this->mThreadList) {
+            thread.join();
+        }
+        //待っている側が止まらないように、始まらなかったものも終わった扱いにする
+        for (auto& job : pending_list) {
+            job->Cancel();
+            job->Execute();
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    void AsyncLoader::Submit(const std::shared_ptr<AsyncLoadJob>& job) {
+        {
+            std::lock_guard<std::mutex> lock(this->mMutex);
+            this->mPendingList.push_back(job);
+        }
+        this->mWakeCondition.notify_one();
+    }
+    //------------------------------------------------------------------------------------------
+    //優先度が一番高いものを取り出す。同じ優先度なら先に来た方。mMutexを取ってから呼ぶ
+    std::shared_ptr<AsyncLoadJob> AsyncLoader::PopJob() {
+        if (this->mPendingList.empty()) {
+            return nullptr;
+        }
+        //優先度は後から変わるので、取り出す時に毎回探す(待ちの数は多くない)
+        size_t best = 0;
+        for (size_t i = 1; i < this->mPendingList.size(); i++) {
+            if (this->mPendingList[i]->GetPriority() > this->mPendingList[best]->GetPriority()) {
+                best = i;
+            }
+        }
+        auto job = this->mPendingList[best];
+        this->mPendingList.erase(this->mPendingList.begin() + best);
+        return job;
+    }
+    //------------------------------------------------------------------------------------------
+    void AsyncLoader::WorkerMain() {
+        for (;;) {
+            std::shared_ptr<AsyncLoadJob> job;
+            {
+                std::unique_lock<std::mutex> lock(this->mMutex);
+                this->mWakeCondition.wait(lock, [this]() { return this->mExit || !this->mPendingList.empty(); });
+                if (this->mExit) {
+                    return;
+                }
+                job = this->PopJob();
+                this->mRunningList.push_back(job);
+            }
+
+            job->Execute();
+
+            std::lock_guard<std::mutex> lock(this->mMutex);
+            this->mRunningList.erase(std::find(this->mRunningList.begin(), this->mRunningList.end(), job));
+        }
+    }
+    //------------------------------------------------------------------------------------------
+} // fbx
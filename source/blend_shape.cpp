@@ -0,0 +1,326 @@
+﻿#include "../include/blend_shape.h"
+#include "../include/skinning.h"
+
+#include <cstddef>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define FBX_BLEND_SHAPE_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+//MSVCは関数ごとの指定なしで全ての命令を使える
+#define FBX_TARGET_SSE41
+#define FBX_TARGET_AVX2
+#else
+#define FBX_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define FBX_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+namespace fbx {
+
+    namespace {
+        const unsigned int kInvalidIndex = 0xffffffff;
+
+        //差分は頂点の先頭6要素(位置と法線)にそのまま足せる並びにしておく
+        static_assert(sizeof(ModelBlendShapeDelta) == sizeof(float) * 6, "ModelBlendShapeDelta must be 6 floats");
+        static_assert(offsetof(ModelVertex, normal) == sizeof(float) * 3, "ModelVertex must start with position and normal");
+
+        //重みが0でないターゲット
+        struct ActiveTarget {
+            const ModelBlendShapeTarget* target;
+            float weight;
+        };
+        typedef void(*ApplyFunc)(ModelVertex*, const ActiveTarget*, size_t);
+
+        //------------------------------------------------------------------------------------------
+        void ApplyTargetsScalar(ModelVertex* out_vertex_list, const ActiveTarget* target_list, size_t target_count) {
+            for (size_t t = 0; t < target_count; t++) {
+                const auto& target = *target_list[t].target;
+                float weight = target_list[t].weight;
+                for (size_t i = 0; i < target.deltaList.size(); i++) {
+                    auto& vertex = out_vertex_list[target.vertexIndexList[i]];
+                    vertex.position += target.deltaList[i].position * weight;
+                    vertex.normal += target.deltaList[i].normal * weight;
+                }
+            }
+        }
+
+#ifdef FBX_BLEND_SHAPE_X86
+        //------------------------------------------------------------------------------------------
+        //位置と法線のxを4要素、法線のyzを2要素でまとめて足す
+        FBX_TARGET_SSE41 void ApplyTargetsSse41(ModelVertex* out_vertex_list, const ActiveTarget* target_list, size_t target_count) {
+            for (size_t t = 0; t < target_count; t++) {
+                const auto& target = *target_list[t].target;
+                const unsigned int* index_list = target.vertexIndexList.data();
+                const float* delta_list = (const float*)target.deltaList.data();
+                size_t delta_count = target.deltaList.size();
+                __m128 weight = _mm_set1_ps(target_list[t].weight);
+                for (size_t i = 0; i < delta_count; i++) {
+                    float* p = (float*)&out_vertex_list[index_list[i]];
+                    const float* d = delta_list + i * 6;
+                    _mm_storeu_ps(p, _mm_add_ps(_mm_loadu_ps(p), _mm_mul_ps(_mm_loadu_ps(d), weight)));
+                    __m128 tail = _mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)(p + 4)));
+                    __m128 delta_tail = _mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)(d + 4)));
+                    _mm_storel_epi64((__m128i*)(p + 4), _mm_castps_si128(_mm_add_ps(tail, _mm_mul_ps(delta_tail, weight))));
+                }
+            }
+        }
+        //------------------------------------------------------------------------------------------
+        //頂点の先頭8要素を読んで6要素だけ書き換える(残りの2要素はuv)
+        FBX_TARGET_AVX2 void ApplyTargetsAvx2(ModelVertex* out_vertex_list, const ActiveTarget* target_list, size_t target_count) {
+            const __m256i last_mask = _mm256_setr_epi32(-1, -1, -1, -1, -1, -1, 0, 0);
+            for (size_t t = 0; t < target_count; t++) {
+                const auto& target = *target_list[t].target;
+                const unsigned int* index_list = target.vertexIndexList.data();
+                const float* delta_list = (const float*)target.deltaList.data();
+                size_t delta_count = target.deltaList.size();
+                if (delta_count == 0) {
+                    continue;
+                }
+                __m256 weight = _mm256_set1_ps(target_list[t].weight);
+                //差分を8要素読むと次の差分の2要素も入るが、blendで捨てる。最後の1つだけは配列の外なのでマスクして読む
+                for (size_t i = 0; i + 1 < delta_count; i++) {
+                    float* p = (float*)&out_vertex_list[index_list[i]];
+                    __m256 vertex = _mm256_loadu_ps(p);
+                    __m256 result = _mm256_fmadd_ps(_mm256_loadu_ps(delta_list + i * 6), weight, vertex);
+                    _mm256_storeu_ps(p, _mm256_blend_ps(vertex, result, 0x3F));
+                }
+                float* p = (float*)&out_vertex_list[index_list[delta_count - 1]];
+                __m256 vertex = _mm256_loadu_ps(p);
+                __m256 result = _mm256_fmadd_ps(_mm256_maskload_ps(delta_list + (delta_count - 1) * 6, last_mask), weight, vertex);
+                _mm256_storeu_ps(p, _mm256_blend_ps(vertex, result, 0x3F));
+            }
+        }
+#endif
+        //------------------------------------------------------------------------------------------
+        ApplyFunc GetApplyFunc() {
+            switch (GetSkinningKernel()) {
+#ifdef FBX_BLEND_SHAPE_X86
+            case kSkinningAvx2:
+                return ApplyTargetsAvx2;
+            case kSkinningSse41:
+                return ApplyTargetsSse41;
+#endif
+            default:
+                return ApplyTargetsScalar;
+            }
+        }
+    }
+
+    //-- BlendShapeCurve --//
+    float BlendShapeCurve::Evaluate(float frame) const {
+        if (keyFrameList.empty()) {
+            return 0.0f;
+        }
+        if (frame <= keyFrameList.front()) {
+            return keyValueList.front();
+        }
+        if (frame >= keyFrameList.back()) {
+            return keyValueList.back();
+        }
+        size_t next = std::upper_bound(keyFrameList.begin(), keyFrameList.end(), frame) - keyFrameList.begin();
+        size_t prev = next - 1;
+        if (prev < keyConstantList.size() && keyConstantList[prev]) {
+            return keyValueList[prev];
+        }
+        float t = (frame - keyFrameList[prev]) / (keyFrameList[next] - keyFrameList[prev]);
+        return keyValueList[prev] + (keyValueList[next] - keyValueList[prev]) * t;
+    }
+
+    //-- BlendShapeVertexMap --//
+    BlendShapeVertexMap::BlendShapeVertexMap(size_t control_point_count) {
+        mOffsetList.assign(control_point_count + 1, 0);
+    }
+    //------------------------------------------------------------------------------------------
+    void BlendShapeVertexMap::Add(int control_point, unsigned int vertex) {
+        if (control_point >= 0 && (size_t)control_point < this->GetControlPointCount()) {
+            this->mPairList.push_back({ control_point, vertex });
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    void BlendShapeVertexMap::Build() {
+        //コントロールポイントの順に数え分けてから、同じ頂点を何度も使う角の分を除く
+        size_t control_point_count = this->GetControlPointCount();
+        std::fill(this->mOffsetList.begin(), this->mOffsetList.end(), 0);
+        for (const auto& pair : this->mPairList) {
+            this->mOffsetList[pair.first + 1]++;
+        }
+        for (size_t i = 0; i < control_point_count; i++) {
+            this->mOffsetList[i + 1] += this->mOffsetList[i];
+        }
+        this->mVertexList.resize(this->mPairList.size());
+        std::vector<unsigned int> cursor(this->mOffsetList.begin(), this->mOffsetList.end() - 1);
+        for (const auto& pair : this->mPairList) {
+            this->mVertexList[cursor[pair.first]++] = pair.second;
+        }
+        unsigned int out_count = 0;
+        for (size_t i = 0; i < control_point_count; i++) {
+            auto begin = this->mVertexList.begin() + this->mOffsetList[i];
+            auto end = this->mVertexList.begin() + this->mOffsetList[i + 1];
+            std::sort(begin, end);
+            end = std::unique(begin, end);
+            this->mOffsetList[i] = out_count;
+            for (auto it = begin; it != end; ++it) {
+                this->mVertexList[out_count++] = *it;
+            }
+        }
+        this->mOffsetList[control_point_count] = out_count;
+        this->mVertexList.resize(out_count);
+        std::vector<std::pair<int, unsigned int>>().swap(this->mPairList);
+    }
+
+    //------------------------------------------------------------------------------------------
+    void BuildBlendShapeTarget(ModelBlendShapeTarget* out_target, const BlendShapeVertexMap& vertex_map, const int* control_point_list,
+        const glm::vec3* position_delta_list, const glm::vec3* normal_delta_list, size_t count) {
+        std::vector<std::pair<unsigned int, ModelBlendShapeDelta>> delta_list;
+        for (size_t i = 0; i < count; i++) {
+            int control_point = control_point_list[i];
+            if (control_point < 0 || (size_t)control_point >= vertex_map.GetControlPointCount()) {
+                continue;
+            }
+            ModelBlendShapeDelta delta;
+            delta.position = position_delta_list[i];
+            delta.normal = normal_delta_list != nullptr ? normal_delta_list[i] : glm::vec3(0.0f);
+            if (delta.position == glm::vec3(0.0f) && delta.normal == glm::vec3(0.0f)) {
+                continue;
+            }
+            for (const unsigned int* it = vertex_map.GetVertexBegin(control_point); it != vertex_map.GetVertexEnd(control_point); ++it) {
+                delta_list.push_back({ *it, delta });
+            }
+        }
+        //同じ頂点は先に出てきたものを残す
+        std::stable_sort(delta_list.begin(), delta_list.end(), [](const std::pair<unsigned int, ModelBlendShapeDelta>& a, const std::pair<unsigned int, ModelBlendShapeDelta>& b) {
+            return a.first < b.first;
+        });
+        out_target->vertexIndexList.clear();
+        out_target->deltaList.clear();
+        out_target->vertexIndexList.reserve(delta_list.size());
+        out_target->deltaList.reserve(delta_list.size());
+        for (const auto& delta : delta_list) {
+            if (!out_target->vertexIndexList.empty() && out_target->vertexIndexList.back() == delta.first) {
+                continue;
+            }
+            out_target->vertexIndexList.push_back(delta.first);
+            out_target->deltaList.push_back(delta.second);
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    void RemapBlendShapeVertices(ModelMesh* mesh, const std::vector<unsigned int>& remap_list) {
+        std::vector<std::pair<unsigned int, ModelBlendShapeDelta>> delta_list;
+        for (auto& channel : mesh->blendShapeList) {
+            for (auto& target : channel.targetList) {
+                delta_list.clear();
+                for (size_t i = 0; i < target.vertexIndexList.size(); i++) {
+                    unsigned int vertex = target.vertexIndexList[i];
+                    unsigned int remap = vertex < remap_list.size() ? remap_list[vertex] : kInvalidIndex;
+                    if (remap != kInvalidIndex) {
+                        delta_list.push_back({ remap, target.deltaList[i] });
+                    }
+                }
+                std::sort(delta_list.begin(), delta_list.end(), [](const std::pair<unsigned int, ModelBlendShapeDelta>& a, const std::pair<unsigned int, ModelBlendShapeDelta>& b) {
+                    return a.first < b.first;
+                });
+                target.vertexIndexList.resize(delta_list.size());
+                target.deltaList.resize(delta_list.size());
+                for (size_t i = 0; i < delta_list.size(); i++) {
+                    target.vertexIndexList[i] = delta_list[i].first;
+                    target.deltaList[i] = delta_list[i].second;
+                }
+            }
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    size_t GetBlendShapeTargetCount(const ModelMesh& mesh) {
+        size_t count = 0;
+        for (const auto& channel : mesh.blendShapeList) {
+            count += channel.targetList.size();
+        }
+        return count;
+    }
+    //------------------------------------------------------------------------------------------
+    void GetBlendShapeTargetWeights(float* out_target_weight_list, const ModelMesh& mesh, const float* channel_weight_list) {
+        float* out = out_target_weight_list;
+        for (size_t c = 0; c < mesh.blendShapeList.size(); c++) {
+            const auto& target_list = mesh.blendShapeList[c].targetList;
+            size_t target_count = target_list.size();
+            float weight = channel_weight_list[c];
+            std::fill(out, out + target_count, 0.0f);
+            if (target_count == 0) {
+                continue;
+            }
+            if (target_count == 1 || weight <= target_list[0].fullWeight) {
+                out[0] = target_list[0].fullWeight != 0.0f ? weight / target_list[0].fullWeight : 0.0f;
+            }
+            else {
+                //weightを挟む2つの形の間を補間する。最後の形を超えたら最後の2つを延ばす
+                size_t next = 1;
+                while (next + 1 < target_count && weight > target_list[next].fullWeight) {
+                    next++;
+                }
+                float span = target_list[next].fullWeight - target_list[next - 1].fullWeight;
+                float t = span > 0.0f ? (weight - target_list[next - 1].fullWeight) / span : 1.0f;
+                out[next - 1] = 1.0f - t;
+                out[next] = t;
+            }
+            out += target_count;
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    void EvaluateBlendShapeWeights(float* out_weight_list, float frame, const ModelMesh& mesh, const std::vector<BlendShapeCurve>& curve_list) {
+        for (size_t c = 0; c < mesh.blendShapeList.size(); c++) {
+            out_weight_list[c] = mesh.blendShapeList[c].defaultWeight;
+        }
+        for (const auto& curve : curve_list) {
+            if (curve.meshName != mesh.nodeName) {
+                continue;
+            }
+            for (size_t c = 0; c < mesh.blendShapeList.size(); c++) {
+                if (mesh.blendShapeList[c].name == curve.channelName) {
+                    out_weight_list[c] = curve.Evaluate(frame);
+                    break;
+                }
+            }
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    void ApplyBlendShapes(ModelVertex* out_vertex_list, const ModelMesh& mesh, const float* channel_weight_list) {
+        std::vector<float> target_weight_list(GetBlendShapeTargetCount(mesh));
+        GetBlendShapeTargetWeights(target_weight_list.data(), mesh, channel_weight_list);
+        ApplyBlendShapeTargets(out_vertex_list, mesh, target_weight_list.data());
+    }
+    //------------------------------------------------------------------------------------------
+    void ApplyBlendShapeTargets(ModelVertex* out_vertex_list, const ModelMesh& mesh, const float* target_weight_list) {
+        auto vertex_list = mesh.GetVertexSpan();
+        std::copy(vertex_list.begin(), vertex_list.end(), out_vertex_list);
+        //動くターゲットだけを集めて、1回の呼び出しで全部足す
+        std::vector<ActiveTarget> active_list;
+        const float* weight = target_weight_list;
+        for (const auto& channel : mesh.blendShapeList) {
+            for (const auto& target : channel.targetList) {
+                if (*weight != 0.0f && !target.deltaList.empty()) {
+                    active_list.push_back({ &target, *weight });
+                }
+                weight++;
+            }
+        }
+        if (!active_list.empty()) {
+            GetApplyFunc()(out_vertex_list, active_list.data(), active_list.size());
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    size_t GetBlendShapeMemorySize(const ModelMesh& mesh) {
+        size_t size = 0;
+        for (const auto& channel : mesh.blendShapeList) {
+            for (const auto& target : channel.targetList) {
+                size += target.vertexIndexList.size() * sizeof(unsigned int) + target.deltaList.size() * sizeof(ModelBlendShapeDelta);
+            }
+        }
+        return size;
+    }
+    //------------------------------------------------------------------------------------------
+    size_t GetBlendShapeDenseMemorySize(const ModelMesh& mesh) {
+        return GetBlendShapeTargetCount(mesh) * mesh.GetVertexSpan().size() * sizeof(ModelBlendShapeDelta);
+    }
+    //------------------------------------------------------------------------------------------
+} // fbx
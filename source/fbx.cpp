@@ -1,220 +1,352 @@
 ﻿#include "../include/fbx.h"
+#include "../include/fbx_binary.h"
 
 #include <memory>
+#include <mutex>
 #include <iostream>
 
 namespace fbx {
 
     //-- FbxLoader Class --//
     FbxLoader::FbxLoader() {
-        mMaterialNum = 0;
+        mManagerPtr = nullptr;
+        mScenePtr = nullptr;
+        mDetached = false;
     }
     FbxLoader::~FbxLoader()
     {
-        this->mManagerPtr->Destroy();
+        if (this->mManagerPtr != nullptr) {
+            this->mManagerPtr->Destroy();
+        }
         this->Finalize();
     }
-
-    bool FbxLoader::Initialize(const char* filepath, const char* animetion_path) {
+    //------------------------------------------------------------------------------------------
+    void FbxLoader::CreateManager() {
         this->mManagerPtr = FbxManager::Create();
         auto* io_setting = FbxIOSettings::Create(this->mManagerPtr, IOSROOT);
         this->mManagerPtr->SetIOSettings(io_setting);
-        auto* importer = fbxsdk::FbxImporter::Create(this->mManagerPtr, "");
-        if (!importer->Initialize(filepath, -1, this->mManagerPtr->GetIOSettings())) {
-            auto& status = importer->GetStatus();
-            std::string err = status.GetErrorString();
-            printf("FBX initialize error! [%s][file:%s][anim:%s]\n", err.c_str(), filepath, animetion_path);
-            return false;
+        this->mDetached = false;
+    }
+    //------------------------------------------------------------------------------------------
+    //マネージャーを消すと、作ったシーンもすべて消える
+    void FbxLoader::Detach() {
+        if (this->mManagerPtr == nullptr) {
+            return;
+        }
+        FBX_PROFILE_SCOPE(&this->mProfiler, "detach");
+        //同じファイルのスタックは同じシーンを指して並んでいるので、前に並ぶ数がスタック番号になる
+        //前の要素を見るので後ろから解放する
+        for (size_t i = this->mAnimationArray.size(); i-- > 0;) {
+            auto& animation = this->mAnimationArray[i];
+            if (animation.clip.IsEmpty() && animation.fbxSceneAnimation != nullptr) {
+                int stack_index = 0;
+                for (size_t j = i; j > 0 && this->mAnimationArray[j - 1].fbxSceneAnimation == animation.fbxSceneAnimation; j--) {
+                    stack_index++;
+                }
+                this->BakeAnimation(&animation, stack_index);
+            }
+            animation.fbxSceneAnimation = nullptr;
+            std::map<std::string, int>().swap(animation.nodeIdDictionaryAnimation);
+        }
+        std::map<std::string, int>().swap(this->mNodeIdDictionary);
+        this->mScenePtr = nullptr;
+        this->mManagerPtr->Destroy();
+        this->mManagerPtr = nullptr;
+        this->mDetached = true;
+    }
+    //------------------------------------------------------------------------------------------
+
+    bool FbxLoader::Initialize(const char* filepath, const char* animetion_path, int thread_count) {
+        FBX_PROFILE_SCOPE(&this->mProfiler, "Initialize");
+        if (this->mManagerPtr == nullptr) {
+            this->CreateManager();
+        }
+
+        //キャッシュが有効ならインポートからの処理を飛ばす。アニメーションはキャッシュしない
+        size_t mesh_offset = this->mMeshList.size();
+        size_t material_offset = this->mMaterialList.size();
+        size_t instance_offset = this->mInstanceList.size();
+        std::string cache_path;
+        AssetCacheKey cache_key;
+        bool cache_hit = false;
+        if (this->mCacheOption.enable) {
+            binary::MappedFile source_file;
+            if (source_file.Open(filepath)) {
+                cache_hit = this->ReadCache(filepath, source_file.GetData(), source_file.GetSize(), kAssetCacheFbxSdk,
+                    mesh_offset, material_offset, instance_offset, &cache_path, &cache_key);
+            }
+        }
+        if (cache_hit) {
+            this->LoadAnimation(animetion_path);
+            if (this->mDetachOption.enable) {
+                this->Detach();
+            }
+            return true;
+        }
+
+        {
+            FBX_PROFILE_SCOPE(&this->mProfiler, "import");
+            auto* importer = fbxsdk::FbxImporter::Create(this->mManagerPtr, "");
+            if (!importer->Initialize(filepath, -1, this->mManagerPtr->GetIOSettings())) {
+                auto& status = importer->GetStatus();
+                std::string err = status.GetErrorString();
+                printf("FBX initialize error! [%s][file:%s][anim:%s]\n", err.c_str(), filepath, animetion_path);
+                return false;
+            }
+            this->mScenePtr = FbxScene::Create(this->mManagerPtr, "myScene");
+            importer->Import(this->mScenePtr);
+            importer->Destroy();
         }
-        this->mScenePtr = FbxScene::Create(this->mManagerPtr, "myScene");
-        importer->Import(this->mScenePtr);
-        importer->Destroy();
 
         //ポリゴンの三角形化を行う
-        FbxGeometryConverter geometry_converter(this->mManagerPtr);
-        geometry_converter.Triangulate(this->mScenePtr, true);
+        {
+            FBX_PROFILE_SCOPE(&this->mProfiler, "triangulate");
+            FbxGeometryConverter geometry_converter(this->mManagerPtr);
+            geometry_converter.Triangulate(this->mScenePtr, true);
+        }
 
         //辞書に登録し、ノード名からノードのIDを取得できるようにする
-        auto node_count = this->mScenePtr->GetNodeCount();
-        printf("NodeCount: %d\n", node_count);
-        for (int i = 0; i < node_count; i++) {
-            auto fbxNode = this->mScenePtr->GetNode(i);
-            this->mNodeIdDictionary.insert({ fbxNode->GetName(),i });
+        {
+            FBX_PROFILE_SCOPE(&this->mProfiler, "node index");
+            auto node_count = this->mScenePtr->GetNodeCount();
+            FBX_LOG("NodeCount: %d\n", node_count);
+            for (int i = 0; i < node_count; i++) {
+                auto fbxNode = this->mScenePtr->GetNode(i);
+                this->mNodeIdDictionary.insert({ fbxNode->GetName(),i });
+            }
         }
 
         //マテリアルの解析
-        auto material_count = this->mScenePtr->GetMaterialCount();
-        this->mMaterialList.reserve(material_count);
-        printf("materialCount: %d\n", material_count);
-        for (int i = 0; i < material_count; ++i)
         {
-            auto fbx_material = this->mScenePtr->GetMaterial(i);
-            ParseMaterial(fbx_material);
+            FBX_PROFILE_SCOPE(&this->mProfiler, "material");
+            auto material_count = this->mScenePtr->GetMaterialCount();
+            this->mMaterialList.reserve(material_count);
+            FBX_LOG("materialCount: %d\n", material_count);
+            for (int i = 0; i < material_count; ++i)
+            {
+                auto fbx_material = this->mScenePtr->GetMaterial(i);
+                ParseMaterial(fbx_material);
+            }
         }
 
         FbxNode *root_node = mScenePtr->GetRootNode();
 
+        //メッシュを集めるところまでは1スレッドで行い、mMeshListとマテリアルIDの順番を固定する
+        std::vector<FbxMesh*> fbx_mesh_list;
+        std::unordered_map<FbxMesh*, int> fbx_mesh_index;
         if (root_node) {
-            ParseNode(root_node);
+            FBX_PROFILE_SCOPE(&this->mProfiler, "node walk");
+            ParseNode(root_node, &fbx_mesh_list, &fbx_mesh_index);
         }
+        FBX_PROFILE_COUNT(&this->mProfiler, kCounterMesh, fbx_mesh_list.size());
+        FBX_PROFILE_COUNT(&this->mProfiler, kCounterInstance, this->mInstanceList.size() - instance_offset);
+        FBX_PROFILE_COUNT(&this->mProfiler, kCounterMaterial, this->mMaterialList.size() - material_offset);
 
-        this->LoadAnimation(animetion_path);
+        //マテリアルはここで出揃う
+        for (size_t i = material_offset; i < this->mMaterialList.size(); i++) {
+            this->NotifyMaterial(i);
+        }
 
-        return true;
-    }
-    //------------------------------------------------------------------------------------------
-    //メッシュに置けるインデックスのリストを返す
-    void GetIndexList(std::vector<int>* index_list, const FbxMesh& mesh) {
-        int polygon_count = mesh.GetPolygonCount();
-        FBXSDK_printf("-----------------------------------------------\n");
-        FBXSDK_printf("loading index start\n");
-        FBXSDK_printf("polygon count:[%d]\n", polygon_count);
+        //頂点の取り出しと重複頂点の除去はメッシュごとに独立しているので並列に行う
+        //できたメッシュは終わった順に通知する。リスナーが同時に呼ばれないようにロックする
+        //中身の同じメッシュをまとめる時は、番号が詰まるので全部できてからまとめて通知する
+        //接線・LOD・並べ替えなどはまとめた後に残ったメッシュだけに行う
+        bool match_content = this->mInstanceOption.enable && this->mInstanceOption.matchContent;
+        std::vector<uint64_t> content_hash_list(match_content ? fbx_mesh_list.size() : 0);
+        //中止した時に、通知まで済んだメッシュだけを残すための印
+        std::vector<uint8_t> delivered_list(fbx_mesh_list.size(), 0);
+        ThreadPool thread_pool(thread_count);
+        std::mutex notify_mutex;
+        FBX_LOG("ParseMesh: %d meshes, %d threads\n", (int)fbx_mesh_list.size(), thread_pool.GetThreadCount());
+        thread_pool.ParallelFor(fbx_mesh_list.size(), [&](size_t i) {
+            if (this->mLoadListener != nullptr && this->mLoadListener->IsCanceled()) {
+                return;
+            }
+            this->ParseMesh(fbx_mesh_list[i], &this->mMeshList[mesh_offset + i]);
+            if (match_content) {
+                content_hash_list[i] = HashMeshGeometry(this->mMeshList[mesh_offset + i]);
+                return;
+            }
+            this->FinishMesh(&this->mMeshList[mesh_offset + i]);
+            std::lock_guard<std::mutex> lock(notify_mutex);
+            delivered_list[i] = 1;
+            this->NotifyMesh(mesh_offset + i);
+            //アリーナは1つなので通知と同じロックの中で詰め直す
+            this->PackGeometry(mesh_offset + i, 1);
+        });
+        if (this->mLoadListener != nullptr && this->mLoadListener->IsCanceled()) {
+            printf("FBX initialize canceled [file:%s]\n", filepath);
+            this->DiscardUndeliveredMeshes(mesh_offset, instance_offset, delivered_list);
+            return false;
+        }
+        if (match_content) {
+            this->MergeSameMeshes(mesh_offset, instance_offset, content_hash_list);
+            thread_pool.ParallelFor(this->mMeshList.size() - mesh_offset, [&](size_t i) {
+                if (this->mLoadListener != nullptr && this->mLoadListener->IsCanceled()) {
+                    return;
+                }
+                this->FinishMesh(&this->mMeshList[mesh_offset + i]);
+            });
+            if (this->mLoadListener != nullptr && this->mLoadListener->IsCanceled()) {
+                printf("FBX initialize canceled [file:%s]\n", filepath);
+                //まだ1つも通知していないので全部捨てる
+                this->DiscardUndeliveredMeshes(mesh_offset, instance_offset, std::vector<uint8_t>(this->mMeshList.size() - mesh_offset, 0));
+                return false;
+            }
+            for (size_t i = mesh_offset; i < this->mMeshList.size(); i++) {
+                this->NotifyMesh(i);
+            }
+            this->PackGeometry(mesh_offset, this->mMeshList.size() - mesh_offset);
+        }
 
-        index_list->reserve(polygon_count * 3);
-        for (int i = 0; i < polygon_count; i++) {
-            index_list->push_back(mesh.GetPolygonVertex(i, 0));
-            index_list->push_back(mesh.GetPolygonVertex(i, 1));
-            index_list->push_back(mesh.GetPolygonVertex(i, 2));
+        this->WriteCache(cache_path, cache_key, mesh_offset, material_offset, instance_offset);
+        {
+            FBX_PROFILE_SCOPE(&this->mProfiler, "animation");
+            this->LoadAnimation(animetion_path);
         }
-        FBXSDK_printf("-----------------------------------------------\n");
+        if (this->mDetachOption.enable) {
+            this->Detach();
+        }
+
+        return true;
     }
     //------------------------------------------------------------------------------------------
-    //頂点の位置座標のリストを返す
-    void GetPositionList(std::vector<glm::vec3>* position_list, const FbxMesh& mesh, const std::vector<int>& indexList) {
-        FBXSDK_printf("-----------------------------------------------\n");
-        FBXSDK_printf("loading position start\n");
-        position_list->reserve(indexList.size());
+    //法線・UVのレイヤー要素の読み方。マッピングモードとリファレンスモードはメッシュごとに1回だけ調べる
+    template<class T>
+    struct FbxLayerReader {
+        const FbxLayerElementArrayTemplate<T>* directArray = nullptr;
+        //eDirectならnullptr
+        const FbxLayerElementArrayTemplate<int>* indexArray = nullptr;
+        bool byControlPoint = false;
 
-        for (int index : indexList) {
-            auto control_point = mesh.GetControlPointAt(index);
-            position_list->push_back(glm::vec3(control_point[0], control_point[1], control_point[2]));
+        bool IsValid() const {
+            return directArray != nullptr;
         }
-        FBXSDK_printf("-----------------------------------------------\n");
-    }
-    //------------------------------------------------------------------------------------------
-    //これはメッシュの法線のリストを返す
-    void GetNormalList(std::vector<glm::vec3>* normal_list, const FbxMesh& mesh, const std::vector<int> &index_list) {
-        FBXSDK_printf("-----------------------------------------------\n");
-        FBXSDK_printf("loading normal start\n");
-        int element_count = mesh.GetElementNormalCount();
-        auto element = mesh.GetElementNormal();
-        auto mapping_mode = element->GetMappingMode();
-        auto referenceMode = element->GetReferenceMode();
-        const auto& indexArray = element->GetIndexArray();
-        const auto& directArray = element->GetDirectArray();
-
-        normal_list->reserve(index_list.size());
-
-        //マッピングモードでfbxファイル内の法線のデータが違う
-        if (mapping_mode == FbxGeometryElement::eByControlPoint) {
-            for (auto index : index_list) {
-                auto normalIndex = (referenceMode == FbxGeometryElement::eDirect) ?
-                    index : indexArray.GetAt(index);
-                //リファレンスモードがeDirectならば、法線はそのまま入っている。
-                //ソレ以外、大体eIndextoVertexかなんかだったらインデックス配列の番号を参照した
-                //法線のデータがあるので其の番号を順番に取り出す
-                auto normal = directArray.GetAt(normalIndex);
-                normal_list->push_back(glm::vec3(normal[0], normal[1], normal[2]));
-            }
-        }
-        else if (mapping_mode == FbxGeometryElement::eByPolygonVertex) {
-            auto indexByPolygonVertex = 0;
-            auto polygonCount = mesh.GetPolygonCount();
-            for (int i = 0; i < polygonCount; i++) {
-                auto polygonSize = mesh.GetPolygonSize(i); //これは三角化しているので全部3だと思う
-                for (int j = 0; j < polygonSize; j++) {
-                    auto normalIndex = (referenceMode == FbxGeometryElement::eDirect)
-                        ? indexByPolygonVertex
-                        : indexArray.GetAt(indexByPolygonVertex);
-                    auto normal = directArray.GetAt(normalIndex);
-                    normal_list->push_back(glm::vec3(normal[0], normal[1], normal[2]));
-                    ++indexByPolygonVertex;
-                }
+        //角の値を取り出す。polygon_vertexはポリゴン頂点の通し番号
+        T Get(int control_point, int polygon_vertex) const {
+            int element = byControlPoint ? control_point : polygon_vertex;
+            if (indexArray != nullptr) {
+                element = indexArray->GetAt(element);
             }
+            return directArray->GetAt(element);
         }
-        else {
+    };
+    //------------------------------------------------------------------------------------------
+    template<class T>
+    FbxLayerReader<T> MakeLayerReader(const FbxLayerElementTemplate<T>* element) {
+        FbxLayerReader<T> reader;
+        if (element == nullptr) {
+            return reader;
+        }
+        auto mapping_mode = element->GetMappingMode();
+        if (mapping_mode != FbxGeometryElement::eByControlPoint && mapping_mode != FbxGeometryElement::eByPolygonVertex) {
             printf("unknown mapping mode\n");
             assert(false);
+            return reader;
         }
-        FBXSDK_printf("-----------------------------------------------\n");
+        reader.byControlPoint = (mapping_mode == FbxGeometryElement::eByControlPoint);
+        reader.directArray = &element->GetDirectArray();
+        //リファレンスモードがeDirectならば値はそのまま入っている
+        //それ以外(大体eIndexToDirect)ならインデックス配列の番号を参照した値を取り出す
+        if (element->GetReferenceMode() != FbxGeometryElement::eDirect) {
+            reader.indexArray = &element->GetIndexArray();
+        }
+        return reader;
     }
     //------------------------------------------------------------------------------------------
-    //メッシュ毎のテクスチャ座標をリストにして返す
-    void GetUVList(std::vector<glm::vec2>* uv_list, const FbxMesh& mesh, const std::vector<int>& index_list, int uv_no) {
-        FBXSDK_printf("-----------------------------------------------\n");
-        FBXSDK_printf("loading uv start\n");
-        int element_cout = mesh.GetElementUVCount();
-        if (uv_no + 1 > element_cout) {
+    //スキンのボーン名とベースポーズの逆行列をリストにして返す
+    //EvaluateGlobalTransformはスレッドセーフではないので、並列化する前に呼ぶこと
+    void GetBoneList(std::vector<std::string>* bone_node_name_list, std::vector<glm::mat4>* inv_basepose_matrix_list, const FbxMesh& mesh) {
+        int skin_count = mesh.GetDeformerCount(FbxDeformer::eSkin);
+        if (skin_count == 0) {
             return;
         }
-        auto element = mesh.GetElementUV(uv_no);
-        auto mapping_mode = element->GetMappingMode();
-        auto reference_mode = element->GetReferenceMode();
-        const auto& index_array = element->GetIndexArray();
-        const auto& direct_array = element->GetDirectArray();
-
-        uv_list->reserve(index_list.size());
-        if (mapping_mode == FbxGeometryElement::eByControlPoint) {
-            //法線とだいたい同じ
-            for (auto index : index_list) {
-                auto uvIndex = (reference_mode == FbxGeometryElement::eDirect)
-                    ? index
-                    : index_array.GetAt(index);
-                auto uv = direct_array.GetAt(uvIndex);
-                uv_list->push_back(glm::vec2(uv[0], uv[1]));
-            }
-        }
-        else if (mapping_mode == FbxGeometryElement::eByPolygonVertex) {
-            int index_by_polygon_vetex = 0;
-            int polygon_count = mesh.GetPolygonCount();
-            for (int i = 0; i < polygon_count; i++) {
-                int polygon_size = mesh.GetPolygonSize(i);
-                for (int j = 0; j < polygon_size; j++) {
-                    int uv_index = (reference_mode == FbxGeometryElement::eDirect)
-                        ? index_by_polygon_vetex
-                        : index_array.GetAt(index_by_polygon_vetex);
-                    auto uv = direct_array.GetAt(uv_index);
-                    uv_list->push_back(glm::vec2(uv[0], uv[1]));
-                    ++index_by_polygon_vetex;
+        assert(skin_count <= 1);
+
+        auto skin = static_cast<FbxSkin*>(mesh.GetDeformer(0, FbxDeformer::eSkin));
+
+        int cluster_count = skin->GetClusterCount();
+        for (int i = 0; i < cluster_count; i++) {
+            auto cluster = skin->GetCluster(i);
+
+            bone_node_name_list->push_back(cluster->GetLink()->GetName());
+            FBX_LOG("cluster name:[%s]\n", cluster->GetLink()->GetName());
+
+            glm::mat4 inverse_base_pose_matrix; //ベースポーズの逆行列、どっかで使うため
+
+            auto basepose_matrix = cluster->GetLink()->EvaluateGlobalTransform().Inverse();
+            for (int k = 0; k < 16; k++) {
+                inverse_base_pose_matrix[k / 4][k % 4] = (float)(basepose_matrix[k / 4][k % 4]);
+            }
+            inv_basepose_matrix_list->push_back(inverse_base_pose_matrix);
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    //スキンのボーンとその祖先(シーンのルートは除く)を集めてスケルトンを作る。GetBoneListの後に呼ぶ
+    void GetSkeleton(ModelMesh* model_mesh, const FbxMesh& mesh) {
+        if (mesh.GetDeformerCount(FbxDeformer::eSkin) == 0) {
+            return;
+        }
+        auto skin = static_cast<FbxSkin*>(mesh.GetDeformer(0, FbxDeformer::eSkin));
+
+        std::map<FbxNode*, int> joint_id_dictionary;
+        std::vector<FbxNode*> joint_node_list;
+        for (int i = 0; i < skin->GetClusterCount(); i++) {
+            for (FbxNode* node = skin->GetCluster(i)->GetLink(); node != nullptr && node->GetParent() != nullptr; node = node->GetParent()) {
+                if (!joint_id_dictionary.insert({ node, (int)joint_node_list.size() }).second) {
+                    break;
                 }
+                joint_node_list.push_back(node);
             }
         }
-        else {
-            printf("unknown mapping mode\n");
-            assert(false);
+
+        std::vector<std::string> joint_name_list;
+        std::vector<int> parent_list;
+        std::vector<glm::mat4> rest_local_list;
+        for (FbxNode* node : joint_node_list) {
+            joint_name_list.push_back(node->GetName());
+            auto it = joint_id_dictionary.find(node->GetParent());
+            parent_list.push_back(it == joint_id_dictionary.end() ? -1 : it->second);
+
+            auto& local_matrix = node->EvaluateLocalTransform();
+            auto local_matrix_ptr = (double*)local_matrix;
+            glm::mat4 matrix;
+            for (int k = 0; k < 16; k++) {
+                matrix[k / 4][k % 4] = (float)local_matrix_ptr[k];
+            }
+            rest_local_list.push_back(matrix);
         }
-        FBXSDK_printf("-----------------------------------------------\n");
+        model_mesh->skeleton.Initialize(joint_name_list, parent_list, rest_local_list, model_mesh->boneNodeNameList, model_mesh->invBoneBaseposeMatrixList);
     }
     //------------------------------------------------------------------------------------------
-    //ウェイトをメッシュごとに手に入れて返す
-    void GetWeight(std::vector<ModelBoneWeight>* bone_weight_list, std::vector<std::string>* bone_node_name_list, std::vector<glm::mat4>* inv_basepose_matrix_list, const FbxMesh& mesh, const std::vector<int>& index_list) {
-        FBXSDK_printf("-----------------------------------------------\n");
-        FBXSDK_printf("loading bone weight start\n");
+    //コントロールポイントごとのウェイトを手に入れて返す。スキンが無ければ空
+    void GetWeight(ArenaVector<ModelBoneWeight>* bone_weight_list, const FbxMesh& mesh) {
+        FBX_LOG("-----------------------------------------------\n");
+        FBX_LOG("loading bone weight start\n");
         int skin_count = mesh.GetDeformerCount(FbxDeformer::eSkin);
-        FBXSDK_printf("skin count:[%d]\n", skin_count);
+        FBX_LOG("skin count:[%d]\n", skin_count);
         if (skin_count == 0) {
-            FBXSDK_printf("-----------------------------------------------\n");
+            FBX_LOG("-----------------------------------------------\n");
             return;
         }
         assert(skin_count <= 1);
 
         int control_points_count = mesh.GetControlPointsCount();
+        //作業用アリーナの中で後から伸ばさないように先に確保する
+        bone_weight_list->reserve(control_points_count);
         using TmpWeight = std::pair<int, float>;
         std::vector<std::vector<TmpWeight>> tmp_bone_weight_list(control_points_count);
-        FBXSDK_printf("mesh control point count:%d\n", control_points_count);
+        FBX_LOG("mesh control point count:%d\n", control_points_count);
 
         auto skin = static_cast<FbxSkin*>(mesh.GetDeformer(0, FbxDeformer::eSkin));
 
         int cluster_count = skin->GetClusterCount();
-        FBXSDK_printf("cluster count:[%d]\n", cluster_count);
+        FBX_LOG("cluster count:[%d]\n", cluster_count);
         for (int i = 0; i < cluster_count; i++) {
             auto cluster = skin->GetCluster(i);
 
             assert(cluster->GetLinkMode() == FbxCluster::eNormalize);
 
-            bone_node_name_list->push_back(cluster->GetLink()->GetName());
-            FBXSDK_printf("cluster name:[%s]\n", cluster->GetLink()->GetName());
-
             int index_count = cluster->GetControlPointIndicesCount();
             auto indices = cluster->GetControlPointIndices();
             auto weights = cluster->GetControlPointWeights();
@@ -223,18 +355,9 @@ namespace fbx {
                 int control_point_index = indices[k];
                 tmp_bone_weight_list[control_point_index].push_back({ i, weights[k] });
             }
-
-            glm::mat4 inverse_base_pose_matrix; //ベースポーズの逆行列、どっかで使うため
-
-            auto basepose_matrix = cluster->GetLink()->EvaluateGlobalTransform().Inverse();
-            for (int k = 0; k < 16; k++) {
-                inverse_base_pose_matrix[k / 4][k % 4] = (float)(basepose_matrix[k / 4][k % 4]);
-            }
-            inv_basepose_matrix_list->push_back(inverse_base_pose_matrix);
         }
 
-        std::vector<ModelBoneWeight> bone_weight_list_control_points;
-        FBXSDK_printf("bone weight count:[%d]\n", (int)tmp_bone_weight_list.size());
+        FBX_LOG("bone weight count:[%d]\n", (int)tmp_bone_weight_list.size());
         for (auto& tmp_bone_weight : tmp_bone_weight_list) {
             //ウェイトの大きさでソート
             std::sort(tmp_bone_weight.begin(), tmp_bone_weight.end(), [](const TmpWeight& weightA, const TmpWeight& weightB) { return weightA.second > weightB.second; });
@@ -258,21 +381,106 @@ namespace fbx {
                 weight.boneWeight[i] /= total;
             }
             /*
-            FBXSDK_printf("push weight %d ([0]index:%d,weight:%f)([1]index:%d,weight:%f)([2]index:%d,weight:%f)([3]index:%d,weight:%f)\n",
-                (int)bone_weight_list_control_points.size(),
+            FBX_LOG("push weight %d ([0]index:%d,weight:%f)([1]index:%d,weight:%f)([2]index:%d,weight:%f)([3]index:%d,weight:%f)\n",
+                (int)bone_weight_list->size(),
                 weight.boneIndex[0], weight.boneWeight[0],
                 weight.boneIndex[1], weight.boneWeight[1],
                 weight.boneIndex[2], weight.boneWeight[2],
                 weight.boneIndex[3], weight.boneWeight[3]
             );
             */
-            bone_weight_list_control_points.push_back(weight);
+            bone_weight_list->push_back(weight);
         }
-
-        for (int index : index_list) {
-            bone_weight_list->push_back(bone_weight_list_control_points[index]);
+        FBX_LOG("-----------------------------------------------\n");
+    }
+    //------------------------------------------------------------------------------------------
+    //ブレンドシェイプを溶接後の頂点ごとの差分にして返す。FbxShapeのコントロールポイントは形そのものなので元の位置を引く
+    //法線はメッシュとシェイプの両方がコントロールポイントごとの時だけ読む
+    void GetBlendShapeList(std::vector<ModelBlendShapeChannel>* out_channel_list, const FbxMesh& mesh, const BlendShapeVertexMap& vertex_map) {
+        int control_points_count = mesh.GetControlPointsCount();
+        const FbxVector4* control_point_list = mesh.GetControlPoints();
+        auto normal_reader = MakeLayerReader(mesh.GetElementNormalCount() > 0 ? mesh.GetElementNormal(0) : nullptr);
+        std::vector<int> index_list;
+        std::vector<glm::vec3> position_delta_list;
+        std::vector<glm::vec3> normal_delta_list;
+        int blend_shape_count = mesh.GetDeformerCount(FbxDeformer::eBlendShape);
+        for (int b = 0; b < blend_shape_count; b++) {
+            auto blend_shape = static_cast<FbxBlendShape*>(mesh.GetDeformer(b, FbxDeformer::eBlendShape));
+            for (int c = 0; c < blend_shape->GetBlendShapeChannelCount(); c++) {
+                auto channel = blend_shape->GetBlendShapeChannel(c);
+                ModelBlendShapeChannel model_channel;
+                model_channel.name = channel->GetName();
+                model_channel.defaultWeight = (float)channel->DeformPercent.Get();
+                const double* full_weight_list = channel->GetTargetShapeFullWeights();
+                for (int t = 0; t < channel->GetTargetShapeCount(); t++) {
+                    FbxShape* shape = channel->GetTargetShape(t);
+                    int count = std::min(shape->GetControlPointsCount(), control_points_count);
+                    const FbxVector4* shape_point_list = shape->GetControlPoints();
+                    auto shape_normal_reader = MakeLayerReader(shape->GetElementNormalCount() > 0 ? shape->GetElementNormal(0) : nullptr);
+                    bool use_normal = normal_reader.IsValid() && normal_reader.byControlPoint && shape_normal_reader.IsValid() && shape_normal_reader.byControlPoint;
+                    index_list.resize(count);
+                    position_delta_list.resize(count);
+                    normal_delta_list.resize(use_normal ? count : 0);
+                    for (int i = 0; i < count; i++) {
+                        index_list[i] = i;
+                        const auto& shape_point = shape_point_list[i];
+                        const auto& point = control_point_list[i];
+                        position_delta_list[i] = glm::vec3(shape_point[0] - point[0], shape_point[1] - point[1], shape_point[2] - point[2]);
+                        if (use_normal) {
+                            auto shape_normal = shape_normal_reader.Get(i, 0);
+                            auto normal = normal_reader.Get(i, 0);
+                            normal_delta_list[i] = glm::vec3(shape_normal[0] - normal[0], shape_normal[1] - normal[1], shape_normal[2] - normal[2]);
+                        }
+                    }
+                    ModelBlendShapeTarget target;
+                    target.name = shape->GetName();
+                    target.fullWeight = full_weight_list != nullptr ? (float)full_weight_list[t] : 100.0f;
+                    BuildBlendShapeTarget(&target, vertex_map, index_list.data(), position_delta_list.data(), use_normal ? normal_delta_list.data() : nullptr, count);
+                    model_channel.targetList.push_back(std::move(target));
+                }
+                std::stable_sort(model_channel.targetList.begin(), model_channel.targetList.end(), [](const ModelBlendShapeTarget& a, const ModelBlendShapeTarget& b) {
+                    return a.fullWeight < b.fullWeight;
+                });
+                FBX_LOG("blend shape channel:[%s] targets:[%d]\n", model_channel.name.c_str(), (int)model_channel.targetList.size());
+                out_channel_list->push_back(std::move(model_channel));
+            }
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    //スタックの最初のレイヤーにあるDeformPercentのカーブを読む
+    void GetBlendShapeCurveList(std::vector<BlendShapeCurve>* out_curve_list, FbxScene* scene, int stack_index) {
+        auto stack = scene->GetSrcObject<FbxAnimStack>(stack_index);
+        FbxAnimLayer* layer = stack != nullptr ? stack->GetMember<FbxAnimLayer>(0) : nullptr;
+        if (layer == nullptr) {
+            return;
+        }
+        double one_frame = (double)FbxTime::GetOneFrameValue(FbxTime::eFrames60);
+        for (int g = 0; g < scene->GetGeometryCount(); g++) {
+            FbxGeometry* geometry = scene->GetGeometry(g);
+            if (geometry->GetNode() == nullptr) {
+                continue;
+            }
+            for (int b = 0; b < geometry->GetDeformerCount(FbxDeformer::eBlendShape); b++) {
+                auto blend_shape = static_cast<FbxBlendShape*>(geometry->GetDeformer(b, FbxDeformer::eBlendShape));
+                for (int c = 0; c < blend_shape->GetBlendShapeChannelCount(); c++) {
+                    auto channel = blend_shape->GetBlendShapeChannel(c);
+                    FbxAnimCurve* curve = channel->DeformPercent.GetCurve(layer);
+                    if (curve == nullptr) {
+                        continue;
+                    }
+                    BlendShapeCurve blend_shape_curve;
+                    blend_shape_curve.meshName = geometry->GetNode()->GetName();
+                    blend_shape_curve.channelName = channel->GetName();
+                    int key_count = curve->KeyGetCount();
+                    for (int k = 0; k < key_count; k++) {
+                        blend_shape_curve.keyFrameList.push_back((float)(curve->KeyGetTime(k).Get() / one_frame));
+                        blend_shape_curve.keyValueList.push_back(curve->KeyGetValue(k));
+                        blend_shape_curve.keyConstantList.push_back(curve->KeyGetInterpolation(k) == FbxAnimCurveDef::eInterpolationConstant ? 1 : 0);
+                    }
+                    out_curve_list->push_back(std::move(blend_shape_curve));
+                }
+            }
         }
-        FBXSDK_printf("-----------------------------------------------\n");
     }
     //------------------------------------------------------------------------------------------
     //アニメーションを得る。
@@ -281,26 +489,41 @@ namespace fbx {
     //**nodeIdDictionaryAnimation ->アニメーションのノードを辞書型にリストに入れておく
     bool FbxLoader::LoadAnimation(const char* filepath)
     {
+        //メッシュだけ読む時はnullptrが渡される
+        if (filepath == nullptr) {
+            return false;
+        }
+        //切り離した後なら読み込む間だけマネージャーを作り直す
+        bool detached = this->mDetached;
+        if (this->mManagerPtr == nullptr) {
+            this->CreateManager();
+        }
         auto importer = FbxImporter::Create(this->mManagerPtr, "");
 
         if (!importer->Initialize(filepath, -1, this->mManagerPtr->GetIOSettings())) {
-            FBXSDK_printf("Animation Load Error!:%s\n", filepath);
+            printf("Animation Load Error!:%s\n", filepath);
+            if (detached) {
+                this->Detach();
+            }
             return false;
         }
         FbxAnimation fbx_animation;
 
-        FBXSDK_printf("-----------------------------------------------\n");
-        FBXSDK_printf("loading animation start:%s\n", filepath);
+        FBX_LOG("-----------------------------------------------\n");
+        FBX_LOG("loading animation start:%s\n", filepath);
         fbx_animation.fbxSceneAnimation = FbxScene::Create(this->mManagerPtr, "animationScene");
-        importer->Import(fbx_animation.fbxSceneAnimation);
+        {
+            FBX_PROFILE_SCOPE(&this->mProfiler, "animation import");
+            importer->Import(fbx_animation.fbxSceneAnimation);
+        }
 
         int animStackCount = importer->GetAnimStackCount();
-        FBXSDK_printf("[ImporterName: %s] [StackCount: %d]\n", importer->GetName(), animStackCount);
+        FBX_LOG("[ImporterName: %s] [StackCount: %d]\n", importer->GetName(), animStackCount);
         assert(animStackCount > 0);
         for (int i = 0; i < animStackCount; i++) {
             auto take_info = importer->GetTakeInfo(i);
 
-            FBXSDK_printf("[AnimationName: %s] [index: %d]\n", take_info->mName.Buffer(), i);
+            FBX_LOG("[AnimationName: %s] [index: %d]\n", take_info->mName.Buffer(), i);
             auto import_offset = take_info->mImportOffset;
             auto start_time = take_info->mLocalTimeSpan.GetStart();
             auto stop_time = take_info->mLocalTimeSpan.GetStop();
@@ -309,59 +532,148 @@ namespace fbx {
             fbx_animation.animationEndFrame = (import_offset.Get() + stop_time.Get()) / (float)FbxTime::GetOneFrameValue(FbxTime::eFrames60);
 
             // ノード名からノードIDを取得できるように辞書に登録
-            int node_count = fbx_animation.fbxSceneAnimation->GetNodeCount();
-            FBXSDK_printf("animationNodeCount: %d\n", node_count);
-            for (int i = 0; i < node_count; ++i)
             {
-                auto fbx_node = fbx_animation.fbxSceneAnimation->GetNode(i);
-                fbx_animation.nodeIdDictionaryAnimation.insert({ fbx_node->GetName(), i });
-                FBXSDK_printf("- add node [bone name:[%s], index:[%d]]\n", fbx_node->GetName(), i);
+                FBX_PROFILE_SCOPE(&this->mProfiler, "animation index");
+                int node_count = fbx_animation.fbxSceneAnimation->GetNodeCount();
+                FBX_LOG("animationNodeCount: %d\n", node_count);
+                FBX_PROFILE_COUNT(&this->mProfiler, kCounterAnimationNode, node_count);
+                for (int i = 0; i < node_count; ++i)
+                {
+                    auto fbx_node = fbx_animation.fbxSceneAnimation->GetNode(i);
+                    fbx_animation.nodeIdDictionaryAnimation.insert({ fbx_node->GetName(), i });
+                    FBX_LOG("- add node [bone name:[%s], index:[%d]]\n", fbx_node->GetName(), i);
+                }
+            }
+            fbx_animation.blendShapeCurveList.clear();
+            GetBlendShapeCurveList(&fbx_animation.blendShapeCurveList, fbx_animation.fbxSceneAnimation, i);
+            FBX_LOG("strtframe %f\n", fbx_animation.GetAnimationStartFrame());
+            FBX_LOG("endframe %f\n", fbx_animation.GetAnimationEndFrame());
+            //切り離すならどうせベイクするので、ここで済ませる
+            if (this->mBakeOption.enable || this->mDetachOption.enable) {
+                FBX_PROFILE_SCOPE(&this->mProfiler, "animation bake");
+                this->BakeAnimation(&fbx_animation, i);
+                FBX_LOG("baked %d nodes x %d keys\n", fbx_animation.clip.GetNodeCount(), fbx_animation.clip.GetKeyCount());
             }
-            FBXSDK_printf("strtframe %f\n", fbx_animation.GetAnimationStartFrame());
-            FBXSDK_printf("endframe %f\n", fbx_animation.GetAnimationEndFrame());
-            FBXSDK_printf("-----------------------------------------------\n");
+            FBX_LOG("-----------------------------------------------\n");
             this->mAnimationArray.push_back(fbx_animation);
+            if (this->mBoundsOption.animation) {
+                FBX_PROFILE_SCOPE(&this->mProfiler, "animation bounds");
+                this->BuildAnimationBoundsList((int)this->mAnimationArray.size() - 1);
+            }
         }
         importer->Destroy();
+
+        //全部のスタックをベイクしたらカーブはもう要らない
+        if (this->mBakeOption.enable && this->mBakeOption.releaseScene) {
+            fbx_animation.fbxSceneAnimation->Destroy();
+            for (int i = (int)this->mAnimationArray.size() - animStackCount; i < (int)this->mAnimationArray.size(); i++) {
+                this->mAnimationArray[i].fbxSceneAnimation = nullptr;
+            }
+        }
+        if (detached) {
+            this->Detach();
+        }
         return true;
     }
     //------------------------------------------------------------------------------------------
+    //スタックのノードごとのローカル行列を一定間隔で取り出してクリップにする
+    void FbxLoader::BakeAnimation(FbxAnimation* animation, int stack_index) {
+        auto scene = animation->fbxSceneAnimation;
+        if (auto stack = scene->GetSrcObject<FbxAnimStack>(stack_index)) {
+            scene->SetCurrentAnimationStack(stack);
+        }
+
+        //ルートから幅優先に並べて、親が子より前に来るようにする
+        std::vector<FbxNode*> node_list;
+        std::vector<int> parent_list;
+        std::vector<std::string> node_name_list;
+        node_list.push_back(scene->GetRootNode());
+        parent_list.push_back(-1);
+        for (size_t i = 0; i < node_list.size(); i++) {
+            FbxNode* node = node_list[i];
+            node_name_list.push_back(node->GetName());
+            for (int c = 0; c < node->GetChildCount(); c++) {
+                node_list.push_back(node->GetChild(c));
+                parent_list.push_back((int)i);
+            }
+        }
+
+        auto& clip = animation->clip;
+        clip.Initialize(node_name_list, parent_list, animation->animationStartFrame, animation->animationEndFrame, this->mBakeOption.sampleRate);
+
+        //同じ時刻のノードをまとめて評価する(評価器のキャッシュが効くように)
+        double one_frame = (double)FbxTime::GetOneFrameValue(FbxTime::eFrames60);
+        for (int key = 0; key < clip.GetKeyCount(); key++) {
+            FbxTime time;
+            time.Set((fbxsdk::FbxLongLong)(one_frame * clip.GetKeyFrame(key)));
+            for (size_t i = 0; i < node_list.size(); i++) {
+                auto& local_matrix = node_list[i]->EvaluateLocalTransform(time);
+                auto local_matrix_ptr = (double*)local_matrix;
+                glm::mat4 matrix;
+                for (int j = 0; j < 16; j++) {
+                    matrix[j / 4][j % 4] = (float)local_matrix_ptr[j];
+                }
+                clip.SetKey((int)i, key, matrix);
+            }
+        }
+    }
+    //------------------------------------------------------------------------------------------
     void FbxLoader::Finalize() {
-        this->mMeshList.clear();
-        this->mMaterialList.clear();
-        this->mMaterialIdDictionary.clear();
+        this->ClearLoadedData();
         this->mNodeIdDictionary.clear();
     }
     //------------------------------------------------------------------------------------------
     //ノードを巡る
-    void FbxLoader::ParseNode(FbxNode *node) {
-        FBXSDK_printf("-----------------------------------------------\n");
-        FBXSDK_printf("parse node\n");
-        FBXSDK_printf("node name:%s\n", node->GetName());
+    void FbxLoader::ParseNode(FbxNode *node, std::vector<FbxMesh*>* out_mesh_list, std::unordered_map<FbxMesh*, int>* out_mesh_index) {
+        FBX_LOG("-----------------------------------------------\n");
+        FBX_LOG("parse node\n");
+        FBX_LOG("node name:%s\n", node->GetName());
         int child_num = node->GetChildCount();
-        FBXSDK_printf("node count:%d\n", child_num);
+        FBX_LOG("node count:%d\n", child_num);
         FbxNode *child_node = 0;
         for (int i = 0; i < child_num; i++) {
             child_node = node->GetChild(i);
-            FBXSDK_printf("child[%d] name:%s\n", i, child_node->GetName());
+            FBX_LOG("child[%d] name:%s\n", i, child_node->GetName());
             FbxMesh* mesh = child_node->GetMesh();
             if (mesh != NULL) {
-                FBXSDK_printf("-----------------------------------------------\n");
-                FBXSDK_printf("parse mesh\n");
-                this->mMeshList.push_back(this->ParseMesh(mesh));
+                FBX_LOG("-----------------------------------------------\n");
+                FBX_LOG("parse mesh\n");
+                ModelInstance instance;
+                instance.nodeName = child_node->GetName();
+                if (fbxsdk::FbxSurfaceMaterial* mt = child_node->GetMaterial(0)) {
+                    instance.materialName = mt->GetName();
+                }
+                auto global_matrix = child_node->EvaluateGlobalTransform();
+                auto global_matrix_ptr = (double*)global_matrix;
+                for (int j = 0; j < 16; j++) {
+                    instance.transform[j / 4][j % 4] = (float)global_matrix_ptr[j];
+                }
+                //同じFbxMeshを使うノードは、できているメッシュを置くだけ
+                auto it = out_mesh_index->find(mesh);
+                if (this->mInstanceOption.enable && it != out_mesh_index->end()) {
+                    instance.meshIndex = it->second;
+                }
+                else {
+                    instance.meshIndex = (int)this->mMeshList.size();
+                    out_mesh_index->insert({ mesh, instance.meshIndex });
+                    this->mMeshList.emplace_back();
+                    this->PrepareMesh(mesh, &this->mMeshList.back());
+                    out_mesh_list->push_back(mesh);
+                }
+                this->mInstanceList.push_back(instance);
                 ParseMaterialList(mesh);
-                FBXSDK_printf("--parse mesh-----------------------------------\n");
+                FBX_LOG("--parse mesh-----------------------------------\n");
             }
-            ParseNode(child_node);
+            ParseNode(child_node, out_mesh_list, out_mesh_index);
         }
-        FBXSDK_printf("-parse node end--------------------------------\n");
+        FBX_LOG("-parse node end--------------------------------\n");
     }
     //------------------------------------------------------------------------------------------
-    //得られたメッシュを走査して頂点・インデックス・法線・ウェイト・ボーンインデックスを得てリストにプッシュする
-    ModelMesh FbxLoader::ParseMesh(FbxMesh *mesh) {
+    //メッシュの名前・マテリアル名・ベースポーズなど、シーンの評価が必要な部分だけを先に取り出す
+    void FbxLoader::PrepareMesh(FbxMesh *mesh, ModelMesh* out_mesh) {
         auto node = mesh->GetNode();
 
-        ModelMesh model_mesh;
+        ModelMesh& model_mesh = *out_mesh;
         model_mesh.nodeName = node->GetName();
         if (fbxsdk::FbxSurfaceMaterial* mt = node->GetMaterial(0)) {
             model_mesh.materialName = mt->GetName();
@@ -369,7 +681,7 @@ namespace fbx {
         else {
             model_mesh.materialName = "";
         }
-        printf(">> mesh: %s\n", model_mesh.nodeName.c_str());
+        FBX_LOG(">> mesh: %s\n", model_mesh.nodeName.c_str());
         //ベースポーズの逆行列？
         auto basepose_matrix = node->EvaluateGlobalTransform().Inverse();
         auto basepose_matrix_ptr = (double*)basepose_matrix;
@@ -378,72 +690,94 @@ namespace fbx {
             model_mesh.invMeshBaseposeMatrix[i / 4][i % 4] = (float)basepose_matrix_ptr[i];
         }
 
-        //インデックス取得フェイズ
-        std::vector<int> index_list;
-        GetIndexList(&index_list, *mesh);
-        //頂点を取得
-        std::vector<glm::vec3> position_list;
-        GetPositionList(&position_list, *mesh, index_list);
-        FBXSDK_printf("*[position num : %d]*\n", (int)position_list.size());
-        std::vector<glm::vec3> normal_list;
-        GetNormalList(&normal_list, *mesh, index_list);
-        FBXSDK_printf("*[normal num : %d]*\n", (int)normal_list.size());
-        std::vector<glm::vec2> uv_list;
-        GetUVList(&uv_list, *mesh, index_list, 0);
-        FBXSDK_printf("*[uv num : %d]*\n", (int)uv_list.size());
-
-        // ボーンウェイト取得
-        std::vector<ModelBoneWeight> bone_weight_list;
-        GetWeight(&bone_weight_list, &model_mesh.boneNodeNameList, &model_mesh.invBoneBaseposeMatrixList, *mesh, index_list);
-
-        std::vector<ModelVertex> model_vertex_list;
-        model_vertex_list.reserve(index_list.size());
-
-        for (unsigned int i = 0; i < index_list.size(); i++) {
-            ModelVertex vertex;
-            vertex.position = position_list[i];
-            vertex.normal = normal_list[i];
-            vertex.uv = (uv_list.size() == 0) ? glm::vec2(0.0f, 0.0f) : uv_list[i];
-            if (bone_weight_list.size() > 0) {
-                for (int j = 0; j < 4; ++j) {
-                    vertex.boneIndex[j] = bone_weight_list[i].boneIndex[j];
-                }
-                vertex.boneWeight = bone_weight_list[i].boneWeight;
-            }
-            else {
-                for (int j = 0; j < 4; ++j) {
-                    vertex.boneIndex[j] = 0;
-                }
-                vertex.boneWeight = glm::vec4(1, 0, 0, 0);
+        GetBoneList(&model_mesh.boneNodeNameList, &model_mesh.invBoneBaseposeMatrixList, *mesh);
+        FBX_PROFILE_COUNT(&this->mProfiler, kCounterSkinCluster, model_mesh.boneNodeNameList.size());
+        GetSkeleton(&model_mesh, *mesh);
+    }
+    //------------------------------------------------------------------------------------------
+    //得られたメッシュを走査して頂点・インデックス・法線・ウェイト・ボーンインデックスを得てリストにプッシュする
+    //溶接とブレンドシェイプまで。接線・LODなどは呼び出し側がFinishMeshで行う
+    //ワーカースレッドから呼ばれるので、メンバーはmodel_mesh以外書き換えないこと
+    void FbxLoader::ParseMesh(FbxMesh *mesh, ModelMesh* model_mesh) {
+        FBX_PROFILE_SCOPE(&this->mProfiler, "ParseMesh");
+        //溶接までの一時配列はすべて作業用アリーナに置き、溶接が終わったらまとめて捨てる
+        {
+            ScratchScope scratch;
+            // ボーンウェイト取得
+            auto bone_weight_list = scratch.MakeVector<ModelBoneWeight>();
+            {
+                FBX_PROFILE_SCOPE(&this->mProfiler, "weight");
+                GetWeight(&bone_weight_list, *mesh);
             }
-            model_vertex_list.push_back(vertex);
-        }
 
-        //glDrawArrays()による描画が可能になる。
-        //インデックスのターン
-        //重複頂点を除く
-        auto& model_vertex_list_opt = model_mesh.vertexList;
-        model_vertex_list_opt.reserve(model_vertex_list.size());
-
-        auto& model_index_list = model_mesh.indexList;
-        model_index_list.reserve(index_list.size());
-
-        for (auto& vertex : model_vertex_list) {
-            //重複しているか
-            auto it = std::find(model_vertex_list_opt.begin(), model_vertex_list_opt.end(), vertex);
-            if (it == model_vertex_list_opt.end()) {
-                //itがリストの最後を指しているので、重複していない。
-                model_index_list.push_back((unsigned short)model_vertex_list_opt.size());
-                model_vertex_list_opt.push_back(vertex);
+            //ポリゴンを1回走査して、角ごとに位置・法線・UV・ウェイトを読んでそのまま溶接する
+            int polygon_count = mesh->GetPolygonCount();
+            const int* polygon_vertex_list = mesh->GetPolygonVertices();
+            const FbxVector4* control_point_list = mesh->GetControlPoints();
+            auto normal_reader = MakeLayerReader(mesh->GetElementNormalCount() > 0 ? mesh->GetElementNormal(0) : nullptr);
+            auto uv_reader = MakeLayerReader(mesh->GetElementUVCount() > 0 ? mesh->GetElementUV(0) : nullptr);
+            size_t corner_count = 0;
+            for (int i = 0; i < polygon_count; i++) {
+                corner_count += (size_t)std::max(mesh->GetPolygonSize(i) - 2, 0) * 3;
             }
-            else {
-                //重複している
-                auto index = std::distance(model_vertex_list_opt.begin(), it);
-                model_index_list.push_back((unsigned short)index);
+            FBX_LOG("polygon count:[%d] corner count:[%d]\n", polygon_count, (int)corner_count);
+            //ブレンドシェイプがあれば、差分を溶接後の頂点に移すためにコントロールポイントと頂点の組を覚えておく
+            bool has_blend_shape = mesh->GetDeformerCount(FbxDeformer::eBlendShape) > 0;
+            BlendShapeVertexMap blend_shape_vertex_map(has_blend_shape ? mesh->GetControlPointsCount() : 0);
+            {
+                FBX_PROFILE_SCOPE(&this->mProfiler, "vertex");
+                VertexWelder welder(corner_count, this->mWeldOption);
+                for (int i = 0; i < polygon_count; i++) {
+                    //三角形化してあるので普通は3。残っていれば扇形に分ける
+                    int polygon_begin = mesh->GetPolygonVertexIndex(i);
+                    int polygon_size = mesh->GetPolygonSize(i);
+                    for (int k = 1; k + 1 < polygon_size; k++) {
+                        const int corner_list[3] = { polygon_begin, polygon_begin + k, polygon_begin + k + 1 };
+                        for (int corner : corner_list) {
+                            int control_point = polygon_vertex_list[corner];
+                            ModelVertex vertex;
+                            const auto& position = control_point_list[control_point];
+                            vertex.position = glm::vec3(position[0], position[1], position[2]);
+                            vertex.normal = glm::vec3(0.0f);
+                            if (normal_reader.IsValid()) {
+                                auto normal = normal_reader.Get(control_point, corner);
+                                vertex.normal = glm::vec3(normal[0], normal[1], normal[2]);
+                            }
+                            vertex.uv = glm::vec2(0.0f, 0.0f);
+                            if (uv_reader.IsValid()) {
+                                auto uv = uv_reader.Get(control_point, corner);
+                                vertex.uv = glm::vec2(uv[0], uv[1]);
+                            }
+                            if (bone_weight_list.size() > 0) {
+                                for (int j = 0; j < 4; ++j) {
+                                    vertex.boneIndex[j] = bone_weight_list[control_point].boneIndex[j];
+                                }
+                                vertex.boneWeight = bone_weight_list[control_point].boneWeight;
+                            }
+                            else {
+                                for (int j = 0; j < 4; ++j) {
+                                    vertex.boneIndex[j] = 0;
+                                }
+                                vertex.boneWeight = glm::vec4(1, 0, 0, 0);
+                            }
+                            unsigned int vertex_index = welder.Add(vertex);
+                            if (has_blend_shape) {
+                                blend_shape_vertex_map.Add(control_point, vertex_index);
+                            }
+                        }
+                    }
+                }
+                welder.Store(model_mesh);
+            }
+            if (has_blend_shape) {
+                FBX_PROFILE_SCOPE(&this->mProfiler, "blend shape");
+                blend_shape_vertex_map.Build();
+                GetBlendShapeList(&model_mesh->blendShapeList, *mesh, blend_shape_vertex_map);
+                FBX_PROFILE_COUNT(&this->mProfiler, kCounterMeshBytes, GetBlendShapeMemorySize(*model_mesh));
             }
+            FBX_LOG("Opt: %d -> %d\n", (int)corner_count, (int)model_mesh->vertexList.size());
+            FBX_PROFILE_COUNT(&this->mProfiler, kCounterVertexBeforeWeld, corner_count);
         }
-        FBXSDK_printf("Opt: %lu -> %lu\n", (unsigned short)model_vertex_list.size(), (unsigned short)model_vertex_list_opt.size());
-        return model_mesh;
     }
     //------------------------------------------------------------------------------------------
     //あるフレームにおける
@@ -453,6 +787,10 @@ namespace fbx {
     }
     //------------------------------------------------------------------------------------------
     void FbxLoader::GetAnimationMeshMatrix(glm::mat4 *out_matrix, float frame, const ModelMesh& mesh, int anim_index) const {
+        if (!this->mAnimationArray[anim_index].clip.IsEmpty()) {
+            GetClipMeshMatrix(out_matrix, this->mAnimationArray[anim_index].clip, frame, mesh);
+            return;
+        }
         auto it = this->mAnimationArray[anim_index].nodeIdDictionaryAnimation.find(mesh.nodeName);
 
         if (it == this->mAnimationArray[anim_index].nodeIdDictionaryAnimation.end()) {
@@ -474,6 +812,31 @@ namespace fbx {
         *out_matrix = *out_matrix* mesh.invMeshBaseposeMatrix;
     }
     //------------------------------------------------------------------------------------------
+    void FbxLoader::GetAnimationInstanceMatrix(glm::mat4 *out_matrix, float frame, int instance_id, int anim_index) const {
+        const auto& instance = this->mInstanceList[instance_id];
+        const auto& animation = this->mAnimationArray[anim_index];
+        if (!animation.clip.IsEmpty()) {
+            int node_id = animation.clip.FindNode(instance.nodeName);
+            *out_matrix = node_id >= 0 ? animation.clip.EvaluateGlobalMatrix(node_id, frame) : instance.transform;
+            return;
+        }
+        auto it = animation.nodeIdDictionaryAnimation.find(instance.nodeName);
+        if (it == animation.nodeIdDictionaryAnimation.end()) {
+            *out_matrix = instance.transform;
+            return;
+        }
+        auto node = animation.fbxSceneAnimation->GetNode(it->second);
+
+        FbxTime time;
+        time.Set(FbxTime::GetOneFrameValue(FbxTime::eFrames60)*(fbxsdk::FbxLongLong)frame);
+
+        auto& node_matrix = node->EvaluateGlobalTransform(time);
+        auto node_matrix_ptr = (double*)node_matrix;
+        for (int i = 0; i < 16; i++) {
+            (*out_matrix)[i / 4][i % 4] = (float)node_matrix_ptr[i];
+        }
+    }
+    //------------------------------------------------------------------------------------------
     void FbxLoader::GetAnimationBoneMatrix(glm::mat4 *out_matrix_list, float frame, int meshId, int matrix_count, int anim_index) const {
         auto& model_mesh = this->mMeshList[meshId];
         GetAnimationBoneMatrix(out_matrix_list, frame, model_mesh, matrix_count, anim_index);
@@ -483,12 +846,17 @@ namespace fbx {
         if (mesh.boneNodeNameList.size() == 0)
         {
             out_matrix_list[0] = glm::mat4(1.0);
-            FBXSDK_printf("no bone\n");
+            FBX_LOG("no bone\n");
             return;
         }
         assert(mesh.boneNodeNameList.size() <= matrix_count);
         assert(anim_index < this->mAnimationArray.size());
 
+        if (!this->mAnimationArray[anim_index].clip.IsEmpty()) {
+            GetClipBoneMatrix(out_matrix_list, this->mAnimationArray[anim_index].clip, frame, mesh);
+            return;
+        }
+
         FbxTime time;
         time.Set(FbxTime::GetOneFrameValue(FbxTime::eFrames60) * (fbxsdk::FbxLongLong)frame);
 
@@ -523,11 +891,248 @@ namespace fbx {
         }
     }
     //------------------------------------------------------------------------------------------
+    bool FbxLoader::CreateSkeletonBinding(SkeletonBinding* out_binding, const ModelMesh& mesh, int anim_index) const {
+        assert(anim_index < (int)this->mAnimationArray.size());
+        auto& animation = this->mAnimationArray[anim_index];
+        if (!animation.clip.IsEmpty()) {
+            BindClip(out_binding, animation.clip, mesh, anim_index);
+        }
+        else {
+            ResolveSkeletonBinding(out_binding, mesh, anim_index, false, [&animation](const std::string& name) {
+                auto it = animation.nodeIdDictionaryAnimation.find(name);
+                return it == animation.nodeIdDictionaryAnimation.end() ? -1 : it->second;
+            });
+        }
+        return !out_binding->HasMissingBone();
+    }
+    //------------------------------------------------------------------------------------------
+    void FbxLoader::GetAnimationMeshMatrix(glm::mat4 *out_matrix, float frame, const ModelMesh& mesh, const SkeletonBinding& binding) const {
+        auto& animation = this->mAnimationArray[binding.animIndex];
+        if (binding.useClip) {
+            GetClipMeshMatrix(out_matrix, animation.clip, frame, mesh, binding);
+            return;
+        }
+        //Detach・releaseSceneの前に作った結び付けはシーンの番号なので使えない。名前でクリップから引く
+        if (animation.fbxSceneAnimation == nullptr) {
+            GetClipMeshMatrix(out_matrix, animation.clip, frame, mesh);
+            return;
+        }
+        if (binding.meshNodeId < 0) {
+            *out_matrix = glm::mat4(1.0);
+            return;
+        }
+        FbxTime time;
+        time.Set(FbxTime::GetOneFrameValue(FbxTime::eFrames60)*(fbxsdk::FbxLongLong)frame);
+
+        auto& mesh_matrix = animation.fbxSceneAnimation->GetNode(binding.meshNodeId)->EvaluateGlobalTransform(time);
+        auto mesh_matrix_ptr = (double*)mesh_matrix;
+        for (int i = 0; i < 16; i++) {
+            (*out_matrix)[i / 4][i % 4] = (float)mesh_matrix_ptr[i];
+        }
+        *out_matrix = *out_matrix* mesh.invMeshBaseposeMatrix;
+    }
+    //------------------------------------------------------------------------------------------
+    void FbxLoader::GetAnimationBoneMatrix(glm::mat4 *out_matrix_list, float frame, const ModelMesh& mesh, const SkeletonBinding& binding) const {
+        if (binding.boneNodeIdList.size() == 0) {
+            out_matrix_list[0] = glm::mat4(1.0);
+            return;
+        }
+        auto& animation = this->mAnimationArray[binding.animIndex];
+        if (binding.useClip) {
+            GetClipBoneMatrix(out_matrix_list, animation.clip, frame, mesh, binding);
+            return;
+        }
+        if (animation.fbxSceneAnimation == nullptr) {
+            GetClipBoneMatrix(out_matrix_list, animation.clip, frame, mesh);
+            return;
+        }
+
+        FbxTime time;
+        time.Set(FbxTime::GetOneFrameValue(FbxTime::eFrames60) * (fbxsdk::FbxLongLong)frame);
+
+        size_t size = binding.boneNodeIdList.size();
+        for (size_t i = 0; i < size; ++i) {
+            auto& out_matrix = out_matrix_list[i];
+            int bone_node_id = binding.boneNodeIdList[i];
+            if (bone_node_id < 0) {
+                out_matrix = glm::mat4(1.0);
+                continue;
+            }
+            auto& bone_matrix = animation.fbxSceneAnimation->GetNode(bone_node_id)->EvaluateGlobalTransform(time);
+            auto bone_matrix_ptr = (double*)bone_matrix;
+            for (int j = 0; j < 16; j++) {
+                out_matrix[j / 4][j % 4] = (float)bone_matrix_ptr[j];
+            }
+            out_matrix = out_matrix * mesh.invBoneBaseposeMatrixList[i];
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    void FbxLoader::GetAnimationPose(glm::mat4 *out_palette, glm::mat4 *out_global_list, float frame, const ModelMesh& mesh, const SkeletonBinding& binding) const {
+        auto& animation = this->mAnimationArray[binding.animIndex];
+        if (binding.useClip) {
+            EvaluateSkeletonPose(out_palette, out_global_list, mesh.skeleton, binding, [&animation, frame](int node_id) {
+                return animation.clip.EvaluateLocalMatrix(node_id, frame);
+            });
+            return;
+        }
+        if (animation.fbxSceneAnimation == nullptr) {
+            //関節の番号だけクリップのものに引き直す。作業用なのでスレッドごとに持ち回す
+            thread_local SkeletonBinding clip_binding;
+            clip_binding.jointNodeIdList.resize(mesh.skeleton.GetJointCount());
+            for (int j = 0; j < mesh.skeleton.GetJointCount(); j++) {
+                clip_binding.jointNodeIdList[j] = animation.clip.FindNode(mesh.skeleton.GetJointName(j));
+            }
+            EvaluateSkeletonPose(out_palette, out_global_list, mesh.skeleton, clip_binding, [&animation, frame](int node_id) {
+                return animation.clip.EvaluateLocalMatrix(node_id, frame);
+            });
+            return;
+        }
+
+        FbxTime time;
+        time.Set(FbxTime::GetOneFrameValue(FbxTime::eFrames60) * (fbxsdk::FbxLongLong)frame);
+        EvaluateSkeletonPose(out_palette, out_global_list, mesh.skeleton, binding, [&animation, &time](int node_id) {
+            auto& local_matrix = animation.fbxSceneAnimation->GetNode(node_id)->EvaluateLocalTransform(time);
+            auto local_matrix_ptr = (double*)local_matrix;
+            glm::mat4 matrix;
+            for (int j = 0; j < 16; j++) {
+                matrix[j / 4][j % 4] = (float)local_matrix_ptr[j];
+            }
+            return matrix;
+        });
+    }
+    //------------------------------------------------------------------------------------------
+    bool FbxLoader::CreateSkeletonBindingList(std::vector<SkeletonBinding>* out_binding_list, const ModelMesh& mesh) const {
+        bool result = true;
+        out_binding_list->resize(this->mAnimationArray.size());
+        for (int i = 0; i < (int)this->mAnimationArray.size(); i++) {
+            result &= this->CreateSkeletonBinding(&(*out_binding_list)[i], mesh, i);
+        }
+        return result;
+    }
+    //------------------------------------------------------------------------------------------
+    void FbxLoader::GetAnimationPoseBatch(glm::mat4 *out_palette_list, const ModelMesh& mesh, const std::vector<SkeletonBinding>& binding_list,
+        const PoseRequest* request_list, size_t request_count, ThreadPool* thread_pool) const {
+        size_t palette_size = std::max<size_t>(mesh.boneNodeNameList.size(), 1);
+        //FBX SDKの評価はスレッドセーフではないので、ベイクしていないアニメーションがあれば1スレッドで行う
+        for (const auto& binding : binding_list) {
+            if (!binding.useClip && this->mAnimationArray[binding.animIndex].fbxSceneAnimation != nullptr) {
+                thread_pool = nullptr;
+            }
+        }
+        EvaluatePoseBatch(out_palette_list, palette_size, request_list, request_count, thread_pool, [&](const PoseRequest& request, glm::mat4* out_palette) {
+            if (mesh.boneNodeNameList.empty()) {
+                out_palette[0] = glm::mat4(1.0);
+                return;
+            }
+            this->GetAnimationPose(out_palette, nullptr, request.frame, mesh, binding_list[request.animIndex]);
+        });
+    }
+    //------------------------------------------------------------------------------------------
+    //ComputePoseBoundsに渡すパレット。ボーンが無ければメッシュの行列
+    void FbxLoader::EvaluateBoundsPalette(glm::mat4 *out_palette, float frame, const ModelMesh& mesh, const SkeletonBinding& binding) const {
+        if (mesh.boneNodeNameList.empty()) {
+            this->GetAnimationMeshMatrix(out_palette, frame, mesh, binding);
+            return;
+        }
+        this->GetAnimationPose(out_palette, nullptr, frame, mesh, binding);
+    }
+    //------------------------------------------------------------------------------------------
+    void FbxLoader::BuildAnimationBoundsList(int anim_index) {
+        auto& animation = this->mAnimationArray[anim_index];
+        animation.meshBoundsList.resize(this->mMeshList.size());
+        for (size_t i = 0; i < this->mMeshList.size(); i++) {
+            const auto& mesh = this->mMeshList[i];
+            SkeletonBinding binding;
+            this->CreateSkeletonBinding(&binding, mesh, anim_index);
+            auto evaluate_palette = [&](float frame, glm::mat4* out_palette) {
+                this->EvaluateBoundsPalette(out_palette, frame, mesh, binding);
+            };
+            BuildAnimationBounds(&animation.meshBoundsList[i], mesh, animation.GetAnimationStartFrame(), animation.GetAnimationEndFrame(),
+                this->mBoundsOption, evaluate_palette);
+        }
+        FBX_LOG("animation bounds: %d meshes x %d segments\n", (int)this->mMeshList.size(),
+            this->mMeshList.empty() ? 0 : (int)animation.meshBoundsList[0].segmentBoundsList.size());
+    }
+    //------------------------------------------------------------------------------------------
+    void FbxLoader::GetAnimationBounds(ModelBounds* out_bounds, float frame, int mesh_id, int anim_index) const {
+        const auto& animation = this->mAnimationArray[anim_index];
+        if (mesh_id < (int)animation.meshBoundsList.size() && fbx::GetAnimationBounds(out_bounds, animation.meshBoundsList[mesh_id], frame)) {
+            return;
+        }
+        //表が無い(オプションが無効か、後から足したメッシュ)ので姿勢を求める
+        const auto& mesh = this->mMeshList[mesh_id];
+        SkeletonBinding binding;
+        this->CreateSkeletonBinding(&binding, mesh, anim_index);
+        thread_local std::vector<glm::mat4> palette;
+        palette.resize(std::max<size_t>(mesh.boneNodeNameList.size(), 1));
+        this->EvaluateBoundsPalette(palette.data(), frame, mesh, binding);
+        ComputePoseBounds(out_bounds, mesh, palette.data());
+    }
+    //------------------------------------------------------------------------------------------
+    void FbxLoader::GetAnimationBlendShapeWeight(float* out_weight_list, float frame, const ModelMesh& mesh, int anim_index) const {
+        EvaluateBlendShapeWeights(out_weight_list, frame, mesh, this->mAnimationArray[anim_index].blendShapeCurveList);
+    }
+    //------------------------------------------------------------------------------------------
+    //中身のハッシュが同じメッシュは番号の小さい方だけを残し、インスタンスの参照を付け替えて詰める
+    void FbxLoader::MergeSameMeshes(size_t mesh_offset, size_t instance_offset, const std::vector<uint64_t>& content_hash_list) {
+        FBX_PROFILE_SCOPE(&this->mProfiler, "instance");
+        std::unordered_map<uint64_t, int> content_mesh_index;
+        std::vector<int> remap(content_hash_list.size());
+        size_t mesh_count = 0;
+        for (size_t i = 0; i < content_hash_list.size(); i++) {
+            auto result = content_mesh_index.insert({ content_hash_list[i], (int)(mesh_offset + mesh_count) });
+            remap[i] = result.first->second;
+            if (!result.second) {
+                continue;
+            }
+            if (mesh_count != i) {
+                this->mMeshList[mesh_offset + mesh_count] = std::move(this->mMeshList[mesh_offset + i]);
+            }
+            mesh_count++;
+        }
+        this->mMeshList.resize(mesh_offset + mesh_count);
+        for (size_t i = instance_offset; i < this->mInstanceList.size(); i++) {
+            auto& instance = this->mInstanceList[i];
+            instance.meshIndex = remap[instance.meshIndex - mesh_offset];
+        }
+        FBX_LOG("Instance: %d -> %d meshes\n", (int)content_hash_list.size(), (int)mesh_count);
+    }
+    //------------------------------------------------------------------------------------------
+    //中止した時に、通知していない作りかけのメッシュを消して詰める。消したメッシュを置くインスタンスも消す
+    void FbxLoader::DiscardUndeliveredMeshes(size_t mesh_offset, size_t instance_offset, const std::vector<uint8_t>& delivered_list) {
+        std::vector<int> remap(delivered_list.size(), -1);
+        size_t mesh_count = 0;
+        for (size_t i = 0; i < delivered_list.size(); i++) {
+            if (!delivered_list[i]) {
+                continue;
+            }
+            remap[i] = (int)(mesh_offset + mesh_count);
+            if (mesh_count != i) {
+                this->mMeshList[mesh_offset + mesh_count] = std::move(this->mMeshList[mesh_offset + i]);
+            }
+            mesh_count++;
+        }
+        this->mMeshList.resize(mesh_offset + mesh_count);
+        size_t instance_count = instance_offset;
+        for (size_t i = instance_offset; i < this->mInstanceList.size(); i++) {
+            int mesh_index = remap[this->mInstanceList[i].meshIndex - mesh_offset];
+            if (mesh_index < 0) {
+                continue;
+            }
+            if (instance_count != i) {
+                this->mInstanceList[instance_count] = std::move(this->mInstanceList[i]);
+            }
+            this->mInstanceList[instance_count].meshIndex = mesh_index;
+            instance_count++;
+        }
+        this->mInstanceList.resize(instance_count);
+    }
+    //------------------------------------------------------------------------------------------
     void FbxLoader::ParseMaterialList(FbxMesh *mesh)
     {
         FbxNode *node = mesh->GetNode();
         int material_count = node->GetMaterialCount();
-        FBXSDK_printf("material count: %d\n", material_count);
+        FBX_LOG("material count: %d\n", material_count);
         for (int i = 0; i < material_count; i++) {
             FbxSurfaceMaterial *material = node->GetMaterial(i);
             ParseMaterial(material);
@@ -578,14 +1183,14 @@ namespace fbx {
                 }
             }
             mtl.materialName = material->GetName();
-            printf("diffuseTexture      : %s\n", mtl.diffuseTextureName.c_str());
-            printf("normalTexture       : %s\n", mtl.normalTextureName.c_str());
-            printf("specularTexture     : %s\n", mtl.specularTextureName.c_str());
-            printf("falloffTexture      : %s\n", mtl.falloffTextureName.c_str());
-            printf("reflectionMapTexture: %s\n", mtl.reflectionMapTextureName.c_str());
+            FBX_LOG("diffuseTexture      : %s\n", mtl.diffuseTextureName.c_str());
+            FBX_LOG("normalTexture       : %s\n", mtl.normalTextureName.c_str());
+            FBX_LOG("specularTexture     : %s\n", mtl.specularTextureName.c_str());
+            FBX_LOG("falloffTexture      : %s\n", mtl.falloffTextureName.c_str());
+            FBX_LOG("reflectionMapTexture: %s\n", mtl.reflectionMapTextureName.c_str());
             this->mMaterialList.push_back(mtl);
             this->mMaterialIdDictionary.insert({ mtl.materialName, mMaterialNum }); //辞書登録
-            FBXSDK_printf("materialName:%d:%s\n", mMaterialNum, mtl.materialName.c_str());
+            FBX_LOG("materialName:%d:%s\n", mMaterialNum, mtl.materialName.c_str());
             mMaterialNum++;
         }
         else {
@@ -593,7 +1198,7 @@ namespace fbx {
             int layer_num = property.GetSrcObjectCount<FbxLayeredTexture>();
             if (layer_num == 0) {
                 int file_texture_count = property.GetSrcObjectCount<FbxFileTexture>();
-                FBXSDK_printf("Texture Count:%d\n", file_texture_count);
+                FBX_LOG("Texture Count:%d\n", file_texture_count);
                 for (int j = 0; j < file_texture_count; j++) {
                     FbxFileTexture* file_texture = FbxCast<FbxFileTexture>(property.GetSrcObject<FbxTexture>(j));
                     std::string tex_name = (char*)file_texture->GetFileName();
@@ -603,8 +1208,8 @@ namespace fbx {
                     mtl.materialName = material->GetName();
                     this->mMaterialList.push_back(mtl);
                     this->mMaterialIdDictionary.insert({ mtl.materialName, mMaterialNum }); //辞書登録
-                    FBXSDK_printf("diffuseTexture: %s\n", mtl.diffuseTextureName.c_str());
-                    FBXSDK_printf("materialName:%d:%s\n", mMaterialNum, mtl.materialName.c_str());
+                    FBX_LOG("diffuseTexture: %s\n", mtl.diffuseTextureName.c_str());
+                    FBX_LOG("materialName:%d:%s\n", mMaterialNum, mtl.materialName.c_str());
                     mMaterialNum++;
                 }
             }
@@ -0,0 +1,1621 @@
+﻿#include "../include/fbx_binary.h"
+
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fbx {
+namespace binary {
+
+    namespace {
+        //60fpsの1フレームをFBXの時間単位(1秒=46186158000)で表したもの
+        const double kOneFrameTime = 46186158000.0 / 60.0;
+
+        template<class T>
+        T ReadValue(const uint8_t* ptr) {
+            T value;
+            std::memcpy(&value, ptr, sizeof(T));
+            return value;
+        }
+
+        size_t ArrayElementSize(char type) {
+            switch (type) {
+            case 'f': return 4;
+            case 'd': return 8;
+            case 'l': return 8;
+            case 'i': return 4;
+            case 'b': return 1;
+            }
+            return 0;
+        }
+    }
+
+    //-- MappedFile Class --//
+    MappedFile::MappedFile() {
+        mData = nullptr;
+        mSize = 0;
+#ifdef _WIN32
+        mFileHandle = INVALID_HANDLE_VALUE;
+        mMappingHandle = nullptr;
+#endif
+    }
+    MappedFile::~MappedFile()
+    {
+        this->Close();
+    }
+    //------------------------------------------------------------------------------------------
+    bool MappedFile::Open(const char* filepath) {
+        this->Close();
+#ifdef _WIN32
+        mFileHandle = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (mFileHandle == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(mFileHandle, &size) || size.QuadPart == 0) {
+            this->Close();
+            return false;
+        }
+        mMappingHandle = CreateFileMappingA(mFileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mMappingHandle == nullptr) {
+            this->Close();
+            return false;
+        }
+        mData = (const uint8_t*)MapViewOfFile(mMappingHandle, FILE_MAP_READ, 0, 0, 0);
+        if (mData == nullptr) {
+            this->Close();
+            return false;
+        }
+        mSize = (size_t)size.QuadPart;
+#else
+        int fd = open(filepath, O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            close(fd);
+            return false;
+        }
+        void* ptr = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (ptr == MAP_FAILED) {
+            return false;
+        }
+        madvise(ptr, (size_t)st.st_size, MADV_SEQUENTIAL);
+        mData = (const uint8_t*)ptr;
+        mSize = (size_t)st.st_size;
+#endif
+        return true;
+    }
+    //------------------------------------------------------------------------------------------
+    void MappedFile::Close() {
+#ifdef _WIN32
+        if (mData != nullptr) {
+            UnmapViewOfFile(mData);
+        }
+        if (mMappingHandle != nullptr) {
+            CloseHandle(mMappingHandle);
+            mMappingHandle = nullptr;
+        }
+        if (mFileHandle != INVALID_HANDLE_VALUE) {
+            CloseHandle(mFileHandle);
+            mFileHandle = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (mData != nullptr) {
+            munmap((void*)mData, mSize);
+        }
+#endif
+        mData = nullptr;
+        mSize = 0;
+    }
+
+    //-- Property --//
+    int64_t Property::GetInt() const {
+        switch (type) {
+        case 'Y': return ReadValue<int16_t>(data);
+        case 'C': return data[0];
+        case 'I': return ReadValue<int32_t>(data);
+        case 'L': return ReadValue<int64_t>(data);
+        case 'F': return (int64_t)ReadValue<float>(data);
+        case 'D': return (int64_t)ReadValue<double>(data);
+        }
+        return 0;
+    }
+    //------------------------------------------------------------------------------------------
+    double Property::GetDouble() const {
+        switch (type) {
+        case 'F': return ReadValue<float>(data);
+        case 'D': return ReadValue<double>(data);
+        case 'Y':
+        case 'C':
+        case 'I':
+        case 'L':
+            return (double)GetInt();
+        }
+        return 0.0;
+    }
+    //------------------------------------------------------------------------------------------
+    std::string Property::GetString() const {
+        if (type != 'S' && type != 'R') {
+            return std::string();
+        }
+        return std::string((const char*)data, length);
+    }
+
+    //-- ArrayView Class --//
+    ArrayView::ArrayView(const Property& property) : mType(0), mData(nullptr), mCount(0) {
+        size_t element_size = ArrayElementSize(property.type);
+        if (element_size == 0) {
+            return;
+        }
+        size_t byte_size = element_size * property.length;
+        if (property.encoding == 0) {
+            if (property.compressedLength < byte_size) {
+                return;
+            }
+            mData = property.data;
+        }
+        else if (property.encoding == 1) {
+            //圧縮されている配列だけは展開先が必要になる
+            mInflated = std::make_shared<std::vector<uint8_t>>(byte_size);
+            if (!Inflate(property.data, property.compressedLength, mInflated->data(), byte_size)) {
+                mInflated.reset();
+                return;
+            }
+            mData = mInflated->data();
+        }
+        else {
+            return;
+        }
+        mType = property.type;
+        mCount = property.length;
+    }
+    //------------------------------------------------------------------------------------------
+    double ArrayView::GetDouble(size_t i) const {
+        switch (mType) {
+        case 'f': return ReadValue<float>(mData + i * 4);
+        case 'd': return ReadValue<double>(mData + i * 8);
+        case 'l': return (double)ReadValue<int64_t>(mData + i * 8);
+        case 'i': return ReadValue<int32_t>(mData + i * 4);
+        case 'b': return mData[i];
+        }
+        return 0.0;
+    }
+    //------------------------------------------------------------------------------------------
+    int64_t ArrayView::GetInt(size_t i) const {
+        switch (mType) {
+        case 'f': return (int64_t)ReadValue<float>(mData + i * 4);
+        case 'd': return (int64_t)ReadValue<double>(mData + i * 8);
+        case 'l': return ReadValue<int64_t>(mData + i * 8);
+        case 'i': return ReadValue<int32_t>(mData + i * 4);
+        case 'b': return mData[i];
+        }
+        return 0;
+    }
+
+    //-- Node --//
+    bool Node::NameIs(const char* str) const {
+        return std::strlen(str) == nameLength && std::memcmp(name, str, nameLength) == 0;
+    }
+
+    //-- Document Class --//
+    bool Document::Parse(const uint8_t* data, size_t size) {
+        static const char kMagic[] = "Kaydara FBX Binary  ";
+        if (size < 27 || std::memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+            return false;
+        }
+        mData = data;
+        mSize = size;
+        mVersion = ReadValue<uint32_t>(data + 23);
+        mNodeList.clear();
+        mPropertyList.clear();
+
+        //0番は仮想的なルート
+        Node root;
+        root.name = "";
+        root.nameLength = 0;
+        root.firstProperty = 0;
+        root.propertyCount = 0;
+        root.firstChild = -1;
+        root.nextSibling = -1;
+        mNodeList.push_back(root);
+
+        return ParseNodeList(0, 27, size);
+    }
+    //------------------------------------------------------------------------------------------
+    //[begin,end)にあるノードレコードを読んでparentの子にする。空のレコードが来たら終わり
+    bool Document::ParseNodeList(int parent, size_t begin, size_t end) {
+        const bool is_64bit = mVersion >= 7500;
+        const size_t header_size = is_64bit ? 25 : 13;
+
+        int last_child = -1;
+        size_t pos = begin;
+        while (pos + header_size <= end) {
+            const uint8_t* header = mData + pos;
+            uint64_t end_offset, property_count, property_list_length;
+            if (is_64bit) {
+                end_offset = ReadValue<uint64_t>(header);
+                property_count = ReadValue<uint64_t>(header + 8);
+                property_list_length = ReadValue<uint64_t>(header + 16);
+            }
+            else {
+                end_offset = ReadValue<uint32_t>(header);
+                property_count = ReadValue<uint32_t>(header + 4);
+                property_list_length = ReadValue<uint32_t>(header + 8);
+            }
+            if (end_offset == 0) {
+                return true;
+            }
+            uint32_t name_length = header[header_size - 1];
+            size_t property_begin = pos + header_size + name_length;
+            size_t property_end = property_begin + (size_t)property_list_length;
+            if (end_offset <= pos || end_offset > end || property_end > end_offset) {
+                return false;
+            }
+
+            Node node;
+            node.name = (const char*)(header + header_size);
+            node.nameLength = name_length;
+            node.firstProperty = (uint32_t)mPropertyList.size();
+            node.propertyCount = (uint32_t)property_count;
+            node.firstChild = -1;
+            node.nextSibling = -1;
+
+            const uint8_t* ptr = mData + property_begin;
+            const uint8_t* ptr_end = mData + property_end;
+            for (uint64_t i = 0; i < property_count; i++) {
+                if (ptr >= ptr_end) {
+                    return false;
+                }
+                Property property;
+                property.type = (char)*ptr++;
+                property.encoding = 0;
+                property.compressedLength = 0;
+                switch (property.type) {
+                case 'Y': property.length = 2; break;
+                case 'C': property.length = 1; break;
+                case 'I': property.length = 4; break;
+                case 'F': property.length = 4; break;
+                case 'D': property.length = 8; break;
+                case 'L': property.length = 8; break;
+                case 'S':
+                case 'R':
+                    if (ptr + 4 > ptr_end) {
+                        return false;
+                    }
+                    property.length = ReadValue<uint32_t>(ptr);
+                    ptr += 4;
+                    break;
+                case 'f':
+                case 'd':
+                case 'l':
+                case 'i':
+                case 'b':
+                    if (ptr + 12 > ptr_end) {
+                        return false;
+                    }
+                    property.length = ReadValue<uint32_t>(ptr);
+                    property.encoding = ReadValue<uint32_t>(ptr + 4);
+                    property.compressedLength = ReadValue<uint32_t>(ptr + 8);
+                    ptr += 12;
+                    break;
+                default:
+                    return false;
+                }
+                property.data = ptr;
+                size_t byte_size = property.IsArray() ? property.compressedLength : property.length;
+                if (ptr + byte_size > ptr_end) {
+                    return false;
+                }
+                ptr += byte_size;
+                mPropertyList.push_back(property);
+            }
+
+            int node_index = (int)mNodeList.size();
+            mNodeList.push_back(node);
+            if (last_child < 0) {
+                mNodeList[parent].firstChild = node_index;
+            }
+            else {
+                mNodeList[last_child].nextSibling = node_index;
+            }
+            last_child = node_index;
+
+            if (property_end < end_offset) {
+                if (!ParseNodeList(node_index, property_end, (size_t)end_offset)) {
+                    return false;
+                }
+            }
+            pos = (size_t)end_offset;
+        }
+        return parent != 0 || pos == end;
+    }
+    //------------------------------------------------------------------------------------------
+    int Document::FindChild(int node_index, const char* name) const {
+        for (int child = mNodeList[node_index].firstChild; child >= 0; child = mNodeList[child].nextSibling) {
+            if (mNodeList[child].NameIs(name)) {
+                return child;
+            }
+        }
+        return -1;
+    }
+    //------------------------------------------------------------------------------------------
+    int Document::FindTopNode(const char* name) const {
+        return mNodeList.empty() ? -1 : FindChild(0, name);
+    }
+
+    //-- AnimationCurve --//
+    float AnimationCurve::Evaluate(float frame) const {
+        if (keyFrameList.empty()) {
+            return 0.0f;
+        }
+        if (frame <= keyFrameList.front()) {
+            return keyValueList.front();
+        }
+        if (frame >= keyFrameList.back()) {
+            return keyValueList.back();
+        }
+        size_t next = std::upper_bound(keyFrameList.begin(), keyFrameList.end(), frame) - keyFrameList.begin();
+        size_t prev = next - 1;
+        if (keyConstantList[prev]) {
+            return keyValueList[prev];
+        }
+        //3次補間のキーも線形補間で近似する
+        float t = (frame - keyFrameList[prev]) / (keyFrameList[next] - keyFrameList[prev]);
+        return keyValueList[prev] + (keyValueList[next] - keyValueList[prev]) * t;
+    }
+
+    //-- AnimationScene --//
+    namespace {
+        glm::mat4 TranslationMatrix(const glm::vec3& t) {
+            glm::mat4 m(1.0f);
+            m[3] = glm::vec4(t.x, t.y, t.z, 1.0f);
+            return m;
+        }
+
+        glm::mat4 ScalingMatrix(const glm::vec3& s) {
+            glm::mat4 m(1.0f);
+            m[0][0] = s.x;
+            m[1][1] = s.y;
+            m[2][2] = s.z;
+            return m;
+        }
+
+        glm::mat4 AxisRotationMatrix(int axis, float degree) {
+            float radian = degree * 3.14159265358979f / 180.0f;
+            float c = std::cos(radian);
+            float s = std::sin(radian);
+            int a = (axis + 1) % 3;
+            int b = (axis + 2) % 3;
+            glm::mat4 m(1.0f);
+            m[a][a] = c;
+            m[a][b] = s;
+            m[b][a] = -s;
+            m[b][b] = c;
+            return m;
+        }
+
+        //FBXの回転順(EFbxRotationOrder)。XYZならX,Y,Zの順に回す
+        glm::mat4 EulerMatrix(const glm::vec3& degree, int order) {
+            static const int kAxisOrder[6][3] = {
+                { 0, 1, 2 }, { 0, 2, 1 }, { 1, 2, 0 }, { 1, 0, 2 }, { 2, 0, 1 }, { 2, 1, 0 } };
+            if (order < 0 || order >= 6) {
+                order = 0;
+            }
+            const int* axis = kAxisOrder[order];
+            return AxisRotationMatrix(axis[2], degree[axis[2]])
+                * AxisRotationMatrix(axis[1], degree[axis[1]])
+                * AxisRotationMatrix(axis[0], degree[axis[0]]);
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    glm::mat4 AnimationScene::EvaluateLocalTransform(int node_id, float frame) const {
+        const auto& node = this->nodeList[node_id];
+        glm::vec3 channel[3] = { node.translation, node.rotation, node.scaling };
+        if (frame >= 0.0f) {
+            for (int i = 0; i < 9; i++) {
+                if (node.curve[i] >= 0) {
+                    channel[i / 3][i % 3] = this->curveList[node.curve[i]].Evaluate(frame);
+                }
+            }
+        }
+
+        //T * Roff * Rp * Rpre * R * Rpost^-1 * Rp^-1 * Soff * Sp * S * Sp^-1
+        //FBX SDKと同じく、Rpre・Rpost・回転順はRotationActiveの時だけ使う
+        glm::mat4 rotation;
+        if (node.rotationActive) {
+            rotation = EulerMatrix(node.preRotation, 0)
+                * EulerMatrix(channel[1], node.rotationOrder)
+                * glm::inverse(EulerMatrix(node.postRotation, 0));
+        }
+        else {
+            rotation = EulerMatrix(channel[1], 0);
+        }
+        return TranslationMatrix(channel[0])
+            * TranslationMatrix(node.rotationOffset)
+            * TranslationMatrix(node.rotationPivot)
+            * rotation
+            * TranslationMatrix(-node.rotationPivot)
+            * TranslationMatrix(node.scalingOffset)
+            * TranslationMatrix(node.scalingPivot)
+            * ScalingMatrix(channel[2])
+            * TranslationMatrix(-node.scalingPivot);
+    }
+    //------------------------------------------------------------------------------------------
+    glm::mat4 AnimationScene::EvaluateGlobalTransform(int node_id, float frame) const {
+        glm::mat4 global = EvaluateLocalTransform(node_id, frame);
+        for (int parent = this->nodeList[node_id].parent; parent >= 0; parent = this->nodeList[parent].parent) {
+            global = EvaluateLocalTransform(parent, frame) * global;
+        }
+        return global;
+    }
+
+    //-- Scene graph (internal) --//
+    namespace {
+        struct ObjectInfo {
+            int64_t id;
+            int node;
+            std::string name;
+            std::string subClass;
+        };
+
+        struct Connection {
+            int64_t child;
+            int64_t parent;
+            std::string property;
+        };
+
+        //Objects と Connections を引けるようにしたもの
+        class SceneGraph
+        {
+        public:
+            explicit SceneGraph(const Document& document) : mDocument(document) {}
+
+            void Build() {
+                int objects = mDocument.FindTopNode("Objects");
+                if (objects >= 0) {
+                    for (int child = mDocument.GetNode(objects).firstChild; child >= 0; child = mDocument.GetNode(child).nextSibling) {
+                        const auto& node = mDocument.GetNode(child);
+                        if (node.propertyCount < 2) {
+                            continue;
+                        }
+                        ObjectInfo info;
+                        info.id = mDocument.GetProperty(node, 0).GetInt();
+                        info.node = child;
+                        //"名前\x00\x01クラス" になっているので前半だけ取る
+                        std::string name = mDocument.GetProperty(node, 1).GetString();
+                        info.name = name.substr(0, name.find('\0'));
+                        info.subClass = node.propertyCount >= 3 ? mDocument.GetProperty(node, 2).GetString() : std::string();
+                        mObjectIndex.insert({ info.id, (int)mObjectList.size() });
+                        mObjectList.push_back(info);
+                    }
+                }
+
+                int connections = mDocument.FindTopNode("Connections");
+                if (connections >= 0) {
+                    for (int child = mDocument.GetNode(connections).firstChild; child >= 0; child = mDocument.GetNode(child).nextSibling) {
+                        const auto& node = mDocument.GetNode(child);
+                        if (!node.NameIs("C") || node.propertyCount < 3) {
+                            continue;
+                        }
+                        Connection connection;
+                        connection.child = mDocument.GetProperty(node, 1).GetInt();
+                        connection.parent = mDocument.GetProperty(node, 2).GetInt();
+                        if (node.propertyCount >= 4) {
+                            connection.property = mDocument.GetProperty(node, 3).GetString();
+                        }
+                        int index = (int)mConnectionList.size();
+                        mConnectionList.push_back(connection);
+                        mChildConnection[connection.parent].push_back(index);
+                        mParentConnection[connection.child].push_back(index);
+                    }
+                }
+
+                //Definitions の PropertyTemplate (既定値)
+                int definitions = mDocument.FindTopNode("Definitions");
+                if (definitions >= 0) {
+                    for (int child = mDocument.GetNode(definitions).firstChild; child >= 0; child = mDocument.GetNode(child).nextSibling) {
+                        const auto& node = mDocument.GetNode(child);
+                        if (!node.NameIs("ObjectType") || node.propertyCount < 1) {
+                            continue;
+                        }
+                        int property_template = mDocument.FindChild(child, "PropertyTemplate");
+                        if (property_template >= 0) {
+                            mTemplate.insert({ mDocument.GetProperty(node, 0).GetString(), property_template });
+                        }
+                    }
+                }
+            }
+
+            const Document& GetDocument() const {
+                return mDocument;
+            }
+            const std::vector<ObjectInfo>& GetObjectList() const {
+                return mObjectList;
+            }
+            const ObjectInfo* FindObject(int64_t id) const {
+                auto it = mObjectIndex.find(id);
+                return it == mObjectIndex.end() ? nullptr : &mObjectList[it->second];
+            }
+            bool IsClass(const ObjectInfo& info, const char* class_name) const {
+                return mDocument.GetNode(info.node).NameIs(class_name);
+            }
+
+            //parent_idに繋がっているclass_nameのオブジェクトを接続順に返す。propertyがnullptrでなければ一致するものだけ
+            std::vector<const ObjectInfo*> GetChildren(int64_t parent_id, const char* class_name, const char* property = nullptr) const {
+                std::vector<const ObjectInfo*> result;
+                auto it = mChildConnection.find(parent_id);
+                if (it == mChildConnection.end()) {
+                    return result;
+                }
+                for (int index : it->second) {
+                    const auto& connection = mConnectionList[index];
+                    if (property != nullptr && connection.property != property) {
+                        continue;
+                    }
+                    auto object = FindObject(connection.child);
+                    if (object != nullptr && IsClass(*object, class_name)) {
+                        result.push_back(object);
+                    }
+                }
+                return result;
+            }
+
+            //child_idが繋がっている先を接続順に返す。接続のプロパティ名も返す
+            std::vector<std::pair<const ObjectInfo*, const Connection*>> GetParents(int64_t child_id, const char* class_name) const {
+                std::vector<std::pair<const ObjectInfo*, const Connection*>> result;
+                auto it = mParentConnection.find(child_id);
+                if (it == mParentConnection.end()) {
+                    return result;
+                }
+                for (int index : it->second) {
+                    const auto& connection = mConnectionList[index];
+                    auto object = FindObject(connection.parent);
+                    if (object != nullptr && IsClass(*object, class_name)) {
+                        result.push_back({ object, &connection });
+                    }
+                }
+                return result;
+            }
+
+            //Properties70のPを、テンプレート→オブジェクト自身の順に渡す
+            template<class Func>
+            void ForEachProperty70(const ObjectInfo& info, const char* template_name, Func func) const {
+                auto it = mTemplate.find(template_name);
+                if (it != mTemplate.end()) {
+                    ForEachP(mDocument.FindChild(it->second, "Properties70"), func);
+                }
+                ForEachP(mDocument.FindChild(info.node, "Properties70"), func);
+            }
+        private:
+            template<class Func>
+            void ForEachP(int properties70, Func func) const {
+                if (properties70 < 0) {
+                    return;
+                }
+                for (int child = mDocument.GetNode(properties70).firstChild; child >= 0; child = mDocument.GetNode(child).nextSibling) {
+                    const auto& p = mDocument.GetNode(child);
+                    if (p.NameIs("P") && p.propertyCount >= 4) {
+                        func(mDocument.GetProperty(p, 0).GetString(), p);
+                    }
+                }
+            }
+
+            const Document& mDocument;
+            std::vector<ObjectInfo> mObjectList;
+            std::unordered_map<int64_t, int> mObjectIndex;
+            std::vector<Connection> mConnectionList;
+            std::unordered_map<int64_t, std::vector<int>> mChildConnection;
+            std::unordered_map<int64_t, std::vector<int>> mParentConnection;
+            std::map<std::string, int> mTemplate;
+        };
+
+        glm::vec3 GetVector3(const Document& document, const Node& p) {
+            glm::vec3 value(0.0f);
+            for (int i = 0; i < 3 && 4 + i < (int)p.propertyCount; i++) {
+                value[i] = (float)document.GetProperty(p, 4 + i).GetDouble();
+            }
+            return value;
+        }
+
+        //Modelをノードとして読む。親子関係はまだ入れない
+        AnimationNode ReadAnimationNode(const SceneGraph& graph, const ObjectInfo& info) {
+            const auto& document = graph.GetDocument();
+
+            AnimationNode node;
+            node.name = info.name;
+            node.parent = -1;
+            node.translation = glm::vec3(0.0f);
+            node.rotation = glm::vec3(0.0f);
+            node.scaling = glm::vec3(1.0f);
+            node.preRotation = glm::vec3(0.0f);
+            node.postRotation = glm::vec3(0.0f);
+            node.rotationOffset = glm::vec3(0.0f);
+            node.rotationPivot = glm::vec3(0.0f);
+            node.scalingOffset = glm::vec3(0.0f);
+            node.scalingPivot = glm::vec3(0.0f);
+            node.rotationOrder = 0;
+            node.rotationActive = false;
+            for (int i = 0; i < 9; i++) {
+                node.curve[i] = -1;
+            }
+
+            graph.ForEachProperty70(info, "Model", [&](const std::string& name, const Node& p) {
+                if (name == "Lcl Translation") node.translation = GetVector3(document, p);
+                else if (name == "Lcl Rotation") node.rotation = GetVector3(document, p);
+                else if (name == "Lcl Scaling") node.scaling = GetVector3(document, p);
+                else if (name == "PreRotation") node.preRotation = GetVector3(document, p);
+                else if (name == "PostRotation") node.postRotation = GetVector3(document, p);
+                else if (name == "RotationOffset") node.rotationOffset = GetVector3(document, p);
+                else if (name == "RotationPivot") node.rotationPivot = GetVector3(document, p);
+                else if (name == "ScalingOffset") node.scalingOffset = GetVector3(document, p);
+                else if (name == "ScalingPivot") node.scalingPivot = GetVector3(document, p);
+                else if (name == "RotationOrder" && p.propertyCount >= 5) node.rotationOrder = (int)document.GetProperty(p, 4).GetInt();
+                else if (name == "RotationActive" && p.propertyCount >= 5) node.rotationActive = document.GetProperty(p, 4).GetInt() != 0;
+            });
+            return node;
+        }
+
+        AnimationCurve ReadAnimationCurve(const Document& document, int node_index) {
+            AnimationCurve curve;
+            int key_time = document.FindChild(node_index, "KeyTime");
+            int key_value = document.FindChild(node_index, "KeyValueFloat");
+            if (key_value < 0) {
+                key_value = document.FindChild(node_index, "KeyValueDouble");
+            }
+            if (key_time < 0 || key_value < 0) {
+                return curve;
+            }
+            ArrayView time_array(document.GetProperty(document.GetNode(key_time), 0));
+            ArrayView value_array(document.GetProperty(document.GetNode(key_value), 0));
+            size_t key_count = std::min(time_array.size(), value_array.size());
+            curve.keyFrameList.resize(key_count);
+            curve.keyValueList.resize(key_count);
+            curve.keyConstantList.assign(key_count, 0);
+            for (size_t i = 0; i < key_count; i++) {
+                curve.keyFrameList[i] = (float)(time_array.GetInt(i) / kOneFrameTime);
+                curve.keyValueList[i] = (float)value_array.GetDouble(i);
+            }
+
+            //補間の種類はフラグとそのフラグが続くキーの数の組で入っている
+            int flags_node = document.FindChild(node_index, "KeyAttrFlags");
+            int ref_count_node = document.FindChild(node_index, "KeyAttrRefCount");
+            if (flags_node >= 0 && ref_count_node >= 0) {
+                ArrayView flags(document.GetProperty(document.GetNode(flags_node), 0));
+                ArrayView ref_count(document.GetProperty(document.GetNode(ref_count_node), 0));
+                size_t key = 0;
+                for (size_t i = 0; i < flags.size() && i < ref_count.size(); i++) {
+                    bool constant = (flags.GetInt(i) & 0x02) != 0;
+                    for (int64_t k = 0; k < ref_count.GetInt(i) && key < key_count; k++) {
+                        curve.keyConstantList[key++] = constant ? 1 : 0;
+                    }
+                }
+            }
+            return curve;
+        }
+
+        //GeometryにBlendShapeがつながっているか
+        bool HasBlendShape(const SceneGraph& graph, const ObjectInfo& geometry) {
+            for (auto deformer : graph.GetChildren(geometry.id, "Deformer")) {
+                if (deformer->subClass == "BlendShape") {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        //Geometry←BlendShape←BlendShapeChannel←Shapeの順につながっている
+        //Shapeは動くコントロールポイントの番号と、位置・法線の元の形からの差分を持つ
+        void ReadBlendShapeList(std::vector<ModelBlendShapeChannel>* out_channel_list, const SceneGraph& graph, const ObjectInfo& geometry, const BlendShapeVertexMap& vertex_map) {
+            const auto& document = graph.GetDocument();
+            std::vector<int> index_list;
+            std::vector<glm::vec3> position_delta_list;
+            std::vector<glm::vec3> normal_delta_list;
+            for (auto blend_shape : graph.GetChildren(geometry.id, "Deformer")) {
+                if (blend_shape->subClass != "BlendShape") {
+                    continue;
+                }
+                for (auto channel : graph.GetChildren(blend_shape->id, "Deformer")) {
+                    if (channel->subClass != "BlendShapeChannel") {
+                        continue;
+                    }
+                    ModelBlendShapeChannel model_channel;
+                    model_channel.name = channel->name;
+                    //7.xは子のノードに、書き出し方によってはProperties70にも入っている
+                    int deform_percent_node = document.FindChild(channel->node, "DeformPercent");
+                    if (deform_percent_node >= 0 && document.GetNode(deform_percent_node).propertyCount >= 1) {
+                        model_channel.defaultWeight = (float)document.GetProperty(document.GetNode(deform_percent_node), 0).GetDouble();
+                    }
+                    graph.ForEachProperty70(*channel, "Deformer", [&](const std::string& name, const Node& p) {
+                        if (name == "DeformPercent" && p.propertyCount >= 5) {
+                            model_channel.defaultWeight = (float)document.GetProperty(p, 4).GetDouble();
+                        }
+                    });
+                    ArrayView full_weight_list;
+                    int full_weights_node = document.FindChild(channel->node, "FullWeights");
+                    if (full_weights_node >= 0) {
+                        full_weight_list = ArrayView(document.GetProperty(document.GetNode(full_weights_node), 0));
+                    }
+                    auto shape_list = graph.GetChildren(channel->id, "Geometry");
+                    for (size_t s = 0; s < shape_list.size(); s++) {
+                        const auto& shape = *shape_list[s];
+                        int indexes_node = document.FindChild(shape.node, "Indexes");
+                        int vertices_node = document.FindChild(shape.node, "Vertices");
+                        if (shape.subClass != "Shape" || indexes_node < 0 || vertices_node < 0) {
+                            continue;
+                        }
+                        ArrayView indexes(document.GetProperty(document.GetNode(indexes_node), 0));
+                        ArrayView vertices(document.GetProperty(document.GetNode(vertices_node), 0));
+                        ArrayView normals;
+                        int normals_node = document.FindChild(shape.node, "Normals");
+                        if (normals_node >= 0) {
+                            normals = ArrayView(document.GetProperty(document.GetNode(normals_node), 0));
+                        }
+                        size_t count = std::min(indexes.size(), vertices.size() / 3);
+                        bool use_normal = normals.size() >= count * 3;
+                        index_list.resize(count);
+                        position_delta_list.resize(count);
+                        normal_delta_list.resize(use_normal ? count : 0);
+                        for (size_t i = 0; i < count; i++) {
+                            index_list[i] = (int)indexes.GetInt(i);
+                            position_delta_list[i] = glm::vec3((float)vertices.GetDouble(i * 3 + 0), (float)vertices.GetDouble(i * 3 + 1), (float)vertices.GetDouble(i * 3 + 2));
+                            if (use_normal) {
+                                normal_delta_list[i] = glm::vec3((float)normals.GetDouble(i * 3 + 0), (float)normals.GetDouble(i * 3 + 1), (float)normals.GetDouble(i * 3 + 2));
+                            }
+                        }
+                        ModelBlendShapeTarget target;
+                        target.name = shape.name;
+                        target.fullWeight = s < full_weight_list.size() ? (float)full_weight_list.GetDouble(s) : 100.0f;
+                        BuildBlendShapeTarget(&target, vertex_map, index_list.data(), position_delta_list.data(), use_normal ? normal_delta_list.data() : nullptr, count);
+                        model_channel.targetList.push_back(std::move(target));
+                    }
+                    std::stable_sort(model_channel.targetList.begin(), model_channel.targetList.end(), [](const ModelBlendShapeTarget& a, const ModelBlendShapeTarget& b) {
+                        return a.fullWeight < b.fullWeight;
+                    });
+                    out_channel_list->push_back(std::move(model_channel));
+                }
+            }
+        }
+
+        //layerに入っているDeformPercentのカーブを読む。メッシュの名前はチャンネル→BlendShape→Geometry→Modelとたどって得る
+        void ReadBlendShapeCurveList(std::vector<BlendShapeCurve>* out_curve_list, const SceneGraph& graph, const ObjectInfo* layer) {
+            for (const auto& channel : graph.GetObjectList()) {
+                if (!graph.IsClass(channel, "Deformer") || channel.subClass != "BlendShapeChannel") {
+                    continue;
+                }
+                for (auto curve_node : graph.GetChildren(channel.id, "AnimationCurveNode", "DeformPercent")) {
+                    bool in_layer = false;
+                    for (auto& parent : graph.GetParents(curve_node->id, "AnimationLayer")) {
+                        in_layer |= (parent.first == layer);
+                    }
+                    auto curve_list = graph.GetChildren(curve_node->id, "AnimationCurve", "d|DeformPercent");
+                    if (!in_layer || curve_list.empty()) {
+                        continue;
+                    }
+                    AnimationCurve curve = ReadAnimationCurve(graph.GetDocument(), curve_list[0]->node);
+                    for (auto& blend_shape : graph.GetParents(channel.id, "Deformer")) {
+                        for (auto& geometry : graph.GetParents(blend_shape.first->id, "Geometry")) {
+                            for (auto& model : graph.GetParents(geometry.first->id, "Model")) {
+                                BlendShapeCurve blend_shape_curve;
+                                blend_shape_curve.meshName = model.first->name;
+                                blend_shape_curve.channelName = channel.name;
+                                blend_shape_curve.keyFrameList = curve.keyFrameList;
+                                blend_shape_curve.keyValueList = curve.keyValueList;
+                                blend_shape_curve.keyConstantList = curve.keyConstantList;
+                                out_curve_list->push_back(std::move(blend_shape_curve));
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        //Modelの一覧から階層を作る。node_object_listはnodeListと同じ順番のオブジェクト
+        void BuildNodeHierarchy(AnimationScene* scene, std::vector<const ObjectInfo*>* node_object_list, const SceneGraph& graph) {
+            std::unordered_map<int64_t, int> node_index;
+            for (const auto& info : graph.GetObjectList()) {
+                if (!graph.IsClass(info, "Model")) {
+                    continue;
+                }
+                node_index.insert({ info.id, (int)scene->nodeList.size() });
+                scene->nodeList.push_back(ReadAnimationNode(graph, info));
+                node_object_list->push_back(&info);
+            }
+            for (size_t i = 0; i < node_object_list->size(); i++) {
+                for (auto& parent : graph.GetParents((*node_object_list)[i]->id, "Model")) {
+                    scene->nodeList[i].parent = node_index.at(parent.first->id);
+                    break;
+                }
+                scene->nodeIdDictionaryAnimation.insert({ scene->nodeList[i].name, (int)i });
+            }
+        }
+
+        //ボーンとその祖先のノードからスケルトンを作る
+        void BuildSkeleton(ModelMesh* model_mesh, const AnimationScene& node_scene, const std::vector<int>& bone_node_id_list) {
+            std::unordered_map<int, int> joint_id_dictionary;
+            std::vector<int> joint_node_list;
+            for (int bone_node_id : bone_node_id_list) {
+                for (int n = bone_node_id; n >= 0; n = node_scene.nodeList[n].parent) {
+                    if (!joint_id_dictionary.insert({ n, (int)joint_node_list.size() }).second) {
+                        break;
+                    }
+                    joint_node_list.push_back(n);
+                }
+            }
+            std::vector<std::string> joint_name_list;
+            std::vector<int> parent_list;
+            std::vector<glm::mat4> rest_local_list;
+            for (int n : joint_node_list) {
+                joint_name_list.push_back(node_scene.nodeList[n].name);
+                int parent = node_scene.nodeList[n].parent;
+                parent_list.push_back(parent >= 0 ? joint_id_dictionary.at(parent) : -1);
+                rest_local_list.push_back(node_scene.EvaluateLocalTransform(n, -1.0f));
+            }
+            model_mesh->skeleton.Initialize(joint_name_list, parent_list, rest_local_list, model_mesh->boneNodeNameList, model_mesh->invBoneBaseposeMatrixList);
+        }
+
+        float GetStackFrame(const SceneGraph& graph, const ObjectInfo& stack, const char* local_name, const char* reference_name) {
+            int64_t local_time = 0;
+            int64_t reference_time = 0;
+            bool has_local = false;
+            graph.ForEachProperty70(stack, "AnimationStack", [&](const std::string& name, const Node& p) {
+                if (p.propertyCount < 5) {
+                    return;
+                }
+                if (name == local_name) {
+                    local_time = graph.GetDocument().GetProperty(p, 4).GetInt();
+                    has_local = true;
+                }
+                else if (name == reference_name) {
+                    reference_time = graph.GetDocument().GetProperty(p, 4).GetInt();
+                }
+            });
+            return (float)((has_local ? local_time : reference_time) / kOneFrameTime);
+        }
+
+        //Geometryのレイヤー要素(法線・UV)の読み方
+        struct LayerElement {
+            ArrayView direct;
+            ArrayView index;
+            int components;
+            //0:コントロールポイント毎 1:ポリゴン頂点毎 2:ポリゴン毎 3:全部同じ
+            int mapping;
+            bool indexed;
+
+            bool IsValid() const {
+                return !direct.empty();
+            }
+            //コーナーの値を取り出す
+            void Get(float* out, int control_point, int polygon_vertex, int polygon) const {
+                int element = 0;
+                switch (mapping) {
+                case 0: element = control_point; break;
+                case 1: element = polygon_vertex; break;
+                case 2: element = polygon; break;
+                default: element = 0; break;
+                }
+                if (indexed) {
+                    element = (size_t)element < index.size() ? (int)index.GetInt(element) : -1;
+                }
+                for (int i = 0; i < components; i++) {
+                    size_t at = (size_t)element * components + i;
+                    out[i] = (element >= 0 && at < direct.size()) ? (float)direct.GetDouble(at) : 0.0f;
+                }
+            }
+        };
+
+        LayerElement ReadLayerElement(const Document& document, int geometry_node, const char* element_name, const char* direct_name, const char* index_name, int components) {
+            LayerElement element;
+            element.components = components;
+            element.mapping = 0;
+            element.indexed = false;
+            int layer = document.FindChild(geometry_node, element_name);
+            if (layer < 0) {
+                return element;
+            }
+            int mapping = document.FindChild(layer, "MappingInformationType");
+            if (mapping >= 0) {
+                std::string type = document.GetProperty(document.GetNode(mapping), 0).GetString();
+                if (type == "ByPolygonVertex") element.mapping = 1;
+                else if (type == "ByPolygon") element.mapping = 2;
+                else if (type == "AllSame") element.mapping = 3;
+                else element.mapping = 0;
+            }
+            int reference = document.FindChild(layer, "ReferenceInformationType");
+            if (reference >= 0) {
+                std::string type = document.GetProperty(document.GetNode(reference), 0).GetString();
+                element.indexed = (type == "IndexToDirect" || type == "Index");
+            }
+            int direct = document.FindChild(layer, direct_name);
+            if (direct >= 0) {
+                element.direct = ArrayView(document.GetProperty(document.GetNode(direct), 0));
+            }
+            int index = document.FindChild(layer, index_name);
+            if (element.indexed && index >= 0) {
+                element.index = ArrayView(document.GetProperty(document.GetNode(index), 0));
+            }
+            else {
+                element.indexed = false;
+            }
+            return element;
+        }
+    }
+
+    //-- BinaryFbxLoader Class --//
+    BinaryFbxLoader::BinaryFbxLoader() {
+    }
+    BinaryFbxLoader::~BinaryFbxLoader()
+    {
+        this->Finalize();
+    }
+    //------------------------------------------------------------------------------------------
+    bool BinaryFbxLoader::Initialize(const char* filepath, const char* animetion_path) {
+        FBX_PROFILE_SCOPE(&this->mProfiler, "Initialize");
+        MappedFile file;
+        Document document;
+        if (!file.Open(filepath)) {
+            printf("FBX initialize error! [binary][file:%s][anim:%s]\n", filepath, animetion_path);
+            return false;
+        }
+
+        //キャッシュが有効なら解析を飛ばす。アニメーションはキャッシュしない
+        size_t mesh_offset = this->mMeshList.size();
+        size_t material_offset = this->mMaterialList.size();
+        size_t instance_offset = this->mInstanceList.size();
+        std::string cache_path;
+        AssetCacheKey cache_key;
+        if (this->ReadCache(filepath, file.GetData(), file.GetSize(), kAssetCacheBinary,
+            mesh_offset, material_offset, instance_offset, &cache_path, &cache_key)) {
+            if (animetion_path != nullptr) {
+                this->LoadAnimation(animetion_path);
+            }
+            return true;
+        }
+
+        {
+            FBX_PROFILE_SCOPE(&this->mProfiler, "parse document");
+            if (!document.Parse(file.GetData(), file.GetSize())) {
+                printf("FBX initialize error! [binary][file:%s][anim:%s]\n", filepath, animetion_path);
+                return false;
+            }
+        }
+        SceneGraph graph(document);
+        //ベースポーズの計算用にノード階層を作る
+        AnimationScene node_scene;
+        std::vector<const ObjectInfo*> node_object_list;
+        {
+            FBX_PROFILE_SCOPE(&this->mProfiler, "scene graph");
+            graph.Build();
+            BuildNodeHierarchy(&node_scene, &node_object_list, graph);
+        }
+
+        //マテリアルの解析。テクスチャの無いマテリアルは登録しない(FbxLoaderと同じ)
+        auto parse_material = [&](const ObjectInfo& material) {
+            for (auto texture : graph.GetChildren(material.id, "Texture", "DiffuseColor")) {
+                int file_name = document.FindChild(texture->node, "FileName");
+                if (file_name < 0) {
+                    file_name = document.FindChild(texture->node, "RelativeFilename");
+                }
+                std::string tex_name = file_name >= 0 ? document.GetProperty(document.GetNode(file_name), 0).GetString() : std::string();
+                tex_name = tex_name.substr(tex_name.find_last_of('/') + 1);
+
+                ModelMaterial mtl;
+                mtl.diffuseTextureName = tex_name;
+                mtl.materialName = material.name;
+                this->mMaterialList.push_back(mtl);
+                this->mMaterialIdDictionary.insert({ mtl.materialName, mMaterialNum }); //辞書登録
+                mMaterialNum++;
+                this->NotifyMaterial(this->mMaterialList.size() - 1);
+            }
+        };
+        {
+            FBX_PROFILE_SCOPE(&this->mProfiler, "material");
+            for (const auto& info : graph.GetObjectList()) {
+                if (graph.IsClass(info, "Material")) {
+                    parse_material(info);
+                }
+            }
+        }
+
+        std::unordered_map<int64_t, int> node_index;
+        for (size_t i = 0; i < node_object_list.size(); i++) {
+            node_index.insert({ node_object_list[i]->id, (int)i });
+        }
+
+        //ルートから子を順に巡る(FbxLoader::ParseNodeと同じ順番)
+        std::vector<int64_t> visit_order;
+        {
+            //再帰の代わりに明示的なスタックで深さ優先に巡る
+            std::vector<std::pair<std::vector<const ObjectInfo*>, size_t>> stack;
+            stack.push_back({ graph.GetChildren(0, "Model"), 0 });
+            while (!stack.empty()) {
+                auto& top = stack.back();
+                if (top.second >= top.first.size()) {
+                    stack.pop_back();
+                    continue;
+                }
+                const ObjectInfo* child = top.first[top.second++];
+                visit_order.push_back(child->id);
+                stack.push_back({ graph.GetChildren(child->id, "Model"), 0 });
+            }
+        }
+
+        //InstanceOptionで使う、GeometryのIDと溶接した結果のハッシュからメッシュ番号への表
+        std::unordered_map<int64_t, int> geometry_mesh_index;
+        std::unordered_map<uint64_t, int> content_mesh_index;
+        for (int64_t model_id : visit_order) {
+            //中止はメッシュの区切りでだけ受け付ける。それまでに届いたメッシュは残る
+            if (this->mLoadListener != nullptr && this->mLoadListener->IsCanceled()) {
+                printf("FBX initialize canceled [binary][file:%s]\n", filepath);
+                return false;
+            }
+            auto geometry_list = graph.GetChildren(model_id, "Geometry");
+            if (geometry_list.empty() || geometry_list[0]->subClass != "Mesh") {
+                continue;
+            }
+            FBX_PROFILE_SCOPE(&this->mProfiler, "ParseMesh");
+            //ウェイトと三角形化した頂点の一時配列はメッシュごとに作業用アリーナから取る
+            ScratchScope scratch;
+            const ObjectInfo& model = *graph.FindObject(model_id);
+            const ObjectInfo& geometry = *geometry_list[0];
+            int model_node_id = node_index.at(model_id);
+
+            ModelInstance instance;
+            instance.nodeName = model.name;
+            auto material_list = graph.GetChildren(model_id, "Material");
+            instance.materialName = material_list.empty() ? "" : material_list[0]->name;
+            instance.transform = node_scene.EvaluateGlobalTransform(model_node_id, -1.0f);
+            //同じGeometryを使うノードは、できているメッシュを置くだけ
+            auto add_instance = [&](int mesh_index) {
+                instance.meshIndex = mesh_index;
+                this->mInstanceList.push_back(instance);
+                FBX_PROFILE_COUNT(&this->mProfiler, kCounterInstance, 1);
+                for (auto material : material_list) {
+                    parse_material(*material);
+                }
+            };
+            if (this->mInstanceOption.enable) {
+                auto it = geometry_mesh_index.find(geometry.id);
+                if (it != geometry_mesh_index.end()) {
+                    add_instance(it->second);
+                    continue;
+                }
+            }
+
+            ModelMesh model_mesh;
+            model_mesh.nodeName = instance.nodeName;
+            model_mesh.materialName = instance.materialName;
+            model_mesh.invMeshBaseposeMatrix = glm::inverse(instance.transform);
+
+            int vertices_node = document.FindChild(geometry.node, "Vertices");
+            int polygon_node = document.FindChild(geometry.node, "PolygonVertexIndex");
+            if (vertices_node < 0 || polygon_node < 0) {
+                continue;
+            }
+            ArrayView vertices(document.GetProperty(document.GetNode(vertices_node), 0));
+            ArrayView polygon_vertex_index(document.GetProperty(document.GetNode(polygon_node), 0));
+            int control_points_count = (int)(vertices.size() / 3);
+
+            LayerElement normal_element = ReadLayerElement(document, geometry.node, "LayerElementNormal", "Normals", "NormalsIndex", 3);
+            LayerElement uv_element = ReadLayerElement(document, geometry.node, "LayerElementUV", "UV", "UVIndex", 2);
+
+            //ボーンウェイト(GetWeightと同じ作り方)
+            auto bone_weight_list_control_points = scratch.MakeVector<ModelBoneWeight>();
+            std::vector<int> bone_node_id_list;
+            {
+                FBX_PROFILE_SCOPE(&this->mProfiler, "weight");
+                auto skin_list = graph.GetChildren(geometry.id, "Deformer");
+                for (auto skin : skin_list) {
+                    if (skin->subClass != "Skin") {
+                        continue;
+                    }
+                    using TmpWeight = std::pair<int, float>;
+                    std::vector<std::vector<TmpWeight>> tmp_bone_weight_list(control_points_count);
+                    auto cluster_list = graph.GetChildren(skin->id, "Deformer");
+                    int cluster_index = 0;
+                    for (auto cluster : cluster_list) {
+                        if (cluster->subClass != "Cluster") {
+                            continue;
+                        }
+                        auto link = graph.GetChildren(cluster->id, "Model");
+                        if (link.empty()) {
+                            continue;
+                        }
+                        bone_node_id_list.push_back(node_index.at(link[0]->id));
+                        model_mesh.boneNodeNameList.push_back(link[0]->name);
+                        model_mesh.invBoneBaseposeMatrixList.push_back(glm::inverse(node_scene.EvaluateGlobalTransform(bone_node_id_list.back(), -1.0f)));
+
+                        int indexes_node = document.FindChild(cluster->node, "Indexes");
+                        int weights_node = document.FindChild(cluster->node, "Weights");
+                        if (indexes_node >= 0 && weights_node >= 0) {
+                            ArrayView indices(document.GetProperty(document.GetNode(indexes_node), 0));
+                            ArrayView weights(document.GetProperty(document.GetNode(weights_node), 0));
+                            for (size_t k = 0; k < indices.size() && k < weights.size(); k++) {
+                                int control_point_index = (int)indices.GetInt(k);
+                                if (control_point_index >= 0 && control_point_index < control_points_count) {
+                                    tmp_bone_weight_list[control_point_index].push_back({ cluster_index, (float)weights.GetDouble(k) });
+                                }
+                            }
+                        }
+                        cluster_index++;
+                    }
+
+                    bone_weight_list_control_points.reserve(control_points_count);
+                    for (auto& tmp_bone_weight : tmp_bone_weight_list) {
+                        std::sort(tmp_bone_weight.begin(), tmp_bone_weight.end(), [](const TmpWeight& weightA, const TmpWeight& weightB) { return weightA.second > weightB.second; });
+                        while (tmp_bone_weight.size() > 4) {
+                            tmp_bone_weight.pop_back();
+                        }
+                        while (tmp_bone_weight.size() < 4) {
+                            tmp_bone_weight.push_back({ 0, 0.0f });
+                        }
+                        ModelBoneWeight weight;
+                        float total = 0.0f;
+                        for (int i = 0; i < 4; i++) {
+                            weight.boneIndex[i] = tmp_bone_weight[i].first;
+                            weight.boneWeight[i] = tmp_bone_weight[i].second;
+                            total += tmp_bone_weight[i].second;
+                        }
+                        for (int i = 0; i < 4; i++) {
+                            weight.boneWeight[i] /= total;
+                        }
+                        bone_weight_list_control_points.push_back(weight);
+                    }
+                    //FbxLoaderと同じくスキンは1つだけ
+                    break;
+                }
+            }
+            FBX_PROFILE_COUNT(&this->mProfiler, kCounterSkinCluster, bone_node_id_list.size());
+            if (!bone_node_id_list.empty()) {
+                BuildSkeleton(&model_mesh, node_scene, bone_node_id_list);
+            }
+
+            //ポリゴンを扇形に三角形化しながら頂点を作り、溶接前の配列を作らずにそのまま溶接する
+            //n角形は3(n-2)個の角になる。溶接の表の大きさに使うので先に数える
+            size_t corner_count = 0;
+            {
+                size_t polygon_begin = 0;
+                for (size_t i = 0; i < polygon_vertex_index.size(); i++) {
+                    if (polygon_vertex_index.GetInt(i) < 0) {
+                        corner_count += (i + 1 - polygon_begin >= 3) ? (i - 1 - polygon_begin) * 3 : 0;
+                        polygon_begin = i + 1;
+                    }
+                }
+            }
+            //ブレンドシェイプがあれば、差分を溶接後の頂点に移すためにコントロールポイントと頂点の組を覚えておく
+            bool has_blend_shape = HasBlendShape(graph, geometry);
+            BlendShapeVertexMap blend_shape_vertex_map(has_blend_shape ? control_points_count : 0);
+            {
+                FBX_PROFILE_SCOPE(&this->mProfiler, "vertex");
+                VertexWelder welder(corner_count, this->mWeldOption);
+                size_t polygon_begin = 0;
+                int polygon = 0;
+                for (size_t i = 0; i < polygon_vertex_index.size(); i++) {
+                    //ポリゴンの最後の頂点はビット反転されている
+                    if (polygon_vertex_index.GetInt(i) >= 0) {
+                        continue;
+                    }
+                    for (size_t k = polygon_begin + 1; k + 1 <= i; k++) {
+                        const size_t corner_list[3] = { polygon_begin, k, k + 1 };
+                        for (size_t corner : corner_list) {
+                            int control_point = (int)polygon_vertex_index.GetInt(corner);
+                            if (control_point < 0) {
+                                control_point = ~control_point;
+                            }
+                            ModelVertex vertex;
+                            vertex.position = glm::vec3(0.0f);
+                            if (control_point < control_points_count) {
+                                vertex.position = glm::vec3(
+                                    (float)vertices.GetDouble(control_point * 3 + 0),
+                                    (float)vertices.GetDouble(control_point * 3 + 1),
+                                    (float)vertices.GetDouble(control_point * 3 + 2));
+                            }
+                            float normal[3] = { 0.0f, 0.0f, 0.0f };
+                            if (normal_element.IsValid()) {
+                                normal_element.Get(normal, control_point, (int)corner, polygon);
+                            }
+                            vertex.normal = glm::vec3(normal[0], normal[1], normal[2]);
+                            float uv[2] = { 0.0f, 0.0f };
+                            if (uv_element.IsValid()) {
+                                uv_element.Get(uv, control_point, (int)corner, polygon);
+                            }
+                            vertex.uv = glm::vec2(uv[0], uv[1]);
+                            if (bone_weight_list_control_points.size() > 0 && control_point < control_points_count) {
+                                for (int j = 0; j < 4; ++j) {
+                                    vertex.boneIndex[j] = bone_weight_list_control_points[control_point].boneIndex[j];
+                                }
+                                vertex.boneWeight = bone_weight_list_control_points[control_point].boneWeight;
+                            }
+                            else {
+                                for (int j = 0; j < 4; ++j) {
+                                    vertex.boneIndex[j] = 0;
+                                }
+                                vertex.boneWeight = glm::vec4(1, 0, 0, 0);
+                            }
+                            unsigned int vertex_index = welder.Add(vertex);
+                            if (has_blend_shape) {
+                                blend_shape_vertex_map.Add(control_point, vertex_index);
+                            }
+                        }
+                    }
+                    polygon_begin = i + 1;
+                    polygon++;
+                }
+                welder.Store(&model_mesh);
+            }
+            if (has_blend_shape) {
+                FBX_PROFILE_SCOPE(&this->mProfiler, "blend shape");
+                blend_shape_vertex_map.Build();
+                ReadBlendShapeList(&model_mesh.blendShapeList, graph, geometry, blend_shape_vertex_map);
+                FBX_LOG("BlendShape: %d channels, %d bytes\n", (int)model_mesh.blendShapeList.size(), (int)GetBlendShapeMemorySize(model_mesh));
+                FBX_PROFILE_COUNT(&this->mProfiler, kCounterMeshBytes, GetBlendShapeMemorySize(model_mesh));
+            }
+            //別のGeometryでも溶接した結果が同じなら、その後の処理は同じ結果になるので飛ばす
+            if (this->mInstanceOption.enable && this->mInstanceOption.matchContent) {
+                uint64_t content_hash = HashMeshGeometry(model_mesh);
+                auto it = content_mesh_index.find(content_hash);
+                if (it != content_mesh_index.end()) {
+                    geometry_mesh_index.insert({ geometry.id, it->second });
+                    add_instance(it->second);
+                    continue;
+                }
+                content_mesh_index.insert({ content_hash, (int)this->mMeshList.size() });
+            }
+            geometry_mesh_index.insert({ geometry.id, (int)this->mMeshList.size() });
+            this->FinishMesh(&model_mesh);
+            FBX_PROFILE_COUNT(&this->mProfiler, kCounterMesh, 1);
+            FBX_PROFILE_COUNT(&this->mProfiler, kCounterVertexBeforeWeld, corner_count);
+            this->mMeshList.push_back(std::move(model_mesh));
+            this->NotifyMesh(this->mMeshList.size() - 1);
+            //次のメッシュの作業用の配列が空いたメモリを使えるように、1つずつ詰め直す
+            this->PackGeometry(this->mMeshList.size() - 1, 1);
+
+            //FbxLoader::ParseMaterialListと同じくメッシュのマテリアルも登録する
+            add_instance((int)this->mMeshList.size() - 1);
+        }
+
+        FBX_PROFILE_COUNT(&this->mProfiler, kCounterMaterial, this->mMaterialList.size() - material_offset);
+
+        this->WriteCache(cache_path, cache_key, mesh_offset, material_offset, instance_offset);
+
+        if (animetion_path != nullptr) {
+            FBX_PROFILE_SCOPE(&this->mProfiler, "animation");
+            this->LoadAnimation(animetion_path);
+        }
+        return true;
+    }
+    //------------------------------------------------------------------------------------------
+    void BakeAnimationScene(AnimationScene* scene, const BakeOption& option) {
+        std::vector<int> original_parent_list;
+        for (const auto& node : scene->nodeList) {
+            original_parent_list.push_back(node.parent);
+        }
+        auto order = SortNodeByHierarchy(original_parent_list);
+        std::vector<int> new_index(order.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            new_index[order[i]] = (int)i;
+        }
+        std::vector<std::string> node_name_list;
+        std::vector<int> parent_list;
+        for (int original : order) {
+            const auto& node = scene->nodeList[original];
+            node_name_list.push_back(node.name);
+            parent_list.push_back(node.parent >= 0 ? new_index[node.parent] : -1);
+        }
+
+        auto& clip = scene->clip;
+        clip.Initialize(node_name_list, parent_list, scene->animationStartFrame, scene->animationEndFrame, option.sampleRate);
+        for (int key = 0; key < clip.GetKeyCount(); key++) {
+            float frame = clip.GetKeyFrame(key);
+            for (size_t i = 0; i < order.size(); i++) {
+                clip.SetKey((int)i, key, scene->EvaluateLocalTransform(order[i], frame));
+            }
+        }
+
+        if (option.releaseScene) {
+            std::vector<AnimationNode>().swap(scene->nodeList);
+            std::vector<AnimationCurve>().swap(scene->curveList);
+            scene->nodeIdDictionaryAnimation.clear();
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    //アニメーションスタックごとにAnimationSceneを作る
+    bool BinaryFbxLoader::LoadAnimation(const char* filepath) {
+        //メッシュだけ読む時はnullptrが渡される
+        if (filepath == nullptr) {
+            return false;
+        }
+        MappedFile file;
+        Document document;
+        SceneGraph graph(document);
+        AnimationScene node_scene;
+        std::vector<const ObjectInfo*> node_object_list;
+        {
+            FBX_PROFILE_SCOPE(&this->mProfiler, "animation parse");
+            if (!file.Open(filepath) || !document.Parse(file.GetData(), file.GetSize())) {
+                printf("Animation Load Error!:%s\n", filepath);
+                return false;
+            }
+            graph.Build();
+            BuildNodeHierarchy(&node_scene, &node_object_list, graph);
+        }
+        FBX_PROFILE_COUNT(&this->mProfiler, kCounterAnimationNode, node_scene.nodeList.size());
+
+        static const char* kChannelName[3] = { "d|X", "d|Y", "d|Z" };
+        static const char* kPropertyName[3] = { "Lcl Translation", "Lcl Rotation", "Lcl Scaling" };
+
+        for (const auto& stack : graph.GetObjectList()) {
+            if (!graph.IsClass(stack, "AnimationStack")) {
+                continue;
+            }
+            FBX_PROFILE_SCOPE(&this->mProfiler, "animation curve");
+            AnimationScene scene = node_scene;
+            scene.animationStartFrame = GetStackFrame(graph, stack, "LocalStart", "ReferenceStart");
+            scene.animationEndFrame = GetStackFrame(graph, stack, "LocalStop", "ReferenceStop");
+
+            //レイヤーの合成はしないので最初のレイヤーのカーブだけ使う
+            auto layer_list = graph.GetChildren(stack.id, "AnimationLayer");
+            if (!layer_list.empty()) {
+                for (size_t i = 0; i < node_object_list.size(); i++) {
+                    auto& node = scene.nodeList[i];
+                    for (int p = 0; p < 3; p++) {
+                        for (auto curve_node : graph.GetChildren(node_object_list[i]->id, "AnimationCurveNode", kPropertyName[p])) {
+                            bool in_layer = false;
+                            for (auto& layer : graph.GetParents(curve_node->id, "AnimationLayer")) {
+                                in_layer |= (layer.first == layer_list[0]);
+                            }
+                            if (!in_layer) {
+                                continue;
+                            }
+                            for (int c = 0; c < 3; c++) {
+                                auto curve_list = graph.GetChildren(curve_node->id, "AnimationCurve", kChannelName[c]);
+                                if (curve_list.empty()) {
+                                    continue;
+                                }
+                                node.curve[p * 3 + c] = (int)scene.curveList.size();
+                                scene.curveList.push_back(ReadAnimationCurve(document, curve_list[0]->node));
+                            }
+                        }
+                    }
+                }
+                ReadBlendShapeCurveList(&scene.blendShapeCurveList, graph, layer_list[0]);
+            }
+            FBX_LOG("[AnimationName: %s] [start: %f] [end: %f]\n", stack.name.c_str(), scene.animationStartFrame, scene.animationEndFrame);
+            if (this->mBakeOption.enable) {
+                FBX_PROFILE_SCOPE(&this->mProfiler, "animation bake");
+                BakeAnimationScene(&scene, this->mBakeOption);
+            }
+            this->mAnimationArray.push_back(std::move(scene));
+            if (this->mBoundsOption.animation) {
+                FBX_PROFILE_SCOPE(&this->mProfiler, "animation bounds");
+                this->BuildAnimationBoundsList((int)this->mAnimationArray.size() - 1);
+            }
+        }
+        return !this->mAnimationArray.empty();
+    }
+    //------------------------------------------------------------------------------------------
+    void BinaryFbxLoader::Finalize() {
+        this->ClearLoadedData();
+        this->mAnimationArray.clear();
+    }
+    //------------------------------------------------------------------------------------------
+    void BinaryFbxLoader::GetAnimationMeshMatrix(glm::mat4 *out_matrix, float frame, int mesh_id, int anim_index) const {
+        auto& model_mesh = this->mMeshList[mesh_id];
+        GetAnimationMeshMatrix(out_matrix, frame, model_mesh, anim_index);
+    }
+    //------------------------------------------------------------------------------------------
+    void BinaryFbxLoader::GetAnimationMeshMatrix(glm::mat4 *out_matrix, float frame, const ModelMesh& mesh, int anim_index) const {
+        const auto& animation = this->mAnimationArray[anim_index];
+        if (!animation.clip.IsEmpty()) {
+            GetClipMeshMatrix(out_matrix, animation.clip, frame, mesh);
+            return;
+        }
+        auto it = animation.nodeIdDictionaryAnimation.find(mesh.nodeName);
+        if (it == animation.nodeIdDictionaryAnimation.end()) {
+            *out_matrix = glm::mat4(1.0);
+            return;
+        }
+        //FbxLoaderと同じくフレームは切り捨てる
+        *out_matrix = animation.EvaluateGlobalTransform(it->second, (float)(long long)frame) * mesh.invMeshBaseposeMatrix;
+    }
+    //------------------------------------------------------------------------------------------
+    void BinaryFbxLoader::GetAnimationInstanceMatrix(glm::mat4 *out_matrix, float frame, int instance_id, int anim_index) const {
+        const auto& instance = this->mInstanceList[instance_id];
+        const auto& animation = this->mAnimationArray[anim_index];
+        if (!animation.clip.IsEmpty()) {
+            int node_id = animation.clip.FindNode(instance.nodeName);
+            *out_matrix = node_id >= 0 ? animation.clip.EvaluateGlobalMatrix(node_id, frame) : instance.transform;
+            return;
+        }
+        auto it = animation.nodeIdDictionaryAnimation.find(instance.nodeName);
+        if (it == animation.nodeIdDictionaryAnimation.end()) {
+            *out_matrix = instance.transform;
+            return;
+        }
+        *out_matrix = animation.EvaluateGlobalTransform(it->second, (float)(long long)frame);
+    }
+    //------------------------------------------------------------------------------------------
+    void BinaryFbxLoader::GetAnimationBoneMatrix(glm::mat4 *out_matrix_list, float frame, int meshId, int matrix_count, int anim_index) const {
+        auto& model_mesh = this->mMeshList[meshId];
+        GetAnimationBoneMatrix(out_matrix_list, frame, model_mesh, matrix_count, anim_index);
+    }
+    //------------------------------------------------------------------------------------------
+    void BinaryFbxLoader::GetAnimationBoneMatrix(glm::mat4 *out_matrix_list, float frame, const ModelMesh& mesh, int matrix_count, int anim_index) const {
+        if (mesh.boneNodeNameList.size() == 0)
+        {
+            out_matrix_list[0] = glm::mat4(1.0);
+            return;
+        }
+        assert((int)mesh.boneNodeNameList.size() <= matrix_count);
+        assert(anim_index < (int)this->mAnimationArray.size());
+
+        const auto& animation = this->mAnimationArray[anim_index];
+        if (!animation.clip.IsEmpty()) {
+            GetClipBoneMatrix(out_matrix_list, animation.clip, frame, mesh);
+            return;
+        }
+        float time = (float)(long long)frame;
+        unsigned int size = (unsigned int)mesh.boneNodeNameList.size();
+        for (unsigned int i = 0; i < size; ++i)
+        {
+            int bone_node_id = animation.nodeIdDictionaryAnimation.at(mesh.boneNodeNameList[i]);
+            out_matrix_list[i] = animation.EvaluateGlobalTransform(bone_node_id, time) * mesh.invBoneBaseposeMatrixList[i];
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    bool BinaryFbxLoader::CreateSkeletonBinding(SkeletonBinding* out_binding, const ModelMesh& mesh, int anim_index) const {
+        assert(anim_index < (int)this->mAnimationArray.size());
+        const auto& animation = this->mAnimationArray[anim_index];
+        if (!animation.clip.IsEmpty()) {
+            BindClip(out_binding, animation.clip, mesh, anim_index);
+        }
+        else {
+            ResolveSkeletonBinding(out_binding, mesh, anim_index, false, [&animation](const std::string& name) {
+                auto it = animation.nodeIdDictionaryAnimation.find(name);
+                return it == animation.nodeIdDictionaryAnimation.end() ? -1 : it->second;
+            });
+            //カーブから計算する時も、共通の祖先を1回だけ計算するようにする
+            BuildEvaluateOrder(out_binding, (int)animation.nodeList.size(), [&animation](int node_id) { return animation.nodeList[node_id].parent; });
+        }
+        return !out_binding->HasMissingBone();
+    }
+    //------------------------------------------------------------------------------------------
+    void BinaryFbxLoader::GetAnimationMeshMatrix(glm::mat4 *out_matrix, float frame, const ModelMesh& mesh, const SkeletonBinding& binding) const {
+        const auto& animation = this->mAnimationArray[binding.animIndex];
+        if (binding.useClip) {
+            GetClipMeshMatrix(out_matrix, animation.clip, frame, mesh, binding);
+            return;
+        }
+        if (binding.meshNodeId < 0) {
+            *out_matrix = glm::mat4(1.0);
+            return;
+        }
+        *out_matrix = animation.EvaluateGlobalTransform(binding.meshNodeId, (float)(long long)frame) * mesh.invMeshBaseposeMatrix;
+    }
+    //------------------------------------------------------------------------------------------
+    void BinaryFbxLoader::GetAnimationBoneMatrix(glm::mat4 *out_matrix_list, float frame, const ModelMesh& mesh, const SkeletonBinding& binding) const {
+        if (binding.boneSlotList.size() == 0) {
+            out_matrix_list[0] = glm::mat4(1.0);
+            return;
+        }
+        const auto& animation = this->mAnimationArray[binding.animIndex];
+        if (binding.useClip) {
+            GetClipBoneMatrix(out_matrix_list, animation.clip, frame, mesh, binding);
+            return;
+        }
+
+        thread_local std::vector<glm::mat4> pose;
+        size_t evaluate_count = binding.evaluateNodeList.size();
+        if (pose.size() < evaluate_count) {
+            pose.resize(evaluate_count);
+        }
+        float time = (float)(long long)frame;
+        for (size_t i = 0; i < evaluate_count; i++) {
+            glm::mat4 local = animation.EvaluateLocalTransform(binding.evaluateNodeList[i], time);
+            int parent = binding.evaluateParentList[i];
+            pose[i] = (parent >= 0) ? pose[parent] * local : local;
+        }
+        size_t size = binding.boneSlotList.size();
+        for (size_t i = 0; i < size; ++i) {
+            int slot = binding.boneSlotList[i];
+            out_matrix_list[i] = (slot < 0) ? glm::mat4(1.0) : pose[slot] * mesh.invBoneBaseposeMatrixList[i];
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    void BinaryFbxLoader::GetAnimationPose(glm::mat4 *out_palette, glm::mat4 *out_global_list, float frame, const ModelMesh& mesh, const SkeletonBinding& binding) const {
+        const auto& animation = this->mAnimationArray[binding.animIndex];
+        if (binding.useClip) {
+            EvaluateSkeletonPose(out_palette, out_global_list, mesh.skeleton, binding, [&animation, frame](int node_id) {
+                return animation.clip.EvaluateLocalMatrix(node_id, frame);
+            });
+            return;
+        }
+        float time = (float)(long long)frame;
+        EvaluateSkeletonPose(out_palette, out_global_list, mesh.skeleton, binding, [&animation, time](int node_id) {
+            return animation.EvaluateLocalTransform(node_id, time);
+        });
+    }
+    //------------------------------------------------------------------------------------------
+    bool BinaryFbxLoader::CreateSkeletonBindingList(std::vector<SkeletonBinding>* out_binding_list, const ModelMesh& mesh) const {
+        bool result = true;
+        out_binding_list->resize(this->mAnimationArray.size());
+        for (int i = 0; i < (int)this->mAnimationArray.size(); i++) {
+            result &= this->CreateSkeletonBinding(&(*out_binding_list)[i], mesh, i);
+        }
+        return result;
+    }
+    //------------------------------------------------------------------------------------------
+    void BinaryFbxLoader::GetAnimationPoseBatch(glm::mat4 *out_palette_list, const ModelMesh& mesh, const std::vector<SkeletonBinding>& binding_list,
+        const PoseRequest* request_list, size_t request_count, ThreadPool* thread_pool) const {
+        size_t palette_size = std::max<size_t>(mesh.boneNodeNameList.size(), 1);
+        EvaluatePoseBatch(out_palette_list, palette_size, request_list, request_count, thread_pool, [&](const PoseRequest& request, glm::mat4* out_palette) {
+            if (mesh.boneNodeNameList.empty()) {
+                out_palette[0] = glm::mat4(1.0);
+                return;
+            }
+            this->GetAnimationPose(out_palette, nullptr, request.frame, mesh, binding_list[request.animIndex]);
+        });
+    }
+    //------------------------------------------------------------------------------------------
+    //ComputePoseBoundsに渡すパレット。ボーンが無ければメッシュの行列
+    void BinaryFbxLoader::EvaluateBoundsPalette(glm::mat4 *out_palette, float frame, const ModelMesh& mesh, const SkeletonBinding& binding) const {
+        if (mesh.boneNodeNameList.empty()) {
+            this->GetAnimationMeshMatrix(out_palette, frame, mesh, binding);
+            return;
+        }
+        this->GetAnimationPose(out_palette, nullptr, frame, mesh, binding);
+    }
+    //------------------------------------------------------------------------------------------
+    void BinaryFbxLoader::BuildAnimationBoundsList(int anim_index) {
+        auto& animation = this->mAnimationArray[anim_index];
+        animation.meshBoundsList.resize(this->mMeshList.size());
+        for (size_t i = 0; i < this->mMeshList.size(); i++) {
+            const auto& mesh = this->mMeshList[i];
+            SkeletonBinding binding;
+            this->CreateSkeletonBinding(&binding, mesh, anim_index);
+            auto evaluate_palette = [&](float frame, glm::mat4* out_palette) {
+                this->EvaluateBoundsPalette(out_palette, frame, mesh, binding);
+            };
+            BuildAnimationBounds(&animation.meshBoundsList[i], mesh, animation.GetAnimationStartFrame(), animation.GetAnimationEndFrame(),
+                this->mBoundsOption, evaluate_palette);
+        }
+        FBX_LOG("animation bounds: %d meshes x %d segments\n", (int)this->mMeshList.size(),
+            this->mMeshList.empty() ? 0 : (int)animation.meshBoundsList[0].segmentBoundsList.size());
+    }
+    //------------------------------------------------------------------------------------------
+    void BinaryFbxLoader::GetAnimationBounds(ModelBounds* out_bounds, float frame, int mesh_id, int anim_index) const {
+        const auto& animation = this->mAnimationArray[anim_index];
+        if (mesh_id < (int)animation.meshBoundsList.size() && fbx::GetAnimationBounds(out_bounds, animation.meshBoundsList[mesh_id], frame)) {
+            return;
+        }
+        //表が無い(オプションが無効か、後から足したメッシュ)ので姿勢を求める
+        const auto& mesh = this->mMeshList[mesh_id];
+        SkeletonBinding binding;
+        this->CreateSkeletonBinding(&binding, mesh, anim_index);
+        thread_local std::vector<glm::mat4> palette;
+        palette.resize(std::max<size_t>(mesh.boneNodeNameList.size(), 1));
+        this->EvaluateBoundsPalette(palette.data(), frame, mesh, binding);
+        ComputePoseBounds(out_bounds, mesh, palette.data());
+    }
+    //------------------------------------------------------------------------------------------
+    void BinaryFbxLoader::GetAnimationBlendShapeWeight(float* out_weight_list, float frame, const ModelMesh& mesh, int anim_index) const {
+        EvaluateBlendShapeWeights(out_weight_list, frame, mesh, this->mAnimationArray[anim_index].blendShapeCurveList);
+    }
+    //------------------------------------------------------------------------------------------
+} // binary
+} // fbx
@@ -0,0 +1,52 @@
+﻿#include "../include/geometry_arena.h"
+
+#include <cstring>
+
+namespace fbx {
+
+    namespace {
+        const size_t kGeometryAlignment = 16;
+
+        //------------------------------------------------------------------------------------------
+        inline size_t AlignSize(size_t size) {
+            return (size + kGeometryAlignment - 1) / kGeometryAlignment * kGeometryAlignment;
+        }
+        //------------------------------------------------------------------------------------------
+        //cursorに写してビューを張り、元のリストは容量ごと捨てる。空のリスト(詰め直し済みを含む)はそのまま
+        template<class T>
+        void MoveToBlock(Span<T>* out_span, uint8_t** cursor, std::vector<T>* list) {
+            if (list->empty()) {
+                return;
+            }
+            T* data = reinterpret_cast<T*>(*cursor);
+            std::memcpy(data, list->data(), sizeof(T) * list->size());
+            *out_span = Span<T>(data, list->size());
+            *cursor += AlignSize(sizeof(T) * list->size());
+            std::vector<T>().swap(*list);
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    size_t PackMeshGeometry(LinearArena* arena, ModelMesh* mesh_list, size_t mesh_count) {
+        //先に合計を求めて1回で確保する
+        size_t total = 0;
+        for (size_t i = 0; i < mesh_count; i++) {
+            const auto& mesh = mesh_list[i];
+            total += AlignSize(sizeof(ModelVertex) * mesh.vertexList.size());
+            total += AlignSize(sizeof(unsigned short) * mesh.indexList.size());
+            total += AlignSize(sizeof(unsigned int) * mesh.indexList32.size());
+        }
+        if (total == 0) {
+            return 0;
+        }
+        uint8_t* cursor = static_cast<uint8_t*>(arena->Allocate(total, kGeometryAlignment));
+        for (size_t i = 0; i < mesh_count; i++) {
+            auto& mesh = mesh_list[i];
+            MoveToBlock(&mesh.packedVertexList, &cursor, &mesh.vertexList);
+            MoveToBlock(&mesh.packedIndexList, &cursor, &mesh.indexList);
+            MoveToBlock(&mesh.packedIndexList32, &cursor, &mesh.indexList32);
+        }
+        return total;
+    }
+    //------------------------------------------------------------------------------------------
+} // fbx
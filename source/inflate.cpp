@@ -0,0 +1,311 @@
+﻿#include "../include/fbx_binary.h"
+
+//zlibに依存しないように、FBXの圧縮配列を展開するためだけの最小限のinflate
+//(RFC1950/1951。構成はzlib付属のpuff.cを参考にしている)
+namespace fbx {
+namespace binary {
+
+    namespace {
+        const int kMaxBits = 15;
+        const int kMaxLengthCodes = 286;
+        const int kMaxDistanceCodes = 30;
+        const int kFixedLengthCodes = 288;
+
+        struct InflateState {
+            const uint8_t* src;
+            size_t srcSize;
+            size_t srcPos;
+            uint8_t* dst;
+            size_t dstSize;
+            size_t dstPos;
+            uint32_t bitBuffer;
+            int bitCount;
+            bool error;
+        };
+
+        struct Huffman {
+            short count[kMaxBits + 1];
+            short symbol[kFixedLengthCodes];
+        };
+
+        int GetBits(InflateState* s, int need) {
+            uint32_t value = s->bitBuffer;
+            while (s->bitCount < need) {
+                if (s->srcPos >= s->srcSize) {
+                    s->error = true;
+                    return 0;
+                }
+                value |= (uint32_t)s->src[s->srcPos++] << s->bitCount;
+                s->bitCount += 8;
+            }
+            s->bitBuffer = value >> need;
+            s->bitCount -= need;
+            return (int)(value & ((1u << need) - 1));
+        }
+
+        bool Stored(InflateState* s) {
+            s->bitBuffer = 0;
+            s->bitCount = 0;
+            if (s->srcPos + 4 > s->srcSize) {
+                return false;
+            }
+            uint32_t length = s->src[s->srcPos] | (s->src[s->srcPos + 1] << 8);
+            uint32_t inverse = s->src[s->srcPos + 2] | (s->src[s->srcPos + 3] << 8);
+            s->srcPos += 4;
+            if (length != (~inverse & 0xffff)) {
+                return false;
+            }
+            if (s->srcPos + length > s->srcSize || s->dstPos + length > s->dstSize) {
+                return false;
+            }
+            std::memcpy(s->dst + s->dstPos, s->src + s->srcPos, length);
+            s->srcPos += length;
+            s->dstPos += length;
+            return true;
+        }
+
+        //符号長の表からカノニカルハフマン符号を作る。負なら過剰な符号
+        int Construct(Huffman* h, const short* length, int n) {
+            for (int len = 0; len <= kMaxBits; len++) {
+                h->count[len] = 0;
+            }
+            for (int symbol = 0; symbol < n; symbol++) {
+                h->count[length[symbol]]++;
+            }
+            if (h->count[0] == n) {
+                return 0;
+            }
+            int left = 1;
+            for (int len = 1; len <= kMaxBits; len++) {
+                left <<= 1;
+                left -= h->count[len];
+                if (left < 0) {
+                    return left;
+                }
+            }
+            short offset[kMaxBits + 1];
+            offset[1] = 0;
+            for (int len = 1; len < kMaxBits; len++) {
+                offset[len + 1] = offset[len] + h->count[len];
+            }
+            for (int symbol = 0; symbol < n; symbol++) {
+                if (length[symbol] != 0) {
+                    h->symbol[offset[length[symbol]]++] = (short)symbol;
+                }
+            }
+            return left;
+        }
+
+        int Decode(InflateState* s, const Huffman* h) {
+            int code = 0;
+            int first = 0;
+            int index = 0;
+            for (int len = 1; len <= kMaxBits; len++) {
+                code |= GetBits(s, 1);
+                int count = h->count[len];
+                if (code - count < first) {
+                    return h->symbol[index + (code - first)];
+                }
+                index += count;
+                first += count;
+                first <<= 1;
+                code <<= 1;
+            }
+            s->error = true;
+            return -1;
+        }
+
+        bool Codes(InflateState* s, const Huffman* length_code, const Huffman* distance_code) {
+            static const short kLengthBase[29] = {
+                3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+            static const short kLengthExtra[29] = {
+                0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+            static const short kDistanceBase[30] = {
+                1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                8193, 12289, 16385, 24577 };
+            static const short kDistanceExtra[30] = {
+                0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+            for (;;) {
+                int symbol = Decode(s, length_code);
+                if (s->error || symbol < 0) {
+                    return false;
+                }
+                if (symbol < 256) {
+                    if (s->dstPos >= s->dstSize) {
+                        return false;
+                    }
+                    s->dst[s->dstPos++] = (uint8_t)symbol;
+                }
+                else if (symbol == 256) {
+                    return true;
+                }
+                else {
+                    symbol -= 257;
+                    if (symbol >= 29) {
+                        return false;
+                    }
+                    size_t length = kLengthBase[symbol] + GetBits(s, kLengthExtra[symbol]);
+                    symbol = Decode(s, distance_code);
+                    if (s->error || symbol < 0 || symbol >= 30) {
+                        return false;
+                    }
+                    size_t distance = kDistanceBase[symbol] + GetBits(s, kDistanceExtra[symbol]);
+                    if (s->error || distance > s->dstPos || s->dstPos + length > s->dstSize) {
+                        return false;
+                    }
+                    //重なる場合があるので1バイトずつコピーする
+                    uint8_t* to = s->dst + s->dstPos;
+                    const uint8_t* from = to - distance;
+                    for (size_t i = 0; i < length; i++) {
+                        to[i] = from[i];
+                    }
+                    s->dstPos += length;
+                }
+            }
+        }
+
+        //固定ハフマン符号の表。static変数の初期化はスレッドセーフなので一度だけ作られる
+        struct FixedTable {
+            Huffman lengthCode;
+            Huffman distanceCode;
+
+            FixedTable() {
+                short length[kFixedLengthCodes];
+                int symbol = 0;
+                for (; symbol < 144; symbol++) length[symbol] = 8;
+                for (; symbol < 256; symbol++) length[symbol] = 9;
+                for (; symbol < 280; symbol++) length[symbol] = 7;
+                for (; symbol < kFixedLengthCodes; symbol++) length[symbol] = 8;
+                Construct(&lengthCode, length, kFixedLengthCodes);
+                for (symbol = 0; symbol < kMaxDistanceCodes; symbol++) length[symbol] = 5;
+                Construct(&distanceCode, length, kMaxDistanceCodes);
+            }
+        };
+
+        bool Fixed(InflateState* s) {
+            static const FixedTable table;
+            return Codes(s, &table.lengthCode, &table.distanceCode);
+        }
+
+        bool Dynamic(InflateState* s) {
+            static const short kOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+            int length_count = GetBits(s, 5) + 257;
+            int distance_count = GetBits(s, 5) + 1;
+            int code_count = GetBits(s, 4) + 4;
+            if (s->error || length_count > kMaxLengthCodes || distance_count > kMaxDistanceCodes) {
+                return false;
+            }
+
+            short length[kMaxLengthCodes + kMaxDistanceCodes];
+            int index = 0;
+            for (; index < code_count; index++) {
+                length[kOrder[index]] = (short)GetBits(s, 3);
+            }
+            for (; index < 19; index++) {
+                length[kOrder[index]] = 0;
+            }
+            Huffman length_code;
+            Huffman distance_code;
+            if (Construct(&length_code, length, 19) != 0) {
+                return false;
+            }
+
+            index = 0;
+            while (index < length_count + distance_count) {
+                int symbol = Decode(s, &length_code);
+                if (s->error || symbol < 0) {
+                    return false;
+                }
+                if (symbol < 16) {
+                    length[index++] = (short)symbol;
+                    continue;
+                }
+                short repeat_length = 0;
+                if (symbol == 16) {
+                    if (index == 0) {
+                        return false;
+                    }
+                    repeat_length = length[index - 1];
+                    symbol = 3 + GetBits(s, 2);
+                }
+                else if (symbol == 17) {
+                    symbol = 3 + GetBits(s, 3);
+                }
+                else {
+                    symbol = 11 + GetBits(s, 7);
+                }
+                if (index + symbol > length_count + distance_count) {
+                    return false;
+                }
+                while (symbol--) {
+                    length[index++] = repeat_length;
+                }
+            }
+            if (length[256] == 0) {
+                return false;
+            }
+
+            int err = Construct(&length_code, length, length_count);
+            if (err < 0 || (err > 0 && length_count - length_code.count[0] != 1)) {
+                return false;
+            }
+            err = Construct(&distance_code, length + length_count, distance_count);
+            if (err < 0 || (err > 0 && distance_count - distance_code.count[0] != 1)) {
+                return false;
+            }
+            return Codes(s, &length_code, &distance_code);
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    bool Inflate(const uint8_t* src, size_t src_size, uint8_t* dst, size_t dst_size) {
+        //zlibのヘッダ(CMF,FLG)。辞書付きは扱わない
+        if (src_size < 2 || (src[0] & 0x0f) != 8 || ((src[0] << 8) | src[1]) % 31 != 0 || (src[1] & 0x20)) {
+            return false;
+        }
+
+        InflateState s;
+        s.src = src;
+        s.srcSize = src_size;
+        s.srcPos = 2;
+        s.dst = dst;
+        s.dstSize = dst_size;
+        s.dstPos = 0;
+        s.bitBuffer = 0;
+        s.bitCount = 0;
+        s.error = false;
+
+        int last;
+        do {
+            last = GetBits(&s, 1);
+            int type = GetBits(&s, 2);
+            if (s.error) {
+                return false;
+            }
+            bool ok = false;
+            if (type == 0) {
+                ok = Stored(&s);
+            }
+            else if (type == 1) {
+                ok = Fixed(&s);
+            }
+            else if (type == 2) {
+                ok = Dynamic(&s);
+            }
+            if (!ok || s.error) {
+                return false;
+            }
+        } while (!last);
+
+        //Adler-32はチェックしない(FBX側で長さが分かっているので長さだけ確認する)
+        return s.dstPos == dst_size;
+    }
+    //------------------------------------------------------------------------------------------
+} // binary
+} // fbx
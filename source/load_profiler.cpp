@@ -0,0 +1,137 @@
+﻿#include "../include/load_profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace fbx {
+
+    //-- LoadProfiler Class --//
+    LoadProfiler::LoadProfiler() {
+        this->Clear();
+    }
+    //------------------------------------------------------------------------------------------
+    void LoadProfiler::Clear() {
+        std::lock_guard<std::mutex> lock(this->mMutex);
+        this->mOrigin = std::chrono::steady_clock::now();
+        for (auto& counter : this->mCounter) {
+            counter.store(0);
+        }
+        this->mEventList.clear();
+        this->mThreadList.clear();
+    }
+    //------------------------------------------------------------------------------------------
+    void LoadProfiler::AddEvent(const char* name, double begin_us, double end_us) {
+        std::thread::id id = std::this_thread::get_id();
+        std::lock_guard<std::mutex> lock(this->mMutex);
+        //スレッドは数個なので線形に探す
+        auto it = std::find(this->mThreadList.begin(), this->mThreadList.end(), id);
+        int thread = (int)(it - this->mThreadList.begin());
+        if (it == this->mThreadList.end()) {
+            this->mThreadList.push_back(id);
+        }
+        this->mEventList.push_back({ name, thread, begin_us, end_us - begin_us });
+    }
+    //------------------------------------------------------------------------------------------
+    std::vector<LoadProfiler::Event> LoadProfiler::GetEventList() const {
+        std::lock_guard<std::mutex> lock(this->mMutex);
+        return this->mEventList;
+    }
+    //------------------------------------------------------------------------------------------
+    double LoadProfiler::GetPhaseTime(const char* name) const {
+        std::lock_guard<std::mutex> lock(this->mMutex);
+        double total_us = 0.0;
+        for (const auto& event : this->mEventList) {
+            if (std::strcmp(event.name, name) == 0) {
+                total_us += event.durationUs;
+            }
+        }
+        return total_us / 1000.0;
+    }
+    //------------------------------------------------------------------------------------------
+    const char* LoadProfiler::GetCounterName(LoadCounter counter) {
+        switch (counter) {
+        case kCounterMesh: return "mesh";
+        case kCounterMaterial: return "material";
+        case kCounterVertexBeforeWeld: return "vertex before weld";
+        case kCounterVertexAfterWeld: return "vertex after weld";
+        case kCounterIndex: return "index";
+        case kCounterMeshBytes: return "mesh bytes";
+        case kCounterSkinCluster: return "skin cluster";
+        case kCounterAnimationNode: return "animation node";
+        case kCounterTransformBeforeOptimize: return "transform before optimize";
+        case kCounterTransformAfterOptimize: return "transform after optimize";
+        case kCounterLodIndex: return "lod index";
+        case kCounterMeshlet: return "meshlet";
+        case kCounterArenaBytes: return "arena bytes";
+        case kCounterInstance: return "instance";
+        default: return "unknown";
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    void LoadProfiler::PrintSummary() const {
+        //最初に現れた順に名前ごとにまとめる
+        struct Phase {
+            const char* name;
+            int count;
+            double totalUs;
+        };
+        std::vector<Phase> phase_list;
+        for (const auto& event : this->GetEventList()) {
+            auto it = std::find_if(phase_list.begin(), phase_list.end(), [&event](const Phase& phase) { return std::strcmp(phase.name, event.name) == 0; });
+            if (it == phase_list.end()) {
+                phase_list.push_back({ event.name, 0, 0.0 });
+                it = phase_list.end() - 1;
+            }
+            it->count++;
+            it->totalUs += event.durationUs;
+        }
+        for (const auto& phase : phase_list) {
+            printf("  %-24s %10.3f ms  x%d\n", phase.name, phase.totalUs / 1000.0, phase.count);
+        }
+        for (int i = 0; i < kLoadCounterCount; i++) {
+            printf("  %-24s %lld\n", GetCounterName((LoadCounter)i), (long long)this->GetCounter((LoadCounter)i));
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    bool LoadProfiler::WriteChromeTrace(const char* filepath) const {
+        FILE* fp = fopen(filepath, "wb");
+        if (fp == nullptr) {
+            printf("profiler: cannot open [%s]\n", filepath);
+            return false;
+        }
+        auto write_name = [fp](const char* name) {
+            fputc('"', fp);
+            for (const char* c = name; *c != '\0'; c++) {
+                if (*c == '"' || *c == '\\') {
+                    fputc('\\', fp);
+                }
+                fputc(*c, fp);
+            }
+            fputc('"', fp);
+        };
+
+        //区間は"X"(開始と長さ)、カウンターは最後の時刻に"C"で書く
+        std::vector<Event> event_list = this->GetEventList();
+        double end_us = 0.0;
+        fprintf(fp, "{\"traceEvents\":[\n");
+        for (size_t i = 0; i < event_list.size(); i++) {
+            const auto& event = event_list[i];
+            fprintf(fp, "{\"name\":");
+            write_name(event.name);
+            fprintf(fp, ",\"cat\":\"load\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d},\n", event.beginUs, event.durationUs, event.thread);
+            end_us = std::max(end_us, event.beginUs + event.durationUs);
+        }
+        for (int i = 0; i < kLoadCounterCount; i++) {
+            fprintf(fp, "{\"name\":");
+            write_name(GetCounterName((LoadCounter)i));
+            fprintf(fp, ",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"args\":{\"value\":%lld}}%s\n", end_us, (long long)this->GetCounter((LoadCounter)i),
+                i + 1 < kLoadCounterCount ? "," : "");
+        }
+        fprintf(fp, "],\"displayTimeUnit\":\"ms\"}\n");
+        bool result = ferror(fp) == 0;
+        fclose(fp);
+        return result;
+    }
+    //------------------------------------------------------------------------------------------
+} // fbx
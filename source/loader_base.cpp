@@ -0,0 +1,144 @@
+﻿#include "../include/loader_base.h"
+
+#include <cstdio>
+
+namespace fbx {
+
+    //------------------------------------------------------------------------------------------
+    void FinishLoadedMesh(ModelMesh* model_mesh, const TangentOption& tangent_option, const LodOption& lod_option,
+        const OptimizeOption& optimize_option, const MeshletOption& meshlet_option, LoadProfiler* profiler) {
+        //FBX_DISABLE_PROFILERの時は使われない
+        (void)profiler;
+        if (tangent_option.enable) {
+            FBX_PROFILE_SCOPE(profiler, "tangent");
+            GenerateTangents(model_mesh);
+            FBX_LOG("Tangent: %d vertices\n", (int)model_mesh->tangentList.size());
+            FBX_PROFILE_COUNT(profiler, kCounterMeshBytes, GetTangentMemorySize(*model_mesh));
+        }
+        if (lod_option.enable) {
+            FBX_PROFILE_SCOPE(profiler, "lod");
+            GenerateLodList(model_mesh, lod_option);
+            FBX_LOG("LOD: %d levels, %d indices\n", (int)model_mesh->lodList.size(), (int)GetLodIndexCount(*model_mesh));
+            FBX_PROFILE_COUNT(profiler, kCounterLodIndex, GetLodIndexCount(*model_mesh));
+            FBX_PROFILE_COUNT(profiler, kCounterMeshBytes, GetLodIndexCount(*model_mesh) * (model_mesh->IsIndex32() ? sizeof(unsigned int) : sizeof(unsigned short)));
+        }
+        if (optimize_option.enable) {
+            FBX_PROFILE_SCOPE(profiler, "optimize");
+            OptimizeStat optimize_stat;
+            OptimizeMesh(model_mesh, optimize_option, &optimize_stat);
+            FBX_LOG("ACMR: %.3f -> %.3f, ATVR: %.3f -> %.3f (%.3f ms)\n", optimize_stat.before.acmr, optimize_stat.after.acmr,
+                optimize_stat.before.atvr, optimize_stat.after.atvr, optimize_stat.timeMs);
+            FBX_PROFILE_COUNT(profiler, kCounterTransformBeforeOptimize, optimize_stat.before.transformCount);
+            FBX_PROFILE_COUNT(profiler, kCounterTransformAfterOptimize, optimize_stat.after.transformCount);
+        }
+        if (meshlet_option.enable) {
+            FBX_PROFILE_SCOPE(profiler, "meshlet");
+            BuildMeshlets(model_mesh, meshlet_option);
+            FBX_LOG("Meshlet: %d\n", (int)model_mesh->meshletList.size());
+            FBX_PROFILE_COUNT(profiler, kCounterMeshlet, model_mesh->meshletList.size());
+            FBX_PROFILE_COUNT(profiler, kCounterMeshBytes, model_mesh->meshletList.size() * sizeof(ModelMeshlet)
+                + model_mesh->meshletVertexList.size() * sizeof(unsigned int) + model_mesh->meshletTriangleList.size());
+        }
+        {
+            FBX_PROFILE_SCOPE(profiler, "bounds");
+            ComputeMeshBounds(model_mesh);
+        }
+        FBX_PROFILE_COUNT(profiler, kCounterVertexAfterWeld, model_mesh->vertexList.size());
+        FBX_PROFILE_COUNT(profiler, kCounterIndex, model_mesh->indexList.size() + model_mesh->indexList32.size());
+        FBX_PROFILE_COUNT(profiler, kCounterMeshBytes, model_mesh->vertexList.size() * sizeof(ModelVertex)
+            + model_mesh->indexList.size() * sizeof(model_mesh->indexList[0]) + model_mesh->indexList32.size() * sizeof(model_mesh->indexList32[0]));
+    }
+
+    //-- LoaderBase Class --//
+    LoaderBase::LoaderBase() {
+        mMaterialNum = 0;
+        mLoadListener = nullptr;
+    }
+    //------------------------------------------------------------------------------------------
+    bool LoaderBase::ReadCache(const char* filepath, const void* content, size_t content_size, AssetCacheLoader loader,
+        size_t mesh_offset, size_t material_offset, size_t instance_offset, std::string* out_cache_path, AssetCacheKey* out_cache_key) {
+        out_cache_path->clear();
+        if (!this->mCacheOption.enable || content == nullptr) {
+            return false;
+        }
+        //FBX_DISABLE_PROFILERの時は使われない
+        (void)instance_offset;
+        *out_cache_key = MakeAssetCacheKey(content, content_size, loader, this->mWeldOption, this->mOptimizeOption, this->mLodOption, this->mMeshletOption, this->mTangentOption, this->mInstanceOption);
+        *out_cache_path = GetAssetCachePath(filepath, this->mCacheOption);
+        if (out_cache_path->empty()) {
+            return false;
+        }
+        {
+            FBX_PROFILE_SCOPE(&this->mProfiler, "cache read");
+            if (!LoadAssetCache(out_cache_path->c_str(), *out_cache_key, &this->mMeshList, &this->mMaterialList, &this->mInstanceList)) {
+                return false;
+            }
+        }
+        FBX_LOG("cache hit: %s\n", out_cache_path->c_str());
+        FBX_PROFILE_COUNT(&this->mProfiler, kCounterMesh, this->mMeshList.size() - mesh_offset);
+        FBX_PROFILE_COUNT(&this->mProfiler, kCounterInstance, this->mInstanceList.size() - instance_offset);
+        FBX_PROFILE_COUNT(&this->mProfiler, kCounterMaterial, this->mMaterialList.size() - material_offset);
+        this->RegisterMaterialList(material_offset);
+        for (size_t i = material_offset; i < this->mMaterialList.size(); i++) {
+            this->NotifyMaterial(i);
+        }
+        for (size_t i = mesh_offset; i < this->mMeshList.size(); i++) {
+            this->NotifyMesh(i);
+        }
+        this->PackGeometry(mesh_offset, this->mMeshList.size() - mesh_offset);
+        return true;
+    }
+    //------------------------------------------------------------------------------------------
+    void LoaderBase::WriteCache(const std::string& cache_path, const AssetCacheKey& cache_key, size_t mesh_offset, size_t material_offset, size_t instance_offset) {
+        if (cache_path.empty()) {
+            return;
+        }
+        FBX_PROFILE_SCOPE(&this->mProfiler, "cache write");
+        SaveAssetCache(cache_path.c_str(), cache_key, this->mMeshList.data() + mesh_offset, this->mMeshList.size() - mesh_offset,
+            this->mMaterialList.data() + material_offset, this->mMaterialList.size() - material_offset,
+            this->mInstanceList.data() + instance_offset, this->mInstanceList.size() - instance_offset, (int)mesh_offset);
+    }
+    //------------------------------------------------------------------------------------------
+    //キャッシュから読んだマテリアルを辞書に登録する(ParseMaterialと同じく先に登録した方が優先)
+    void LoaderBase::RegisterMaterialList(size_t material_offset) {
+        for (size_t i = material_offset; i < this->mMaterialList.size(); i++) {
+            this->mMaterialIdDictionary.insert({ this->mMaterialList[i].materialName, mMaterialNum });
+            mMaterialNum++;
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    void LoaderBase::NotifyMesh(size_t index) {
+        if (this->mLoadListener != nullptr && this->mLoadListener->onMesh) {
+            this->mLoadListener->onMesh(index, this->mMeshList[index]);
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    void LoaderBase::NotifyMaterial(size_t index) {
+        if (this->mLoadListener != nullptr && this->mLoadListener->onMaterial) {
+            this->mLoadListener->onMaterial(index, this->mMaterialList[index]);
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    //読み込んだメッシュの頂点とインデックスをアリーナの1つのブロックに移す
+    void LoaderBase::PackGeometry(size_t mesh_offset, size_t mesh_count) {
+        if (!this->mArenaOption.enable || mesh_count == 0) {
+            return;
+        }
+        FBX_PROFILE_SCOPE(&this->mProfiler, "arena");
+        size_t packed_bytes = PackMeshGeometry(&this->mGeometryArena, this->mMeshList.data() + mesh_offset, mesh_count);
+        if (packed_bytes == 0) {
+            return;
+        }
+        FBX_PROFILE_COUNT(&this->mProfiler, kCounterArenaBytes, packed_bytes);
+        FBX_LOG("arena: %d bytes\n", (int)packed_bytes);
+    }
+    //------------------------------------------------------------------------------------------
+    void LoaderBase::ClearLoadedData() {
+        this->mMeshList.clear();
+        this->mMaterialList.clear();
+        this->mInstanceList.clear();
+        this->mMaterialIdDictionary.clear();
+        this->mMaterialNum = 0;
+        this->mGeometryArena.Reset();
+    }
+}
@@ -0,0 +1,200 @@
+﻿#include "../include/mesh_bounds.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace fbx {
+
+    namespace {
+        //ウェイトの合計を1とみなす誤差
+        const float kWeightSumEpsilon = 1e-3f;
+
+        //------------------------------------------------------------------------------------------
+        //球の中心は箱の中心にして、半径は一番遠い点までの距離にする
+        void FitSphereRadius(ModelBounds* bounds, const glm::vec3& point) {
+            bounds->radius = std::max(bounds->radius, glm::length(point - bounds->center));
+        }
+        //------------------------------------------------------------------------------------------
+        //ボーンの空間からパレットの空間への行列(palette * バインドポーズ)で、ボーンごとの範囲を移して合わせる
+        void MergePoseBounds(ModelBounds* out_bounds, const ModelMesh& mesh, const glm::mat4* palette, const glm::mat4* bind_pose_list) {
+            *out_bounds = ModelBounds();
+            if (mesh.boneBoundsList.empty()) {
+                *out_bounds = TransformBounds(mesh.bounds, palette[0]);
+                return;
+            }
+            //スキニング後の頂点はボーンごとに移した点の重み付き平均なので、移した範囲の和に入る
+            for (size_t i = 0; i < mesh.boneBoundsList.size(); i++) {
+                if (mesh.boneBoundsList[i].IsEmpty()) {
+                    continue;
+                }
+                MergeBounds(out_bounds, TransformBounds(mesh.boneBoundsList[i], palette[i] * bind_pose_list[i]));
+            }
+            if (mesh.partialWeight) {
+                ExtendBounds(out_bounds, glm::vec3(0.0f));
+            }
+            UpdateBoundsSphere(out_bounds);
+        }
+        //------------------------------------------------------------------------------------------
+        std::vector<glm::mat4> GetBindPoseList(const ModelMesh& mesh) {
+            std::vector<glm::mat4> bind_pose_list(mesh.invBoneBaseposeMatrixList.size());
+            for (size_t i = 0; i < bind_pose_list.size(); i++) {
+                bind_pose_list[i] = glm::inverse(mesh.invBoneBaseposeMatrixList[i]);
+            }
+            return bind_pose_list;
+        }
+        //------------------------------------------------------------------------------------------
+        void PadBounds(ModelBounds* bounds, float padding) {
+            if (bounds->IsEmpty() || padding <= 0.0f) {
+                return;
+            }
+            glm::vec3 margin(glm::length(bounds->max - bounds->min) * padding);
+            bounds->min -= margin;
+            bounds->max += margin;
+            UpdateBoundsSphere(bounds);
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    void ExtendBounds(ModelBounds* bounds, const glm::vec3& point) {
+        bounds->min = glm::min(bounds->min, point);
+        bounds->max = glm::max(bounds->max, point);
+    }
+    //------------------------------------------------------------------------------------------
+    void MergeBounds(ModelBounds* bounds, const ModelBounds& other) {
+        if (other.IsEmpty()) {
+            return;
+        }
+        bounds->min = glm::min(bounds->min, other.min);
+        bounds->max = glm::max(bounds->max, other.max);
+    }
+    //------------------------------------------------------------------------------------------
+    void UpdateBoundsSphere(ModelBounds* bounds) {
+        if (bounds->IsEmpty()) {
+            bounds->center = glm::vec3(0.0f);
+            bounds->radius = 0.0f;
+            return;
+        }
+        bounds->center = (bounds->min + bounds->max) * 0.5f;
+        bounds->radius = glm::length(bounds->max - bounds->min) * 0.5f;
+    }
+    //------------------------------------------------------------------------------------------
+    ModelBounds TransformBounds(const ModelBounds& bounds, const glm::mat4& matrix) {
+        ModelBounds result;
+        if (bounds.IsEmpty()) {
+            return result;
+        }
+        //中心を移し、半分の大きさは行列の絶対値で広げる(8つの角を移すのと同じ箱になる)
+        glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+        glm::vec3 extent = (bounds.max - bounds.min) * 0.5f;
+        glm::vec3 new_center = glm::vec3(matrix * glm::vec4(center, 1.0f));
+        glm::vec3 new_extent;
+        for (int row = 0; row < 3; row++) {
+            new_extent[row] = std::fabs(matrix[0][row]) * extent.x + std::fabs(matrix[1][row]) * extent.y + std::fabs(matrix[2][row]) * extent.z;
+        }
+        result.min = new_center - new_extent;
+        result.max = new_center + new_extent;
+        UpdateBoundsSphere(&result);
+        return result;
+    }
+    //------------------------------------------------------------------------------------------
+    void ComputeMeshBounds(ModelMesh* mesh) {
+        size_t bone_count = mesh->invBoneBaseposeMatrixList.size();
+        mesh->bounds = ModelBounds();
+        mesh->boneBoundsList.assign(bone_count, ModelBounds());
+        mesh->partialWeight = false;
+
+        //1回目で箱、2回目で箱の中心からの球の半径を求める
+        auto for_each_influence = [mesh, bone_count](const ModelVertex& vertex, auto func) {
+            for (int j = 0; j < 4; j++) {
+                if (vertex.boneWeight[j] > 0.0f && vertex.boneIndex[j] < bone_count) {
+                    int bone = vertex.boneIndex[j];
+                    func(bone, glm::vec3(mesh->invBoneBaseposeMatrixList[bone] * glm::vec4(vertex.position, 1.0f)));
+                }
+            }
+        };
+        for (const auto& vertex : mesh->GetVertexSpan()) {
+            ExtendBounds(&mesh->bounds, vertex.position);
+            if (bone_count == 0) {
+                continue;
+            }
+            for_each_influence(vertex, [mesh](int bone, const glm::vec3& position) {
+                ExtendBounds(&mesh->boneBoundsList[bone], position);
+            });
+            float weight_sum = vertex.boneWeight[0] + vertex.boneWeight[1] + vertex.boneWeight[2] + vertex.boneWeight[3];
+            if (std::fabs(weight_sum - 1.0f) > kWeightSumEpsilon) {
+                mesh->partialWeight = true;
+            }
+        }
+        UpdateBoundsSphere(&mesh->bounds);
+        mesh->bounds.radius = 0.0f;
+        for (auto& bone_bounds : mesh->boneBoundsList) {
+            UpdateBoundsSphere(&bone_bounds);
+            bone_bounds.radius = 0.0f;
+        }
+        for (const auto& vertex : mesh->GetVertexSpan()) {
+            FitSphereRadius(&mesh->bounds, vertex.position);
+            for_each_influence(vertex, [mesh](int bone, const glm::vec3& position) {
+                FitSphereRadius(&mesh->boneBoundsList[bone], position);
+            });
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    void ComputePoseBounds(ModelBounds* out_bounds, const ModelMesh& mesh, const glm::mat4* palette) {
+        //バインドポーズは呼ぶたびに逆行列を求める。毎フレーム呼ぶならBuildAnimationBoundsで表を作っておく
+        thread_local std::vector<glm::mat4> bind_pose_list;
+        bind_pose_list = GetBindPoseList(mesh);
+        MergePoseBounds(out_bounds, mesh, palette, bind_pose_list.data());
+    }
+    //------------------------------------------------------------------------------------------
+    void BuildAnimationBounds(AnimationBounds* out_bounds, const ModelMesh& mesh, float start_frame, float end_frame, const BoundsOption& option,
+        const std::function<void(float, glm::mat4*)>& evaluate_palette) {
+        float segment_length = std::max(option.segmentLength, 1e-3f);
+        float sample_step = std::max(std::min(option.sampleStep, segment_length), 1e-3f);
+        float length = std::max(end_frame - start_frame, 0.0f);
+        size_t segment_count = std::max<size_t>((size_t)std::ceil(length / segment_length), 1);
+
+        out_bounds->startFrame = start_frame;
+        out_bounds->segmentLength = segment_length;
+        out_bounds->segmentBoundsList.assign(segment_count, ModelBounds());
+        out_bounds->total = ModelBounds();
+
+        std::vector<glm::mat4> bind_pose_list = GetBindPoseList(mesh);
+        std::vector<glm::mat4> palette(std::max<size_t>(mesh.invBoneBaseposeMatrixList.size(), 1));
+        auto sample = [&](float frame) {
+            ModelBounds pose_bounds;
+            evaluate_palette(frame, palette.data());
+            MergePoseBounds(&pose_bounds, mesh, palette.data(), bind_pose_list.data());
+            return pose_bounds;
+        };
+
+        //区間の終わりは次の区間の始まりなので、1回だけ求めて両方に入れる
+        ModelBounds boundary = sample(start_frame);
+        for (size_t i = 0; i < segment_count; i++) {
+            float segment_start = start_frame + i * segment_length;
+            float segment_end = std::min(segment_start + segment_length, start_frame + length);
+            auto& segment = out_bounds->segmentBoundsList[i];
+            MergeBounds(&segment, boundary);
+            for (float frame = segment_start + sample_step; frame < segment_end - 1e-3f; frame += sample_step) {
+                MergeBounds(&segment, sample(frame));
+            }
+            if (segment_end > segment_start) {
+                boundary = sample(segment_end);
+                MergeBounds(&segment, boundary);
+            }
+            PadBounds(&segment, option.padding);
+            MergeBounds(&out_bounds->total, segment);
+        }
+        UpdateBoundsSphere(&out_bounds->total);
+    }
+    //------------------------------------------------------------------------------------------
+    bool GetAnimationBounds(ModelBounds* out_bounds, const AnimationBounds& bounds, float frame) {
+        if (bounds.IsEmpty()) {
+            return false;
+        }
+        float position = std::floor((frame - bounds.startFrame) / bounds.segmentLength);
+        size_t segment = position <= 0.0f ? 0 : std::min((size_t)position, bounds.segmentBoundsList.size() - 1);
+        *out_bounds = bounds.segmentBoundsList[segment];
+        return true;
+    }
+    //------------------------------------------------------------------------------------------
+} // fbx
@@ -0,0 +1,57 @@
+﻿#include "../include/mesh_instance.h"
+#include "../include/asset_cache.h"
+
+namespace fbx {
+
+    namespace {
+        //要素数も混ぜて、配列の区切りが違えば別のハッシュになるようにする
+        template<class T>
+        uint64_t HashArray(const T* data, size_t count, uint64_t seed) {
+            uint64_t size = count;
+            seed = HashBytes(&size, sizeof(size), seed);
+            return HashBytes(data, count * sizeof(T), seed);
+        }
+
+        uint64_t HashString(const std::string& text, uint64_t seed) {
+            return HashArray(text.data(), text.size(), seed);
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    uint64_t HashMeshGeometry(const ModelMesh& mesh) {
+        auto vertex_list = mesh.GetVertexSpan();
+        uint64_t hash = HashArray(vertex_list.data(), vertex_list.size(), 0);
+        if (mesh.IsIndex32()) {
+            auto index_list = mesh.GetIndexSpan32();
+            hash = HashArray(index_list.data(), index_list.size(), hash + 4);
+        }
+        else {
+            auto index_list = mesh.GetIndexSpan();
+            hash = HashArray(index_list.data(), index_list.size(), hash + 2);
+        }
+        //ボーンの名前と逆行列が違えば同じ頂点でも別の動きになる
+        for (const auto& name : mesh.boneNodeNameList) {
+            hash = HashString(name, hash);
+        }
+        hash = HashArray(mesh.invBoneBaseposeMatrixList.data(), mesh.invBoneBaseposeMatrixList.size(), hash);
+        for (const auto& channel : mesh.blendShapeList) {
+            hash = HashString(channel.name, hash);
+            hash = HashBytes(&channel.defaultWeight, sizeof(channel.defaultWeight), hash);
+            for (const auto& target : channel.targetList) {
+                hash = HashBytes(&target.fullWeight, sizeof(target.fullWeight), hash);
+                hash = HashArray(target.vertexIndexList.data(), target.vertexIndexList.size(), hash);
+                hash = HashArray(target.deltaList.data(), target.deltaList.size(), hash);
+            }
+        }
+        return hash;
+    }
+    //------------------------------------------------------------------------------------------
+    size_t GetInstanceMemorySize(const std::vector<ModelInstance>& instance_list) {
+        size_t bytes = instance_list.size() * sizeof(ModelInstance);
+        for (const auto& instance : instance_list) {
+            bytes += instance.nodeName.size() + instance.materialName.size();
+        }
+        return bytes;
+    }
+    //------------------------------------------------------------------------------------------
+} // fbx
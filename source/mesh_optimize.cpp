@@ -0,0 +1,371 @@
+﻿#include "../include/mesh_optimize.h"
+#include "../include/blend_shape.h"
+
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+
+namespace fbx {
+
+    namespace {
+        const unsigned int kInvalidIndex = 0xffffffff;
+
+        //FIFOの頂点キャッシュ。入った時刻で持つので、Resetは時刻を進めるだけでよい
+        class FifoCache {
+        public:
+            FifoCache(size_t vertex_count, int cache_size) : mTimeList(vertex_count, 0), mTime(cache_size + 1), mCacheSize(cache_size) {
+            }
+            void Reset() {
+                this->mTime += this->mCacheSize + 1;
+            }
+            //キャッシュに無ければ入れて1を返す
+            int Touch(unsigned int vertex) {
+                if (this->mTime - this->mTimeList[vertex] > (unsigned int)this->mCacheSize) {
+                    this->mTimeList[vertex] = this->mTime;
+                    this->mTime++;
+                    return 1;
+                }
+                return 0;
+            }
+            int TouchTriangle(const unsigned int* triangle) {
+                return this->Touch(triangle[0]) + this->Touch(triangle[1]) + this->Touch(triangle[2]);
+            }
+        private:
+            std::vector<unsigned int> mTimeList;
+            unsigned int mTime;
+            int mCacheSize;
+        };
+    }
+
+    //------------------------------------------------------------------------------------------
+    VertexCacheStat AnalyzeVertexCache(const unsigned int* index_list, size_t index_count, size_t vertex_count, int cache_size) {
+        VertexCacheStat stat;
+        FifoCache cache(vertex_count, cache_size);
+        for (size_t i = 0; i < index_count; i++) {
+            stat.transformCount += cache.Touch(index_list[i]);
+        }
+        if (index_count >= 3) {
+            stat.acmr = (float)stat.transformCount / (float)(index_count / 3);
+        }
+        if (vertex_count > 0) {
+            stat.atvr = (float)stat.transformCount / (float)vertex_count;
+        }
+        return stat;
+    }
+    //------------------------------------------------------------------------------------------
+    void OptimizeVertexCache(unsigned int* out_index_list, const unsigned int* index_list, size_t index_count, size_t vertex_count, int cache_size) {
+        size_t triangle_count = index_count / 3;
+
+        //頂点ごとに、まだ出していない三角形の数と、その頂点を使う三角形のリスト
+        std::vector<unsigned int> live_list(vertex_count, 0);
+        for (size_t i = 0; i < triangle_count * 3; i++) {
+            live_list[index_list[i]]++;
+        }
+        std::vector<unsigned int> offset_list(vertex_count + 1, 0);
+        for (size_t i = 0; i < vertex_count; i++) {
+            offset_list[i + 1] = offset_list[i] + live_list[i];
+        }
+        std::vector<unsigned int> adjacency_list(triangle_count * 3);
+        {
+            std::vector<unsigned int> fill_list(offset_list.begin(), offset_list.end() - 1);
+            for (size_t i = 0; i < triangle_count * 3; i++) {
+                adjacency_list[fill_list[index_list[i]]++] = (unsigned int)(i / 3);
+            }
+        }
+
+        std::vector<unsigned int> cache_time_list(vertex_count, 0);
+        std::vector<char> emitted_list(triangle_count, 0);
+        std::vector<unsigned int> dead_end_list;
+        dead_end_list.reserve(triangle_count * 3);
+        std::vector<unsigned int> candidate_list;
+        unsigned int time = cache_size + 1;
+        size_t cursor = 0;
+        size_t out_count = 0;
+
+        //行き止まりになったら、最近出した頂点、それも無ければ番号順に残っている頂点から続ける
+        auto skip_dead_end = [&]() {
+            while (!dead_end_list.empty()) {
+                unsigned int vertex = dead_end_list.back();
+                dead_end_list.pop_back();
+                if (live_list[vertex] > 0) {
+                    return vertex;
+                }
+            }
+            for (; cursor < vertex_count; cursor++) {
+                if (live_list[cursor] > 0) {
+                    return (unsigned int)cursor;
+                }
+            }
+            return kInvalidIndex;
+        };
+
+        unsigned int fan = skip_dead_end();
+        while (fan != kInvalidIndex) {
+            //扇の中心の頂点を使う三角形をすべて出す
+            candidate_list.clear();
+            for (unsigned int i = offset_list[fan]; i < offset_list[fan + 1]; i++) {
+                unsigned int triangle = adjacency_list[i];
+                if (emitted_list[triangle]) {
+                    continue;
+                }
+                emitted_list[triangle] = 1;
+                for (int j = 0; j < 3; j++) {
+                    unsigned int vertex = index_list[triangle * 3 + j];
+                    out_index_list[out_count++] = vertex;
+                    dead_end_list.push_back(vertex);
+                    candidate_list.push_back(vertex);
+                    live_list[vertex]--;
+                    if (time - cache_time_list[vertex] > (unsigned int)cache_size) {
+                        cache_time_list[vertex] = time;
+                        time++;
+                    }
+                }
+            }
+
+            //次の中心は、残りの三角形を出してもキャッシュに残っている頂点のうち一番古いもの
+            unsigned int next = kInvalidIndex;
+            int best_priority = -1;
+            for (auto vertex : candidate_list) {
+                if (live_list[vertex] == 0) {
+                    continue;
+                }
+                int priority = 0;
+                int age = (int)(time - cache_time_list[vertex]);
+                if (age + 2 * (int)live_list[vertex] <= cache_size) {
+                    priority = age;
+                }
+                if (priority > best_priority) {
+                    best_priority = priority;
+                    next = vertex;
+                }
+            }
+            if (next == kInvalidIndex) {
+                next = skip_dead_end();
+            }
+            fan = next;
+        }
+
+        //3で割り切れない余りはそのまま残す
+        for (size_t i = triangle_count * 3; i < index_count; i++) {
+            out_index_list[out_count++] = index_list[i];
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    void OptimizeOverdraw(unsigned int* out_index_list, const unsigned int* index_list, size_t index_count, const ModelVertex* vertex_list, size_t vertex_count,
+        int cache_size, float threshold) {
+        size_t triangle_count = index_count / 3;
+        if (triangle_count == 0) {
+            std::copy(index_list, index_list + index_count, out_index_list);
+            return;
+        }
+
+        //3頂点ともキャッシュに無い三角形でキャッシュが途切れているので、そこで区切る
+        FifoCache cache(vertex_count, cache_size);
+        std::vector<unsigned int> hard_start_list;
+        for (size_t i = 0; i < triangle_count; i++) {
+            if (cache.TouchTriangle(index_list + i * 3) == 3) {
+                hard_start_list.push_back((unsigned int)i);
+            }
+        }
+        hard_start_list.push_back((unsigned int)triangle_count);
+
+        //区切りの中を、そこまでのACMRが区切り全体のthreshold倍以下になった所でさらに細かく区切る
+        std::vector<unsigned int> cluster_start_list;
+        for (size_t i = 0; i + 1 < hard_start_list.size(); i++) {
+            unsigned int begin = hard_start_list[i];
+            unsigned int end = hard_start_list[i + 1];
+
+            cache.Reset();
+            int cluster_miss = 0;
+            for (unsigned int j = begin; j < end; j++) {
+                cluster_miss += cache.TouchTriangle(index_list + j * 3);
+            }
+            float limit = threshold * (float)cluster_miss / (float)(end - begin);
+
+            cache.Reset();
+            cluster_start_list.push_back(begin);
+            unsigned int start = begin;
+            int miss = 0;
+            for (unsigned int j = begin; j < end; j++) {
+                miss += cache.TouchTriangle(index_list + j * 3);
+                if (j + 1 < end && (float)miss <= limit * (float)(j + 1 - start)) {
+                    cluster_start_list.push_back(j + 1);
+                    start = j + 1;
+                    miss = 0;
+                    cache.Reset();
+                }
+            }
+        }
+        cluster_start_list.push_back((unsigned int)triangle_count);
+        size_t cluster_count = cluster_start_list.size() - 1;
+
+        //メッシュの中心から見て、かたまりの向きが外側を向いているほど先に描く
+        glm::vec3 mesh_center(0.0f, 0.0f, 0.0f);
+        for (size_t i = 0; i < vertex_count; i++) {
+            mesh_center += vertex_list[i].position;
+        }
+        if (vertex_count > 0) {
+            mesh_center /= (float)vertex_count;
+        }
+
+        std::vector<float> sort_key_list(cluster_count);
+        for (size_t i = 0; i < cluster_count; i++) {
+            glm::vec3 center(0.0f, 0.0f, 0.0f);
+            glm::vec3 normal(0.0f, 0.0f, 0.0f);
+            float area = 0.0f;
+            for (unsigned int j = cluster_start_list[i]; j < cluster_start_list[i + 1]; j++) {
+                const glm::vec3& p0 = vertex_list[index_list[j * 3 + 0]].position;
+                const glm::vec3& p1 = vertex_list[index_list[j * 3 + 1]].position;
+                const glm::vec3& p2 = vertex_list[index_list[j * 3 + 2]].position;
+                //外積の長さは面積の2倍なので、そのまま面積の重みになる
+                glm::vec3 cross = glm::cross(p1 - p0, p2 - p0);
+                float weight = glm::length(cross);
+                center += (p0 + p1 + p2) * (weight / 3.0f);
+                normal += cross;
+                area += weight;
+            }
+            float normal_length = glm::length(normal);
+            if (area <= 0.0f || normal_length <= 0.0f) {
+                sort_key_list[i] = 0.0f;
+                continue;
+            }
+            sort_key_list[i] = glm::dot(center / area - mesh_center, normal / normal_length);
+        }
+
+        std::vector<unsigned int> order(cluster_count);
+        for (size_t i = 0; i < cluster_count; i++) {
+            order[i] = (unsigned int)i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&sort_key_list](unsigned int a, unsigned int b) {
+            return sort_key_list[a] > sort_key_list[b];
+        });
+
+        size_t out_count = 0;
+        for (auto cluster : order) {
+            for (unsigned int i = cluster_start_list[cluster] * 3; i < cluster_start_list[cluster + 1] * 3; i++) {
+                out_index_list[out_count++] = index_list[i];
+            }
+        }
+        for (size_t i = triangle_count * 3; i < index_count; i++) {
+            out_index_list[out_count++] = index_list[i];
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    size_t OptimizeVertexFetch(std::vector<ModelVertex>* vertex_list, unsigned int* index_list, size_t index_count, std::vector<unsigned int>* out_remap_list) {
+        std::vector<unsigned int> remap_list(vertex_list->size(), kInvalidIndex);
+        std::vector<ModelVertex> new_vertex_list;
+        new_vertex_list.reserve(vertex_list->size());
+        for (size_t i = 0; i < index_count; i++) {
+            unsigned int& remap = remap_list[index_list[i]];
+            if (remap == kInvalidIndex) {
+                remap = (unsigned int)new_vertex_list.size();
+                new_vertex_list.push_back((*vertex_list)[index_list[i]]);
+            }
+            index_list[i] = remap;
+        }
+        vertex_list->swap(new_vertex_list);
+        if (out_remap_list != nullptr) {
+            out_remap_list->swap(remap_list);
+        }
+        return vertex_list->size();
+    }
+    //------------------------------------------------------------------------------------------
+    void OptimizeMesh(ModelMesh* mesh, const OptimizeOption& option, OptimizeStat* out_stat) {
+        bool index32 = mesh->IsIndex32();
+        std::vector<unsigned int> index_list;
+        if (index32) {
+            index_list.swap(mesh->indexList32);
+        }
+        else {
+            index_list.assign(mesh->indexList.begin(), mesh->indexList.end());
+        }
+        if (index_list.empty()) {
+            return;
+        }
+        int cache_size = std::max(option.cacheSize, 3);
+        if (out_stat != nullptr) {
+            out_stat->before = AnalyzeVertexCache(index_list.data(), index_list.size(), mesh->vertexList.size(), cache_size);
+        }
+
+        auto begin = std::chrono::steady_clock::now();
+        std::vector<unsigned int> optimized_list(index_list.size());
+        OptimizeVertexCache(optimized_list.data(), index_list.data(), index_list.size(), mesh->vertexList.size(), cache_size);
+        if (option.overdraw) {
+            OptimizeOverdraw(index_list.data(), optimized_list.data(), optimized_list.size(), mesh->vertexList.data(), mesh->vertexList.size(),
+                cache_size, option.overdrawThreshold);
+            index_list.swap(optimized_list);
+        }
+        //LODは頂点キャッシュの並べ替えだけ行う
+        std::vector<std::vector<unsigned int>> lod_index_list(mesh->lodList.size());
+        for (size_t i = 0; i < mesh->lodList.size(); i++) {
+            const auto& lod = mesh->lodList[i];
+            std::vector<unsigned int> source_list;
+            if (index32) {
+                source_list = lod.indexList32;
+            }
+            else {
+                source_list.assign(lod.indexList.begin(), lod.indexList.end());
+            }
+            lod_index_list[i].resize(source_list.size());
+            OptimizeVertexCache(lod_index_list[i].data(), source_list.data(), source_list.size(), mesh->vertexList.size(), cache_size);
+        }
+        if (option.vertexFetch) {
+            //ブレンドシェイプか接線がある時だけ並べ替えの表を受け取る
+            std::vector<unsigned int> remap_list;
+            std::vector<unsigned int>* remap_ptr = (mesh->blendShapeList.empty() && mesh->tangentList.empty()) ? nullptr : &remap_list;
+            size_t old_vertex_count = mesh->vertexList.size();
+            if (lod_index_list.empty()) {
+                OptimizeVertexFetch(&mesh->vertexList, optimized_list.data(), optimized_list.size(), remap_ptr);
+            }
+            else {
+                //LODの頂点は元のメッシュの頂点の一部なので、つなげて1回で並べ直せば元のメッシュの順になる
+                std::vector<unsigned int> all_list(optimized_list);
+                for (const auto& lod_index : lod_index_list) {
+                    all_list.insert(all_list.end(), lod_index.begin(), lod_index.end());
+                }
+                OptimizeVertexFetch(&mesh->vertexList, all_list.data(), all_list.size(), remap_ptr);
+                auto it = all_list.begin();
+                std::copy(it, it + optimized_list.size(), optimized_list.begin());
+                it += optimized_list.size();
+                for (auto& lod_index : lod_index_list) {
+                    std::copy(it, it + lod_index.size(), lod_index.begin());
+                    it += lod_index.size();
+                }
+            }
+            if (!mesh->blendShapeList.empty()) {
+                RemapBlendShapeVertices(mesh, remap_list);
+            }
+            if (!mesh->tangentList.empty()) {
+                std::vector<glm::vec4> tangent_list(mesh->vertexList.size());
+                for (size_t i = 0; i < old_vertex_count && i < mesh->tangentList.size(); i++) {
+                    if (remap_list[i] != kInvalidIndex) {
+                        tangent_list[remap_list[i]] = mesh->tangentList[i];
+                    }
+                }
+                mesh->tangentList.swap(tangent_list);
+            }
+        }
+        if (out_stat != nullptr) {
+            out_stat->timeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+            out_stat->after = AnalyzeVertexCache(optimized_list.data(), optimized_list.size(), mesh->vertexList.size(), cache_size);
+        }
+
+        //使われない頂点が消えて16bitに収まるようになることもあるので、溶接と同じ決まりで入れ直す
+        bool use_index32 = mesh->vertexList.size() > 0xffff;
+        auto store = [use_index32](std::vector<unsigned int>* source_list, std::vector<unsigned short>* out_index_list, std::vector<unsigned int>* out_index_list32) {
+            out_index_list->clear();
+            out_index_list32->clear();
+            if (use_index32) {
+                out_index_list32->swap(*source_list);
+            }
+            else {
+                out_index_list->assign(source_list->begin(), source_list->end());
+            }
+        };
+        store(&optimized_list, &mesh->indexList, &mesh->indexList32);
+        for (size_t i = 0; i < mesh->lodList.size(); i++) {
+            store(&lod_index_list[i], &mesh->lodList[i].indexList, &mesh->lodList[i].indexList32);
+        }
+    }
+    //------------------------------------------------------------------------------------------
+} // fbx
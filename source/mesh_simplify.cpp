@@ -0,0 +1,579 @@
+﻿#include "../include/mesh_simplify.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+namespace fbx {
+
+    namespace {
+        const unsigned int kInvalidIndex = 0xffffffff;
+        const uint64_t kEmptyEdge = ~0ULL;
+        //穴の縁を保つための平面の重み
+        const double kBorderWeight = 10.0;
+
+        enum VertexKind : uint8_t {
+            //周りが閉じていて、どの隣へも寄せられる
+            kVertexManifold,
+            //穴の縁。縁に沿ってだけ寄せる
+            kVertexBorder,
+            //UVなどの継ぎ目。同じ位置のもう1つの頂点と一緒に継ぎ目に沿って寄せる
+            kVertexSeam,
+            //動かさない(3つ以上の面が集まる所・縁と継ぎ目の交わる所など)
+            kVertexLocked,
+        };
+
+        //平面までの距離の2乗の和。Q(p) = p^T A p + 2 b^T p + c
+        struct Quadric {
+            double a00, a11, a22, a10, a20, a21;
+            double b0, b1, b2;
+            double c;
+            double weight;
+        };
+
+        //------------------------------------------------------------------------------------------
+        void AddPlane(Quadric* q, const glm::vec3& n, double d, double weight) {
+            q->a00 += weight * n.x * n.x;
+            q->a11 += weight * n.y * n.y;
+            q->a22 += weight * n.z * n.z;
+            q->a10 += weight * n.y * n.x;
+            q->a20 += weight * n.z * n.x;
+            q->a21 += weight * n.z * n.y;
+            q->b0 += weight * n.x * d;
+            q->b1 += weight * n.y * d;
+            q->b2 += weight * n.z * d;
+            q->c += weight * d * d;
+            q->weight += weight;
+        }
+        //------------------------------------------------------------------------------------------
+        void AddQuadric(Quadric* q, const Quadric& r) {
+            q->a00 += r.a00; q->a11 += r.a11; q->a22 += r.a22;
+            q->a10 += r.a10; q->a20 += r.a20; q->a21 += r.a21;
+            q->b0 += r.b0; q->b1 += r.b1; q->b2 += r.b2;
+            q->c += r.c;
+            q->weight += r.weight;
+        }
+        //------------------------------------------------------------------------------------------
+        //重みで割らない値
+        double Evaluate(const Quadric& q, const glm::vec3& p) {
+            double x = p.x, y = p.y, z = p.z;
+            double result = q.a00 * x * x + q.a11 * y * y + q.a22 * z * z
+                + 2.0 * (q.a10 * x * y + q.a20 * x * z + q.a21 * y * z)
+                + 2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+            return std::max(result, 0.0);
+        }
+        //------------------------------------------------------------------------------------------
+        //法線・UV・ボーンウェイトの違い。だいたい0～1に収まるようにする
+        float GetAttributeDistance(const ModelVertex& a, const ModelVertex& b) {
+            glm::vec3 normal = a.normal - b.normal;
+            glm::vec2 uv = a.uv - b.uv;
+            float distance = glm::dot(normal, normal) * 0.25f + glm::dot(uv, uv);
+            //同じボーンのウェイトの差を足す。片方にしか無いボーンはそのウェイトがそのまま差になる
+            float weight_diff = 0.0f;
+            for (int i = 0; i < 4; i++) {
+                bool found = false;
+                for (int j = 0; j < 4; j++) {
+                    if (a.boneIndex[i] == b.boneIndex[j]) {
+                        weight_diff += std::abs(a.boneWeight[i] - b.boneWeight[j]);
+                        found = true;
+                        break;
+                    }
+                }
+                if (!found) {
+                    weight_diff += a.boneWeight[i];
+                }
+                found = false;
+                for (int j = 0; j < 4; j++) {
+                    found = found || b.boneIndex[i] == a.boneIndex[j];
+                }
+                if (!found) {
+                    weight_diff += b.boneWeight[i];
+                }
+            }
+            return distance + weight_diff * 0.5f;
+        }
+        //------------------------------------------------------------------------------------------
+        glm::vec3 GetTriangleNormal(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2) {
+            return glm::cross(p1 - p0, p2 - p0);
+        }
+
+        //-- EdgeSet Class --//
+        //向きのある辺(a, b)の集合。オープンアドレス法
+        class EdgeSet
+        {
+        public:
+            explicit EdgeSet(size_t count) {
+                size_t capacity = 16;
+                while (capacity < count * 2) {
+                    capacity *= 2;
+                }
+                mTable.assign(capacity, kEmptyEdge);
+                mMask = capacity - 1;
+            }
+            void Insert(unsigned int a, unsigned int b) {
+                uint64_t key = MakeKey(a, b);
+                size_t slot = Hash(key);
+                while (mTable[slot] != kEmptyEdge) {
+                    if (mTable[slot] == key) {
+                        return;
+                    }
+                    slot = (slot + 1) & mMask;
+                }
+                mTable[slot] = key;
+            }
+            bool Contains(unsigned int a, unsigned int b) const {
+                uint64_t key = MakeKey(a, b);
+                size_t slot = Hash(key);
+                while (mTable[slot] != kEmptyEdge) {
+                    if (mTable[slot] == key) {
+                        return true;
+                    }
+                    slot = (slot + 1) & mMask;
+                }
+                return false;
+            }
+        private:
+            static uint64_t MakeKey(unsigned int a, unsigned int b) {
+                return ((uint64_t)a << 32) | b;
+            }
+            size_t Hash(uint64_t key) const {
+                key ^= key >> 29;
+                key *= 0xbf58476d1ce4e5b9ULL;
+                key ^= key >> 32;
+                return (size_t)key & mMask;
+            }
+            std::vector<uint64_t> mTable;
+            size_t mMask;
+        };
+
+        struct Collapse {
+            unsigned int vertex;
+            unsigned int target;
+            //並べる値(形の誤差 + 属性の違い)
+            float cost;
+            //形の誤差の2乗(重みで割った値)
+            float error;
+        };
+    }
+
+    //------------------------------------------------------------------------------------------
+    float GetMeshExtent(const ModelVertex* vertex_list, size_t vertex_count) {
+        if (vertex_count == 0) {
+            return 0.0f;
+        }
+        glm::vec3 min_position = vertex_list[0].position;
+        glm::vec3 max_position = vertex_list[0].position;
+        for (size_t i = 1; i < vertex_count; i++) {
+            const auto& p = vertex_list[i].position;
+            min_position = glm::vec3(std::min(min_position.x, p.x), std::min(min_position.y, p.y), std::min(min_position.z, p.z));
+            max_position = glm::vec3(std::max(max_position.x, p.x), std::max(max_position.y, p.y), std::max(max_position.z, p.z));
+        }
+        glm::vec3 size = max_position - min_position;
+        return std::max(size.x, std::max(size.y, size.z));
+    }
+    //------------------------------------------------------------------------------------------
+    void SimplifyMesh(std::vector<unsigned int>* out_index_list, const unsigned int* index_list, size_t index_count,
+        const ModelVertex* vertex_list, size_t vertex_count, size_t target_index_count, float target_error, float attribute_weight, float* out_error) {
+        std::vector<unsigned int>& result = *out_index_list;
+        result.assign(index_list, index_list + index_count / 3 * 3);
+        float max_error = 0.0f;
+        if (out_error != nullptr) {
+            *out_error = 0.0f;
+        }
+        if (result.size() <= target_index_count || vertex_count == 0) {
+            return;
+        }
+
+        float extent = GetMeshExtent(vertex_list, vertex_count);
+        float scale = extent > 0.0f ? extent : 1.0f;
+        //誤差は重みで割った距離の2乗なので、比べる時も2乗にしておく
+        double error_limit = (target_error > 0.0f) ? (double)target_error * scale * target_error * scale : 1e30;
+
+        //同じ位置の頂点をまとめる。remapは位置ごとの代表、wedgeは同じ位置の頂点の輪
+        std::vector<unsigned int> remap(vertex_count);
+        std::vector<unsigned int> wedge(vertex_count);
+        {
+            std::vector<unsigned int> order(vertex_count);
+            for (size_t i = 0; i < vertex_count; i++) {
+                order[i] = (unsigned int)i;
+            }
+            auto less = [vertex_list](unsigned int a, unsigned int b) {
+                const auto& pa = vertex_list[a].position;
+                const auto& pb = vertex_list[b].position;
+                if (pa.x != pb.x) return pa.x < pb.x;
+                if (pa.y != pb.y) return pa.y < pb.y;
+                if (pa.z != pb.z) return pa.z < pb.z;
+                return a < b;
+            };
+            std::sort(order.begin(), order.end(), less);
+            for (size_t i = 0; i < vertex_count;) {
+                size_t end = i + 1;
+                while (end < vertex_count && vertex_list[order[end]].position == vertex_list[order[i]].position) {
+                    end++;
+                }
+                for (size_t j = i; j < end; j++) {
+                    remap[order[j]] = order[i];
+                    wedge[order[j]] = order[(j + 1 < end) ? j + 1 : i];
+                }
+                i = end;
+            }
+        }
+
+        //向かいの辺が無い辺は穴の縁か継ぎ目。頂点ごとに出ていく辺と入ってくる辺を1本ずつ覚える
+        std::vector<VertexKind> kind_list(vertex_count, kVertexManifold);
+        {
+            EdgeSet edge_set(result.size());
+            for (size_t i = 0; i < result.size(); i += 3) {
+                for (int e = 0; e < 3; e++) {
+                    edge_set.Insert(result[i + e], result[i + (e + 1) % 3]);
+                }
+            }
+            std::vector<unsigned int> open_out(vertex_count, kInvalidIndex);
+            std::vector<unsigned int> open_in(vertex_count, kInvalidIndex);
+            for (size_t i = 0; i < result.size(); i += 3) {
+                for (int e = 0; e < 3; e++) {
+                    unsigned int a = result[i + e];
+                    unsigned int b = result[i + (e + 1) % 3];
+                    if (edge_set.Contains(b, a)) {
+                        continue;
+                    }
+                    //2本目の縁があれば複雑な所なので動かさない
+                    if (open_out[a] != kInvalidIndex || open_in[b] != kInvalidIndex) {
+                        kind_list[a] = kVertexLocked;
+                        kind_list[b] = kVertexLocked;
+                    }
+                    open_out[a] = b;
+                    open_in[b] = a;
+                }
+            }
+            for (size_t v = 0; v < vertex_count; v++) {
+                if (kind_list[v] == kVertexLocked) {
+                    continue;
+                }
+                unsigned int sibling = wedge[v];
+                bool open = open_out[v] != kInvalidIndex || open_in[v] != kInvalidIndex;
+                bool both_open = open_out[v] != kInvalidIndex && open_in[v] != kInvalidIndex;
+                if (sibling == v) {
+                    kind_list[v] = !open ? kVertexManifold : (both_open ? kVertexBorder : kVertexLocked);
+                }
+                //継ぎ目の両側は向きが逆の縁になっている
+                else if (wedge[sibling] == v && both_open && kind_list[sibling] != kVertexLocked
+                    && open_out[sibling] != kInvalidIndex && open_in[sibling] != kInvalidIndex
+                    && remap[open_out[v]] == remap[open_in[sibling]] && remap[open_in[v]] == remap[open_out[sibling]]) {
+                    kind_list[v] = kVertexSeam;
+                }
+                else {
+                    kind_list[v] = kVertexLocked;
+                }
+            }
+
+            //穴の縁なら向かいの辺は位置で見ても無い。継ぎ目は位置で見ると向かいの辺がある
+            EdgeSet position_edge_set(result.size());
+            for (size_t i = 0; i < result.size(); i += 3) {
+                for (int e = 0; e < 3; e++) {
+                    position_edge_set.Insert(remap[result[i + e]], remap[result[i + (e + 1) % 3]]);
+                }
+            }
+
+            //面の平面と、穴の縁では縁を通って面に垂直な平面を足す。位置ごとに持つ
+            std::vector<Quadric> quadric_list(vertex_count);
+            std::memset(quadric_list.data(), 0, sizeof(Quadric) * vertex_count);
+            for (size_t i = 0; i < result.size(); i += 3) {
+                const glm::vec3& p0 = vertex_list[result[i + 0]].position;
+                const glm::vec3& p1 = vertex_list[result[i + 1]].position;
+                const glm::vec3& p2 = vertex_list[result[i + 2]].position;
+                glm::vec3 normal = GetTriangleNormal(p0, p1, p2);
+                float area = glm::length(normal);
+                if (area <= 0.0f) {
+                    continue;
+                }
+                normal /= area;
+                for (int e = 0; e < 3; e++) {
+                    AddPlane(&quadric_list[remap[result[i + e]]], normal, -glm::dot(normal, p0), area * 0.5f);
+                }
+                for (int e = 0; e < 3; e++) {
+                    unsigned int a = result[i + e];
+                    unsigned int b = result[i + (e + 1) % 3];
+                    if (position_edge_set.Contains(remap[b], remap[a])) {
+                        continue;
+                    }
+                    glm::vec3 edge = vertex_list[b].position - vertex_list[a].position;
+                    float length = glm::length(edge);
+                    if (length <= 0.0f) {
+                        continue;
+                    }
+                    glm::vec3 border_normal = glm::normalize(glm::cross(edge / length, normal));
+                    double d = -glm::dot(border_normal, vertex_list[a].position);
+                    AddPlane(&quadric_list[remap[a]], border_normal, d, length * length * kBorderWeight);
+                    AddPlane(&quadric_list[remap[b]], border_normal, d, length * length * kBorderWeight);
+                }
+            }
+
+            //縮約の組み合わせを安い順に行う。1回のまとまりの中では、縮約した2つの頂点はもう動かさない
+            std::vector<Collapse> collapse_list;
+            std::vector<unsigned int> collapse_remap(vertex_count);
+            std::vector<char> touched_list(vertex_count);
+            std::vector<unsigned int> offset_list(vertex_count + 1);
+            std::vector<unsigned int> adjacency_list;
+
+            //継ぎ目の頂点をtargetへ寄せる時、もう1つの頂点の行き先
+            auto find_sibling_target = [&](unsigned int vertex, unsigned int target) {
+                unsigned int sibling = wedge[vertex];
+                if (open_out[sibling] != kInvalidIndex && remap[open_out[sibling]] == remap[target]) {
+                    return open_out[sibling];
+                }
+                if (open_in[sibling] != kInvalidIndex && remap[open_in[sibling]] == remap[target]) {
+                    return open_in[sibling];
+                }
+                return kInvalidIndex;
+            };
+            auto can_collapse = [&](unsigned int vertex, unsigned int target) {
+                if (remap[vertex] == remap[target]) {
+                    return false;
+                }
+                switch (kind_list[vertex]) {
+                case kVertexManifold:
+                    return true;
+                case kVertexBorder:
+                    return target == open_out[vertex] || target == open_in[vertex];
+                case kVertexSeam:
+                    return (target == open_out[vertex] || target == open_in[vertex]) && find_sibling_target(vertex, target) != kInvalidIndex;
+                default:
+                    return false;
+                }
+            };
+            //vertexをtargetの位置へ動かしても周りの三角形が裏返らないか。同じまとまりで先に行った縮約も反映して見る
+            auto is_flip = [&](unsigned int vertex, unsigned int target) {
+                const glm::vec3& to = vertex_list[target].position;
+                for (unsigned int i = offset_list[vertex]; i < offset_list[vertex + 1]; i++) {
+                    const unsigned int* source = &result[adjacency_list[i] * 3];
+                    unsigned int triangle[3] = { collapse_remap[source[0]], collapse_remap[source[1]], collapse_remap[source[2]] };
+                    unsigned int r0 = remap[triangle[0]], r1 = remap[triangle[1]], r2 = remap[triangle[2]];
+                    if (r0 == remap[target] || r1 == remap[target] || r2 == remap[target] || r0 == r1 || r1 == r2 || r2 == r0) {
+                        continue;
+                    }
+                    glm::vec3 p[3];
+                    glm::vec3 q[3];
+                    for (int k = 0; k < 3; k++) {
+                        p[k] = vertex_list[triangle[k]].position;
+                        q[k] = (source[k] == vertex) ? to : p[k];
+                    }
+                    if (glm::dot(GetTriangleNormal(p[0], p[1], p[2]), GetTriangleNormal(q[0], q[1], q[2])) <= 0.0f) {
+                        return true;
+                    }
+                }
+                return false;
+            };
+            //縁と継ぎ目の頂点が消えた後、前後の頂点をつなぎ直す
+            auto relink = [&](unsigned int vertex, unsigned int target) {
+                unsigned int prev = open_in[vertex];
+                unsigned int next = open_out[vertex];
+                if (target == next) {
+                    open_out[prev] = target;
+                    open_in[target] = prev;
+                }
+                else {
+                    open_in[next] = target;
+                    open_out[target] = next;
+                }
+            };
+
+            while (result.size() > target_index_count) {
+                size_t triangle_count = result.size() / 3;
+
+                //頂点ごとの三角形のリスト
+                std::fill(offset_list.begin(), offset_list.end(), 0);
+                for (auto index : result) {
+                    offset_list[index + 1]++;
+                }
+                for (size_t i = 0; i < vertex_count; i++) {
+                    offset_list[i + 1] += offset_list[i];
+                }
+                adjacency_list.resize(result.size());
+                {
+                    std::vector<unsigned int> fill_list(offset_list.begin(), offset_list.end() - 1);
+                    for (size_t i = 0; i < result.size(); i++) {
+                        adjacency_list[fill_list[result[i]]++] = (unsigned int)(i / 3);
+                    }
+                }
+
+                collapse_list.clear();
+                for (size_t i = 0; i < result.size(); i += 3) {
+                    for (int e = 0; e < 3; e++) {
+                        unsigned int a = result[i + e];
+                        unsigned int b = result[i + (e + 1) % 3];
+                        //向かいの三角形からも同じ辺が来るので、閉じた辺は片方からだけ見る
+                        if (a > b && kind_list[a] == kVertexManifold && kind_list[b] == kVertexManifold) {
+                            continue;
+                        }
+                        for (int direction = 0; direction < 2; direction++) {
+                            unsigned int vertex = direction == 0 ? a : b;
+                            unsigned int target = direction == 0 ? b : a;
+                            if (!can_collapse(vertex, target)) {
+                                continue;
+                            }
+                            const Quadric& qv = quadric_list[remap[vertex]];
+                            const Quadric& qt = quadric_list[remap[target]];
+                            const glm::vec3& p = vertex_list[target].position;
+                            double weight = qv.weight + qt.weight;
+                            double error = (weight > 0.0) ? (Evaluate(qv, p) + Evaluate(qt, p)) / weight : 0.0;
+                            float attribute = GetAttributeDistance(vertex_list[vertex], vertex_list[target]);
+                            if (kind_list[vertex] == kVertexSeam) {
+                                unsigned int sibling_target = find_sibling_target(vertex, target);
+                                attribute = std::max(attribute, GetAttributeDistance(vertex_list[wedge[vertex]], vertex_list[sibling_target]));
+                            }
+                            glm::vec3 edge = vertex_list[vertex].position - p;
+                            Collapse collapse;
+                            collapse.vertex = vertex;
+                            collapse.target = target;
+                            collapse.error = (float)error;
+                            collapse.cost = (float)(error + attribute_weight * attribute * glm::dot(edge, edge));
+                            collapse_list.push_back(collapse);
+                        }
+                    }
+                }
+                if (collapse_list.empty()) {
+                    break;
+                }
+                std::sort(collapse_list.begin(), collapse_list.end(), [](const Collapse& a, const Collapse& b) {
+                    return a.cost < b.cost;
+                });
+
+                size_t remove_goal = triangle_count - target_index_count / 3;
+                size_t removed = 0;
+                size_t collapse_count = 0;
+                for (size_t i = 0; i < vertex_count; i++) {
+                    collapse_remap[i] = (unsigned int)i;
+                }
+                std::fill(touched_list.begin(), touched_list.end(), 0);
+                for (const auto& collapse : collapse_list) {
+                    if (removed >= remove_goal) {
+                        break;
+                    }
+                    if (collapse.error > error_limit) {
+                        continue;
+                    }
+                    unsigned int vertex = collapse.vertex;
+                    unsigned int target = collapse.target;
+                    if (touched_list[remap[vertex]] || touched_list[remap[target]]) {
+                        continue;
+                    }
+                    bool seam = kind_list[vertex] == kVertexSeam;
+                    unsigned int sibling = wedge[vertex];
+                    unsigned int sibling_target = seam ? find_sibling_target(vertex, target) : kInvalidIndex;
+                    if (is_flip(vertex, target) || (seam && is_flip(sibling, sibling_target))) {
+                        continue;
+                    }
+
+                    collapse_remap[vertex] = target;
+                    if (kind_list[vertex] != kVertexManifold) {
+                        relink(vertex, target);
+                    }
+                    if (seam) {
+                        collapse_remap[sibling] = sibling_target;
+                        relink(sibling, sibling_target);
+                    }
+                    AddQuadric(&quadric_list[remap[target]], quadric_list[remap[vertex]]);
+                    touched_list[remap[vertex]] = 1;
+                    touched_list[remap[target]] = 1;
+                    //閉じた所では2つ、縁では1つの三角形が消える
+                    removed += (kind_list[vertex] == kVertexBorder) ? 1 : 2;
+                    collapse_count++;
+                    max_error = std::max(max_error, collapse.error);
+                }
+                if (collapse_count == 0) {
+                    break;
+                }
+
+                //寄せた頂点を書き換え、位置が重なった三角形を消す
+                size_t write = 0;
+                for (size_t i = 0; i < result.size(); i += 3) {
+                    unsigned int a = collapse_remap[result[i + 0]];
+                    unsigned int b = collapse_remap[result[i + 1]];
+                    unsigned int c = collapse_remap[result[i + 2]];
+                    if (remap[a] == remap[b] || remap[b] == remap[c] || remap[c] == remap[a]) {
+                        continue;
+                    }
+                    result[write + 0] = a;
+                    result[write + 1] = b;
+                    result[write + 2] = c;
+                    write += 3;
+                }
+                result.resize(write);
+            }
+        }
+
+        if (out_error != nullptr) {
+            *out_error = std::sqrt(max_error) / scale;
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    void GenerateLodList(ModelMesh* mesh, const LodOption& option) {
+        mesh->lodList.clear();
+        std::vector<unsigned int> index_list;
+        if (mesh->IsIndex32()) {
+            index_list = mesh->indexList32;
+        }
+        else {
+            index_list.assign(mesh->indexList.begin(), mesh->indexList.end());
+        }
+        float extent = GetMeshExtent(mesh->vertexList.data(), mesh->vertexList.size());
+        float error = 0.0f;
+        float target_error = option.targetError;
+        size_t target_index_count = index_list.size();
+
+        std::vector<unsigned int> lod_index_list;
+        for (int level = 0; level < option.levelCount; level++) {
+            target_index_count = (option.triangleRatio > 0.0f) ? (size_t)(target_index_count / 3 * option.triangleRatio) * 3 : 0;
+            float level_error = 0.0f;
+            SimplifyMesh(&lod_index_list, index_list.data(), index_list.size(), mesh->vertexList.data(), mesh->vertexList.size(),
+                target_index_count, target_error, option.attributeWeight, &level_error);
+            //ほとんど減らなければこれ以上作らない
+            if (lod_index_list.empty() || lod_index_list.size() > index_list.size() * 95 / 100) {
+                break;
+            }
+            //前のLODからの誤差を足していく。元のメッシュからのずれはこの値を超えない
+            error += level_error * extent;
+            index_list.swap(lod_index_list);
+
+            ModelLod lod;
+            lod.error = error;
+            if (mesh->IsIndex32()) {
+                lod.indexList32 = index_list;
+            }
+            else {
+                lod.indexList.assign(index_list.begin(), index_list.end());
+            }
+            mesh->lodList.push_back(std::move(lod));
+            target_error *= 2.0f;
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    size_t GetLodIndexCount(const ModelMesh& mesh) {
+        size_t count = 0;
+        for (const auto& lod : mesh.lodList) {
+            count += lod.indexList.size() + lod.indexList32.size();
+        }
+        return count;
+    }
+    //------------------------------------------------------------------------------------------
+    float GetLodScreenError(float error, float distance, float screen_height, float fov_y) {
+        if (distance <= 0.0f) {
+            return 1e30f;
+        }
+        return error / (distance * std::tan(fov_y * 0.5f)) * screen_height * 0.5f;
+    }
+    //------------------------------------------------------------------------------------------
+    int SelectLod(const ModelMesh& mesh, float distance, float screen_height, float fov_y, float max_pixel_error) {
+        int lod = 0;
+        for (size_t i = 0; i < mesh.lodList.size(); i++) {
+            if (GetLodScreenError(mesh.lodList[i].error, distance, screen_height, fov_y) > max_pixel_error) {
+                break;
+            }
+            lod = (int)i + 1;
+        }
+        return lod;
+    }
+    //------------------------------------------------------------------------------------------
+} // fbx
@@ -0,0 +1,232 @@
+﻿#include "../include/meshlet.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace fbx {
+
+    namespace {
+        const unsigned int kInvalidIndex = 0xffffffff;
+        //三角形を選ぶ時の、頂点に残っている三角形の数の重み
+        const float kLiveWeight = 0.1f;
+
+        //------------------------------------------------------------------------------------------
+        //Ritterの方法。一番遠い2点を直径にした球を、外の点が入るように広げる
+        void ComputeBoundingSphere(glm::vec3* out_center, float* out_radius, const unsigned int* vertex_index_list, size_t count, const ModelVertex* vertex_list) {
+            const glm::vec3& first = vertex_list[vertex_index_list[0]].position;
+            auto find_farthest = [&](const glm::vec3& from) {
+                glm::vec3 farthest = from;
+                float max_distance = -1.0f;
+                for (size_t i = 0; i < count; i++) {
+                    const glm::vec3& p = vertex_list[vertex_index_list[i]].position;
+                    glm::vec3 d = p - from;
+                    float distance = glm::dot(d, d);
+                    if (distance > max_distance) {
+                        max_distance = distance;
+                        farthest = p;
+                    }
+                }
+                return farthest;
+            };
+            glm::vec3 a = find_farthest(first);
+            glm::vec3 b = find_farthest(a);
+            glm::vec3 center = (a + b) * 0.5f;
+            float radius = glm::length(b - a) * 0.5f;
+            for (size_t i = 0; i < count; i++) {
+                const glm::vec3& p = vertex_list[vertex_index_list[i]].position;
+                float distance = glm::length(p - center);
+                if (distance > radius) {
+                    float new_radius = (radius + distance) * 0.5f;
+                    center += (p - center) * ((new_radius - radius) / distance);
+                    radius = new_radius;
+                }
+            }
+            *out_center = center;
+            *out_radius = radius;
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    void BuildMeshlets(std::vector<ModelMeshlet>* out_meshlet_list, std::vector<unsigned int>* out_vertex_list, std::vector<uint8_t>* out_triangle_list,
+        const unsigned int* index_list, size_t index_count, const ModelVertex* vertex_list, size_t vertex_count, const MeshletOption& option) {
+        size_t triangle_count = index_count / 3;
+        if (triangle_count == 0) {
+            return;
+        }
+        unsigned int max_vertex_count = (unsigned int)std::min(std::max(option.maxVertexCount, 3), 256);
+        unsigned int max_triangle_count = (unsigned int)std::min(std::max(option.maxTriangleCount, 1), 512);
+
+        //三角形の向き(面積0なら0ベクトル)
+        std::vector<glm::vec3> normal_list(triangle_count);
+        for (size_t i = 0; i < triangle_count; i++) {
+            const glm::vec3& p0 = vertex_list[index_list[i * 3 + 0]].position;
+            const glm::vec3& p1 = vertex_list[index_list[i * 3 + 1]].position;
+            const glm::vec3& p2 = vertex_list[index_list[i * 3 + 2]].position;
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float length = glm::length(normal);
+            normal_list[i] = (length > 0.0f) ? normal / length : glm::vec3(0.0f, 0.0f, 0.0f);
+        }
+
+        //頂点ごとの三角形のリストと、まだ使っていない三角形の数
+        std::vector<unsigned int> live_list(vertex_count, 0);
+        for (size_t i = 0; i < triangle_count * 3; i++) {
+            live_list[index_list[i]]++;
+        }
+        std::vector<unsigned int> offset_list(vertex_count + 1, 0);
+        for (size_t i = 0; i < vertex_count; i++) {
+            offset_list[i + 1] = offset_list[i] + live_list[i];
+        }
+        std::vector<unsigned int> adjacency_list(triangle_count * 3);
+        {
+            std::vector<unsigned int> fill_list(offset_list.begin(), offset_list.end() - 1);
+            for (size_t i = 0; i < triangle_count * 3; i++) {
+                adjacency_list[fill_list[index_list[i]]++] = (unsigned int)(i / 3);
+            }
+        }
+
+        std::vector<char> emitted_list(triangle_count, 0);
+        //作っている途中のメッシュレットの中の頂点番号。入っていなければ-1
+        std::vector<short> local_list(vertex_count, -1);
+        ModelMeshlet meshlet;
+        glm::vec3 normal_sum(0.0f, 0.0f, 0.0f);
+        size_t cursor = 0;
+
+        auto begin_meshlet = [&]() {
+            meshlet = ModelMeshlet();
+            meshlet.vertexOffset = (uint32_t)out_vertex_list->size();
+            meshlet.triangleOffset = (uint32_t)out_triangle_list->size();
+            meshlet.vertexCount = 0;
+            meshlet.triangleCount = 0;
+            normal_sum = glm::vec3(0.0f, 0.0f, 0.0f);
+        };
+        auto finish_meshlet = [&]() {
+            if (meshlet.triangleCount == 0) {
+                return;
+            }
+            const unsigned int* meshlet_vertex = out_vertex_list->data() + meshlet.vertexOffset;
+            ComputeBoundingSphere(&meshlet.center, &meshlet.radius, meshlet_vertex, meshlet.vertexCount, vertex_list);
+
+            //法線の円錐。中心の向きから一番離れた三角形の角度aに対してsin(a)を持つ
+            meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 0.0f);
+            meshlet.coneCutoff = 1.0f;
+            float length = glm::length(normal_sum);
+            if (length > 0.0f) {
+                meshlet.coneAxis = normal_sum / length;
+                float min_dot = 1.0f;
+                const uint8_t* local = out_triangle_list->data() + meshlet.triangleOffset;
+                for (uint32_t i = 0; i < meshlet.triangleCount; i++) {
+                    const glm::vec3& p0 = vertex_list[meshlet_vertex[local[i * 3 + 0]]].position;
+                    const glm::vec3& p1 = vertex_list[meshlet_vertex[local[i * 3 + 1]]].position;
+                    const glm::vec3& p2 = vertex_list[meshlet_vertex[local[i * 3 + 2]]].position;
+                    glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                    float normal_length = glm::length(normal);
+                    if (normal_length > 0.0f) {
+                        min_dot = std::min(min_dot, glm::dot(normal / normal_length, meshlet.coneAxis));
+                    }
+                }
+                //半球より広がっていると裏向きの判定はできない
+                if (min_dot > 0.0f) {
+                    meshlet.coneCutoff = std::sqrt(1.0f - min_dot * min_dot);
+                }
+            }
+            for (uint32_t i = 0; i < meshlet.vertexCount; i++) {
+                local_list[meshlet_vertex[i]] = -1;
+            }
+            out_meshlet_list->push_back(meshlet);
+            begin_meshlet();
+        };
+        auto count_new_vertex = [&](unsigned int triangle) {
+            const unsigned int* t = index_list + triangle * 3;
+            return (unsigned int)((local_list[t[0]] < 0) + (local_list[t[1]] < 0 && t[1] != t[0]) + (local_list[t[2]] < 0 && t[2] != t[0] && t[2] != t[1]));
+        };
+
+        begin_meshlet();
+        for (size_t emitted_count = 0; emitted_count < triangle_count; emitted_count++) {
+            //メッシュレットの頂点につながっている三角形から、増える頂点が少なく向きの近いものを選ぶ
+            unsigned int best = kInvalidIndex;
+            float best_score = 1e30f;
+            if (meshlet.triangleCount > 0) {
+                float length = glm::length(normal_sum);
+                glm::vec3 axis = (length > 0.0f) ? normal_sum / length : glm::vec3(0.0f, 0.0f, 0.0f);
+                for (uint32_t i = 0; i < meshlet.vertexCount; i++) {
+                    unsigned int vertex = (*out_vertex_list)[meshlet.vertexOffset + i];
+                    if (live_list[vertex] == 0) {
+                        continue;
+                    }
+                    for (unsigned int j = offset_list[vertex]; j < offset_list[vertex + 1]; j++) {
+                        unsigned int triangle = adjacency_list[j];
+                        if (emitted_list[triangle]) {
+                            continue;
+                        }
+                        unsigned int extra = count_new_vertex(triangle);
+                        if (meshlet.vertexCount + extra > max_vertex_count) {
+                            continue;
+                        }
+                        //残りの三角形が少ない頂点を先に使い切ると、縁が短く(三角形が多く入る形に)なる
+                        const unsigned int* t = index_list + triangle * 3;
+                        float live = (float)(live_list[t[0]] + live_list[t[1]] + live_list[t[2]]);
+                        float score = (float)extra + option.coneWeight * (1.0f - glm::dot(axis, normal_list[triangle])) + live * kLiveWeight;
+                        if (score < best_score) {
+                            best_score = score;
+                            best = triangle;
+                        }
+                    }
+                }
+            }
+            //入る三角形が無ければ、残っている一番前の三角形から新しく始める
+            if (best == kInvalidIndex) {
+                finish_meshlet();
+                while (emitted_list[cursor]) {
+                    cursor++;
+                }
+                best = (unsigned int)cursor;
+            }
+
+            const unsigned int* triangle = index_list + best * 3;
+            for (int k = 0; k < 3; k++) {
+                unsigned int vertex = triangle[k];
+                if (local_list[vertex] < 0) {
+                    local_list[vertex] = (short)meshlet.vertexCount;
+                    out_vertex_list->push_back(vertex);
+                    meshlet.vertexCount++;
+                }
+                out_triangle_list->push_back((uint8_t)local_list[vertex]);
+                live_list[vertex]--;
+            }
+            emitted_list[best] = 1;
+            meshlet.triangleCount++;
+            normal_sum += normal_list[best];
+
+            //頂点が一杯でも、頂点の増えない三角形は続けて入れられる
+            if (meshlet.triangleCount >= max_triangle_count) {
+                finish_meshlet();
+            }
+        }
+        finish_meshlet();
+    }
+    //------------------------------------------------------------------------------------------
+    void BuildMeshlets(ModelMesh* mesh, const MeshletOption& option) {
+        mesh->meshletList.clear();
+        mesh->meshletVertexList.clear();
+        mesh->meshletTriangleList.clear();
+        if (mesh->IsIndex32()) {
+            BuildMeshlets(&mesh->meshletList, &mesh->meshletVertexList, &mesh->meshletTriangleList, mesh->indexList32.data(), mesh->indexList32.size(),
+                mesh->vertexList.data(), mesh->vertexList.size(), option);
+        }
+        else {
+            std::vector<unsigned int> index_list(mesh->indexList.begin(), mesh->indexList.end());
+            BuildMeshlets(&mesh->meshletList, &mesh->meshletVertexList, &mesh->meshletTriangleList, index_list.data(), index_list.size(),
+                mesh->vertexList.data(), mesh->vertexList.size(), option);
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    bool IsMeshletBackfacing(const ModelMeshlet& meshlet, const glm::vec3& camera_position) {
+        if (meshlet.coneCutoff >= 1.0f) {
+            return false;
+        }
+        //球のどこから見ても円錐の外(裏側)になっていればよい
+        glm::vec3 view = meshlet.center - camera_position;
+        return glm::dot(view, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(view) + meshlet.radius;
+    }
+    //------------------------------------------------------------------------------------------
+} // fbx
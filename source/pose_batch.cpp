@@ -0,0 +1,57 @@
+﻿#include "../include/pose_batch.h"
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+namespace fbx {
+
+    //------------------------------------------------------------------------------------------
+    void EvaluatePoseBatch(glm::mat4* out_palette_list, size_t palette_size, const PoseRequest* request_list, size_t request_count,
+        ThreadPool* thread_pool, const std::function<void(const PoseRequest&, glm::mat4*)>& evaluate_pose) {
+        //同じクリップの近い時刻が続くように並べる(キーを読む場所が近くなる)
+        std::vector<uint32_t> order(request_count);
+        for (size_t i = 0; i < request_count; i++) {
+            order[i] = (uint32_t)i;
+        }
+        std::sort(order.begin(), order.end(), [request_list](uint32_t a, uint32_t b) {
+            const auto& request_a = request_list[a];
+            const auto& request_b = request_list[b];
+            if (request_a.animIndex != request_b.animIndex) {
+                return request_a.animIndex < request_b.animIndex;
+            }
+            return request_a.frame < request_b.frame;
+        });
+
+        //並べた順に区切って配る。区切りが細かすぎるとスレッドの受け渡しが目立つ
+        const size_t kChunkSize = 64;
+        size_t chunk_count = (request_count + kChunkSize - 1) / kChunkSize;
+        auto run_chunk = [&](size_t chunk) {
+            size_t begin = chunk * kChunkSize;
+            size_t end = std::min(begin + kChunkSize, request_count);
+            const PoseRequest* previous = nullptr;
+            glm::mat4* previous_palette = nullptr;
+            for (size_t i = begin; i < end; i++) {
+                const auto& request = request_list[order[i]];
+                glm::mat4* palette = out_palette_list + (size_t)request.instance * palette_size;
+                if (previous != nullptr && previous->animIndex == request.animIndex && previous->frame == request.frame) {
+                    std::copy(previous_palette, previous_palette + palette_size, palette);
+                }
+                else {
+                    evaluate_pose(request, palette);
+                }
+                previous = &request;
+                previous_palette = palette;
+            }
+        };
+
+        if (thread_pool == nullptr || thread_pool->GetThreadCount() <= 1) {
+            for (size_t chunk = 0; chunk < chunk_count; chunk++) {
+                run_chunk(chunk);
+            }
+            return;
+        }
+        thread_pool->ParallelFor(chunk_count, run_chunk);
+    }
+    //------------------------------------------------------------------------------------------
+} // fbx
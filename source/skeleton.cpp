@@ -0,0 +1,103 @@
+﻿#include "../include/skeleton.h"
+#include "../include/animation_clip.h"
+
+#include <cassert>
+#include <map>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FBX_SKELETON_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace fbx {
+
+    //------------------------------------------------------------------------------------------
+    void MultiplyMatrix(glm::mat4* out, const glm::mat4& a, const glm::mat4& b) {
+#ifdef FBX_SKELETON_SSE
+        //列ごとに a の4列を b の要素で重み付けして足す
+        __m128 a0 = _mm_loadu_ps(&a[0][0]);
+        __m128 a1 = _mm_loadu_ps(&a[1][0]);
+        __m128 a2 = _mm_loadu_ps(&a[2][0]);
+        __m128 a3 = _mm_loadu_ps(&a[3][0]);
+        __m128 column[4];
+        for (int c = 0; c < 4; c++) {
+            __m128 r = _mm_mul_ps(a0, _mm_set1_ps(b[c][0]));
+            r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(b[c][1])));
+            r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(b[c][2])));
+            r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(b[c][3])));
+            column[c] = r;
+        }
+        for (int c = 0; c < 4; c++) {
+            _mm_storeu_ps(&(*out)[c][0], column[c]);
+        }
+#else
+        *out = a * b;
+#endif
+    }
+
+    //-- Skeleton Class --//
+    Skeleton::Skeleton() {
+    }
+    //------------------------------------------------------------------------------------------
+    void Skeleton::Initialize(const std::vector<std::string>& joint_name_list, const std::vector<int>& parent_list, const std::vector<glm::mat4>& rest_local_list,
+        const std::vector<std::string>& bone_node_name_list, const std::vector<glm::mat4>& inv_bind_pose_list) {
+        assert(joint_name_list.size() == parent_list.size() && joint_name_list.size() == rest_local_list.size());
+        assert(bone_node_name_list.size() == inv_bind_pose_list.size());
+
+        //親から順に並べ直す
+        auto order = SortNodeByHierarchy(parent_list);
+        std::vector<int> new_index(order.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            new_index[order[i]] = (int)i;
+        }
+        this->mJointNameList.clear();
+        this->mParentList.clear();
+        this->mRestLocalList.clear();
+        std::map<std::string, int> joint_id_dictionary;
+        for (int original : order) {
+            joint_id_dictionary.insert({ joint_name_list[original], (int)this->mJointNameList.size() });
+            this->mJointNameList.push_back(joint_name_list[original]);
+            this->mParentList.push_back(parent_list[original] >= 0 ? new_index[parent_list[original]] : -1);
+            this->mRestLocalList.push_back(rest_local_list[original]);
+        }
+
+        //ボーンを関節ごとにまとめる
+        int joint_count = this->GetJointCount();
+        int bone_count = (int)bone_node_name_list.size();
+        this->mInvBindPoseList = inv_bind_pose_list;
+        this->mBoneJointList.assign(bone_count, -1);
+        this->mJointBoneOffsetList.assign(joint_count + 1, 0);
+        for (int i = 0; i < bone_count; i++) {
+            auto it = joint_id_dictionary.find(bone_node_name_list[i]);
+            assert(it != joint_id_dictionary.end());
+            this->mBoneJointList[i] = it->second;
+            this->mJointBoneOffsetList[it->second + 1]++;
+        }
+        for (int j = 0; j < joint_count; j++) {
+            this->mJointBoneOffsetList[j + 1] += this->mJointBoneOffsetList[j];
+        }
+        this->mJointBoneList.assign(bone_count, -1);
+        std::vector<int> fill(this->mJointBoneOffsetList.begin(), this->mJointBoneOffsetList.end() - 1);
+        for (int i = 0; i < bone_count; i++) {
+            this->mJointBoneList[fill[this->mBoneJointList[i]]++] = i;
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    void Skeleton::SolvePose(const glm::mat4* local_list, glm::mat4* out_global_list, glm::mat4* out_palette) const {
+        int joint_count = this->GetJointCount();
+        for (int j = 0; j < joint_count; j++) {
+            int parent = this->mParentList[j];
+            if (parent >= 0) {
+                MultiplyMatrix(&out_global_list[j], out_global_list[parent], local_list[j]);
+            }
+            else {
+                out_global_list[j] = local_list[j];
+            }
+            for (int b = this->mJointBoneOffsetList[j]; b < this->mJointBoneOffsetList[j + 1]; b++) {
+                int bone = this->mJointBoneList[b];
+                MultiplyMatrix(&out_palette[bone], out_global_list[j], this->mInvBindPoseList[bone]);
+            }
+        }
+    }
+    //------------------------------------------------------------------------------------------
+} // fbx
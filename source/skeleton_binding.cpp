@@ -0,0 +1,39 @@
+﻿#include "../include/skeleton_binding.h"
+
+namespace fbx {
+
+    //------------------------------------------------------------------------------------------
+    void BindClip(SkeletonBinding* out_binding, const AnimationClip& clip, const ModelMesh& mesh, int anim_index) {
+        ResolveSkeletonBinding(out_binding, mesh, anim_index, true, [&clip](const std::string& name) { return clip.FindNode(name); });
+        BuildEvaluateOrder(out_binding, clip.GetNodeCount(), [&clip](int node_id) { return clip.GetParent(node_id); });
+    }
+    //------------------------------------------------------------------------------------------
+    void GetClipMeshMatrix(glm::mat4* out_matrix, const AnimationClip& clip, float frame, const ModelMesh& mesh, const SkeletonBinding& binding) {
+        if (binding.meshNodeId < 0) {
+            *out_matrix = glm::mat4(1.0);
+            return;
+        }
+        *out_matrix = clip.EvaluateGlobalMatrix(binding.meshNodeId, frame) * mesh.invMeshBaseposeMatrix;
+    }
+    //------------------------------------------------------------------------------------------
+    void GetClipBoneMatrix(glm::mat4* out_matrix_list, const AnimationClip& clip, float frame, const ModelMesh& mesh, const SkeletonBinding& binding) {
+        thread_local std::vector<glm::mat4> pose;
+        size_t evaluate_count = binding.evaluateNodeList.size();
+        if (pose.size() < evaluate_count) {
+            pose.resize(evaluate_count);
+        }
+
+        for (size_t i = 0; i < evaluate_count; i++) {
+            glm::mat4 local = clip.EvaluateLocalMatrix(binding.evaluateNodeList[i], frame);
+            int parent = binding.evaluateParentList[i];
+            pose[i] = (parent >= 0) ? pose[parent] * local : local;
+        }
+
+        size_t size = binding.boneSlotList.size();
+        for (size_t i = 0; i < size; ++i) {
+            int slot = binding.boneSlotList[i];
+            out_matrix_list[i] = (slot < 0) ? glm::mat4(1.0) : pose[slot] * mesh.invBoneBaseposeMatrixList[i];
+        }
+    }
+    //------------------------------------------------------------------------------------------
+} // fbx
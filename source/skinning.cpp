@@ -0,0 +1,261 @@
+﻿#include "../include/skinning.h"
+
+#include <cmath>
+#include <cstring>
+#include <atomic>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define FBX_SKINNING_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+//MSVCは関数ごとの指定なしで全ての命令を使える
+#define FBX_TARGET_SSE41
+#define FBX_TARGET_AVX2
+#else
+#define FBX_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define FBX_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+namespace fbx {
+
+    namespace {
+        //------------------------------------------------------------------------------------------
+        void SkinVerticesScalar(SkinnedVertex* out_vertex_list, const ModelVertex* vertex_list, size_t vertex_count, const glm::mat4* palette) {
+            for (size_t i = 0; i < vertex_count; i++) {
+                const auto& vertex = vertex_list[i];
+                glm::mat4 matrix = palette[vertex.boneIndex[0]] * vertex.boneWeight[0];
+                for (int j = 1; j < 4; j++) {
+                    if (vertex.boneWeight[j] != 0.0f) {
+                        matrix += palette[vertex.boneIndex[j]] * vertex.boneWeight[j];
+                    }
+                }
+                out_vertex_list[i].position = glm::vec3(matrix * glm::vec4(vertex.position, 1.0f));
+                glm::vec3 normal = glm::vec3(matrix * glm::vec4(vertex.normal, 0.0f));
+                float length = glm::length(normal);
+                out_vertex_list[i].normal = length > 0.0f ? normal / length : normal;
+            }
+        }
+
+#ifdef FBX_SKINNING_X86
+        //------------------------------------------------------------------------------------------
+        //xyzだけ書く。4要素で書くと隣の頂点を壊すので
+        FBX_TARGET_SSE41 inline void StoreVec3(glm::vec3* out, __m128 value) {
+            float tmp[4];
+            _mm_storeu_ps(tmp, value);
+            std::memcpy(out, tmp, sizeof(glm::vec3));
+        }
+        //------------------------------------------------------------------------------------------
+        FBX_TARGET_SSE41 inline __m128 NormalizeVec3(__m128 value) {
+            //rsqrtの近似をニュートン法で1回補正する(sqrtと除算より速い)
+            __m128 length_sq = _mm_dp_ps(value, value, 0x7F);
+            __m128 inv_length = _mm_rsqrt_ps(length_sq);
+            __m128 half_length_sq = _mm_mul_ps(length_sq, _mm_set1_ps(0.5f));
+            inv_length = _mm_mul_ps(inv_length, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(half_length_sq, _mm_mul_ps(inv_length, inv_length))));
+            __m128 mask = _mm_cmpgt_ps(length_sq, _mm_setzero_ps());
+            return _mm_blendv_ps(value, _mm_mul_ps(value, inv_length), mask);
+        }
+        //------------------------------------------------------------------------------------------
+        //4列をそれぞれボーン4本分重み付けして足し、位置と法線を変換する
+        FBX_TARGET_SSE41 void SkinVerticesSse41(SkinnedVertex* out_vertex_list, const ModelVertex* vertex_list, size_t vertex_count, const glm::mat4* palette) {
+            for (size_t i = 0; i < vertex_count; i++) {
+                const auto& vertex = vertex_list[i];
+                __m128 column[4];
+                {
+                    const float* m = &palette[vertex.boneIndex[0]][0][0];
+                    __m128 w = _mm_set1_ps(vertex.boneWeight[0]);
+                    for (int c = 0; c < 4; c++) {
+                        column[c] = _mm_mul_ps(_mm_loadu_ps(m + c * 4), w);
+                    }
+                }
+                for (int j = 1; j < 4; j++) {
+                    const float* m = &palette[vertex.boneIndex[j]][0][0];
+                    __m128 w = _mm_set1_ps(vertex.boneWeight[j]);
+                    for (int c = 0; c < 4; c++) {
+                        column[c] = _mm_add_ps(column[c], _mm_mul_ps(_mm_loadu_ps(m + c * 4), w));
+                    }
+                }
+
+                __m128 position = _mm_add_ps(column[3], _mm_mul_ps(column[0], _mm_set1_ps(vertex.position.x)));
+                position = _mm_add_ps(position, _mm_mul_ps(column[1], _mm_set1_ps(vertex.position.y)));
+                position = _mm_add_ps(position, _mm_mul_ps(column[2], _mm_set1_ps(vertex.position.z)));
+                __m128 normal = _mm_mul_ps(column[0], _mm_set1_ps(vertex.normal.x));
+                normal = _mm_add_ps(normal, _mm_mul_ps(column[1], _mm_set1_ps(vertex.normal.y)));
+                normal = _mm_add_ps(normal, _mm_mul_ps(column[2], _mm_set1_ps(vertex.normal.z)));
+
+                StoreVec3(&out_vertex_list[i].position, position);
+                StoreVec3(&out_vertex_list[i].normal, NormalizeVec3(normal));
+            }
+        }
+        //------------------------------------------------------------------------------------------
+        //列0,1と列2,3を256bitに並べて、重み付けの加算を半分の命令数にする
+        FBX_TARGET_AVX2 void SkinVerticesAvx2(SkinnedVertex* out_vertex_list, const ModelVertex* vertex_list, size_t vertex_count, const glm::mat4* palette) {
+            const __m256 one_high = _mm256_setr_ps(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f);
+            for (size_t i = 0; i < vertex_count; i++) {
+                const auto& vertex = vertex_list[i];
+                __m256 column01;
+                __m256 column23;
+                {
+                    const float* m = &palette[vertex.boneIndex[0]][0][0];
+                    __m256 w = _mm256_set1_ps(vertex.boneWeight[0]);
+                    column01 = _mm256_mul_ps(_mm256_loadu_ps(m), w);
+                    column23 = _mm256_mul_ps(_mm256_loadu_ps(m + 8), w);
+                }
+                for (int j = 1; j < 4; j++) {
+                    const float* m = &palette[vertex.boneIndex[j]][0][0];
+                    __m256 w = _mm256_set1_ps(vertex.boneWeight[j]);
+                    column01 = _mm256_fmadd_ps(_mm256_loadu_ps(m), w, column01);
+                    column23 = _mm256_fmadd_ps(_mm256_loadu_ps(m + 8), w, column23);
+                }
+
+                //位置: 列0*x + 列1*y + 列2*z + 列3*1、法線: 列0*x + 列1*y + 列2*z
+                __m128 px = _mm_set1_ps(vertex.position.x);
+                __m128 py = _mm_set1_ps(vertex.position.y);
+                __m128 pz = _mm_set1_ps(vertex.position.z);
+                __m128 nx = _mm_set1_ps(vertex.normal.x);
+                __m128 ny = _mm_set1_ps(vertex.normal.y);
+                __m128 nz = _mm_set1_ps(vertex.normal.z);
+                __m256 position = _mm256_mul_ps(column01, _mm256_set_m128(py, px));
+                position = _mm256_fmadd_ps(column23, _mm256_blend_ps(_mm256_castps128_ps256(pz), one_high, 0xF0), position);
+                __m256 normal = _mm256_mul_ps(column01, _mm256_set_m128(ny, nx));
+                normal = _mm256_fmadd_ps(column23, _mm256_blend_ps(_mm256_castps128_ps256(nz), _mm256_setzero_ps(), 0xF0), normal);
+                //上位と下位の128bitを足すと4列分の和になる
+                __m128 position_sum = _mm_add_ps(_mm256_castps256_ps128(position), _mm256_extractf128_ps(position, 1));
+                __m128 normal_sum = _mm_add_ps(_mm256_castps256_ps128(normal), _mm256_extractf128_ps(normal, 1));
+
+                StoreVec3(&out_vertex_list[i].position, position_sum);
+                StoreVec3(&out_vertex_list[i].normal, NormalizeVec3(normal_sum));
+            }
+        }
+#endif
+
+        typedef void(*SkinFunc)(SkinnedVertex*, const ModelVertex*, size_t, const glm::mat4*);
+
+        //------------------------------------------------------------------------------------------
+        bool IsKernelSupported(SkinningKernel kernel) {
+            if (kernel == kSkinningScalar) {
+                return true;
+            }
+#if defined(FBX_SKINNING_X86) && defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 1);
+            bool sse41 = (info[2] & (1 << 19)) != 0;
+            bool fma = (info[2] & (1 << 12)) != 0;
+            bool avx = (info[2] & (1 << 28)) != 0;
+            //OSがYMMレジスタを保存するか
+            bool ymm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+            __cpuidex(info, 7, 0);
+            bool avx2 = (info[1] & (1 << 5)) != 0;
+            if (kernel == kSkinningSse41) {
+                return sse41;
+            }
+            if (kernel == kSkinningAvx2) {
+                return avx && ymm && fma && avx2;
+            }
+#elif defined(FBX_SKINNING_X86)
+            if (kernel == kSkinningSse41) {
+                return __builtin_cpu_supports("sse4.1");
+            }
+            if (kernel == kSkinningAvx2) {
+                return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+            }
+#endif
+            return false;
+        }
+        //------------------------------------------------------------------------------------------
+        SkinningKernel DetectKernel() {
+            if (IsKernelSupported(kSkinningAvx2)) {
+                return kSkinningAvx2;
+            }
+            if (IsKernelSupported(kSkinningSse41)) {
+                return kSkinningSse41;
+            }
+            return kSkinningScalar;
+        }
+        //------------------------------------------------------------------------------------------
+        std::atomic<int>& CurrentKernel() {
+            static std::atomic<int> kernel((int)DetectKernel());
+            return kernel;
+        }
+        //------------------------------------------------------------------------------------------
+        SkinFunc GetSkinFunc() {
+            switch (CurrentKernel().load(std::memory_order_relaxed)) {
+#ifdef FBX_SKINNING_X86
+            case kSkinningAvx2:
+                return SkinVerticesAvx2;
+            case kSkinningSse41:
+                return SkinVerticesSse41;
+#endif
+            default:
+                return SkinVerticesScalar;
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    SkinningKernel GetSkinningKernel() {
+        return (SkinningKernel)CurrentKernel().load(std::memory_order_relaxed);
+    }
+    //------------------------------------------------------------------------------------------
+    bool SetSkinningKernel(SkinningKernel kernel) {
+        if (kernel == kSkinningAuto) {
+            kernel = DetectKernel();
+        }
+        if (!IsKernelSupported(kernel)) {
+            return false;
+        }
+        CurrentKernel().store((int)kernel, std::memory_order_relaxed);
+        return true;
+    }
+    //------------------------------------------------------------------------------------------
+    const char* GetSkinningKernelName(SkinningKernel kernel) {
+        switch (kernel) {
+        case kSkinningAuto:
+            return "auto";
+        case kSkinningScalar:
+            return "scalar";
+        case kSkinningSse41:
+            return "sse4.1";
+        case kSkinningAvx2:
+            return "avx2";
+        }
+        return "unknown";
+    }
+    //------------------------------------------------------------------------------------------
+    void SkinVertices(SkinnedVertex* out_vertex_list, const ModelVertex* vertex_list, size_t vertex_count, const glm::mat4* palette) {
+        GetSkinFunc()(out_vertex_list, vertex_list, vertex_count, palette);
+    }
+    //------------------------------------------------------------------------------------------
+    void SkinMesh(SkinnedVertex* out_vertex_list, const ModelMesh& mesh, const glm::mat4* palette) {
+        auto vertex_list = mesh.GetVertexSpan();
+        SkinVertices(out_vertex_list, vertex_list.data(), vertex_list.size(), palette);
+    }
+    //------------------------------------------------------------------------------------------
+    void SkinMeshInstances(SkinnedVertex* out_vertex_list, const ModelMesh& mesh, const glm::mat4* palette_list, size_t instance_count, ThreadPool* thread_pool) {
+        auto vertex_list = mesh.GetVertexSpan();
+        size_t vertex_count = vertex_list.size();
+        size_t palette_size = std::max<size_t>(mesh.boneNodeNameList.size(), 1);
+        SkinFunc skin = GetSkinFunc();
+        if (thread_pool == nullptr || thread_pool->GetThreadCount() <= 1) {
+            for (size_t i = 0; i < instance_count; i++) {
+                skin(out_vertex_list + i * vertex_count, vertex_list.data(), vertex_count, palette_list + i * palette_size);
+            }
+            return;
+        }
+        //大きなメッシュはインスタンスの中でも分割して、スレッドごとの量をそろえる
+        const size_t kChunkVertexCount = 4096;
+        size_t chunk_per_instance = std::max<size_t>((vertex_count + kChunkVertexCount - 1) / kChunkVertexCount, 1);
+        thread_pool->ParallelFor(instance_count * chunk_per_instance, [&](size_t task) {
+            size_t instance = task / chunk_per_instance;
+            size_t begin = (task % chunk_per_instance) * kChunkVertexCount;
+            size_t end = std::min(begin + kChunkVertexCount, vertex_count);
+            if (begin >= end) {
+                return;
+            }
+            skin(out_vertex_list + instance * vertex_count + begin, vertex_list.data() + begin, end - begin, palette_list + instance * palette_size);
+        });
+    }
+    //------------------------------------------------------------------------------------------
+} // fbx
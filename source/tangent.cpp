@@ -0,0 +1,165 @@
+﻿#include "../include/tangent.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+namespace fbx {
+
+    namespace {
+        const unsigned int kInvalidIndex = 0xffffffff;
+
+        //三角形の表裏。UVの面積が0の三角形はどちらにも付く
+        const uint8_t kOrientAny = 0;
+        const uint8_t kOrientPreserving = 1;
+        const uint8_t kOrientMirrored = 2;
+
+        //長さが0なら0のまま返す(MikkTSpaceのNormalizeSafe)
+        glm::vec3 NormalizeSafe(const glm::vec3& v) {
+            float length = glm::length(v);
+            return length > FLT_MIN ? v / length : glm::vec3(0.0f);
+        }
+
+        //法線の面に落とす
+        glm::vec3 Project(const glm::vec3& v, const glm::vec3& normal) {
+            return v - normal * glm::dot(normal, v);
+        }
+
+        //法線に垂直な適当な向き。UVが無い・潰れている頂点に使う
+        glm::vec3 GetOrthogonal(const glm::vec3& normal) {
+            glm::vec3 axis = std::fabs(normal.x) < 0.9f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+            glm::vec3 tangent = NormalizeSafe(Project(axis, normal));
+            return glm::dot(tangent, tangent) > 0.0f ? tangent : glm::vec3(1, 0, 0);
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    size_t GenerateTangents(ModelMesh* mesh) {
+        auto& vertex_list = mesh->vertexList;
+        std::vector<unsigned int> index_list;
+        if (!mesh->indexList32.empty()) {
+            index_list.swap(mesh->indexList32);
+        }
+        else {
+            index_list.assign(mesh->indexList.begin(), mesh->indexList.end());
+        }
+        size_t vertex_count = vertex_list.size();
+        size_t triangle_count = index_list.size() / 3;
+
+        //三角形ごとのUVのuの向き(MikkTSpaceのvOs)と表裏
+        std::vector<glm::vec3> face_tangent_list(triangle_count, glm::vec3(0.0f));
+        std::vector<uint8_t> orient_list(triangle_count, kOrientAny);
+        //頂点ごとに、表と裏のどちらの三角形に使われたか
+        std::vector<uint8_t> vertex_orient_list(vertex_count, kOrientAny);
+        for (size_t t = 0; t < triangle_count; t++) {
+            const auto& v0 = vertex_list[index_list[t * 3 + 0]];
+            const auto& v1 = vertex_list[index_list[t * 3 + 1]];
+            const auto& v2 = vertex_list[index_list[t * 3 + 2]];
+            glm::vec3 d1 = v1.position - v0.position;
+            glm::vec3 d2 = v2.position - v0.position;
+            glm::vec2 s1 = v1.uv - v0.uv;
+            glm::vec2 s2 = v2.uv - v0.uv;
+            float area = s1.x * s2.y - s1.y * s2.x;
+            if (std::fabs(area) <= FLT_MIN) {
+                continue;
+            }
+            orient_list[t] = area > 0.0f ? kOrientPreserving : kOrientMirrored;
+            glm::vec3 tangent = d1 * s2.y - d2 * s1.y;
+            float length = glm::length(tangent);
+            if (length > FLT_MIN) {
+                face_tangent_list[t] = tangent * ((area > 0.0f ? 1.0f : -1.0f) / length);
+            }
+            for (int k = 0; k < 3; k++) {
+                vertex_orient_list[index_list[t * 3 + k]] |= orient_list[t];
+            }
+        }
+
+        //表と裏の両方に使われた頂点は複製し、裏の三角形を複製の方につなぎ直す
+        std::vector<unsigned int> split_list(vertex_count, kInvalidIndex);
+        size_t split_count = 0;
+        for (size_t v = 0; v < vertex_count; v++) {
+            if (vertex_orient_list[v] == (kOrientPreserving | kOrientMirrored)) {
+                split_list[v] = (unsigned int)(vertex_count + split_count);
+                split_count++;
+            }
+        }
+        if (split_count > 0) {
+            vertex_list.reserve(vertex_count + split_count);
+            for (size_t v = 0; v < vertex_count; v++) {
+                if (split_list[v] != kInvalidIndex) {
+                    vertex_list.push_back(vertex_list[v]);
+                }
+            }
+            for (size_t t = 0; t < triangle_count; t++) {
+                if (orient_list[t] != kOrientMirrored) {
+                    continue;
+                }
+                for (int k = 0; k < 3; k++) {
+                    unsigned int& index = index_list[t * 3 + k];
+                    if (split_list[index] != kInvalidIndex) {
+                        index = split_list[index];
+                    }
+                }
+            }
+            //複製した頂点は元の頂点より後ろで、元の番号の順に並んでいるので、後ろに足すだけで小さい順のまま
+            for (auto& channel : mesh->blendShapeList) {
+                for (auto& target : channel.targetList) {
+                    size_t delta_count = target.vertexIndexList.size();
+                    for (size_t i = 0; i < delta_count; i++) {
+                        unsigned int split = split_list[target.vertexIndexList[i]];
+                        if (split != kInvalidIndex) {
+                            target.vertexIndexList.push_back(split);
+                            target.deltaList.push_back(target.deltaList[i]);
+                        }
+                    }
+                }
+            }
+        }
+
+        //角ごとに、三角形の向きを頂点の法線の面に落として角の大きさで重みを付けて足す
+        std::vector<glm::vec3> tangent_sum_list(vertex_list.size(), glm::vec3(0.0f));
+        for (size_t t = 0; t < triangle_count; t++) {
+            if (orient_list[t] == kOrientAny) {
+                continue;
+            }
+            for (int k = 0; k < 3; k++) {
+                unsigned int index = index_list[t * 3 + k];
+                const auto& vertex = vertex_list[index];
+                const glm::vec3& p1 = vertex_list[index_list[t * 3 + (k + 1) % 3]].position;
+                const glm::vec3& p2 = vertex_list[index_list[t * 3 + (k + 2) % 3]].position;
+                glm::vec3 edge1 = NormalizeSafe(Project(p1 - vertex.position, vertex.normal));
+                glm::vec3 edge2 = NormalizeSafe(Project(p2 - vertex.position, vertex.normal));
+                float angle = std::acos(std::min(std::max(glm::dot(edge1, edge2), -1.0f), 1.0f));
+                tangent_sum_list[index] += NormalizeSafe(Project(face_tangent_list[t], vertex.normal)) * angle;
+            }
+        }
+        mesh->tangentList.resize(vertex_list.size());
+        for (size_t v = 0; v < vertex_list.size(); v++) {
+            glm::vec3 tangent = NormalizeSafe(tangent_sum_list[v]);
+            if (glm::dot(tangent, tangent) == 0.0f) {
+                tangent = GetOrthogonal(vertex_list[v].normal);
+            }
+            //複製した頂点と裏の三角形だけに使われた頂点は従法線が逆向き
+            bool mirrored = v >= vertex_count || vertex_orient_list[v] == kOrientMirrored;
+            mesh->tangentList[v] = glm::vec4(tangent, mirrored ? -1.0f : 1.0f);
+        }
+
+        //溶接と同じ決まりで入れ直す
+        mesh->indexList.clear();
+        mesh->indexList32.clear();
+        if (vertex_list.size() > 0xffff) {
+            mesh->indexList32.swap(index_list);
+        }
+        else {
+            mesh->indexList.assign(index_list.begin(), index_list.end());
+        }
+        return split_count;
+    }
+    //------------------------------------------------------------------------------------------
+    size_t GetTangentMemorySize(const ModelMesh& mesh) {
+        return mesh.tangentList.size() * sizeof(glm::vec4);
+    }
+    //------------------------------------------------------------------------------------------
+} // fbx
@@ -0,0 +1,148 @@
+﻿#include "../include/thread_pool.h"
+
+namespace fbx {
+
+    //-- ThreadPool Class --//
+    ThreadPool::ThreadPool(int thread_count) {
+        if (thread_count <= 0) {
+            thread_count = (int)std::thread::hardware_concurrency();
+            if (thread_count <= 0) {
+                thread_count = 1;
+            }
+        }
+        this->mGeneration = 0;
+        this->mExit = false;
+        this->mActiveWorker = 0;
+        this->mFunc = nullptr;
+
+        for (int i = 0; i < thread_count; i++) {
+            this->mQueueList.push_back(std::unique_ptr<TaskQueue>(new TaskQueue()));
+        }
+        //0番は呼び出し元のスレッドが使う
+        for (int i = 1; i < thread_count; i++) {
+            this->mThreadList.push_back(std::thread(&ThreadPool::WorkerMain, this, i));
+        }
+    }
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->mMutex);
+            this->mExit = true;
+        }
+        this->mWakeCondition.notify_all();
+        for (auto& thread : this->mThreadList) {
+            thread.join();
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& func) {
+        if (count == 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> call_lock(this->mCallMutex);
+
+        int worker_count = this->GetThreadCount();
+        if (worker_count == 1 || count == 1) {
+            for (size_t i = 0; i < count; i++) {
+                func(i);
+            }
+            return;
+        }
+
+        //連続した範囲ごとに配っておく。重い仕事が偏っても盗まれるので均される
+        for (int w = 0; w < worker_count; w++) {
+            size_t begin = count * w / worker_count;
+            size_t end = count * (w + 1) / worker_count;
+            auto& queue = *this->mQueueList[w];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            for (size_t i = begin; i < end; i++) {
+                queue.taskList.push_back(i);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(this->mMutex);
+            this->mFunc = &func;
+            this->mException = nullptr;
+            this->mActiveWorker = worker_count - 1;
+            this->mGeneration++;
+        }
+        this->mWakeCondition.notify_all();
+
+        this->RunTasks(0);
+
+        std::exception_ptr exception;
+        {
+            std::unique_lock<std::mutex> lock(this->mMutex);
+            this->mDoneCondition.wait(lock, [this] { return this->mActiveWorker == 0; });
+            this->mFunc = nullptr;
+            exception = this->mException;
+            this->mException = nullptr;
+        }
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    void ThreadPool::WorkerMain(int worker_index) {
+        uint64_t generation = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(this->mMutex);
+                this->mWakeCondition.wait(lock, [&] { return this->mExit || this->mGeneration != generation; });
+                if (this->mExit) {
+                    return;
+                }
+                generation = this->mGeneration;
+            }
+
+            this->RunTasks(worker_index);
+
+            std::lock_guard<std::mutex> lock(this->mMutex);
+            this->mActiveWorker--;
+            if (this->mActiveWorker == 0) {
+                this->mDoneCondition.notify_one();
+            }
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    void ThreadPool::RunTasks(int worker_index) {
+        size_t task;
+        while (this->PopTask(worker_index, &task)) {
+            try {
+                (*this->mFunc)(task);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(this->mMutex);
+                if (!this->mException) {
+                    this->mException = std::current_exception();
+                }
+            }
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    //自分のキューは前から取り、空なら他のキューの後ろから盗む
+    bool ThreadPool::PopTask(int worker_index, size_t* task) {
+        {
+            auto& queue = *this->mQueueList[worker_index];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.taskList.empty()) {
+                *task = queue.taskList.front();
+                queue.taskList.pop_front();
+                return true;
+            }
+        }
+        int worker_count = this->GetThreadCount();
+        for (int i = 1; i < worker_count; i++) {
+            auto& queue = *this->mQueueList[(worker_index + i) % worker_count];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.taskList.empty()) {
+                *task = queue.taskList.back();
+                queue.taskList.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+    //------------------------------------------------------------------------------------------
+} // fbx
@@ -0,0 +1,349 @@
+﻿#include "../include/vertex_format.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <glm/gtc/quaternion.hpp>
+
+namespace fbx {
+
+    namespace {
+        template<class T>
+        void WriteValue(uint8_t* out, const T& value) {
+            std::memcpy(out, &value, sizeof(T));
+        }
+
+        template<class T>
+        T ReadValue(const uint8_t* data) {
+            T value;
+            std::memcpy(&value, data, sizeof(T));
+            return value;
+        }
+
+        //-1～1を10bitの符号付き整数にする
+        uint32_t PackSnorm10(float value) {
+            float clamped = std::min(std::max(value, -1.0f), 1.0f);
+            return (uint32_t)(int32_t)std::floor(clamped * 511.0f + 0.5f) & 0x3ffu;
+        }
+
+        float UnpackSnorm10(uint32_t bits) {
+            //符号を広げる
+            int32_t value = (int32_t)(bits << 22) >> 22;
+            return std::max((float)value / 511.0f, -1.0f);
+        }
+
+        //0～1を16bitの正規化にする
+        uint16_t PackUnorm16(float value) {
+            float clamped = std::min(std::max(value, 0.0f), 1.0f);
+            return (uint16_t)std::floor(clamped * 65535.0f + 0.5f);
+        }
+
+        //-1～1を16bitの符号付き正規化にする
+        int16_t PackSnorm16(float value) {
+            float clamped = std::min(std::max(value, -1.0f), 1.0f);
+            return (int16_t)std::floor(clamped * 32767.0f + 0.5f);
+        }
+
+        float UnpackSnorm16(int16_t value) {
+            return std::max((float)value / 32767.0f, -1.0f);
+        }
+
+        //接線をx、従法線をy、法線をzに移す回転。接線は法線に垂直になるように直す
+        glm::quat MakeTangentFrame(const glm::vec3& normal, const glm::vec4& tangent) {
+            float normal_length = glm::length(normal);
+            glm::vec3 n = normal_length > 0.0f ? normal / normal_length : glm::vec3(0, 0, 1);
+            glm::vec3 t = glm::vec3(tangent.x, tangent.y, tangent.z);
+            t = t - n * glm::dot(n, t);
+            float tangent_length = glm::length(t);
+            if (tangent_length > 1e-6f) {
+                t = t / tangent_length;
+            }
+            else {
+                //接線が無ければ法線に垂直な適当な向きにする
+                glm::vec3 axis = std::fabs(n.x) < 0.9f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+                t = glm::normalize(axis - n * glm::dot(n, axis));
+            }
+            glm::mat3 frame;
+            frame[0] = t;
+            frame[1] = glm::cross(n, t);
+            frame[2] = n;
+            return glm::normalize(glm::quat_cast(frame));
+        }
+
+        //最も近い半精度に丸める(非正規化数はゼロ、範囲外は無限大)
+        uint16_t FloatToHalf(float value) {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            uint32_t sign = (bits >> 16) & 0x8000u;
+            int32_t exponent = (int32_t)((bits >> 23) & 0xff) - 127 + 15;
+            uint32_t mantissa = bits & 0x7fffffu;
+            if (exponent <= 0) {
+                return (uint16_t)sign;
+            }
+            if (exponent >= 31) {
+                return (uint16_t)(sign | 0x7c00u);
+            }
+            uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+            //切り捨てた13bitで最近接偶数に丸める。繰り上がりは指数にそのまま伝わる
+            uint32_t rest = mantissa & 0x1fffu;
+            if (rest > 0x1000u || (rest == 0x1000u && (half & 1u))) {
+                half++;
+            }
+            return (uint16_t)half;
+        }
+
+        float HalfToFloat(uint16_t half) {
+            uint32_t sign = (uint32_t)(half & 0x8000u) << 16;
+            uint32_t exponent = (half >> 10) & 0x1fu;
+            uint32_t mantissa = half & 0x3ffu;
+            uint32_t bits;
+            if (exponent == 0) {
+                bits = sign;
+            }
+            else if (exponent == 31) {
+                bits = sign | 0x7f800000u | (mantissa << 13);
+            }
+            else {
+                bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+            }
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        //ウェイトを合計がちょうどscaleになる整数にする。丸めの余りは大きいウェイトから配る
+        void QuantizeWeight(uint32_t* out_weight, const glm::vec4& weight, uint32_t scale) {
+            float total = weight[0] + weight[1] + weight[2] + weight[3];
+            if (total <= 0.0f) {
+                out_weight[0] = scale;
+                out_weight[1] = out_weight[2] = out_weight[3] = 0;
+                return;
+            }
+            int32_t sum = 0;
+            float rest[4];
+            for (int i = 0; i < 4; i++) {
+                float value = std::max(weight[i], 0.0f) / total * (float)scale;
+                out_weight[i] = (uint32_t)std::floor(value);
+                rest[i] = value - (float)out_weight[i];
+                sum += (int32_t)out_weight[i];
+            }
+            for (int32_t remain = (int32_t)scale - sum; remain > 0; remain--) {
+                int best = 0;
+                for (int i = 1; i < 4; i++) {
+                    if (rest[i] > rest[best]) {
+                        best = i;
+                    }
+                }
+                out_weight[best]++;
+                rest[best] = -1.0f;
+            }
+        }
+
+        int AddElement(VertexElement* out_list, VertexSemantic semantic, VertexElementType type, uint32_t offset) {
+            out_list->semantic = semantic;
+            out_list->type = type;
+            out_list->offset = offset;
+            return 1;
+        }
+    }
+
+    //-- Float3Position --//
+    void Float3Position::Encode(uint8_t* out, const ModelVertex& vertex, const glm::vec4&, const VertexEncodeParam&) {
+        WriteValue(out, vertex.position);
+    }
+    //------------------------------------------------------------------------------------------
+    void Float3Position::Decode(ModelVertex* out_vertex, glm::vec4*, const uint8_t* data, const VertexEncodeParam&) {
+        out_vertex->position = ReadValue<glm::vec3>(data);
+    }
+    //------------------------------------------------------------------------------------------
+    int Float3Position::GetElementList(VertexElement* out_list, uint32_t offset) {
+        return AddElement(out_list, kSemanticPosition, kElementFloat3, offset);
+    }
+
+    //-- Unorm16Position --//
+    void Unorm16Position::Encode(uint8_t* out, const ModelVertex& vertex, const glm::vec4&, const VertexEncodeParam& param) {
+        uint16_t value[4] = { 0, 0, 0, 0 };
+        for (int i = 0; i < 3; i++) {
+            value[i] = PackUnorm16((vertex.position[i] - param.positionMin[i]) / param.positionExtent[i]);
+        }
+        WriteValue(out, value);
+    }
+    //------------------------------------------------------------------------------------------
+    void Unorm16Position::Decode(ModelVertex* out_vertex, glm::vec4*, const uint8_t* data, const VertexEncodeParam& param) {
+        for (int i = 0; i < 3; i++) {
+            out_vertex->position[i] = param.positionMin[i] + (float)ReadValue<uint16_t>(data + i * 2) / 65535.0f * param.positionExtent[i];
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    int Unorm16Position::GetElementList(VertexElement* out_list, uint32_t offset) {
+        return AddElement(out_list, kSemanticPosition, kElementUnorm16x4, offset);
+    }
+
+    //-- Float3Normal --//
+    void Float3Normal::Encode(uint8_t* out, const ModelVertex& vertex, const glm::vec4&, const VertexEncodeParam&) {
+        WriteValue(out, vertex.normal);
+    }
+    //------------------------------------------------------------------------------------------
+    void Float3Normal::Decode(ModelVertex* out_vertex, glm::vec4*, const uint8_t* data, const VertexEncodeParam&) {
+        out_vertex->normal = ReadValue<glm::vec3>(data);
+    }
+    //------------------------------------------------------------------------------------------
+    int Float3Normal::GetElementList(VertexElement* out_list, uint32_t offset) {
+        return AddElement(out_list, kSemanticNormal, kElementFloat3, offset);
+    }
+
+    //-- Snorm10Normal --//
+    void Snorm10Normal::Encode(uint8_t* out, const ModelVertex& vertex, const glm::vec4&, const VertexEncodeParam&) {
+        uint32_t bits = PackSnorm10(vertex.normal.x) | (PackSnorm10(vertex.normal.y) << 10) | (PackSnorm10(vertex.normal.z) << 20);
+        WriteValue(out, bits);
+    }
+    //------------------------------------------------------------------------------------------
+    void Snorm10Normal::Decode(ModelVertex* out_vertex, glm::vec4*, const uint8_t* data, const VertexEncodeParam&) {
+        uint32_t bits = ReadValue<uint32_t>(data);
+        out_vertex->normal = glm::vec3(UnpackSnorm10(bits & 0x3ffu), UnpackSnorm10((bits >> 10) & 0x3ffu), UnpackSnorm10((bits >> 20) & 0x3ffu));
+    }
+    //------------------------------------------------------------------------------------------
+    int Snorm10Normal::GetElementList(VertexElement* out_list, uint32_t offset) {
+        return AddElement(out_list, kSemanticNormal, kElementSnorm10x3, offset);
+    }
+
+    //-- QTangentNormal --//
+    void QTangentNormal::Encode(uint8_t* out, const ModelVertex& vertex, const glm::vec4& tangent, const VertexEncodeParam&) {
+        glm::quat frame = MakeTangentFrame(vertex.normal, tangent);
+        if (frame.w < 0.0f) {
+            frame = -frame;
+        }
+        //wが16bitで0に丸まると符号で従法線の向きを表せないので、最小の大きさを残す
+        const float kBias = 1.0f / 32767.0f;
+        if (frame.w < kBias) {
+            float scale = std::sqrt(1.0f - kBias * kBias);
+            frame = glm::quat(kBias, frame.x * scale, frame.y * scale, frame.z * scale);
+        }
+        if (tangent.w < 0.0f) {
+            frame = -frame;
+        }
+        int16_t value[4] = { PackSnorm16(frame.x), PackSnorm16(frame.y), PackSnorm16(frame.z), PackSnorm16(frame.w) };
+        WriteValue(out, value);
+    }
+    //------------------------------------------------------------------------------------------
+    void QTangentNormal::Decode(ModelVertex* out_vertex, glm::vec4* out_tangent, const uint8_t* data, const VertexEncodeParam&) {
+        glm::quat frame(UnpackSnorm16(ReadValue<int16_t>(data + 6)), UnpackSnorm16(ReadValue<int16_t>(data)),
+            UnpackSnorm16(ReadValue<int16_t>(data + 2)), UnpackSnorm16(ReadValue<int16_t>(data + 4)));
+        float sign = frame.w < 0.0f ? -1.0f : 1.0f;
+        frame = glm::normalize(frame);
+        out_vertex->normal = frame * glm::vec3(0, 0, 1);
+        *out_tangent = glm::vec4(frame * glm::vec3(1, 0, 0), sign);
+    }
+    //------------------------------------------------------------------------------------------
+    int QTangentNormal::GetElementList(VertexElement* out_list, uint32_t offset) {
+        return AddElement(out_list, kSemanticTangentFrame, kElementSnorm16x4, offset);
+    }
+
+    //-- Float2Uv --//
+    void Float2Uv::Encode(uint8_t* out, const ModelVertex& vertex, const glm::vec4&, const VertexEncodeParam&) {
+        WriteValue(out, vertex.uv);
+    }
+    //------------------------------------------------------------------------------------------
+    void Float2Uv::Decode(ModelVertex* out_vertex, glm::vec4*, const uint8_t* data, const VertexEncodeParam&) {
+        out_vertex->uv = ReadValue<glm::vec2>(data);
+    }
+    //------------------------------------------------------------------------------------------
+    int Float2Uv::GetElementList(VertexElement* out_list, uint32_t offset) {
+        return AddElement(out_list, kSemanticTexcoord, kElementFloat2, offset);
+    }
+
+    //-- Half2Uv --//
+    void Half2Uv::Encode(uint8_t* out, const ModelVertex& vertex, const glm::vec4&, const VertexEncodeParam&) {
+        uint16_t half[2] = { FloatToHalf(vertex.uv.x), FloatToHalf(vertex.uv.y) };
+        WriteValue(out, half);
+    }
+    //------------------------------------------------------------------------------------------
+    void Half2Uv::Decode(ModelVertex* out_vertex, glm::vec4*, const uint8_t* data, const VertexEncodeParam&) {
+        out_vertex->uv = glm::vec2(HalfToFloat(ReadValue<uint16_t>(data)), HalfToFloat(ReadValue<uint16_t>(data + 2)));
+    }
+    //------------------------------------------------------------------------------------------
+    int Half2Uv::GetElementList(VertexElement* out_list, uint32_t offset) {
+        return AddElement(out_list, kSemanticTexcoord, kElementHalf2, offset);
+    }
+
+    //-- FloatSkin --//
+    void FloatSkin::Encode(uint8_t* out, const ModelVertex& vertex, const glm::vec4&, const VertexEncodeParam&) {
+        std::memcpy(out, vertex.boneIndex, 4);
+        WriteValue(out + 4, vertex.boneWeight);
+    }
+    //------------------------------------------------------------------------------------------
+    void FloatSkin::Decode(ModelVertex* out_vertex, glm::vec4*, const uint8_t* data, const VertexEncodeParam&) {
+        std::memcpy(out_vertex->boneIndex, data, 4);
+        out_vertex->boneWeight = ReadValue<glm::vec4>(data + 4);
+    }
+    //------------------------------------------------------------------------------------------
+    int FloatSkin::GetElementList(VertexElement* out_list, uint32_t offset) {
+        AddElement(out_list, kSemanticBoneIndex, kElementUint8x4, offset);
+        return 1 + AddElement(out_list + 1, kSemanticBoneWeight, kElementFloat4, offset + 4);
+    }
+
+    //-- Unorm16Skin --//
+    void Unorm16Skin::Encode(uint8_t* out, const ModelVertex& vertex, const glm::vec4&, const VertexEncodeParam&) {
+        uint32_t weight[4];
+        QuantizeWeight(weight, vertex.boneWeight, 0xffffu);
+        std::memcpy(out, vertex.boneIndex, 4);
+        for (int i = 0; i < 4; i++) {
+            WriteValue(out + 4 + i * 2, (uint16_t)weight[i]);
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    void Unorm16Skin::Decode(ModelVertex* out_vertex, glm::vec4*, const uint8_t* data, const VertexEncodeParam&) {
+        std::memcpy(out_vertex->boneIndex, data, 4);
+        for (int i = 0; i < 4; i++) {
+            out_vertex->boneWeight[i] = (float)ReadValue<uint16_t>(data + 4 + i * 2) / 65535.0f;
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    int Unorm16Skin::GetElementList(VertexElement* out_list, uint32_t offset) {
+        AddElement(out_list, kSemanticBoneIndex, kElementUint8x4, offset);
+        return 1 + AddElement(out_list + 1, kSemanticBoneWeight, kElementUnorm16x4, offset + 4);
+    }
+
+    //-- Unorm8Skin --//
+    void Unorm8Skin::Encode(uint8_t* out, const ModelVertex& vertex, const glm::vec4&, const VertexEncodeParam&) {
+        uint32_t weight[4];
+        QuantizeWeight(weight, vertex.boneWeight, 0xffu);
+        std::memcpy(out, vertex.boneIndex, 4);
+        for (int i = 0; i < 4; i++) {
+            out[4 + i] = (uint8_t)weight[i];
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    void Unorm8Skin::Decode(ModelVertex* out_vertex, glm::vec4*, const uint8_t* data, const VertexEncodeParam&) {
+        std::memcpy(out_vertex->boneIndex, data, 4);
+        for (int i = 0; i < 4; i++) {
+            out_vertex->boneWeight[i] = (float)data[4 + i] / 255.0f;
+        }
+    }
+    //------------------------------------------------------------------------------------------
+    int Unorm8Skin::GetElementList(VertexElement* out_list, uint32_t offset) {
+        AddElement(out_list, kSemanticBoneIndex, kElementUint8x4, offset);
+        return 1 + AddElement(out_list + 1, kSemanticBoneWeight, kElementUnorm8x4, offset + 4);
+    }
+    //------------------------------------------------------------------------------------------
+    VertexEncodeParam MakeVertexEncodeParam(const ModelMesh& mesh) {
+        VertexEncodeParam param;
+        auto vertex_list = mesh.GetVertexSpan();
+        if (vertex_list.size() == 0) {
+            return param;
+        }
+        glm::vec3 min_position = vertex_list[0].position;
+        glm::vec3 max_position = vertex_list[0].position;
+        for (const auto& vertex : vertex_list) {
+            min_position = glm::min(min_position, vertex.position);
+            max_position = glm::max(max_position, vertex.position);
+        }
+        param.positionMin = min_position;
+        for (int i = 0; i < 3; i++) {
+            float extent = max_position[i] - min_position[i];
+            param.positionExtent[i] = extent > 0.0f ? extent : 1.0f;
+        }
+        return param;
+    }
+    //------------------------------------------------------------------------------------------
+} // fbx
@@ -0,0 +1,137 @@
+﻿#include "../include/weld.h"
+#include "../include/arena.h"
+
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+#include <limits>
+
+namespace fbx {
+
+    namespace {
+        //int32に入らない値(NaNも)をそのまま変換すると未定義なので、範囲の端にそろえる。端の値どうしは同じ頂点とみなされる
+        uint32_t Quantize(float value, float epsilon) {
+            float scaled = std::floor(value / epsilon + 0.5f);
+            if (!(scaled > -2147483648.0f)) {
+                return (uint32_t)std::numeric_limits<int32_t>::min();
+            }
+            if (scaled >= 2147483648.0f) {
+                return (uint32_t)std::numeric_limits<int32_t>::max();
+            }
+            return (uint32_t)(int32_t)scaled;
+        }
+
+        void QuantizeWords(uint32_t* word, size_t offset, const float* value, int count, float epsilon) {
+            if (epsilon <= 0.0f) {
+                return;
+            }
+            for (int i = 0; i < count; i++) {
+                word[offset / 4 + i] = Quantize(value[i], epsilon);
+            }
+        }
+
+        uint32_t Rotl(uint32_t x, int r) {
+            return (x << r) | (x >> (32 - r));
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    uint32_t HashWeldKey(const uint32_t* word, size_t word_count) {
+        uint32_t h = 0x9747b28cu;
+        for (size_t i = 0; i < word_count; i++) {
+            uint32_t k = word[i];
+            k *= 0xcc9e2d51u;
+            k = Rotl(k, 15);
+            k *= 0x1b873593u;
+            h ^= k;
+            h = Rotl(h, 13);
+            h = h * 5 + 0xe6546b64u;
+        }
+        h ^= (uint32_t)(word_count * 4);
+        h ^= h >> 16;
+        h *= 0x85ebca6bu;
+        h ^= h >> 13;
+        h *= 0xc2b2ae35u;
+        h ^= h >> 16;
+        return h;
+    }
+    //------------------------------------------------------------------------------------------
+    size_t GetWeldTableCapacity(size_t vertex_count) {
+        size_t capacity = 16;
+        while (capacity < vertex_count * 2) {
+            capacity <<= 1;
+        }
+        return capacity;
+    }
+    //------------------------------------------------------------------------------------------
+    void ModelVertexWeldKey::operator()(uint32_t* out_word, const ModelVertex& vertex) const {
+        std::memcpy(out_word, &vertex, sizeof(ModelVertex));
+        QuantizeWords(out_word, offsetof(ModelVertex, position), &vertex.position.x, 3, option.positionEpsilon);
+        QuantizeWords(out_word, offsetof(ModelVertex, normal), &vertex.normal.x, 3, option.normalEpsilon);
+        QuantizeWords(out_word, offsetof(ModelVertex, uv), &vertex.uv.x, 2, option.uvEpsilon);
+    }
+
+    //-- VertexWelder Class --//
+    VertexWelder::VertexWelder(size_t max_vertex_count, const WeldOption& option)
+        : BasicVertexWelder(max_vertex_count, ModelVertexWeldKey{ option }) {
+    }
+    //------------------------------------------------------------------------------------------
+    void VertexWelder::Store(ModelMesh* mesh) const {
+        const auto& vertex_list = this->GetVertexList();
+        const auto& index_list = this->GetIndexList();
+        mesh->vertexList.assign(vertex_list.begin(), vertex_list.end());
+        mesh->indexList.clear();
+        mesh->indexList32.clear();
+        if (mesh->vertexList.size() > 0xffff) {
+            //unsigned shortに収まらないので32bitのまま持つ
+            mesh->indexList32.assign(index_list.begin(), index_list.end());
+        }
+        else {
+            mesh->indexList.reserve(index_list.size());
+            for (auto index : index_list) {
+                mesh->indexList.push_back((unsigned short)index);
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------------------
+    void WeldVertices(std::vector<ModelVertex>* out_vertex_list, std::vector<unsigned int>* out_index_list, const std::vector<ModelVertex>& vertex_list, const WeldOption& option) {
+        VertexWelder welder(vertex_list.size(), option);
+        for (const auto& vertex : vertex_list) {
+            welder.Add(vertex);
+        }
+        out_vertex_list->assign(welder.GetVertexList().begin(), welder.GetVertexList().end());
+        out_index_list->assign(welder.GetIndexList().begin(), welder.GetIndexList().end());
+    }
+    //------------------------------------------------------------------------------------------
+    void WeldVertices(ModelMesh* mesh, const ModelVertex* vertex_list, size_t vertex_count, const WeldOption& option) {
+        VertexWelder welder(vertex_count, option);
+        for (size_t i = 0; i < vertex_count; i++) {
+            welder.Add(vertex_list[i]);
+        }
+        welder.Store(mesh);
+    }
+    //------------------------------------------------------------------------------------------
+    void WeldVertices(ModelMesh* mesh, const std::vector<ModelVertex>& vertex_list, const WeldOption& option) {
+        WeldVertices(mesh, vertex_list.data(), vertex_list.size(), option);
+    }
+    //------------------------------------------------------------------------------------------
+    void WeldVerticesLinearSearch(std::vector<ModelVertex>* out_vertex_list, std::vector<unsigned int>* out_index_list, const std::vector<ModelVertex>& vertex_list) {
+        out_vertex_list->clear();
+        out_index_list->clear();
+        out_vertex_list->reserve(vertex_list.size());
+        out_index_list->reserve(vertex_list.size());
+
+        for (auto& vertex : vertex_list) {
+            auto it = std::find(out_vertex_list->begin(), out_vertex_list->end(), vertex);
+            if (it == out_vertex_list->end()) {
+                out_index_list->push_back((unsigned int)out_vertex_list->size());
+                out_vertex_list->push_back(vertex);
+            }
+            else {
+                out_index_list->push_back((unsigned int)std::distance(out_vertex_list->begin(), it));
+            }
+        }
+    }
+    //------------------------------------------------------------------------------------------
+} // fbx